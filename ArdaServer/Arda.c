@@ -28,6 +28,10 @@
 #define MIN_N_ARGS				2
 #define N_MSG_FILE_PATH			"./totalMessages.txt"
 #define N_MSG_EOF				'#'
+#define OPTION_SEPARATOR		'='
+#define BLOB_CACHE_OPTION		"blob_cache"
+#define BYTES_PER_MB			(1024LL * 1024)
+#define UNKNOWN_OPTION_MSG		"WARNING: Unknown option %s in the configuration file\n"
 
 Arda arda;
 Server server;
@@ -88,9 +92,42 @@ Arda newArda() {
 	arda.directory = NULL;
     arda.port = 0;
 	arda.ip_address = NULL;
+	arda.blob_cache = 0;
 	return (arda);
 }
 
+/*********************************************************************
+* @Purpose: Reads an optional setting (key=value) of the configuration
+*           file.
+* @Params: in: line = string with the option
+*          in/out: arda = pointer to Arda to configure
+* @Return: ----
+*********************************************************************/
+void readArdaOption(char *line, Arda *arda) {
+	char *buffer = NULL;
+	char *value = strchr(line, OPTION_SEPARATOR);
+
+	if (NULL != value) {
+	    *value = '\0';
+		value++;
+
+		if ((0 == strcmp(line, BLOB_CACHE_OPTION)) && (atoll(value) >= 0)) {
+		    // MB of the blobs uploaded by the sons kept in the directory (0 = disabled)
+			arda->blob_cache = atoll(value) * BYTES_PER_MB;
+			return;
+		}
+
+		*(value - 1) = OPTION_SEPARATOR;
+	}
+
+	asprintf(&buffer, UNKNOWN_OPTION_MSG, line);
+	printMsg(COLOR_RED_TXT);
+	printMsg(buffer);
+	printMsg(COLOR_DEFAULT_TXT);
+	free(buffer);
+	buffer = NULL;
+}
+
 /*********************************************************************
 * @Purpose: Reads an Arda from a given file.
 * @Params: in: filename = string with the name of the file
@@ -113,6 +150,14 @@ int readArda(char *filename, Arda *arda) {
 		free(buffer);
 		// directory
 		arda->directory = SHAREDFUNCTIONS_readUntil(fd, END_OF_LINE);
+
+		// optional settings
+		while (NULL != (buffer = SHAREDFUNCTIONS_readUntil(fd, END_OF_LINE))) {
+		    readArdaOption(buffer, arda);
+			free(buffer);
+			buffer = NULL;
+		}
+
 		// no errors
 		error = ARDA_OK;
 		close(fd);
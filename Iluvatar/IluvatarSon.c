@@ -3,7 +3,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 07/10/2022
-* @Last change: 09/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #define _GNU_SOURCE 1
 #include <stdio.h>
@@ -23,20 +23,40 @@
 #include "../icp.h"
 #include "../client.h"
 #include "../semaphore_v2.h"
+#include "transfer.h"
 
 #define MIN_N_ARGS 					2
 #define WELCOME_MSG 				"\n%sWelcome %s, son of Iluvatar\n"
 #define ARDA_CONNECTION_DENIED_MSG	"Connection denied by server\n"
 #define ILUVATARSON_OK				0
 #define ILUVATARSON_KO				-1
+#define OPTION_SEPARATOR			'='
+#define DURABILITY_OPTION			"durability"
+#define SYNC_INTERVAL_OPTION		"sync_interval"
+#define RATE_LIMIT_OPTION			"rate_limit"
+#define PEER_RATE_LIMIT_OPTION		"peer_rate_limit"
+#define TRANSFER_RATE_LIMIT_OPTION	"transfer_rate_limit"
+#define COMPRESSION_OPTION			"compression"
+#define PUBLISH_OPTION				"publish"
+#define LOCAL_DELIVERY_OPTION		"local_delivery"
+#define QUEUE_DEPTH_OPTION			"queue_depth"
+#define QUEUE_MSG_SIZE_OPTION		"queue_msg_size"
+#define LOCAL_TRANSPORT_OPTION		"local_transport"
+#define UNKNOWN_OPTION_MSG			"WARNING: Unknown option %s in the configuration file\n"
+#define BYTES_PER_MB				1048576
+#define BYTES_PER_KB				1024
 
 IluvatarSon iluvatarSon;
 char *iluvatar_command = NULL;
 BidirectionalList users_list;
 Client client;
 Server server;
-semaphore sem_mq;			// synchronization semaphore to wait for qfd answers when file sent
+TransferTable transfers;
 mqd_t qfd;
+ShmRing ring;				// ring in shared memory for the data of the files sent in this machine
+int fd_socket = -1;			// socket to receive the file descriptors of the files sent in this machine
+int fd_bus = -1;			// readable when the bus of this machine has new messages
+IcpStreams streams;			// files being received through the queue
 pthread_t thread_accept;
 pthread_mutex_t mutex_print = PTHREAD_MUTEX_INITIALIZER;
 
@@ -49,6 +69,8 @@ pthread_mutex_t mutex_print = PTHREAD_MUTEX_INITIALIZER;
 void disconnectionManager() {
 	char *buffer = NULL;
 
+	// stop the transfers in background
+	TRANSFER_close(&transfers);
 	// close thread
 	pthread_cancel(thread_accept);
 	pthread_join(thread_accept, NULL);
@@ -57,8 +79,19 @@ void disconnectionManager() {
 	mq_close(qfd);
 	asprintf(&buffer, "/%d", getpid());
 	mq_unlink(buffer);
-	// destroy semaphore
-	SEM_destructor(&sem_mq);
+	SHMRING_close(&ring);
+	ICP_closeStreams(&streams);
+	ICP_closeBus();
+	ICP_closeMsgSocket();
+	ICP_flushChannels(ICP_EXIT_WAIT_TIME, &mutex_print);
+	ICP_invalidateChannels();
+	FILEINDEX_free();
+
+	if (fd_socket >= 0) {
+	    close(fd_socket);
+		fd_socket = -1;
+	}
+
 	// free memory
 	free(buffer);
 	buffer = NULL;
@@ -74,10 +107,6 @@ void disconnectionManager() {
 	SERVER_close(&server);
 	free(server.thread);
 	close(client.server_fd);
-	
-	if (server.client_fd > 0) {
-		close(server.client_fd);
-	}
 
 	// reset command line
 	printMsg(COLOR_DEFAULT_TXT);
@@ -111,10 +140,121 @@ IluvatarSon newIluvatarSon() {
 	iluvatar.directory = NULL;
 	iluvatar.ip_address = NULL;
 	iluvatar.arda_ip_address = NULL;
+	iluvatar.write_policy.durability = DURABILITY_NONE;
+	iluvatar.write_policy.sync_bytes = DEFAULT_SYNC_BYTES;
+	iluvatar.write_policy.local_delivery = DELIVERY_CLONE;
+	iluvatar.rate_limits.global = 0;
+	iluvatar.rate_limits.peer = 0;
+	iluvatar.rate_limits.transfer = 0;
+	iluvatar.codec = CODEC_LZ;
+	iluvatar.publish = 0;
+	iluvatar.queue_depth = 0;
+	iluvatar.queue_msg_size = 0;
+	iluvatar.local_transport = LOCAL_TRANSPORT_AUTO;
+	SHAREDFUNCTIONS_getHostId(iluvatar.host_id);
 
 	return (iluvatar);
 }
 
+/*********************************************************************
+* @Purpose: Applies an optional "key=value" line of the configuration
+*           file.
+* @Params: in: line = string with the option
+*          in/out: iluvatar = pointer to IluvatarSon to configure
+* @Return: ----
+*********************************************************************/
+void readOption(char *line, IluvatarSon *iluvatar) {
+	char *buffer = NULL;
+	char *value = strchr(line, OPTION_SEPARATOR);
+
+	if (NULL != value) {
+	    *value = '\0';
+		value++;
+
+		if (0 == strcmp(line, DURABILITY_OPTION)) {
+		    // none (default), end (fdatasync before the file is accepted) or periodic
+			if (0 == strcmp(value, "end")) {
+			    iluvatar->write_policy.durability = DURABILITY_END;
+				return;
+			} else if (0 == strcmp(value, "periodic")) {
+			    iluvatar->write_policy.durability = DURABILITY_PERIODIC;
+				return;
+			} else if (0 == strcmp(value, "none")) {
+			    iluvatar->write_policy.durability = DURABILITY_NONE;
+				return;
+			}
+		} else if ((0 == strcmp(line, SYNC_INTERVAL_OPTION)) && (atoll(value) > 0)) {
+		    // MB written between two syncs of the periodic policy
+			iluvatar->write_policy.sync_bytes = atoll(value) * BYTES_PER_MB;
+			return;
+		} else if ((0 == strcmp(line, RATE_LIMIT_OPTION)) && (atoll(value) >= 0)) {
+		    // KB/s of all the transfers through the network (0 = unlimited)
+			iluvatar->rate_limits.global = atoll(value) * BYTES_PER_KB;
+			return;
+		} else if ((0 == strcmp(line, PEER_RATE_LIMIT_OPTION)) && (atoll(value) >= 0)) {
+		    // KB/s of all the transfers to the same user
+			iluvatar->rate_limits.peer = atoll(value) * BYTES_PER_KB;
+			return;
+		} else if ((0 == strcmp(line, TRANSFER_RATE_LIMIT_OPTION)) && (atoll(value) >= 0)) {
+		    // KB/s of every transfer
+			iluvatar->rate_limits.transfer = atoll(value) * BYTES_PER_KB;
+			return;
+		} else if (0 == strcmp(line, COMPRESSION_OPTION)) {
+		    // lz (default) offers and accepts compressed file data, none disables it
+			if (0 == strcmp(value, GPC_CODEC_LZ)) {
+			    iluvatar->codec = CODEC_LZ;
+				return;
+			} else if (0 == strcmp(value, GPC_CODEC_NONE)) {
+			    iluvatar->codec = CODEC_NONE;
+				return;
+			}
+		} else if (0 == strcmp(line, PUBLISH_OPTION)) {
+		    // yes publishes the content hashes of the directory to Arda, so GET FILE can download from this son
+			if ((0 == strcmp(value, "yes")) || (0 == strcmp(value, "no"))) {
+			    iluvatar->publish = (0 == strcmp(value, "yes"));
+				return;
+			}
+		} else if (0 == strcmp(line, LOCAL_DELIVERY_OPTION)) {
+		    // clone (default) copies the files sent in this machine sharing their blocks when the
+			// filesystem allows it, hardlink links them (both sons see the same file until it is replaced)
+			if ((0 == strcmp(value, "clone")) || (0 == strcmp(value, "hardlink"))) {
+			    iluvatar->write_policy.local_delivery = (0 == strcmp(value, "hardlink")) ? DELIVERY_HARDLINK : DELIVERY_CLONE;
+				return;
+			}
+		} else if ((0 == strcmp(line, QUEUE_DEPTH_OPTION)) && (atol(value) >= 0)) {
+		    // messages of the queue that receives from the sons of this machine (0 = system default)
+			iluvatar->queue_depth = atol(value);
+			return;
+		} else if ((0 == strcmp(line, QUEUE_MSG_SIZE_OPTION)) && (atol(value) >= 0)) {
+		    // bytes of every message of that queue (0 = system default)
+			iluvatar->queue_msg_size = atol(value);
+			return;
+		} else if (0 == strcmp(line, LOCAL_TRANSPORT_OPTION)) {
+		    // how the sons of this machine reach this one: auto (default) uses the fastest way available,
+			// queue sends everything through the queue and tcp makes them take it as a son of another machine
+			if (0 == strcmp(value, "auto")) {
+			    iluvatar->local_transport = LOCAL_TRANSPORT_AUTO;
+				return;
+			} else if (0 == strcmp(value, "queue")) {
+			    iluvatar->local_transport = LOCAL_TRANSPORT_QUEUE;
+				return;
+			} else if (0 == strcmp(value, "tcp")) {
+			    iluvatar->local_transport = LOCAL_TRANSPORT_TCP;
+				return;
+			}
+		}
+
+		*(value - 1) = OPTION_SEPARATOR;
+	}
+
+	asprintf(&buffer, UNKNOWN_OPTION_MSG, line);
+	printMsg(COLOR_RED_TXT);
+	printMsg(buffer);
+	printMsg(COLOR_DEFAULT_TXT);
+	free(buffer);
+	buffer = NULL;
+}
+
 /*********************************************************************
 * @Purpose: Reads an IluvatarSon from a given file.
 * @Params: in: filename = string with the name of the file
@@ -146,6 +286,15 @@ int readIluvatarSon(char *filename, IluvatarSon *iluvatar) {
 		buffer = SHAREDFUNCTIONS_readUntil(fd, END_OF_LINE);
 		iluvatar->port = atoi(buffer);
 		free(buffer);
+		buffer = NULL;
+
+		// optional settings
+		while (NULL != (buffer = SHAREDFUNCTIONS_readUntil(fd, END_OF_LINE))) {
+		    readOption(buffer, iluvatar);
+			free(buffer);
+			buffer = NULL;
+		}
+
 		// no errors
 		error = ILUVATARSON_OK;
 		close(fd);
@@ -166,9 +315,10 @@ char connectToArda() {
 	char type = 0x07;
 
 	// notify connection to Arda
-	asprintf(&buffer, "%s%c%s%c%d%c%d", iluvatarSon.username, GPC_DATA_SEPARATOR,
-	                                    iluvatarSon.ip_address, GPC_DATA_SEPARATOR,
-										iluvatarSon.port, GPC_DATA_SEPARATOR, getpid());
+	asprintf(&buffer, "%s%c%s%c%d%c%d%c%s", iluvatarSon.username, GPC_DATA_SEPARATOR,
+	                                        iluvatarSon.ip_address, GPC_DATA_SEPARATOR,
+											iluvatarSon.port, GPC_DATA_SEPARATOR, getpid(),
+											GPC_DATA_SEPARATOR, iluvatarSon.host_id);
 	// check frame
 	if (GCP_FRAME_OK == GCP_checkFrameFormat(GCP_CONNECT_TYPE, GCP_CONNECT_HEADER, buffer)) {
 	    GPC_writeFrame(client.server_fd, GCP_CONNECT_TYPE, GCP_CONNECT_HEADER, buffer, strlen(buffer));
@@ -211,8 +361,15 @@ char connectToArda() {
 	header = NULL;
 	// update list of users
 	GPC_updateUsersList(&users_list, buffer);
+	COMMANDS_updateRoutes(&users_list, &iluvatarSon);
 	free(buffer);
 	buffer = NULL;
+
+	// the other sons can download the contents of the directory from now on
+	if (iluvatarSon.publish) {
+	    SWARM_publishInventory(client.server_fd, iluvatarSon.username, iluvatarSon.directory);
+	}
+
 	return (0);
 }
 
@@ -260,7 +417,7 @@ int manageUserPrompt() {
 	
 	// execute command
 	if (NULL != iluvatar_command) {
-		is_exit = COMMANDS_executeCommand(iluvatar_command, &iluvatarSon, client.server_fd, &users_list, &mutex_print);
+		is_exit = COMMANDS_executeCommand(iluvatar_command, &iluvatarSon, client.server_fd, &users_list, &transfers, &mutex_print);
 		free(iluvatar_command);
 		iluvatar_command = NULL;
 	}
@@ -272,84 +429,118 @@ int manageUserPrompt() {
 }
 
 /*********************************************************************
-* @Purpose: Gets an ICP frame sent between IluvatarSons in the same
-*           machine.
-* @Params: in/out: attr = attributes of the message queue
+* @Purpose: Shows or saves an ICP frame sent by another IluvatarSon in
+*           the same machine.
+* @Params: in/out: frame = frame received (freed)
+*          in: n = number of bytes of the frame
+*          in/out: shown = whether the command line has to be reopened
 * @Return: Returns 0 if no errors occurred, otherwise 1.
 *********************************************************************/
-char getLocalFrame(struct mq_attr *attr) {
-	char *frame = NULL;
+char manageLocalFrame(char **frame, int n, char *shown) {
 	char *type = NULL;
 	char *buffer = NULL;
-	int n = 0;
+	char error = 0;
 
-	// reset command line
-	pthread_mutex_lock(&mutex_print);
-	printMsg(COLOR_DEFAULT_TXT);
-	pthread_mutex_unlock(&mutex_print);
-	// get ICP frame
-	frame = (char *) malloc((attr->mq_msgsize + 1) * sizeof(char));
-	n = mq_receive(qfd, frame, attr->mq_msgsize, NULL);
-		
-	if (-1 == n) {
+	// the fragments of the files only touch the command line when a file ends
+	if ((n >= (int) sizeof(IcpChunkHeader)) && (0 == strcmp(*frame, ICP_CHUNK_TYPE))) {
+	    if (ICP_receiveChunk(*frame, n, &streams, iluvatarSon.directory, &mutex_print)) {
+		    *shown = 1;
+		}
+
+		free(*frame);
+		*frame = NULL;
+		return (0);
+	}
+
+	// reset command line once for the whole batch
+	if (!*shown) {
+	    pthread_mutex_lock(&mutex_print);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(&mutex_print);
+		*shown = 1;
+	}
+
+	buffer = strdup(*frame);
+	type = strtok(buffer, "&");
+
+	if ((NULL != type) && (strcmp(type, "msg") == 0)) {
+	    // show received message
+		ICP_receiveMsg(*frame, &mutex_print);
+	} else if ((NULL != type) && (strcmp(type, ICP_PACK_TYPE) == 0)) {
+	    // several messages sent while the queue was full
+		ICP_receivePack(*frame, n, &mutex_print);
+	} else if ((NULL != type) && (strcmp(type, "file") == 0)) {
+		// save received file
+		if (ICP_READ_FRAME_ERROR == ICP_receiveFile(frame, iluvatarSon.directory, &iluvatarSon.write_policy, &streams, &ring, fd_socket, &mutex_print)) {
+		    error = 1;
+		}
+	} else {
 		pthread_mutex_lock(&mutex_print);
 		printMsg(COLOR_RED_TXT);
-		printMsg(ERROR_RECEIVING_MSG_MSG);
+		printMsg("ERROR: Unknown message type\n");
 		printMsg(COLOR_DEFAULT_TXT);
 		pthread_mutex_unlock(&mutex_print);
-		// free memory
-		free(frame);
-		frame = NULL;
-		return (1);
-	} else {
-		buffer = strdup(frame);
-		type = strtok(buffer, "&");
-
-		if (strcmp(type, "msg") == 0) {
-		    // show received message
-			ICP_receiveMsg(frame, &mutex_print);
-		} else if (strcmp(type, "file") == 0) {
-			// save received file
-			if (ICP_READ_FRAME_ERROR == ICP_receiveFile(&frame, iluvatarSon.directory, attr, qfd, getpid(), &mutex_print)) {
-			    // free memory
-				if (NULL != frame) {
-				    free(frame);
-				    frame = NULL;
-				}
-				
-				if (NULL != buffer) {
-				    free(buffer);
-				    buffer = NULL;
-				}
+	}
 
-				// reopen command line
-				openCLI();
-				return (1);
+	// free memory
+	if (NULL != *frame) {
+	    free(*frame);
+		*frame = NULL;
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Gets the ICP frames sent between IluvatarSons in the same
+*           machine. Every frame waiting in the queue is read (without
+*           blocking) and the command line is reopened once for all of
+*           them.
+* @Params: in/out: attr = attributes of the message queue
+* @Return: Returns 0 if no errors occurred, otherwise 1.
+*********************************************************************/
+char getLocalFrame(struct mq_attr *attr) {
+	char *frame = NULL;
+	char shown = 0;
+	char error = 0;
+	int n = 0;
+	int i = 0;
+
+	// at most a full queue per wake up, so a file sent through the queue does not
+	// keep the commands of the user waiting
+	for (i = 0; (i < attr->mq_maxmsg) && (0 == error); i++) {
+	    frame = (char *) malloc((attr->mq_msgsize + 1) * sizeof(char));
+		n = mq_receive(qfd, frame, attr->mq_msgsize, NULL);
+
+		if (-1 == n) {
+		    free(frame);
+			frame = NULL;
+
+			// the queue is empty
+			if (EAGAIN == errno) {
+			    break;
 			}
-		} else {
+
 			pthread_mutex_lock(&mutex_print);
 			printMsg(COLOR_RED_TXT);
-			printMsg("ERROR: Unknown message type\n");
+			printMsg(ERROR_RECEIVING_MSG_MSG);
 			printMsg(COLOR_DEFAULT_TXT);
 			pthread_mutex_unlock(&mutex_print);
+			return (1);
 		}
-	
-		// reopen command line
-		openCLI();
-	}
 
-	// free memory
-	if (NULL != frame) {
-	    free(frame);
-		frame = NULL;
+		error = manageLocalFrame(&frame, n, &shown);
 	}
 
-	if (NULL != buffer) {
-	    free(buffer);
-		buffer = NULL;
+	// reopen command line
+	if (shown) {
+	    openCLI();
 	}
 
-	return (0);
+	return (error);
 }
 
 /*********************************************************************
@@ -360,17 +551,19 @@ char getLocalFrame(struct mq_attr *attr) {
 *********************************************************************/
 int main(int argc, char* argv[]) {
 	struct mq_attr attr;
+	FileIndex index;
     char *buffer = NULL;
 	int exit_program = 0, read_ok = ILUVATARSON_KO;
 	char *header = NULL;
+	char *has_list = NULL;
 	fd_set read_fds;
+	struct timeval timeout;
 
 	iluvatarSon = newIluvatarSon();
+	transfers = TRANSFER_init();
+	streams = ICP_initStreams();
 	// Configure SIGINT
 	signal(SIGINT, sigintHandler);
-	// Init synchronization semaphore for message queue
-	SEM_constructor_with_name(&sem_mq, getpid());
-	SEM_init(&sem_mq, 0);
 
 	// check args
 	if (MIN_N_ARGS != argc) {
@@ -400,6 +593,16 @@ int main(int argc, char* argv[]) {
 			return (-1);
 		}
 
+		SCHEDULER_setLimits(&transfers.scheduler, &iluvatarSon.rate_limits);
+
+		// a son reached through TCP announces a machine of its own
+		if (LOCAL_TRANSPORT_TCP == iluvatarSon.local_transport) {
+		    SHAREDFUNCTIONS_getProcessHostId(iluvatarSon.host_id);
+		}
+
+		// the index is synchronized with the directory once, the files received later only check the entries they use
+		index = FILEINDEX_open(iluvatarSon.directory, FILEINDEX_REFRESH);
+		FILEINDEX_close(iluvatarSon.directory, &index);
 		users_list = BIDIRECTIONALLIST_create();
 		// Open active socket (connection with Arda)
 		client = CLIENT_init(iluvatarSon.arda_ip_address, iluvatarSon.arda_port);
@@ -443,10 +646,14 @@ int main(int argc, char* argv[]) {
 
 		// From here, iluvatarSon has more than one thread, so we need to protect the STDIN
 		// Create queue
-		asprintf(&buffer, "/%d", getpid());
-		qfd = mq_open(buffer, O_RDWR | O_CREAT | O_EXCL, 0600, NULL);
-		free(buffer);
-		buffer = NULL;
+		qfd = ICP_createQueue(iluvatarSon.queue_depth, iluvatarSon.queue_msg_size, &mutex_print);
+
+		if (LOCAL_TRANSPORT_AUTO == iluvatarSon.local_transport) {
+		    // the messages to all the users of this machine come through the bus
+			fd_bus = ICP_openBus(iluvatarSon.arda_ip_address, iluvatarSon.arda_port);
+			// and the messages to a single user, through its socket
+			ICP_openMsgSocket();
+		}
 
 		if (qfd == (mqd_t) -1) {  
 			pthread_mutex_lock(&mutex_print);
@@ -461,6 +668,12 @@ int main(int argc, char* argv[]) {
 		// get attributes of the queue
 		mq_getattr(qfd, &attr);
 
+		// without the socket or the ring, the files are received through the queue
+		if (LOCAL_TRANSPORT_AUTO == iluvatarSon.local_transport) {
+		    fd_socket = FDPASS_open();
+			SHMRING_create(&ring);
+		}
+
 		// welcome user
 		asprintf(&buffer, WELCOME_MSG, COLOR_DEFAULT_TXT, iluvatarSon.username);
 		pthread_mutex_lock(&mutex_print);
@@ -480,8 +693,19 @@ int main(int argc, char* argv[]) {
 			FD_SET(client.server_fd, &read_fds);
 			FD_SET(qfd, &read_fds);
 
+			if (fd_bus >= 0) {
+			    FD_SET(fd_bus, &read_fds);
+			}
+
+			ICP_setMsgSockets(&read_fds);
+
+			// the messages packed while a queue was full are sent when it has room
+			ICP_flushChannels(0, &mutex_print);
+			timeout.tv_sec = 0;
+			timeout.tv_usec = ICP_FLUSH_TIME;
+
 			// wait for input
-			if (select(MAX_FD_SET_SIZE, &read_fds, NULL, NULL, NULL) < 0) {
+			if (select(MAX_FD_SET_SIZE, &read_fds, NULL, NULL, ICP_hasPendingMsgs() ? &timeout : NULL) < 0) {
 				pthread_mutex_lock(&mutex_print);
 				printMsg(COLOR_RED_TXT);
 				printMsg(ERROR_SELECT_MSG);
@@ -490,13 +714,32 @@ int main(int argc, char* argv[]) {
 				exit_program = 1;
 			} else if (FD_ISSET(client.server_fd, &read_fds)) {				
 				// Arda server replied to sent frame
-				exit_program = CLIENT_manageArdaServerAnswer(&client, &users_list, &mutex_print);
+				exit_program = CLIENT_manageArdaServerAnswer(&client, &users_list, &has_list, &mutex_print);
+
+				// Arda answered who holds the content of a GET FILE
+				if (NULL != has_list) {
+				    COMMANDS_getFile(&has_list, &iluvatarSon, &transfers, &mutex_print);
+				} else {
+				    // the users have changed, the queues kept open may belong to sons that left
+					COMMANDS_updateRoutes(&users_list, &iluvatarSon);
+					ICP_invalidateChannels();
+				}
 			} else if (FD_ISSET(STDIN_FILENO, &read_fds)) {
 				// reads and executes the command, then prepares the prompt for next command
 				exit_program = manageUserPrompt();
+			} else if (ICP_isMsgSocketSet(&read_fds)) {
+			    // messages of other Iluvatars in same machine, before the frames queued after them
+				if (ICP_receiveSocketMsgs(&read_fds, &mutex_print)) {
+				    openCLI();
+				}
 			} else if (FD_ISSET(qfd, &read_fds)) {
 				// received message or file from another Iluvatar in same machine
 				exit_program = getLocalFrame(&attr);
+			} else if ((fd_bus >= 0) && FD_ISSET(fd_bus, &read_fds)) {
+			    // message to all the users published by another Iluvatar in same machine
+				if (ICP_receiveBus(&mutex_print)) {
+				    openCLI();
+				}
 			}
 
 			if (header != NULL) {
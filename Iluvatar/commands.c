@@ -4,7 +4,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 07/10/2022
-* @Last change: 09/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "commands.h"
 
@@ -82,9 +82,46 @@ int getCmdArgs(char *input, char ***args) {
 int identifyCommand(char **args, int n_args, pthread_mutex_t *mutex) {
     char *concat_args = NULL;
 
-	if (EXIT_N_ARGS == n_args) {
+	if (0 == strcasecmp(args[0], CANCEL_CMD)) {
+	    if (n_args != CANCEL_N_ARGS) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(ERROR_CANCEL_ARGS);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			return (ERROR_CMD_ARGS);
+		}
+
+		return (IS_CANCEL_CMD);
+	} else if (0 == strcasecmp(args[0], SYNC_CMD)) {
+	    // the subdirectory is sent inside a frame, so it cannot have its separator
+		if ((n_args != SYNC_N_ARGS) || (NULL != strchr(args[2], GPC_DATA_SEPARATOR)) || !SHAREDFUNCTIONS_isInsideDirectory(args[2])) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(ERROR_SYNC_ARGS);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			return (ERROR_CMD_ARGS);
+		}
+
+		return (IS_SYNC_CMD);
+	} else if (0 == strcasecmp(args[0], UPLOAD_CMD)) {
+	    // the name is sent inside a frame, so it cannot have its separator
+		if ((n_args != UPLOAD_N_ARGS) || (NULL != strchr(args[1], GPC_DATA_SEPARATOR)) || !SHAREDFUNCTIONS_isInsideDirectory(args[1])) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(ERROR_UPLOAD_ARGS);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			return (ERROR_CMD_ARGS);
+		}
+
+		return (IS_UPLOAD_CMD);
+	} else if (EXIT_N_ARGS == n_args) {
 	    if (0 == strcasecmp(args[0], EXIT_CMD)) {
 		    return (IS_EXIT_CMD);
+		} else if (0 == strcasecmp(args[0], TRANSFERS_CMD)) {
+		    return (IS_TRANSFERS_CMD);
 		} else {
 		    return (IS_NOT_CUSTOM_CMD);
 		}
@@ -132,6 +169,20 @@ int identifyCommand(char **args, int n_args, pthread_mutex_t *mutex) {
 
 		    free(concat_args);
 		    return (IS_SEND_MSG_CMD);
+		} else if (0 == strcasecmp(concat_args, GET_FILE_CMD)) {
+		    // the hash is sent inside a frame, so it cannot have its separators
+			if ((n_args != GET_FILE_N_ARGS) || (NULL != strchr(args[2], GPC_DATA_SEPARATOR)) || (NULL != strchr(args[2], GPC_USERS_SEPARATOR))) {
+			    pthread_mutex_lock(mutex);
+				printMsg(COLOR_RED_TXT);
+				printMsg(ERROR_GET_FILE_ARGS);
+				printMsg(COLOR_DEFAULT_TXT);
+				pthread_mutex_unlock(mutex);
+				free(concat_args);
+				return (ERROR_CMD_ARGS);
+			}
+
+			free(concat_args);
+		    return (IS_GET_FILE_CMD);
 		} else if (0 == strcasecmp(concat_args, SEND_FILE_CMD)) {
 		    if (n_args != SEND_FILE_N_ARGS) {
 			    // print error msg
@@ -326,15 +377,20 @@ char socketsSendMsg(char *sender, Element e, char *msg, pthread_mutex_t *mutex)
 * @Params: in: iluvatar = iluvatar son.
 * 			in: e = element with the user to send the file.
 * 			in: filename = filename to send.
+* 			in: codec = codec offered to compress the data
+* 			in/out: control = progress and cancellation of the transfer
 * @Return: Returns 0 if the file was sent successfully, otherwise 1.
 *********************************************************************/
-char socketsSendFile(char *username, Element e, char *filename, char *directory, pthread_mutex_t *mutex) {
+char socketsSendFile(char *username, Element e, char *filename, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex) {
 	char *filename_path = NULL;
-	int file_size = 0;
+	struct stat st;
+	long long file_size = 0;
 	char *md5sum = NULL;
 	Client client;
+	TreeHash tree;
 	char *data = NULL;
 	int fd_file = FD_NOT_FOUND;
+	char ret_value = 0;
 
 	asprintf(&filename_path, ".%s/%s", directory, filename);
 	fd_file = open(filename_path, O_RDONLY);
@@ -356,8 +412,8 @@ char socketsSendFile(char *username, Element e, char *filename, char *directory,
 	}
 
 	// get file size
-	file_size = (int) lseek(fd_file, 0, SEEK_END);
-	lseek(fd_file, 0, SEEK_SET);
+	fstat(fd_file, &st);
+	file_size = st.st_size;
 
 	if (file_size == 0) {
 	    pthread_mutex_lock(mutex);
@@ -371,10 +427,18 @@ char socketsSendFile(char *username, Element e, char *filename, char *directory,
 		return (1);
 	}
 
-	// get MD5SUM
-	md5sum = SHAREDFUNCTIONS_getMD5Sum(filename_path);
+	// big files are hashed as a tree in parallel, and its leaves are kept to be sent with the data
+	tree.leaves = NULL;
+	tree.n_leaves = 0;
+
+	if ((file_size >= TREEHASH_MIN_FILE_SIZE) && (TREEHASH_OK == TREEHASH_compute(&tree, fd_file, file_size))) {
+	    md5sum = TREEHASH_getRoot(&tree);
+	} else {
+	    md5sum = SHAREDFUNCTIONS_getMD5Sum(filename_path);
+	}
+
 	// Prepare the data to send
-	asprintf(&data, "%s%c%s%c%d%c%s", username, GPC_DATA_SEPARATOR, filename, GPC_DATA_SEPARATOR, file_size, GPC_DATA_SEPARATOR, md5sum);
+	asprintf(&data, "%s%c%s%c%lld%c%s%c%s", username, GPC_DATA_SEPARATOR, filename, GPC_DATA_SEPARATOR, file_size, GPC_DATA_SEPARATOR, md5sum, GPC_DATA_SEPARATOR, GPC_getCodecName(codec));
 	free(md5sum);
 	md5sum = NULL;
 	free(filename_path);
@@ -383,27 +447,226 @@ char socketsSendFile(char *username, Element e, char *filename, char *directory,
 	if (data != NULL) {
 		// Open socket
 		client = CLIENT_init(e.ip_network, e.port);
-		// Check client
+		// Check client (the transfer fails, the IluvatarSon keeps running)
 		if (FD_NOT_FOUND == client.server_fd) {
 			close(fd_file);
 			free(data);
 			data = NULL;
-			raise(SIGINT);
+			TREEHASH_free(&tree);
+			return (1);
 		}
 
 		// Send file frames
-		return (CLIENT_sendFile(&client, &data, &fd_file, file_size, mutex));
+		ret_value = CLIENT_sendFile(&client, &data, &fd_file, file_size, &tree, control, mutex);
+		TREEHASH_free(&tree);
+		return (ret_value);
 	} else {
 	    pthread_mutex_lock(mutex);
 		printMsg(COLOR_RED_TXT);
 		printMsg(SEND_FILE_INVALID_FILE_ERROR);
 		printMsg(COLOR_DEFAULT_TXT);
 		pthread_mutex_unlock(mutex);
+		TREEHASH_free(&tree);
 	}
 
 	return (0);
 }
 
+/*********************************************************************
+* @Purpose: Gets the files to send when the argument of SEND FILE is a
+*           directory or a glob pattern.
+* @Params: in: directory = directory of the IluvatarSon
+*          in: file = argument of the command
+*          in/out: files = array to store the names of the files
+*                  (relative to the directory)
+* @Return: Returns the number of files, or NOT_A_BATCH if the argument
+*          is a single file.
+*********************************************************************/
+int getBatchFiles(char *directory, char *file, char ***files) {
+	char *path = NULL;
+	char *prefix = NULL;
+	struct stat st;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+	glob_t matches;
+	int n_files = 0;
+	size_t i = 0;
+
+	*files = NULL;
+	asprintf(&path, ".%s/%s", directory, file);
+
+	if ((0 == stat(path, &st)) && S_ISDIR(st.st_mode)) {
+	    // every regular file of the directory (hidden ones are internal)
+		dir = opendir(path);
+
+		while ((NULL != dir) && (NULL != (entry = readdir(dir)))) {
+		    free(path);
+			path = NULL;
+			asprintf(&path, ".%s/%s/%s", directory, file, entry->d_name);
+
+			if (('.' != entry->d_name[0]) && (0 == stat(path, &st)) && S_ISREG(st.st_mode)) {
+			    *files = (char **) realloc (*files, sizeof(char *) * (n_files + 1));
+				asprintf(&(*files)[n_files], "%s/%s", file, entry->d_name);
+				n_files++;
+			}
+		}
+
+		if (NULL != dir) {
+		    closedir(dir);
+		}
+	} else if (NULL != strpbrk(file, GLOB_CHARACTERS)) {
+	    // every regular file matching the pattern
+		asprintf(&prefix, ".%s/", directory);
+
+		if (0 == glob(path, 0, NULL, &matches)) {
+		    for (i = 0; i < matches.gl_pathc; i++) {
+			    if ((0 == stat(matches.gl_pathv[i], &st)) && S_ISREG(st.st_mode)) {
+				    *files = (char **) realloc (*files, sizeof(char *) * (n_files + 1));
+					(*files)[n_files] = strdup(matches.gl_pathv[i] + strlen(prefix));
+					n_files++;
+				}
+			}
+		}
+
+		globfree(&matches);
+		free(prefix);
+		prefix = NULL;
+	} else {
+	    n_files = NOT_A_BATCH;
+	}
+
+	free(path);
+	path = NULL;
+	return (n_files);
+}
+
+/*********************************************************************
+* @Purpose: Frees the names of the files of a batch.
+* @Params: in/out: files = array with the names of the files
+*          in: n_files = number of files
+* @Return: ----
+*********************************************************************/
+void freeBatchFiles(char ***files, int n_files) {
+	int i = 0;
+
+	for (i = 0; i < n_files; i++) {
+	    free((*files)[i]);
+		(*files)[i] = NULL;
+	}
+
+	if (NULL != *files) {
+	    free(*files);
+		*files = NULL;
+	}
+}
+
+/*********************************************************************
+* @Purpose: Builds the manifest of a batch hashing its files (the
+*           empty or unreadable ones are skipped).
+* @Params: in: filenames = names of the files to send
+* 		   in: n_files = number of files to send
+* 		   in: directory = directory of the files
+* 		   out: files = manifest of the batch (the names belong to
+* 		        filenames)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns the number of files of the manifest.
+*********************************************************************/
+int buildBatchManifest(char **filenames, int n_files, char *directory, BatchFile **files, pthread_mutex_t *mutex) {
+	char *buffer = NULL;
+	struct stat st;
+	int n_batch = 0, i = 0;
+
+	*files = (BatchFile *) malloc (sizeof(BatchFile) * n_files);
+
+	for (i = 0; i < n_files; i++) {
+	    asprintf(&buffer, ".%s/%s", directory, filenames[i]);
+		(*files)[n_batch].md5sum = NULL;
+
+		if ((0 == stat(buffer, &st)) && (0 < st.st_size)) {
+		    (*files)[n_batch].md5sum = TREEHASH_getFileHash(buffer, NULL, mutex);
+		}
+
+		free(buffer);
+		buffer = NULL;
+
+		if (NULL == (*files)[n_batch].md5sum) {
+		    asprintf(&buffer, SEND_FILE_SKIPPED_FILE_MSG, filenames[i]);
+			pthread_mutex_lock(mutex);
+			printMsg(buffer);
+			pthread_mutex_unlock(mutex);
+			free(buffer);
+			buffer = NULL;
+			continue;
+		}
+
+		(*files)[n_batch].filename = filenames[i];
+		(*files)[n_batch].file_size = (long long) st.st_size;
+		n_batch++;
+	}
+
+	return (n_batch);
+}
+
+/*********************************************************************
+* @Purpose: Frees the manifest of a batch.
+* @Params: in/out: files = manifest of the batch
+* 		   in: n_batch = number of files of the manifest
+* @Return: ----
+*********************************************************************/
+void freeBatchManifest(BatchFile **files, int n_batch) {
+	int i = 0;
+
+	// the filenames belong to the caller
+	for (i = 0; i < n_batch; i++) {
+	    free((*files)[i].md5sum);
+		(*files)[i].md5sum = NULL;
+	}
+
+	free(*files);
+	*files = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Sends a batch of files to a user using sockets.
+* @Params: in: username = user who sends the files
+* 		   in: e = element with the user to send the files
+* 		   in: filenames = names of the files to send
+* 		   in: n_files = number of files to send
+* 		   in: directory = directory of the files
+* 		   in: codec = codec offered to compress the data
+* 		   in/out: control = progress and cancellation of the transfer
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the files were sent successfully, otherwise 1.
+*********************************************************************/
+char socketsSendBatch(char *username, Element e, char **filenames, int n_files, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex) {
+	BatchFile *files = NULL;
+	Client client;
+	int n_batch = 0;
+	char ret_value = 1;
+
+	// the manifest is built hashing the files in process
+	n_batch = buildBatchManifest(filenames, n_files, directory, &files, mutex);
+
+	if (0 < n_batch) {
+		// Open socket
+		client = CLIENT_init(e.ip_network, e.port);
+
+		// Check client
+		if (FD_NOT_FOUND == client.server_fd) {
+		    freeBatchManifest(&files, n_batch);
+			return (1);
+		}
+
+		// Send all the files through the same connection
+		ret_value = CLIENT_sendBatch(&client, username, files, n_batch, directory, codec, control, mutex);
+	}
+
+	freeBatchManifest(&files, n_batch);
+	return (ret_value);
+}
+
 /*********************************************************************
 * @Purpose: Checks whether user is in the same machine as origin user.
 * @Params: in: origin_ip = string containing the IP of the origin user
@@ -434,6 +697,108 @@ char checkUserIP(char *origin_ip, char *destination_ip) {
 	return (IS_REMOTE_USER);
 }
 
+/*********************************************************************
+* @Purpose: Decides once how every user of the list is reached, so the
+*           commands do not resolve any address when they send. Two
+*           sons are in the same machine if they have the same host id;
+*           the hostnames of their IPs are only compared for the users
+*           registered without it.
+* @Params: in/out: users = list of users
+*          in: iluvatar = IluvatarSon that owns the list
+* @Return: ----
+*********************************************************************/
+void COMMANDS_updateRoutes(BidirectionalList *users, IluvatarSon *iluvatar) {
+	BidirectionalList routes = BIDIRECTIONALLIST_create();
+	Element e;
+
+	BIDIRECTIONALLIST_goToTail(&routes);
+
+	if (!BIDIRECTIONALLIST_isEmpty(*users)) {
+	    BIDIRECTIONALLIST_goToHead(users);
+
+		while (BIDIRECTIONALLIST_isValid(*users)) {
+		    e = BIDIRECTIONALLIST_get(users);
+
+			if (('\0' != e.host_id[0]) && ('\0' != iluvatar->host_id[0])) {
+			    e.route = (0 == strcmp(e.host_id, iluvatar->host_id)) ? IS_LOCAL_USER : IS_REMOTE_USER;
+			} else {
+			    e.route = checkUserIP(iluvatar->ip_address, e.ip_network);
+			}
+
+			BIDIRECTIONALLIST_addAfter(&routes, e);
+			// next user
+			free(e.username);
+			e.username = NULL;
+			free(e.ip_network);
+			e.ip_network = NULL;
+			BIDIRECTIONALLIST_next(users);
+		}
+	}
+
+	BIDIRECTIONALLIST_destroy(users);
+	*users = routes;
+}
+
+/*********************************************************************
+* @Purpose: Sends a message to all the other IluvatarSons. The ones of
+*           other machines get it through a socket each, and the ones
+*           of this machine through a single publish in the bus.
+* @Params: in: clients = list of users of the sender
+*		   in: message = string containing the message to send
+*		   in: origin_username = string containing the username of the
+*		       sender
+*		   in/out: mutex = screen mutex to prevent writing to screen
+*		           simultaneously
+* @Return: Returns SEND_MSG_OK if no errors occurred, otherwise
+*          SEND_MSG_KO.
+*********************************************************************/
+char sendMsgAllCommand(BidirectionalList clients, char *message, char *origin_username, pthread_mutex_t *mutex) {
+	Element e;
+	char *msg = NULL;
+	int *pids = NULL;
+	int n_pids = 0;
+	char error = 0;
+
+	if (!BIDIRECTIONALLIST_isEmpty(clients)) {
+	    BIDIRECTIONALLIST_goToHead(&clients);
+
+		while (BIDIRECTIONALLIST_isValid(clients)) {
+		    e = BIDIRECTIONALLIST_get(&clients);
+
+			if (IS_REMOTE_USER == e.route) {
+			    // the delimiters of the message are removed in place
+				msg = strdup(message);
+				error |= socketsSendMsg(origin_username, e, msg, mutex);
+				free(msg);
+				msg = NULL;
+			} else if (0 != strcmp(origin_username, e.username)) {
+			    pids = (int *) realloc(pids, sizeof(int) * (n_pids + 1));
+				pids[n_pids] = e.pid;
+				n_pids++;
+			}
+
+			// next user
+			free(e.username);
+			e.username = NULL;
+			free(e.ip_network);
+			e.ip_network = NULL;
+			BIDIRECTIONALLIST_next(&clients);
+		}
+	}
+
+	if (n_pids > 0) {
+	    error |= ICP_broadcastMsg(pids, n_pids, message, origin_username, mutex);
+	}
+
+	// free memory
+	if (NULL != pids) {
+	    free(pids);
+		pids = NULL;
+	}
+
+	return (error ? SEND_MSG_KO : SEND_MSG_OK);
+}
+
 /*********************************************************************
 * @Purpose: Send a message to another IluvatarSon.
 * @Params: in: clients = list of users of the sender
@@ -442,20 +807,24 @@ char checkUserIP(char *origin_ip, char *destination_ip) {
 *		   in: message = string containing the message to send
 *		   in: origin_username = string containing the username of the
 *		       sender
-*		   in: origin_ip = string with the IP address of the sender
 *		   in/out: mutex = screen mutex to prevent writing to screen
 *		           simultaneously
 * @Return: Returns SEND_MSG_OK if no errors occurred, otherwise
 *          SEND_MSG_KO.
 *********************************************************************/
-char sendMsgCommand(BidirectionalList clients, char *dest_username, char *message, char *origin_username, char *origin_ip, pthread_mutex_t *mutex) {
+char sendMsgCommand(BidirectionalList clients, char *dest_username, char *message, char *origin_username, pthread_mutex_t *mutex) {
 	Element e;
 	char *buffer = NULL;
 
+	// the message goes to every user
+	if (0 == strcmp(dest_username, ALL_USERS)) {
+	    return (sendMsgAllCommand(clients, message, origin_username, mutex));
+	}
+
 	// search destination user
 	if (USER_FOUND == searchUserInList(clients, dest_username, &e)) {
 		// check if remote user
-		if (IS_REMOTE_USER == checkUserIP(origin_ip, e.ip_network)) {
+		if (IS_REMOTE_USER == e.route) {
 		    // send message
 			if (0 != socketsSendMsg(origin_username, e, message, mutex)) {
 				// free memory
@@ -493,7 +862,7 @@ char sendMsgCommand(BidirectionalList clients, char *dest_username, char *messag
 			free(e.ip_network);
 			e.ip_network = NULL;
 
-			// send message
+			// send message (the fragments of the files in the queue carry their stream)
 			if (0 != ICP_sendMsg(e.pid, message, origin_username, mutex)) {
 			    return (SEND_MSG_KO);
 			}
@@ -517,68 +886,163 @@ char sendMsgCommand(BidirectionalList clients, char *dest_username, char *messag
 }
 
 /*********************************************************************
-* @Purpose: Send a file to another IluvatarSon.
+* @Purpose: Sends the files of a SEND FILE command (runs in a
+*           background transfer).
+* @Params: in/out: job = transfer whose arguments are a SendFileJob
+*                  (freed here)
+* @Return: Returns 0 if all the files were sent, otherwise 1.
+*********************************************************************/
+char sendFileJob(TransferJob *job) {
+	SendFileJob *args = (SendFileJob *) job->args;
+	Throttle throttle;
+	char error = 0;
+	int i = 0;
+
+	// the data of the transfer is paced by the rate limits
+	SCHEDULER_openThrottle(args->scheduler, &throttle, args->user.ip_network, args->user.port, args->remote);
+	job->control.throttle = &throttle;
+
+	if (args->remote) {
+	    // send file (or all the files of the batch through one connection)
+		if (args->batch) {
+		    error = socketsSendBatch(args->username, args->user, args->files, args->n_files, args->directory, args->codec, &job->control, args->mutex);
+		} else {
+		    error = socketsSendFile(args->username, args->user, args->files[0], args->directory, args->codec, &job->control, args->mutex);
+		}
+
+		job->files_done = error ? 0 : args->n_files;
+	} else {
+	    // the fragments carry the stream of the file, so other transfers to the same
+		// user go on at the same time; a file already started is never interrupted
+		for (i = 0; (i < args->n_files) && !job->control.cancel; i++) {
+		    if (0 == ICP_sendFile(args->user.pid, args->files[i], args->directory, args->username, &job->control, args->mutex)) {
+			    (job->files_done)++;
+			} else {
+			    error = 1;
+			}
+		}
+	}
+
+	// a cancelled transfer leaves files unsent
+	if (job->files_done < args->n_files) {
+	    error = 1;
+	}
+
+	job->control.throttle = NULL;
+
+	// free memory
+	freeBatchFiles(&args->files, args->n_files);
+	free(args->user.username);
+	args->user.username = NULL;
+	free(args->user.ip_network);
+	args->user.ip_network = NULL;
+	free(args->directory);
+	args->directory = NULL;
+	free(args->username);
+	args->username = NULL;
+	free(args);
+	job->args = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Send a file to another IluvatarSon. The files are sent by
+*           a background transfer, so the command returns at once.
 * @Params: in: clients = list of users of the sender
 *          in: dest_username = string containing the username of the
 *		       destination IluvatarSon
-*		   in: file = string containing the name of the file to send
+*		   in: file = string containing the name of the file to send, a
+*		       directory or a glob pattern
 *		   in: directory = string containing the directory of the file
 *		   in: origin_username = string containing the username of the
 *		       sender
-*		   in: origin_ip = string with the IP address of the sender
+*		   in: codec = codec offered to compress the data
+*		   in/out: transfers = table of background transfers
 *		   in/out: mutex = screen mutex to prevent writing to screen
 *		           simultaneously
 * @Return: ----
 *********************************************************************/
 void sendFileCommand(BidirectionalList clients, char *dest_username, char *file, char *directory,
-                     char *origin_username, char *origin_ip, pthread_mutex_t *mutex) {
+                     char *origin_username, char codec, TransferTable *transfers, pthread_mutex_t *mutex) {
+	SendFileJob *args = NULL;
 	Element e;
 	char *buffer = NULL;
+	char **files = NULL;
+	int n_files = 0;
 
 	// search destination user
 	if (USER_FOUND == searchUserInList(clients, dest_username, &e)) {
-		// check if remote user
-		if (IS_REMOTE_USER == checkUserIP(origin_ip, e.ip_network)) {
-		    // send file
-			if (0 != socketsSendFile(origin_username, e, file, directory, mutex)) {
-				// free memory
-				free(e.username);
-				e.username = NULL;
-				free(e.ip_network);
-				e.ip_network = NULL;
-			    return;
-			}
-					
+		// a directory or a glob pattern sends several files
+		n_files = getBatchFiles(directory, file, &files);
+
+		if (0 == n_files) {
+		    asprintf(&buffer, SEND_FILE_NO_FILES_ERROR, file);
+			pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(buffer);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
 			// free memory
+			free(buffer);
+			buffer = NULL;
 			free(e.username);
 			e.username = NULL;
 			free(e.ip_network);
 			e.ip_network = NULL;
-		// user in same machine
-		} else {
-	        // check destination user is not origin user
-			if (0 == strcmp(origin_username, e.username)) {
-		        pthread_mutex_lock(mutex);
-				printMsg(COLOR_RED_TXT);
-				printMsg(SEND_MSG_ERROR_SAME_USER);
-				printMsg(COLOR_DEFAULT_TXT);
-				pthread_mutex_unlock(mutex);
-				// free memory
-				free(e.username);
-				e.username = NULL;
-				free(e.ip_network);
-				e.ip_network = NULL;
-				return;
-			}
+			return;
+		}
 
+		// check destination user is not origin user
+		if ((IS_LOCAL_USER == e.route) && (0 == strcmp(origin_username, e.username))) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(SEND_MSG_ERROR_SAME_USER);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
 			// free memory
 			free(e.username);
 			e.username = NULL;
 			free(e.ip_network);
-			e.ip_network = NULL;	
-			// send file
-			ICP_sendFile(e.pid, file, directory, origin_username, mutex);
+			e.ip_network = NULL;
+			freeBatchFiles(&files, n_files);
+			return;
+		}
+
+		// the transfer keeps its own copy of everything it needs
+		args = (SendFileJob *) malloc (sizeof(SendFileJob));
+		args->user = e;
+		args->remote = (IS_REMOTE_USER == e.route);
+		args->batch = (NOT_A_BATCH != n_files);
+
+		if (args->batch) {
+		    args->files = files;
+			args->n_files = n_files;
+		} else {
+		    args->files = (char **) malloc (sizeof(char *));
+			args->files[0] = strdup(file);
+			args->n_files = 1;
 		}
+
+		args->directory = strdup(directory);
+		args->username = strdup(origin_username);
+		args->codec = codec;
+		args->scheduler = &transfers->scheduler;
+		args->mutex = mutex;
+		asprintf(&buffer, "%s %s %s", SEND_FILE_CMD, dest_username, file);
+
+		if (TRANSFER_ERROR == TRANSFER_start(transfers, buffer, args->n_files, sendFileJob, args, mutex)) {
+		    freeBatchFiles(&args->files, args->n_files);
+			free(args->user.username);
+			free(args->user.ip_network);
+			free(args->directory);
+			free(args->username);
+			free(args);
+			args = NULL;
+		}
+
+		free(buffer);
+		buffer = NULL;
 	} else {
 	    // show error message for unfound user
 		asprintf(&buffer, USER_NOT_FOUND_ERROR_MSG, dest_username);
@@ -593,6 +1057,449 @@ void sendFileCommand(BidirectionalList clients, char *dest_username, char *file,
 	}
 }
 
+/*********************************************************************
+* @Purpose: Sends the deleted files of a sync (as many SYNC_DELETE
+*           frames as needed).
+* @Params: in: fd_socket = socket connected to the receiver
+*          in: deleted = names of the deleted files
+*          in: n_deleted = number of deleted files
+* @Return: Returns 0 if no errors, otherwise 1.
+*********************************************************************/
+char sendSyncDeletes(int fd_socket, char **deleted, int n_deleted) {
+	char *buffer = NULL;
+	size_t length = 0, name_length = 0;
+	int i = 0;
+	char error = 0;
+
+	buffer = (char *) malloc (sizeof(char) * GPC_FILE_MAX_BYTES);
+
+	for (i = 0; (i <= n_deleted) && !error; i++) {
+	    name_length = (i < n_deleted) ? strlen(deleted[i]) : 0;
+
+		// the frame is sent when the next name does not fit or at the end
+		if ((0 < length) && ((i == n_deleted) || (length + name_length + 1 > GPC_FILE_MAX_BYTES))) {
+		    error = (GCP_WRITE_KO == GPC_writeFrame(fd_socket, GCP_SEND_FILE_TYPE, GCP_SYNC_DELETE_HEADER, buffer, length));
+			length = 0;
+		}
+
+		if ((i < n_deleted) && (name_length < GPC_FILE_MAX_BYTES)) {
+		    if (0 < length) {
+			    buffer[length++] = GPC_USERS_SEPARATOR;
+			}
+
+			memcpy(buffer + length, deleted[i], name_length);
+			length += name_length;
+		}
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Keeps a subdirectory synchronized with another IluvatarSon
+*           (runs in a background transfer until it is cancelled). All
+*           the files are sent first, and then the changes detected by
+*           the watcher through the same connection.
+* @Params: in/out: job = transfer whose arguments are a SyncJob (freed
+*                  here)
+* @Return: Returns 0 if the sync ended without errors, otherwise 1.
+*********************************************************************/
+char syncJob(TransferJob *job) {
+	SyncJob *args = (SyncJob *) job->args;
+	SyncWatcher watcher;
+	BatchFile *files = NULL;
+	Throttle throttle;
+	Client client;
+	char *buffer = NULL;
+	char *header = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	int n_batch = 0;
+	char watching = 0;
+	char error = 0;
+
+	// the data of the sync is paced by the rate limits
+	SCHEDULER_openThrottle(args->scheduler, &throttle, args->user.ip_network, args->user.port, 1);
+	job->control.throttle = &throttle;
+
+	// the watch starts before the first batch, so no change is lost
+	if (SYNC_OK == SYNC_open(&watcher, args->directory, args->subdir)) {
+	    watching = 1;
+		client = CLIENT_init(args->user.ip_network, args->user.port);
+		error = (FD_NOT_FOUND == client.server_fd);
+	} else {
+	    error = 1;
+	}
+
+	if (!error) {
+	    asprintf(&buffer, "%s%c%s", args->username, GPC_DATA_SEPARATOR, args->subdir);
+		error = (GCP_WRITE_KO == GPC_writeFrame(client.server_fd, GCP_SEND_FILE_TYPE, GCP_SYNC_START_HEADER, buffer, strlen(buffer)));
+		free(buffer);
+		buffer = NULL;
+
+		if (!error) {
+		    error = (0 == GPC_readFrame(client.server_fd, &type, &header, &buffer)) || (NULL == header) || (0 != strcmp(header, GCP_SYNC_OK_HEADER));
+		}
+
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != buffer) {
+		    free(buffer);
+			buffer = NULL;
+		}
+
+		// the contents already at the destination are not sent again
+		SYNC_addAll(&watcher);
+
+		while (!error && !job->control.cancel) {
+			if (0 < watcher.n_changed) {
+			    job->n_files += watcher.n_changed;
+				n_batch = buildBatchManifest(watcher.changed, watcher.n_changed, args->directory, &files, args->mutex);
+
+				if ((0 < n_batch) && (0 == CLIENT_streamBatch(&client, args->username, files, n_batch, args->directory, args->codec, &job->control, args->mutex))) {
+				    job->files_done += n_batch;
+				} else if ((0 < n_batch) && (0 == recv(client.server_fd, &type, 1, MSG_PEEK | MSG_DONTWAIT))) {
+				    // the receiver has closed the connection
+					error = 1;
+				}
+
+				freeBatchManifest(&files, n_batch);
+			}
+
+			// deletes go after the batch, so a renamed file is copied from its old name
+			if (!error && (0 < watcher.n_deleted) && sendSyncDeletes(client.server_fd, watcher.deleted, watcher.n_deleted)) {
+			    error = 1;
+			}
+
+			SYNC_clear(&watcher);
+
+			if (error || (SYNC_KO == SYNC_wait(&watcher, &job->control))) {
+			    // cancelled or the subdirectory is gone
+				error = !job->control.cancel;
+				break;
+			}
+		}
+
+		close(client.server_fd);
+	}
+
+	if (watching) {
+	    SYNC_close(&watcher);
+	}
+
+	job->control.throttle = NULL;
+
+	// a cancelled sync is the normal way to stop it
+	error = error || job->control.cancel;
+
+	// free memory
+	free(args->user.username);
+	args->user.username = NULL;
+	free(args->user.ip_network);
+	args->user.ip_network = NULL;
+	free(args->subdir);
+	args->subdir = NULL;
+	free(args->directory);
+	args->directory = NULL;
+	free(args->username);
+	args->username = NULL;
+	free(args);
+	job->args = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Keeps a subdirectory synchronized with another IluvatarSon.
+*           The sync is run by a background transfer until it is
+*           cancelled, so the command returns at once.
+* @Params: in: clients = list of users of the sender
+*          in: dest_username = string containing the username of the
+*		       destination IluvatarSon
+*		   in: subdir = string containing the subdirectory to sync
+*		   in: directory = string containing the directory of the sender
+*		   in: origin_username = string containing the username of the
+*		       sender
+*		   in: codec = codec offered to compress the data
+*		   in/out: transfers = table of background transfers
+*		   in/out: mutex = screen mutex to prevent writing to screen
+*		           simultaneously
+* @Return: ----
+*********************************************************************/
+void syncCommand(BidirectionalList clients, char *dest_username, char *subdir, char *directory,
+                 char *origin_username, char codec, TransferTable *transfers, pthread_mutex_t *mutex) {
+	SyncJob *args = NULL;
+	Element e;
+	struct stat st;
+	char *buffer = NULL;
+	size_t length = strlen(subdir);
+
+	// the names sent are "subdir/file"
+	while ((1 < length) && ('/' == subdir[length - 1])) {
+	    subdir[--length] = '\0';
+	}
+
+	asprintf(&buffer, ".%s/%s", directory, subdir);
+
+	if ((0 != stat(buffer, &st)) || !S_ISDIR(st.st_mode)) {
+	    free(buffer);
+		buffer = NULL;
+		asprintf(&buffer, SYNC_NOT_A_DIRECTORY_ERROR, subdir);
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(buffer);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		return;
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	// search destination user
+	if (USER_NOT_FOUND == searchUserInList(clients, dest_username, &e)) {
+	    asprintf(&buffer, USER_NOT_FOUND_ERROR_MSG, dest_username);
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(buffer);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		return;
+	}
+
+	// check destination user is not origin user
+	if ((IS_LOCAL_USER == e.route) && (0 == strcmp(origin_username, e.username))) {
+	    pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(SEND_MSG_ERROR_SAME_USER);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(e.username);
+		e.username = NULL;
+		free(e.ip_network);
+		e.ip_network = NULL;
+		return;
+	}
+
+	// the transfer keeps its own copy of everything it needs
+	args = (SyncJob *) malloc (sizeof(SyncJob));
+	args->user = e;
+	args->subdir = strdup(subdir);
+	args->directory = strdup(directory);
+	args->username = strdup(origin_username);
+	args->codec = codec;
+	args->scheduler = &transfers->scheduler;
+	args->mutex = mutex;
+	asprintf(&buffer, "%s %s %s", SYNC_CMD, dest_username, subdir);
+
+	if (TRANSFER_ERROR == TRANSFER_start(transfers, buffer, 0, syncJob, args, mutex)) {
+	    free(args->user.username);
+		free(args->user.ip_network);
+		free(args->subdir);
+		free(args->directory);
+		free(args->username);
+		free(args);
+		args = NULL;
+	}
+
+	free(buffer);
+	buffer = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Uploads the file of an UPLOAD command to Arda (runs in a
+*           background transfer).
+* @Params: in/out: job = transfer whose arguments are an UploadJob
+*                  (freed here)
+* @Return: Returns 0 if the file is in Arda, otherwise 1.
+*********************************************************************/
+char uploadJob(TransferJob *job) {
+	UploadJob *args = (UploadJob *) job->args;
+	Throttle throttle;
+	Client client;
+	struct stat st;
+	char *path = NULL;
+	char *md5sum = NULL;
+	char *slash = NULL;
+	char error = 1;
+
+	// the data of the upload is paced by the rate limits
+	SCHEDULER_openThrottle(args->scheduler, &throttle, args->arda_ip_address, args->arda_port, 1);
+	job->control.throttle = &throttle;
+	asprintf(&path, ".%s/%s", args->directory, args->file);
+
+	if ((0 == stat(path, &st)) && (0 < st.st_size) && (NULL != (md5sum = TREEHASH_getFileHash(path, NULL, args->mutex)))) {
+	    client = CLIENT_init(args->arda_ip_address, args->arda_port);
+
+		if (FD_NOT_FOUND != client.server_fd) {
+		    // the blob keeps the name without the subdirectories
+			slash = strrchr(args->file, '/');
+			error = CLIENT_uploadBlob(&client, args->username, path, (NULL == slash) ? args->file : slash + 1, md5sum,
+			                          (long long) st.st_size, args->codec, &job->control, args->mutex);
+		}
+	}
+
+	job->files_done = error ? 0 : 1;
+	job->control.throttle = NULL;
+
+	// free memory
+	if (NULL != md5sum) {
+	    free(md5sum);
+		md5sum = NULL;
+	}
+
+	free(path);
+	path = NULL;
+	free(args->file);
+	args->file = NULL;
+	free(args->directory);
+	args->directory = NULL;
+	free(args->username);
+	args->username = NULL;
+	free(args->arda_ip_address);
+	args->arda_ip_address = NULL;
+	free(args);
+	job->args = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Uploads a file to the blob cache of Arda, so that any
+*           number of users can download it from Arda with GET FILE.
+*           The file is uploaded by a background transfer.
+* @Params: in: file = string containing the name of the file
+*          in: iluvatar = IluvatarSon that uploads the file
+*          in/out: transfers = table of background transfers
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void uploadCommand(char *file, IluvatarSon *iluvatar, TransferTable *transfers, pthread_mutex_t *mutex) {
+	UploadJob *args = NULL;
+	struct stat st;
+	char *buffer = NULL;
+
+	asprintf(&buffer, ".%s/%s", iluvatar->directory, file);
+
+	if ((0 != stat(buffer, &st)) || !S_ISREG(st.st_mode)) {
+	    free(buffer);
+		buffer = NULL;
+		asprintf(&buffer, UPLOAD_NOT_A_FILE_ERROR, file);
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(buffer);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		return;
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	// the transfer keeps its own copy of everything it needs
+	args = (UploadJob *) malloc (sizeof(UploadJob));
+	args->file = strdup(file);
+	args->directory = strdup(iluvatar->directory);
+	args->username = strdup(iluvatar->username);
+	args->arda_ip_address = strdup(iluvatar->arda_ip_address);
+	args->arda_port = iluvatar->arda_port;
+	args->codec = iluvatar->codec;
+	args->scheduler = &transfers->scheduler;
+	args->mutex = mutex;
+	asprintf(&buffer, "%s %s", UPLOAD_CMD, file);
+
+	if (TRANSFER_ERROR == TRANSFER_start(transfers, buffer, 1, uploadJob, args, mutex)) {
+	    free(args->file);
+		free(args->directory);
+		free(args->username);
+		free(args->arda_ip_address);
+		free(args);
+		args = NULL;
+	}
+
+	free(buffer);
+	buffer = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Downloads the file of a GET FILE command (runs in a
+*           background transfer).
+* @Params: in/out: job = transfer whose arguments are a GetFileJob
+*                  (freed here)
+* @Return: Returns 0 if the file was downloaded, otherwise 1.
+*********************************************************************/
+char getFileJob(TransferJob *job) {
+	GetFileJob *args = (GetFileJob *) job->args;
+	char error = 0;
+
+	error = (SWARM_OK != SWARM_download(args->has_list, args->directory, args->username, args->codec, &args->policy, &job->control, args->mutex));
+	job->files_done = error ? 0 : 1;
+
+	// free memory
+	free(args->has_list);
+	args->has_list = NULL;
+	free(args->directory);
+	args->directory = NULL;
+	free(args->username);
+	args->username = NULL;
+	free(args);
+	job->args = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Starts the download of a GET FILE command once Arda has
+*           answered who holds the content. The file is downloaded by
+*           a background transfer.
+* @Params: in/out: has_list = data of the HAS_LIST reply (owned by the
+*                  transfer, set to NULL)
+*          in: iluvatar = IluvatarSon that downloads the file
+*          in/out: transfers = table of background transfers
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void COMMANDS_getFile(char **has_list, IluvatarSon *iluvatar, TransferTable *transfers, pthread_mutex_t *mutex) {
+	GetFileJob *args = NULL;
+	char *buffer = NULL;
+
+	// the transfer keeps its own copy of everything it needs
+	args = (GetFileJob *) malloc (sizeof(GetFileJob));
+	args->has_list = *has_list;
+	*has_list = NULL;
+	args->directory = strdup(iluvatar->directory);
+	args->username = strdup(iluvatar->username);
+	args->codec = iluvatar->codec;
+	args->policy = iluvatar->write_policy;
+	args->mutex = mutex;
+	// the hash is the first field of the reply
+	asprintf(&buffer, "%s %.*s", GET_FILE_CMD, (int) strcspn(args->has_list, "&#"), args->has_list);
+
+	if (TRANSFER_ERROR == TRANSFER_start(transfers, buffer, 1, getFileJob, args, mutex)) {
+	    free(args->has_list);
+		free(args->directory);
+		free(args->username);
+		free(args);
+		args = NULL;
+	}
+
+	free(buffer);
+	buffer = NULL;
+}
+
 /*********************************************************************
 * @Purpose: Executes a custom command given its ID. Currently only
 *           prints the selected command.
@@ -601,10 +1508,12 @@ void sendFileCommand(BidirectionalList clients, char *dest_username, char *file,
 *          in: iluvatar = IluvatarSon that executes command
 *          in/out: clients = list of clients
 *          in/out: command = string containing the command to execute
+*          in/out: transfers = table of background transfers
 * @Return: ----
 *********************************************************************/
-char executeCustomCommand(int id, int fd_dest, IluvatarSon iluvatar, BidirectionalList *clients, char **command, pthread_mutex_t *mutex) {
+char executeCustomCommand(int id, int fd_dest, IluvatarSon iluvatar, BidirectionalList *clients, char **command, TransferTable *transfers, pthread_mutex_t *mutex) {
 	char *buffer = NULL;
+	int id_transfer = 0;
 
 	switch (id) {
 	    case IS_UPDATE_USERS_CMD:			
@@ -613,8 +1522,15 @@ char executeCustomCommand(int id, int fd_dest, IluvatarSon iluvatar, Bidirection
 			    pthread_mutex_lock(mutex);
 				printMsg(UPDATE_USERS_SUCCESS_MSG);
 				pthread_mutex_unlock(mutex);
-				// request list
+				// request list (before any new chunk of the transfers)
+				SCHEDULER_beginUrgent(&transfers->scheduler);
 				GPC_writeFrame(fd_dest, GCP_UPDATE_USERS_TYPE, GPC_UPDATE_USERS_HEADER_IN, iluvatar.username, strlen(iluvatar.username));
+				SCHEDULER_endUrgent(&transfers->scheduler);
+
+				// the contents of the directory may have changed too
+				if (iluvatar.publish) {
+				    SWARM_publishInventory(fd_dest, iluvatar.username, iluvatar.directory);
+				}
 			} else {
 			    // show error message
 				asprintf(&buffer, GCP_WRONG_FORMAT_ERROR_MSG, GCP_UPDATE_USERS_TYPE, GPC_UPDATE_USERS_HEADER_IN);
@@ -633,14 +1549,57 @@ char executeCustomCommand(int id, int fd_dest, IluvatarSon iluvatar, Bidirection
 			printUsersList(*clients, mutex);
 			break;
 		case IS_SEND_MSG_CMD:
-		    if (SEND_MSG_OK == sendMsgCommand(*clients, command[2], command[3], iluvatar.username, iluvatar.ip_address, mutex)) {
+		    // messages go before any new chunk of the transfers
+			SCHEDULER_beginUrgent(&transfers->scheduler);
+
+		    if (SEND_MSG_OK == sendMsgCommand(*clients, command[2], command[3], iluvatar.username, mutex)) {
 			    // send frame to count new message
 				GPC_writeFrame(fd_dest, GCP_COUNT_TYPE, GCP_COUNT_MSG_HEADER, iluvatar.username, strlen(iluvatar.username));
 			}
 
+			SCHEDULER_endUrgent(&transfers->scheduler);
+
 			break;
 		case IS_SEND_FILE_CMD:
-		    sendFileCommand(*clients, command[2], command[3], iluvatar.directory, iluvatar.username, iluvatar.ip_address, mutex);
+		    sendFileCommand(*clients, command[2], command[3], iluvatar.directory, iluvatar.username, iluvatar.codec, transfers, mutex);
+			break;
+		case IS_SYNC_CMD:
+		    syncCommand(*clients, command[1], command[2], iluvatar.directory, iluvatar.username, iluvatar.codec, transfers, mutex);
+			break;
+		case IS_UPLOAD_CMD:
+		    uploadCommand(command[1], &iluvatar, transfers, mutex);
+			break;
+		case IS_GET_FILE_CMD:
+		    // ask Arda who holds the content, the download starts with the reply
+			asprintf(&buffer, "%s%c%s", iluvatar.username, GPC_DATA_SEPARATOR, command[2]);
+			SCHEDULER_beginUrgent(&transfers->scheduler);
+			GPC_writeFrame(fd_dest, GCP_SWARM_TYPE, GCP_WHO_HAS_HEADER, buffer, strlen(buffer));
+			SCHEDULER_endUrgent(&transfers->scheduler);
+			free(buffer);
+			buffer = NULL;
+			break;
+		case IS_TRANSFERS_CMD:
+		    TRANSFER_list(transfers, mutex);
+			break;
+		case IS_CANCEL_CMD:
+		    id_transfer = atoi(command[1]);
+
+			if (TRANSFER_OK == TRANSFER_cancel(transfers, id_transfer)) {
+			    asprintf(&buffer, TRANSFER_CANCEL_SENT_MSG, id_transfer);
+				pthread_mutex_lock(mutex);
+				printMsg(buffer);
+				pthread_mutex_unlock(mutex);
+			} else {
+			    asprintf(&buffer, TRANSFER_NOT_FOUND_MSG, id_transfer);
+				pthread_mutex_lock(mutex);
+				printMsg(COLOR_RED_TXT);
+				printMsg(buffer);
+				printMsg(COLOR_DEFAULT_TXT);
+				pthread_mutex_unlock(mutex);
+			}
+
+			free(buffer);
+			buffer = NULL;
 			break;
 		default:
 		    // check frame
@@ -695,11 +1654,12 @@ void freeMemCmd(char ***args, int *n_args) {
 *          in/out: iluvatar = IluvatarSon issuing command
 *		   in: fd_arda = Arda's file descriptor (connected to server)
 *          in/out: users_list = list of users
+*          in/out: transfers = table of background transfers
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: 0 if EXIT command entered, otherwise 1.
 *********************************************************************/
-int COMMANDS_executeCommand(char *user_input, IluvatarSon *iluvatar, int fd_arda, BidirectionalList *users_list, pthread_mutex_t *mutex) {
+int COMMANDS_executeCommand(char *user_input, IluvatarSon *iluvatar, int fd_arda, BidirectionalList *users_list, TransferTable *transfers, pthread_mutex_t *mutex) {
 	char **command = NULL;
 	char *buffer = NULL;
 	char error = 0;
@@ -712,7 +1672,7 @@ int COMMANDS_executeCommand(char *user_input, IluvatarSon *iluvatar, int fd_arda
 
 	if ((ERROR_CMD_ARGS != cmd_id) && (IS_NOT_CUSTOM_CMD != cmd_id)) {
 	    // execute custom command
-		error = executeCustomCommand(cmd_id, fd_arda, *iluvatar, users_list, command, mutex);
+		error = executeCustomCommand(cmd_id, fd_arda, *iluvatar, users_list, command, transfers, mutex);
 
 		if ((cmd_id == IS_EXIT_CMD) && !error) {
 			freeMemCmd(&command, &n_args);
@@ -11,6 +11,9 @@
 #include <sys/wait.h>
 #include <mqueue.h>
 #include <pthread.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include "../definitions.h"
 #include "../sharedFunctions.h"
@@ -20,6 +23,9 @@
 #include "../server.h"
 #include "../client.h"
 #include "../semaphore_v2.h"
+#include "../swarm.h"
+#include "transfer.h"
+#include "sync.h"
 
 /* CUSTOM COMMANDS */
 #define UPDATE_USERS_CMD		"UPDATE USERS\0"
@@ -27,6 +33,11 @@
 #define SEND_MSG_CMD			"SEND MSG\0"
 #define SEND_FILE_CMD			"SEND FILE\0"
 #define EXIT_CMD				"EXIT\0"
+#define TRANSFERS_CMD			"TRANSFERS\0"
+#define CANCEL_CMD				"CANCEL\0"
+#define GET_FILE_CMD			"GET FILE\0"
+#define SYNC_CMD				"SYNC\0"
+#define UPLOAD_CMD				"UPLOAD\0"
 #define CMD_END_BYTE			'\n'
 #define CMD_MSG_SEPARATOR		'"'
 
@@ -43,6 +54,14 @@
 #define SEND_MSG_INVALID_MSG_ERROR		"ERROR: Message cannot be empty\n"
 #define USER_NOT_FOUND_ERROR_MSG		"ERROR: %s was not found. Try updating the list of users\n"
 #define SEND_FILE_INVALID_FILE_ERROR 	"ERROR: File could not be sent due to an error in the data\n"
+#define SEND_FILE_NO_FILES_ERROR		"ERROR: No files match %s\n"
+#define SEND_FILE_SKIPPED_FILE_MSG		"Skipping %s (empty or unreadable file)\n"
+#define ERROR_CANCEL_ARGS				"ERROR: To cancel a transfer use: cancel <Transfer ID>\n"
+#define ERROR_GET_FILE_ARGS				"ERROR: To download a file use: get file <Content hash>\n"
+#define ERROR_SYNC_ARGS					"ERROR: To synchronize a subdirectory use: sync <Dst. User> <Subdirectory>\n"
+#define SYNC_NOT_A_DIRECTORY_ERROR		"ERROR: %s is not a subdirectory of the directory\n"
+#define ERROR_UPLOAD_ARGS				"ERROR: To upload a file to Arda use: upload <File>\n"
+#define UPLOAD_NOT_A_FILE_ERROR			"ERROR: %s is not a file of the directory\n"
 
 /* Number of required args for custom command */
 #define UPDATE_USERS_N_ARGS		2
@@ -50,6 +69,11 @@
 #define SEND_MSG_N_ARGS			4
 #define SEND_FILE_N_ARGS		4
 #define EXIT_N_ARGS				1
+#define TRANSFERS_N_ARGS		1
+#define CANCEL_N_ARGS			2
+#define GET_FILE_N_ARGS			3
+#define SYNC_N_ARGS				3
+#define UPLOAD_N_ARGS			2
 
 /* ID to identify custom command */
 #define IS_UPDATE_USERS_CMD		1
@@ -57,6 +81,11 @@
 #define IS_SEND_MSG_CMD			3
 #define IS_SEND_FILE_CMD		4
 #define IS_EXIT_CMD				5
+#define IS_TRANSFERS_CMD		6
+#define IS_CANCEL_CMD			7
+#define IS_GET_FILE_CMD			8
+#define IS_SYNC_CMD				9
+#define IS_UPLOAD_CMD			10
 #define IS_NOT_CUSTOM_CMD		0
 #define ERROR_CMD_ARGS			-1
 
@@ -67,6 +96,52 @@
 #define SEND_MSG_KO				0
 #define USER_FOUND				1
 #define USER_NOT_FOUND			0
+#define ALL_USERS				"*"
+#define NOT_A_BATCH				-1
+#define GLOB_CHARACTERS			"*?["
+
+typedef struct {
+    Element user;
+	char remote;
+	char batch;
+	char **files;
+	int n_files;
+	char *directory;
+	char *username;
+	char codec;
+	Scheduler *scheduler;
+	pthread_mutex_t *mutex;
+} SendFileJob;
+
+typedef struct {
+    Element user;
+	char *subdir;
+	char *directory;
+	char *username;
+	char codec;
+	Scheduler *scheduler;
+	pthread_mutex_t *mutex;
+} SyncJob;
+
+typedef struct {
+    char *file;
+	char *directory;
+	char *username;
+	char *arda_ip_address;
+	int arda_port;
+	char codec;
+	Scheduler *scheduler;
+	pthread_mutex_t *mutex;
+} UploadJob;
+
+typedef struct {
+    char *has_list;
+	char *directory;
+	char *username;
+	char codec;
+	WritePolicy policy;
+	pthread_mutex_t *mutex;
+} GetFileJob;
 
 /*********************************************************************
 * @Purpose: Executes the command entered by the user.
@@ -74,10 +149,37 @@
 *          in/out: iluvatar = IluvatarSon issuing command
 *		   in: fd_arda = Arda's file descriptor (connected to server)
 *          in/out: users_list = list of users
+*          in/out: transfers = table of background transfers
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: 0 if EXIT command entered, otherwise 1.
 *********************************************************************/
-int COMMANDS_executeCommand(char *user_input, IluvatarSon *iluvatar, int fd_arda, BidirectionalList *users_list,/* semaphore *sem_mq,*/ pthread_mutex_t *mutex);
+int COMMANDS_executeCommand(char *user_input, IluvatarSon *iluvatar, int fd_arda, BidirectionalList *users_list, TransferTable *transfers, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Starts the download of a GET FILE command once Arda has
+*           answered who holds the content. The file is downloaded by
+*           a background transfer.
+* @Params: in/out: has_list = data of the HAS_LIST reply (owned by the
+*                  transfer, set to NULL)
+*          in: iluvatar = IluvatarSon that downloads the file
+*          in/out: transfers = table of background transfers
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void COMMANDS_getFile(char **has_list, IluvatarSon *iluvatar, TransferTable *transfers, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Decides once how every user of the list is reached, so the
+*           commands do not resolve any address when they send. Two
+*           sons are in the same machine if they have the same host id;
+*           the hostnames of their IPs are only compared for the users
+*           registered without it.
+* @Params: in/out: users = list of users
+*          in: iluvatar = IluvatarSon that owns the list
+* @Return: ----
+*********************************************************************/
+void COMMANDS_updateRoutes(BidirectionalList *users, IluvatarSon *iluvatar);
 
 #endif
@@ -0,0 +1,287 @@
+/*********************************************************************
+* @Purpose: Module that watches a subdirectory of an IluvatarSon with
+*           inotify and gathers the files that have to be synchronized.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "sync.h"
+
+/*********************************************************************
+* @Purpose: Gets the current time of a monotonic clock.
+* @Params: ----
+* @Return: Returns the time in milliseconds.
+*********************************************************************/
+long long getSyncTime() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((long long) now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+* @Purpose: Removes a name from a list of names.
+* @Params: in/out: list = list of names
+*          in/out: n = number of names of the list
+*          in: name = name to remove
+* @Return: ----
+*********************************************************************/
+void removeSyncName(char ***list, int *n, char *name) {
+	int i = 0;
+
+	for (i = 0; i < *n; i++) {
+	    if (0 == strcmp((*list)[i], name)) {
+		    free((*list)[i]);
+			(*list)[i] = (*list)[*n - 1];
+			(*n)--;
+			return;
+		}
+	}
+}
+
+/*********************************************************************
+* @Purpose: Adds a name to a list of names (if it is not there yet).
+* @Params: in/out: list = list of names
+*          in/out: n = number of names of the list
+*          in: name = name to add
+* @Return: ----
+*********************************************************************/
+void addSyncName(char ***list, int *n, char *name) {
+	int i = 0;
+
+	for (i = 0; i < *n; i++) {
+	    if (0 == strcmp((*list)[i], name)) {
+		    return;
+		}
+	}
+
+	*list = (char **) realloc (*list, sizeof(char *) * (*n + 1));
+	(*list)[*n] = strdup(name);
+	(*n)++;
+}
+
+/*********************************************************************
+* @Purpose: Starts watching the changes of the files of a subdirectory
+*           of the IluvatarSon directory.
+* @Params: out: w = instance of SyncWatcher to initialize
+*          in: directory = directory of the IluvatarSon
+*          in: subdir = subdirectory to watch (relative to directory)
+* @Return: Returns SYNC_OK if no errors, otherwise SYNC_KO.
+*********************************************************************/
+char SYNC_open(SyncWatcher *w, char *directory, char *subdir) {
+	char *path = NULL;
+
+	w->changed = NULL;
+	w->n_changed = 0;
+	w->deleted = NULL;
+	w->n_deleted = 0;
+	w->wd = -1;
+	w->directory = strdup(directory);
+	w->subdir = strdup(subdir);
+	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (w->fd >= 0) {
+	    asprintf(&path, ".%s/%s", directory, subdir);
+		w->wd = inotify_add_watch(w->fd, path, SYNC_EVENTS | IN_ONLYDIR);
+		free(path);
+		path = NULL;
+	}
+
+	if (w->wd < 0) {
+	    SYNC_close(w);
+		return (SYNC_KO);
+	}
+
+	return (SYNC_OK);
+}
+
+/*********************************************************************
+* @Purpose: Marks all the files of the subdirectory as changed (the
+*           first synchronization, or after losing events).
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_addAll(SyncWatcher *w) {
+	char *path = NULL;
+	char *name = NULL;
+	struct stat st;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+
+	asprintf(&path, ".%s/%s", w->directory, w->subdir);
+	dir = opendir(path);
+	free(path);
+	path = NULL;
+
+	while ((NULL != dir) && (NULL != (entry = readdir(dir)))) {
+	    // hidden files are internal (temporary files, index)
+		if ('.' == entry->d_name[0]) {
+		    continue;
+		}
+
+		asprintf(&path, ".%s/%s/%s", w->directory, w->subdir, entry->d_name);
+		asprintf(&name, "%s/%s", w->subdir, entry->d_name);
+
+		if ((0 == stat(path, &st)) && S_ISREG(st.st_mode)) {
+		    removeSyncName(&w->deleted, &w->n_deleted, name);
+			addSyncName(&w->changed, &w->n_changed, name);
+		}
+
+		free(path);
+		path = NULL;
+		free(name);
+		name = NULL;
+	}
+
+	if (NULL != dir) {
+	    closedir(dir);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Reads the pending events of the watched subdirectory.
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: Returns SYNC_OK if no errors, or SYNC_KO if the subdirectory
+*          is not watched anymore.
+*********************************************************************/
+char readSyncEvents(SyncWatcher *w) {
+	char buffer[SYNC_BUFFER_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *event = NULL;
+	char *name = NULL;
+	ssize_t size = 0;
+	ssize_t i = 0;
+
+	while ((size = read(w->fd, buffer, SYNC_BUFFER_SIZE)) > 0) {
+	    for (i = 0; i < size; i += sizeof(struct inotify_event) + event->len) {
+		    event = (struct inotify_event *) (buffer + i);
+
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+			    return (SYNC_KO);
+			}
+
+			if (event->mask & IN_Q_OVERFLOW) {
+			    // events were lost, the whole subdirectory is sent again
+				SYNC_addAll(w);
+				continue;
+			}
+
+			if ((0 == event->len) || ('.' == event->name[0]) || (event->mask & IN_ISDIR)) {
+			    continue;
+			}
+
+			asprintf(&name, "%s/%s", w->subdir, event->name);
+
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+			    removeSyncName(&w->deleted, &w->n_deleted, name);
+				addSyncName(&w->changed, &w->n_changed, name);
+			} else {
+			    removeSyncName(&w->changed, &w->n_changed, name);
+				addSyncName(&w->deleted, &w->n_deleted, name);
+			}
+
+			free(name);
+			name = NULL;
+		}
+	}
+
+	if ((size < 0) && (EAGAIN != errno) && (EINTR != errno)) {
+	    return (SYNC_KO);
+	}
+
+	return (SYNC_OK);
+}
+
+/*********************************************************************
+* @Purpose: Waits for changes of the subdirectory. The events are
+*           batched: once a file changes, the events that follow it
+*           are gathered until there are none for SYNC_QUIET_TIME ms
+*           (or for SYNC_MAX_DELAY ms at most). The changed and deleted
+*           files (relative to the directory) are left in the watcher.
+* @Params: in/out: w = opened instance of SyncWatcher
+*          in: control = progress and cancellation of the transfer
+* @Return: Returns SYNC_OK when there are changes, or SYNC_KO if the
+*          subdirectory is gone or the transfer has been cancelled.
+*********************************************************************/
+char SYNC_wait(SyncWatcher *w, TransferControl *control) {
+	struct pollfd pfd;
+	long long first = -1;
+	long long timeout = 0;
+	int ret = 0;
+
+	pfd.fd = w->fd;
+	pfd.events = POLLIN;
+
+	while (!control->cancel) {
+	    if (first < 0) {
+		    // the poll is short to notice the cancellation
+			timeout = SYNC_POLL_TIME;
+		} else {
+		    timeout = first + SYNC_MAX_DELAY - getSyncTime();
+			timeout = timeout < SYNC_QUIET_TIME ? timeout : SYNC_QUIET_TIME;
+			timeout = timeout > 0 ? timeout : 0;
+		}
+
+		ret = poll(&pfd, 1, (int) timeout);
+
+		if ((ret < 0) && (EINTR != errno)) {
+		    return (SYNC_KO);
+		}
+
+		if ((ret > 0) && (SYNC_KO == readSyncEvents(w))) {
+		    return (SYNC_KO);
+		}
+
+		if ((first < 0) && (w->n_changed + w->n_deleted > 0)) {
+		    first = getSyncTime();
+		} else if ((first >= 0) && ((0 == ret) || (getSyncTime() - first >= SYNC_MAX_DELAY))) {
+		    // the changes have settled (or waited enough)
+			return (SYNC_OK);
+		}
+	}
+
+	return (SYNC_KO);
+}
+
+/*********************************************************************
+* @Purpose: Forgets the changes already sent.
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_clear(SyncWatcher *w) {
+	int i = 0;
+
+	for (i = 0; i < w->n_changed; i++) {
+	    free(w->changed[i]);
+	}
+	for (i = 0; i < w->n_deleted; i++) {
+	    free(w->deleted[i]);
+	}
+
+	free(w->changed);
+	w->changed = NULL;
+	w->n_changed = 0;
+	free(w->deleted);
+	w->deleted = NULL;
+	w->n_deleted = 0;
+}
+
+/*********************************************************************
+* @Purpose: Stops watching the subdirectory and frees the watcher.
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_close(SyncWatcher *w) {
+	SYNC_clear(w);
+
+	if (w->fd >= 0) {
+	    close(w->fd);
+		w->fd = -1;
+	}
+
+	free(w->directory);
+	w->directory = NULL;
+	free(w->subdir);
+	w->subdir = NULL;
+}
@@ -0,0 +1,84 @@
+#ifndef _SYNC_H_
+#define _SYNC_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "../definitions.h"
+#include "../sharedFunctions.h"
+
+/* Constants */
+#define SYNC_EVENTS				(IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF)
+#define SYNC_BUFFER_SIZE		(64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+#define SYNC_POLL_TIME			500
+#define SYNC_QUIET_TIME			300
+#define SYNC_MAX_DELAY			3000
+#define SYNC_OK					0
+#define SYNC_KO					1
+
+typedef struct {
+	int fd;
+	int wd;
+	char *directory;
+	char *subdir;
+	char **changed;
+	int n_changed;
+	char **deleted;
+	int n_deleted;
+} SyncWatcher;
+
+/*********************************************************************
+* @Purpose: Starts watching the changes of the files of a subdirectory
+*           of the IluvatarSon directory.
+* @Params: out: w = instance of SyncWatcher to initialize
+*          in: directory = directory of the IluvatarSon
+*          in: subdir = subdirectory to watch (relative to directory)
+* @Return: Returns SYNC_OK if no errors, otherwise SYNC_KO.
+*********************************************************************/
+char SYNC_open(SyncWatcher *w, char *directory, char *subdir);
+
+/*********************************************************************
+* @Purpose: Marks all the files of the subdirectory as changed (the
+*           first synchronization, or after losing events).
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_addAll(SyncWatcher *w);
+
+/*********************************************************************
+* @Purpose: Waits for changes of the subdirectory. The events are
+*           batched: once a file changes, the events that follow it
+*           are gathered until there are none for SYNC_QUIET_TIME ms
+*           (or for SYNC_MAX_DELAY ms at most). The changed and deleted
+*           files (relative to the directory) are left in the watcher.
+* @Params: in/out: w = opened instance of SyncWatcher
+*          in: control = progress and cancellation of the transfer
+* @Return: Returns SYNC_OK when there are changes, or SYNC_KO if the
+*          subdirectory is gone or the transfer has been cancelled.
+*********************************************************************/
+char SYNC_wait(SyncWatcher *w, TransferControl *control);
+
+/*********************************************************************
+* @Purpose: Forgets the changes already sent.
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_clear(SyncWatcher *w);
+
+/*********************************************************************
+* @Purpose: Stops watching the subdirectory and frees the watcher.
+* @Params: in/out: w = opened instance of SyncWatcher
+* @Return: ----
+*********************************************************************/
+void SYNC_close(SyncWatcher *w);
+
+#endif
@@ -0,0 +1,264 @@
+/*********************************************************************
+* @Purpose: Module that runs the file transfers of an IluvatarSon in
+*           background threads and keeps a table with their state.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "transfer.h"
+
+/*********************************************************************
+* @Purpose: Creates an empty table of transfers.
+* @Params: ----
+* @Return: Returns an initialized TransferTable.
+*********************************************************************/
+TransferTable TRANSFER_init() {
+	TransferTable table;
+
+	table.jobs = NULL;
+	table.n_jobs = 0;
+	table.next_id = 1;
+	pthread_mutex_init(&table.mutex, NULL);
+	SCHEDULER_init(&table.scheduler);
+
+	return (table);
+}
+
+/*********************************************************************
+* @Purpose: Runs a transfer (thread function).
+* @Params: in/out: args = the TransferJob to run
+* @Return: Returns NULL.
+*********************************************************************/
+void *runTransfer(void *args) {
+	TransferJob *job = (TransferJob *) args;
+	sigset_t set;
+	char *buffer = NULL;
+	char error = 0;
+
+	// SIGINT must be handled by the main thread
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	error = job->run(job);
+
+	// a transfer that finished before noticing the cancellation is done
+	if (error && job->control.cancel) {
+	    job->state = TRANSFER_CANCELLED;
+		asprintf(&buffer, TRANSFER_CANCELLED_MSG, job->id);
+		pthread_mutex_lock(job->mutex_print);
+		printMsg(buffer);
+		pthread_mutex_unlock(job->mutex_print);
+		free(buffer);
+		buffer = NULL;
+	} else {
+	    job->state = error ? TRANSFER_FAILED : TRANSFER_DONE;
+	}
+
+	// open again the command line
+	asprintf(&buffer, CMD_LINE_PROMPT, COLOR_CLI_TXT, CMD_ID_BYTE);
+	pthread_mutex_lock(job->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(job->mutex_print);
+	free(buffer);
+	buffer = NULL;
+
+	job->terminated = 1;
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Releases the threads of the finished transfers.
+* @Params: in/out: table = table of transfers (its mutex must be held)
+* @Return: ----
+*********************************************************************/
+void joinFinishedTransfers(TransferTable *table) {
+	int i = 0;
+
+	for (i = 0; i < table->n_jobs; i++) {
+	    if (table->jobs[i]->terminated && !table->jobs[i]->joined) {
+		    pthread_join(table->jobs[i]->thread, NULL);
+			table->jobs[i]->joined = 1;
+		}
+	}
+}
+
+/*********************************************************************
+* @Purpose: Starts a transfer in a background thread.
+* @Params: in/out: table = table of transfers
+*          in: description = command that started the transfer
+*          in: n_files = number of files of the transfer
+*          in: run = function that performs the transfer (returns 0
+*              if no errors, otherwise 1)
+*          in/out: args = arguments of the function (freed by it)
+*          in/out: mutex_print = screen mutex to prevent writing to
+*                  screen simultaneously
+* @Return: Returns the ID of the transfer, or TRANSFER_ERROR.
+*********************************************************************/
+int TRANSFER_start(TransferTable *table, char *description, int n_files, char (*run)(TransferJob *job), void *args, pthread_mutex_t *mutex_print) {
+	TransferJob *job = (TransferJob *) malloc (sizeof(TransferJob));
+	char *buffer = NULL;
+	int id = TRANSFER_ERROR;
+
+	job->state = TRANSFER_RUNNING;
+	job->terminated = 0;
+	job->joined = 0;
+	job->n_files = n_files;
+	job->files_done = 0;
+	job->description = strdup(description);
+	job->control.cancel = 0;
+	job->control.bytes = 0;
+	job->control.throttle = NULL;
+	job->run = run;
+	job->args = args;
+	job->mutex_print = mutex_print;
+
+	pthread_mutex_lock(&table->mutex);
+	joinFinishedTransfers(table);
+	job->id = table->next_id;
+
+	if (0 != pthread_create(&job->thread, NULL, runTransfer, job)) {
+	    pthread_mutex_unlock(&table->mutex);
+		pthread_mutex_lock(mutex_print);
+		printMsg(COLOR_RED_TXT);
+		printMsg(TRANSFER_THREAD_ERROR_MSG);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex_print);
+		free(job->description);
+		free(job);
+		return (TRANSFER_ERROR);
+	}
+
+	// add the job to the table
+	table->jobs = (TransferJob **) realloc (table->jobs, sizeof(TransferJob *) * (table->n_jobs + 1));
+	table->jobs[table->n_jobs] = job;
+	(table->n_jobs)++;
+	(table->next_id)++;
+	id = job->id;
+	pthread_mutex_unlock(&table->mutex);
+
+	asprintf(&buffer, TRANSFER_STARTED_MSG, id);
+	pthread_mutex_lock(mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(mutex_print);
+	free(buffer);
+	buffer = NULL;
+
+	return (id);
+}
+
+/*********************************************************************
+* @Purpose: Gets the name of the state of a transfer.
+* @Params: in: state = state of the transfer
+* @Return: Returns the name of the state.
+*********************************************************************/
+char * getStateName(char state) {
+	switch (state) {
+	    case TRANSFER_RUNNING:
+		    return ("running");
+		case TRANSFER_DONE:
+		    return ("done");
+		case TRANSFER_FAILED:
+		    return ("failed");
+		default:
+		    return ("cancelled");
+	}
+}
+
+/*********************************************************************
+* @Purpose: Shows the transfers and their progress.
+* @Params: in/out: table = table of transfers
+*          in/out: mutex_print = screen mutex to prevent writing to
+*                  screen simultaneously
+* @Return: ----
+*********************************************************************/
+void TRANSFER_list(TransferTable *table, pthread_mutex_t *mutex_print) {
+	TransferJob *job = NULL;
+	char *buffer = NULL;
+	int i = 0;
+
+	pthread_mutex_lock(&table->mutex);
+	pthread_mutex_lock(mutex_print);
+
+	if (0 == table->n_jobs) {
+	    printMsg(TRANSFER_NO_JOBS_MSG);
+	} else {
+	    printMsg(TRANSFER_LIST_HEADER_MSG);
+	}
+
+	for (i = 0; i < table->n_jobs; i++) {
+	    job = table->jobs[i];
+		asprintf(&buffer, TRANSFER_LIST_ENTRY_MSG, job->id, getStateName(job->state), job->files_done, job->n_files, job->control.bytes, job->description);
+		printMsg(buffer);
+		free(buffer);
+		buffer = NULL;
+	}
+
+	pthread_mutex_unlock(mutex_print);
+	pthread_mutex_unlock(&table->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Asks a running transfer to stop. Socket transfers stop
+*           after the chunk in flight, message queue transfers after
+*           the file in flight.
+* @Params: in/out: table = table of transfers
+*          in: id = ID of the transfer
+* @Return: Returns TRANSFER_OK if the transfer is running, otherwise
+*          TRANSFER_KO.
+*********************************************************************/
+char TRANSFER_cancel(TransferTable *table, int id) {
+	char ret_value = TRANSFER_KO;
+	int i = 0;
+
+	pthread_mutex_lock(&table->mutex);
+
+	for (i = 0; i < table->n_jobs; i++) {
+	    if ((table->jobs[i]->id == id) && !table->jobs[i]->terminated) {
+		    table->jobs[i]->control.cancel = 1;
+			ret_value = TRANSFER_OK;
+		}
+	}
+
+	pthread_mutex_unlock(&table->mutex);
+
+	return (ret_value);
+}
+
+/*********************************************************************
+* @Purpose: Cancels the running transfers, waits for them and frees the
+*           table.
+* @Params: in/out: table = table of transfers
+* @Return: ----
+*********************************************************************/
+void TRANSFER_close(TransferTable *table) {
+	int i = 0;
+
+	pthread_mutex_lock(&table->mutex);
+
+	for (i = 0; i < table->n_jobs; i++) {
+	    table->jobs[i]->control.cancel = 1;
+	}
+
+	for (i = 0; i < table->n_jobs; i++) {
+	    if (!table->jobs[i]->joined) {
+		    pthread_join(table->jobs[i]->thread, NULL);
+		}
+
+		free(table->jobs[i]->description);
+		table->jobs[i]->description = NULL;
+		free(table->jobs[i]);
+		table->jobs[i] = NULL;
+	}
+
+	if (NULL != table->jobs) {
+	    free(table->jobs);
+		table->jobs = NULL;
+	}
+
+	table->n_jobs = 0;
+	pthread_mutex_unlock(&table->mutex);
+	pthread_mutex_destroy(&table->mutex);
+	SCHEDULER_close(&table->scheduler);
+}
@@ -0,0 +1,108 @@
+#ifndef _TRANSFER_H_
+#define _TRANSFER_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "../definitions.h"
+#include "../sharedFunctions.h"
+#include "../scheduler.h"
+
+/* Messages */
+#define TRANSFER_STARTED_MSG		"Transfer %d started in background\n"
+#define TRANSFER_CANCELLED_MSG		"Transfer %d cancelled\n"
+#define TRANSFER_CANCEL_SENT_MSG	"Cancelling transfer %d\n"
+#define TRANSFER_NOT_FOUND_MSG		"ERROR: There is no active transfer with ID %d\n"
+#define TRANSFER_NO_JOBS_MSG		"There are no transfers\n"
+#define TRANSFER_LIST_HEADER_MSG	"ID\tSTATE\t\tFILES\tBYTES\t\tCOMMAND\n"
+#define TRANSFER_LIST_ENTRY_MSG		"%d\t%s\t%d/%d\t%lld\t\t%s\n"
+#define TRANSFER_THREAD_ERROR_MSG	"ERROR: The transfer could not be started\n"
+
+/* Constants */
+#define TRANSFER_RUNNING			0
+#define TRANSFER_DONE				1
+#define TRANSFER_FAILED				2
+#define TRANSFER_CANCELLED			3
+#define TRANSFER_ERROR				-1
+#define TRANSFER_OK					0
+#define TRANSFER_KO					1
+
+typedef struct _TransferJob TransferJob;
+
+struct _TransferJob {
+	int id;
+	pthread_t thread;
+	char state;
+	char terminated;
+	char joined;
+	int n_files;
+	volatile int files_done;
+	char *description;
+	TransferControl control;
+	char (*run)(TransferJob *job);
+	void *args;
+	pthread_mutex_t *mutex_print;
+};
+
+typedef struct {
+	TransferJob **jobs;
+	int n_jobs;
+	int next_id;
+	pthread_mutex_t mutex;
+	Scheduler scheduler;
+} TransferTable;
+
+/*********************************************************************
+* @Purpose: Creates an empty table of transfers.
+* @Params: ----
+* @Return: Returns an initialized TransferTable.
+*********************************************************************/
+TransferTable TRANSFER_init();
+
+/*********************************************************************
+* @Purpose: Starts a transfer in a background thread.
+* @Params: in/out: table = table of transfers
+*          in: description = command that started the transfer
+*          in: n_files = number of files of the transfer
+*          in: run = function that performs the transfer (returns 0
+*              if no errors, otherwise 1)
+*          in/out: args = arguments of the function (freed by it)
+*          in/out: mutex_print = screen mutex to prevent writing to
+*                  screen simultaneously
+* @Return: Returns the ID of the transfer, or TRANSFER_ERROR.
+*********************************************************************/
+int TRANSFER_start(TransferTable *table, char *description, int n_files, char (*run)(TransferJob *job), void *args, pthread_mutex_t *mutex_print);
+
+/*********************************************************************
+* @Purpose: Shows the transfers and their progress.
+* @Params: in/out: table = table of transfers
+*          in/out: mutex_print = screen mutex to prevent writing to
+*                  screen simultaneously
+* @Return: ----
+*********************************************************************/
+void TRANSFER_list(TransferTable *table, pthread_mutex_t *mutex_print);
+
+/*********************************************************************
+* @Purpose: Asks a running transfer to stop. Socket transfers stop
+*           after the chunk in flight, message queue transfers after
+*           the file in flight.
+* @Params: in/out: table = table of transfers
+*          in: id = ID of the transfer
+* @Return: Returns TRANSFER_OK if the transfer is running, otherwise
+*          TRANSFER_KO.
+*********************************************************************/
+char TRANSFER_cancel(TransferTable *table, int id);
+
+/*********************************************************************
+* @Purpose: Cancels the running transfers, waits for them and frees the
+*           table.
+* @Params: in/out: table = table of transfers
+* @Return: ----
+*********************************************************************/
+void TRANSFER_close(TransferTable *table);
+
+#endif
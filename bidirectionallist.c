@@ -70,6 +70,8 @@ void BIDIRECTIONALLIST_addBefore(BidirectionalList * list, Element element) {
 			new_node->element.port = element.port;
 			new_node->element.pid = element.pid;
 			new_node->element.clientFD = element.clientFD;
+			memcpy(new_node->element.host_id, element.host_id, sizeof(element.host_id));
+			new_node->element.route = element.route;
 			new_node->next = list->poi;
 			new_node->previous = list->poi->previous;
 			
@@ -100,6 +102,8 @@ void BIDIRECTIONALLIST_addAfter (BidirectionalList * list, Element element) {
 			new_node->element.port = element.port;
 			new_node->element.pid = element.pid;
 			new_node->element.clientFD = element.clientFD;
+			memcpy(new_node->element.host_id, element.host_id, sizeof(element.host_id));
+			new_node->element.route = element.route;
 			new_node->next = list->poi->next;
 			new_node->previous = list->poi;
 			
@@ -125,6 +129,8 @@ Element	BIDIRECTIONALLIST_get(BidirectionalList * list) {
 			element.port = list->poi->element.port;
 			element.pid = list->poi->element.pid;
 			element.clientFD = list->poi->element.clientFD;
+			memcpy(element.host_id, list->poi->element.host_id, sizeof(element.host_id));
+			element.route = list->poi->element.route;
 		}
 	}
 
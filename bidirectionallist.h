@@ -46,6 +46,8 @@ typedef struct {
 	int port;
 	pid_t pid;
 	int clientFD;
+	char host_id[HOST_ID_LENGTH + 1];	// machine of the user (empty if Arda does not send it)
+	char route;							// how the user is reached, set when the list is received
 } Element;
 
 /*
@@ -0,0 +1,361 @@
+/*********************************************************************
+* @Purpose: Module that keeps the contents uploaded to Arda, so that
+*           any number of sons can download them without the son that
+*           uploaded them. The blobs are evicted by size, the least
+*           recently used first.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "blobcache.h"
+
+/*********************************************************************
+* @Purpose: Searches the entry of a blob. The mutex must be locked.
+* @Params: in: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+* @Return: Returns the index of the entry, or -1 if it is not found.
+*********************************************************************/
+int searchBlob(BlobCache *cache, char *md5sum) {
+	int i = 0;
+
+	for (i = 0; i < cache->n_entries; i++) {
+	    if (0 == strcmp(cache->entries[i].md5sum, md5sum)) {
+		    return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/*********************************************************************
+* @Purpose: Adds the entry of a blob. The mutex must be locked.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+*          in: filename = name of the file
+*          in: size = size in bytes of the blob
+*          in: last_use = time of the last use of the blob
+* @Return: ----
+*********************************************************************/
+void addBlobEntry(BlobCache *cache, char *md5sum, char *filename, long long size, long long last_use) {
+	cache->entries = (BlobEntry *) realloc(cache->entries, sizeof(BlobEntry) * (cache->n_entries + 1));
+	cache->entries[cache->n_entries].md5sum = strdup(md5sum);
+	cache->entries[cache->n_entries].filename = strdup(filename);
+	cache->entries[cache->n_entries].size = size;
+	cache->entries[cache->n_entries].last_use = last_use;
+	cache->n_entries++;
+	cache->used += size;
+}
+
+/*********************************************************************
+* @Purpose: Deletes a blob from the disk and the cache. The mutex must
+*           be locked.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: i = index of the entry
+* @Return: ----
+*********************************************************************/
+void removeBlob(BlobCache *cache, int i) {
+	char *path = NULL;
+
+	// a son that is downloading it keeps its open file
+	asprintf(&path, ".%s/%s/%s", cache->directory, cache->entries[i].md5sum, cache->entries[i].filename);
+	unlink(path);
+	free(path);
+	path = NULL;
+	asprintf(&path, ".%s/%s", cache->directory, cache->entries[i].md5sum);
+	rmdir(path);
+	free(path);
+	path = NULL;
+
+	cache->used -= cache->entries[i].size;
+	free(cache->entries[i].md5sum);
+	free(cache->entries[i].filename);
+	cache->entries[i] = cache->entries[cache->n_entries - 1];
+	cache->n_entries--;
+}
+
+/*********************************************************************
+* @Purpose: Evicts the least recently used blobs until the given
+*           bytes fit in the cache. The mutex must be locked.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: size = bytes that must fit
+* @Return: ----
+*********************************************************************/
+void evictBlobs(BlobCache *cache, long long size) {
+	int i = 0, oldest = 0;
+
+	while ((0 < cache->n_entries) && (cache->used + size > cache->capacity)) {
+	    oldest = 0;
+
+		for (i = 1; i < cache->n_entries; i++) {
+		    if (cache->entries[i].last_use < cache->entries[oldest].last_use) {
+			    oldest = i;
+			}
+		}
+
+		removeBlob(cache, oldest);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Loads the blob stored in a subdirectory of the cache.
+* @Params: in/out: cache = instance of BlobCache being opened
+*          in: md5sum = name of the subdirectory (content hash)
+* @Return: ----
+*********************************************************************/
+void loadBlob(BlobCache *cache, char *md5sum) {
+	char *path = NULL;
+	struct stat st;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+
+	asprintf(&path, ".%s/%s", cache->directory, md5sum);
+	dir = opendir(path);
+	free(path);
+	path = NULL;
+
+	while ((NULL != dir) && (NULL != (entry = readdir(dir)))) {
+	    if ('.' == entry->d_name[0]) {
+		    continue;
+		}
+
+		asprintf(&path, ".%s/%s/%s", cache->directory, md5sum, entry->d_name);
+
+		if ((0 == stat(path, &st)) && S_ISREG(st.st_mode)) {
+		    // the modification time orders the blobs of a previous run
+			addBlobEntry(cache, md5sum, entry->d_name, (long long) st.st_size, (long long) st.st_mtime);
+			cache->clock = ((long long) st.st_mtime > cache->clock) ? (long long) st.st_mtime : cache->clock;
+			free(path);
+			path = NULL;
+			break;
+		}
+
+		free(path);
+		path = NULL;
+	}
+
+	if (NULL != dir) {
+	    closedir(dir);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Opens the blob cache of a directory (it is created if it
+*           does not exist). The blobs already stored are kept, the
+*           oldest first when some must be evicted.
+* @Params: out: cache = instance of BlobCache to initialize
+*          in: directory = directory of the cache
+*          in: capacity = maximum bytes of the blobs
+* @Return: ----
+*********************************************************************/
+void BLOBCACHE_init(BlobCache *cache, char *directory, long long capacity) {
+	char *path = NULL;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+
+	cache->directory = strdup(directory);
+	cache->capacity = capacity;
+	cache->used = 0;
+	cache->clock = 0;
+	cache->n_uploads = 0;
+	cache->entries = NULL;
+	cache->n_entries = 0;
+	pthread_mutex_init(&cache->mutex, NULL);
+
+	asprintf(&path, ".%s", directory);
+	mkdir(path, 0777);
+	dir = opendir(path);
+	free(path);
+	path = NULL;
+
+	while ((NULL != dir) && (NULL != (entry = readdir(dir)))) {
+	    if (0 == strncmp(entry->d_name, BLOBCACHE_UPLOAD_PREFIX, strlen(BLOBCACHE_UPLOAD_PREFIX))) {
+		    // an upload that was interrupted
+			asprintf(&path, ".%s/%s", directory, entry->d_name);
+			unlink(path);
+			free(path);
+			path = NULL;
+		} else if (BLOBCACHE_checkNames(entry->d_name, NULL)) {
+		    loadBlob(cache, entry->d_name);
+		}
+	}
+
+	if (NULL != dir) {
+	    closedir(dir);
+	}
+
+	// the capacity may be smaller than in the previous run
+	evictBlobs(cache, 0);
+}
+
+/*********************************************************************
+* @Purpose: Checks that a content hash and a filename can be used as
+*           the path of a blob (no path separators or hidden names).
+* @Params: in: md5sum = content hash
+*          in: filename = name of the file (can be NULL)
+* @Return: Returns 1 if they are valid, otherwise 0.
+*********************************************************************/
+char BLOBCACHE_checkNames(char *md5sum, char *filename) {
+	size_t length = strlen(md5sum);
+
+	if ((0 == length) || (BLOBCACHE_MAX_HASH_LENGTH < length) || (length != strspn(md5sum, BLOBCACHE_HASH_CHARACTERS))) {
+	    return (0);
+	}
+
+	return ((NULL == filename) || (('\0' != filename[0]) && ('.' != filename[0]) && (NULL == strchr(filename, '/'))));
+}
+
+/*********************************************************************
+* @Purpose: Searches a blob by its content hash. A found blob becomes
+*           the most recently used.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+*          out: size = size in bytes of the blob (can be NULL)
+*          out: filename = new string with the name of the file (can be
+*               NULL)
+* @Return: Returns BLOBCACHE_FOUND or BLOBCACHE_NOT_FOUND.
+*********************************************************************/
+char BLOBCACHE_lookup(BlobCache *cache, char *md5sum, long long *size, char **filename) {
+	int i = 0;
+
+	pthread_mutex_lock(&cache->mutex);
+	i = searchBlob(cache, md5sum);
+
+	if (-1 != i) {
+	    cache->entries[i].last_use = ++cache->clock;
+
+		if (NULL != size) {
+		    *size = cache->entries[i].size;
+		}
+
+		if (NULL != filename) {
+		    *filename = strdup(cache->entries[i].filename);
+		}
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	return ((-1 != i) ? BLOBCACHE_FOUND : BLOBCACHE_NOT_FOUND);
+}
+
+/*********************************************************************
+* @Purpose: Opens a blob to read it. The file stays readable if the
+*           blob is evicted while it is being sent.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+*          out: size = size in bytes of the blob
+* @Return: Returns the file descriptor, or FD_NOT_FOUND if the blob is
+*          not in the cache.
+*********************************************************************/
+int BLOBCACHE_open(BlobCache *cache, char *md5sum, long long *size) {
+	char *path = NULL;
+	int fd = FD_NOT_FOUND;
+	int i = 0;
+
+	pthread_mutex_lock(&cache->mutex);
+	i = searchBlob(cache, md5sum);
+
+	if (-1 != i) {
+	    cache->entries[i].last_use = ++cache->clock;
+		*size = cache->entries[i].size;
+		asprintf(&path, ".%s/%s/%s", cache->directory, md5sum, cache->entries[i].filename);
+		fd = open(path, O_RDONLY);
+		free(path);
+		path = NULL;
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	return (fd);
+}
+
+/*********************************************************************
+* @Purpose: Gets a new path to receive an upload before it is added.
+* @Params: in/out: cache = opened instance of BlobCache
+* @Return: Returns a new string with the path.
+*********************************************************************/
+char * BLOBCACHE_getUploadPath(BlobCache *cache) {
+	char *path = NULL;
+
+	pthread_mutex_lock(&cache->mutex);
+	asprintf(&path, ".%s/%s%d", cache->directory, BLOBCACHE_UPLOAD_PREFIX, cache->n_uploads++);
+	pthread_mutex_unlock(&cache->mutex);
+
+	return (path);
+}
+
+/*********************************************************************
+* @Purpose: Adds a received (and checked) upload to the cache, evicting
+*           the least recently used blobs until it fits.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: upload_path = path of the received file (it is moved)
+*          in: md5sum = content hash of the file
+*          in: filename = name of the file
+*          in: size = size in bytes of the file
+* @Return: Returns BLOBCACHE_OK if the blob is in the cache, otherwise
+*          BLOBCACHE_KO.
+*********************************************************************/
+char BLOBCACHE_add(BlobCache *cache, char *upload_path, char *md5sum, char *filename, long long size) {
+	char *path = NULL;
+	char error = BLOBCACHE_KO;
+	int i = 0;
+
+	pthread_mutex_lock(&cache->mutex);
+	i = searchBlob(cache, md5sum);
+
+	if (-1 != i) {
+	    // uploaded at the same time by another son
+		cache->entries[i].last_use = ++cache->clock;
+		unlink(upload_path);
+		error = BLOBCACHE_OK;
+	} else if (size <= cache->capacity) {
+	    evictBlobs(cache, size);
+		asprintf(&path, ".%s/%s", cache->directory, md5sum);
+		mkdir(path, 0777);
+		free(path);
+		path = NULL;
+		asprintf(&path, ".%s/%s/%s", cache->directory, md5sum, filename);
+
+		if (0 == rename(upload_path, path)) {
+		    addBlobEntry(cache, md5sum, filename, size, ++cache->clock);
+			error = BLOBCACHE_OK;
+		}
+
+		free(path);
+		path = NULL;
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	if (BLOBCACHE_KO == error) {
+	    unlink(upload_path);
+	}
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Frees the memory of the cache (the blobs stay on disk).
+* @Params: in/out: cache = opened instance of BlobCache
+* @Return: ----
+*********************************************************************/
+void BLOBCACHE_free(BlobCache *cache) {
+	int i = 0;
+
+	for (i = 0; i < cache->n_entries; i++) {
+	    free(cache->entries[i].md5sum);
+		cache->entries[i].md5sum = NULL;
+		free(cache->entries[i].filename);
+		cache->entries[i].filename = NULL;
+	}
+
+	if (NULL != cache->entries) {
+	    free(cache->entries);
+		cache->entries = NULL;
+	}
+
+	cache->n_entries = 0;
+	free(cache->directory);
+	cache->directory = NULL;
+	pthread_mutex_destroy(&cache->mutex);
+}
@@ -0,0 +1,115 @@
+#ifndef _BLOBCACHE_H_
+#define _BLOBCACHE_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "sharedFunctions.h"
+
+/* Constants */
+#define BLOBCACHE_UPLOAD_PREFIX		".upload_"
+#define BLOBCACHE_HASH_CHARACTERS	"0123456789abcdefT"
+#define BLOBCACHE_MAX_HASH_LENGTH	33
+#define BLOBCACHE_FOUND				1
+#define BLOBCACHE_NOT_FOUND			0
+#define BLOBCACHE_OK				0
+#define BLOBCACHE_KO				1
+
+typedef struct {
+	char *md5sum;
+	char *filename;
+	long long size;
+	long long last_use;
+} BlobEntry;
+
+// contents uploaded to Arda, stored as directory/hash/filename
+typedef struct {
+	char *directory;
+	long long capacity;
+	long long used;
+	long long clock;
+	int n_uploads;
+	BlobEntry *entries;
+	int n_entries;
+	pthread_mutex_t mutex;
+} BlobCache;
+
+/*********************************************************************
+* @Purpose: Opens the blob cache of a directory (it is created if it
+*           does not exist). The blobs already stored are kept, the
+*           oldest first when some must be evicted.
+* @Params: out: cache = instance of BlobCache to initialize
+*          in: directory = directory of the cache
+*          in: capacity = maximum bytes of the blobs
+* @Return: ----
+*********************************************************************/
+void BLOBCACHE_init(BlobCache *cache, char *directory, long long capacity);
+
+/*********************************************************************
+* @Purpose: Checks that a content hash and a filename can be used as
+*           the path of a blob (no path separators or hidden names).
+* @Params: in: md5sum = content hash
+*          in: filename = name of the file (can be NULL)
+* @Return: Returns 1 if they are valid, otherwise 0.
+*********************************************************************/
+char BLOBCACHE_checkNames(char *md5sum, char *filename);
+
+/*********************************************************************
+* @Purpose: Searches a blob by its content hash. A found blob becomes
+*           the most recently used.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+*          out: size = size in bytes of the blob (can be NULL)
+*          out: filename = new string with the name of the file (can be
+*               NULL)
+* @Return: Returns BLOBCACHE_FOUND or BLOBCACHE_NOT_FOUND.
+*********************************************************************/
+char BLOBCACHE_lookup(BlobCache *cache, char *md5sum, long long *size, char **filename);
+
+/*********************************************************************
+* @Purpose: Opens a blob to read it. The file stays readable if the
+*           blob is evicted while it is being sent.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: md5sum = content hash
+*          out: size = size in bytes of the blob
+* @Return: Returns the file descriptor, or FD_NOT_FOUND if the blob is
+*          not in the cache.
+*********************************************************************/
+int BLOBCACHE_open(BlobCache *cache, char *md5sum, long long *size);
+
+/*********************************************************************
+* @Purpose: Gets a new path to receive an upload before it is added.
+* @Params: in/out: cache = opened instance of BlobCache
+* @Return: Returns a new string with the path.
+*********************************************************************/
+char * BLOBCACHE_getUploadPath(BlobCache *cache);
+
+/*********************************************************************
+* @Purpose: Adds a received (and checked) upload to the cache, evicting
+*           the least recently used blobs until it fits.
+* @Params: in/out: cache = opened instance of BlobCache
+*          in: upload_path = path of the received file (it is moved)
+*          in: md5sum = content hash of the file
+*          in: filename = name of the file
+*          in: size = size in bytes of the file
+* @Return: Returns BLOBCACHE_OK if the blob is in the cache, otherwise
+*          BLOBCACHE_KO.
+*********************************************************************/
+char BLOBCACHE_add(BlobCache *cache, char *upload_path, char *md5sum, char *filename, long long size);
+
+/*********************************************************************
+* @Purpose: Frees the memory of the cache (the blobs stay on disk).
+* @Params: in/out: cache = opened instance of BlobCache
+* @Return: ----
+*********************************************************************/
+void BLOBCACHE_free(BlobCache *cache);
+
+#endif
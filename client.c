@@ -3,7 +3,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 10/12/2022
-* @Last change: 09/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "client.h"
 
@@ -65,22 +65,12 @@ BidirectionalList getListFromString(char *users, int length) {
     BidirectionalList list = BIDIRECTIONALLIST_create();
 	Element user;
 	char *buffer = NULL;
-	char *tmp = NULL;
-	int i = 0, j = 0;
+	int i = 0;
 
 	while (i < length) {
-	    // get single user
+	    // get single user (an old Arda does not send the host id)
 		buffer = SHAREDFUNCTIONS_splitString(users, GPC_USERS_SEPARATOR, &i);
-		user.username = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &j);
-		user.ip_network = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &j);
-		tmp = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &j);
-		user.port = atoi(tmp);
-		free(tmp);
-		tmp = NULL;
-		tmp = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &j);
-		user.pid = atoi(tmp);
-		free(tmp);
-		tmp = NULL;
+		GPC_parseUserFromFrame(buffer, &user);
 		// add to list
 		BIDIRECTIONALLIST_addAfter(&list, user);
 		// next user
@@ -90,7 +80,6 @@ BidirectionalList getListFromString(char *users, int length) {
 		user.username = NULL;
 		free(user.ip_network);
 		user.ip_network = NULL;
-		j = 0;
 	}
 
 	return (list);
@@ -100,16 +89,20 @@ BidirectionalList getListFromString(char *users, int length) {
 * @Purpose: Manages replies from Arda server.
 * @Params: in/out: c = initialized instance of Client
 *          in/out: users_list = list of users of the client
+*          out: has_list = data of a HAS_LIST reply (NULL if the reply
+*               is of another kind)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 1 if received EXIT, otherwise 0.
 *********************************************************************/
-char CLIENT_manageArdaServerAnswer(Client *c, BidirectionalList *users_list, pthread_mutex_t *mutex) {
+char CLIENT_manageArdaServerAnswer(Client *c, BidirectionalList *users_list, char **has_list, pthread_mutex_t *mutex) {
 	char *buffer = NULL;
 	char *header = NULL;
 	char type = 0x07;
 	char ret_value = 0;
 
+	*has_list = NULL;
+
 	// If the read frame returns 0, it means that the connection has been closed
 	if (GPC_readFrame(c->server_fd, &type, &header, &buffer) == 0) {
 		pthread_mutex_lock(mutex);
@@ -124,6 +117,10 @@ char CLIENT_manageArdaServerAnswer(Client *c, BidirectionalList *users_list, pth
 		*users_list = getListFromString(buffer, (int) strlen(buffer));
 		free(buffer);
 		buffer = NULL;
+	} else if ((0 == strcmp(header, GCP_HAS_LIST_HEADER)) && (GCP_SWARM_TYPE == type) && (NULL != buffer)) {
+		// Manage WHO_HAS (the download is started by the caller)
+		*has_list = buffer;
+		buffer = NULL;
 	} else if ((0 == strcmp(header, GPC_HEADER_CONOK)) && (GCP_EXIT_TYPE == type)) {
 		// Manage EXIT
 		pthread_mutex_lock(mutex);
@@ -216,20 +213,92 @@ char CLIENT_sendMsg(Client *c, char **data, pthread_mutex_t *mutex) {
 	return (0);
 }
 
+/*********************************************************************
+* @Purpose: Reads the answer of the receiver after checking the MD5SUM
+*           of a sent file and closes the connection.
+* @Params: in/out: c = initialized instance of Client
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the file arrived correctly, otherwise 1.
+*********************************************************************/
+char readFileCheckAnswer(Client *c, pthread_mutex_t *mutex) {
+	char *header = NULL;
+	char *ranges = NULL;
+	char *buffer = NULL;
+	char type = 0x07;
+
+	// Get the md5sum answer (a file hashed as a tree also gets the wrong byte ranges)
+	GPC_readFrame(c->server_fd, &type, &header, &ranges);
+
+	if ((NULL == header) || (0 == strcmp(header, GPC_SEND_FILE_HEADER_KO_OUT))) {
+	    // print error message
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg("ERROR: The file sent has lost its integrity\n");
+
+		if (NULL != ranges) {
+		    asprintf(&buffer, FILE_BAD_RANGES_MSG, ranges);
+			printMsg(buffer);
+			free(buffer);
+			buffer = NULL;
+		}
+
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		// free memory and close socket
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != ranges) {
+		    free(ranges);
+			ranges = NULL;
+		}
+
+		close(c->server_fd);
+		return (1);
+	} else {
+	    pthread_mutex_lock(mutex);
+		printMsg("File correctly sent\n");
+		pthread_mutex_unlock(mutex);
+	}
+
+	// close socket and free memory
+	close(c->server_fd);
+	free(header);
+	header = NULL;
+
+	if (NULL != ranges) {
+	    free(ranges);
+		ranges = NULL;
+	}
+
+	return (0);
+}
+
 /*********************************************************************
 * @Purpose: Sends a file to an IluvatarSon in different machines.
 * @Params: in/out: c = initialized instance of Client
 *          in/out: data = string with info about file to send
 *          in/out: fd_file = open file descriptor of the file to send
 *          in: file_size = size in bytes of the file to send
+*          in: tree = leaves of the file, sent after the data so the
+*              receiver can find the wrong ranges (no leaves if the
+*              file is hashed with MD5SUM)
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 0 if no errors, otherwise 1.
 *********************************************************************/
-char CLIENT_sendFile(Client *c, char **data, int *fd_file, int file_size, pthread_mutex_t *mutex) {
+char CLIENT_sendFile(Client *c, char **data, int *fd_file, long long file_size, TreeHash *tree, TransferControl *control, pthread_mutex_t *mutex) {
 	char *header = NULL;
 	char type = 0x07;
 	char *buffer = NULL;
+	long long literal_bytes = 0;
+	char codec = CODEC_NONE;
+	DataPlane dp;
 
 	// check frame
 	if (GCP_FRAME_KO == GCP_checkFrameFormat(GCP_SEND_FILE_TYPE, GCP_SEND_FILE_INFO_HEADER, *data)) {
@@ -260,63 +329,430 @@ char CLIENT_sendFile(Client *c, char **data, int *fd_file, int file_size, pthrea
 	free(*data);
 	*data = NULL;
 
-	// Send the file
-	while (file_size > GPC_FILE_MAX_BYTES) {
-		*data = (char *) malloc(sizeof(char) * (GPC_FILE_MAX_BYTES + 1));
-		read(*fd_file, *data, GPC_FILE_MAX_BYTES);
-		(*data)[GPC_FILE_MAX_BYTES] = '\0';
-		
-		if (GCP_WRITE_KO == GPC_writeFrame(c->server_fd, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_DATA_HEADER, *data, GPC_FILE_MAX_BYTES)) {
-		    free(*data);
-			*data = NULL;
+	// Wait until the receiver tells us whether it already has the content
+	GPC_readFrame(c->server_fd, &type, &header, &buffer);
+
+	if ((NULL != header) && (0 == strcmp(header, GCP_SEND_FILE_HAVE_HEADER))) {
+	    pthread_mutex_lock(mutex);
+		printMsg(FILE_ALREADY_PRESENT_MSG);
+		pthread_mutex_unlock(mutex);
+		// free memory and close file and socket
+		free(header);
+		header = NULL;
+		close(*fd_file);
+		close(c->server_fd);
+		return (0);
+	} else if ((NULL != header) && (NULL != buffer) && (0 == strcmp(header, GCP_SEND_FILE_DELTA_HEADER))) {
+	    // the receiver has an older version of the file, send only the differences
+		free(header);
+		header = NULL;
+
+		// the literal data goes through the data plane, like the data of a full file
+		DATAPLANE_init(&dp, c->server_fd, CODEC_NONE, control);
+
+		if ((DELTA_OK != DELTA_sendDelta(&dp, *fd_file, file_size, buffer, &literal_bytes)) || (DATAPLANE_KO == DATAPLANE_drain(&dp))) {
+		    // a cancelled transfer is not an error
+			if ((NULL == control) || !control->cancel) {
+			    pthread_mutex_lock(mutex);
+				printMsg(COLOR_RED_TXT);
+				printMsg("ERROR: The delta of the file could not be sent\n");
+				printMsg(COLOR_DEFAULT_TXT);
+				pthread_mutex_unlock(mutex);
+			}
+
+			DATAPLANE_free(&dp);
+			free(buffer);
+			buffer = NULL;
 			close(*fd_file);
+			close(c->server_fd);
 			return (1);
 		}
-		
-		free(*data);
-		*data = NULL;
-		file_size -= GPC_FILE_MAX_BYTES;
-	}
 
-	*data = (char *) malloc(sizeof(char) * (file_size + 1));
-	read(*fd_file, *data, file_size);
-	(*data)[file_size] = '\0';
-	
-	if (GCP_WRITE_KO == GPC_writeFrame(c->server_fd, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_DATA_HEADER, *data, file_size)) {
-	    free(*data);
-		*data = NULL;
+		DATAPLANE_free(&dp);
+		free(buffer);
+		buffer = NULL;
+
+		asprintf(&buffer, DELTA_SENT_MSG, literal_bytes, file_size);
+		pthread_mutex_lock(mutex);
+		printMsg(buffer);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		close(*fd_file);
+
+		return (readFileCheckAnswer(c, mutex));
+	} else if ((NULL == header) || (0 != strcmp(header, GCP_SEND_FILE_SEND_HEADER))) {
+	    pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg("ERROR: The receiver did not accept the file\n");
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != buffer) {
+		    free(buffer);
+			buffer = NULL;
+		}
+
 		close(*fd_file);
+		close(c->server_fd);
+		return (1);
+	}
+
+	free(header);
+	header = NULL;
+	// the receiver tells whether the data can be compressed
+	codec = GPC_parseCodec(buffer);
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	// Send the file and wait until the receiver has written all of it
+	DATAPLANE_init(&dp, c->server_fd, codec, control);
+
+	if ((DATAPLANE_KO == DATAPLANE_sendFile(&dp, *fd_file, file_size)) || (DATAPLANE_KO == DATAPLANE_drain(&dp)) ||
+	    (TREEHASH_KO == TREEHASH_sendLeaves(c->server_fd, tree))) {
+	    DATAPLANE_free(&dp);
+	    close(*fd_file);
+		close(c->server_fd);
 		return (1);
 	}
 	
-	// free memory and close file
-	free(*data);
-	*data = NULL;
+	// close file
+	DATAPLANE_free(&dp);
 	close(*fd_file);
-	// Get the md5sum answer
-	GPC_readFrame(c->server_fd, &type, &header, NULL);
 
-	if (0 == strcmp(header, GPC_SEND_FILE_HEADER_KO_OUT)) {
-	    // print error message
+	return (readFileCheckAnswer(c, mutex));
+}
+
+/*********************************************************************
+* @Purpose: Uploads a file to the blob cache of Arda (BLOB_PUT), so
+*           that other sons can download it from Arda. Nothing is sent
+*           if Arda already has the content. Closes the connection.
+* @Params: in/out: c = instance of Client connected to Arda
+*          in: username = user who uploads the file
+*          in: path = path of the file
+*          in: filename = name of the file in Arda
+*          in: md5sum = content hash of the file
+*          in: file_size = size in bytes of the file
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the file is in Arda, otherwise 1.
+*********************************************************************/
+char CLIENT_uploadBlob(Client *c, char *username, char *path, char *filename, char *md5sum, long long file_size, char codec, TransferControl *control, pthread_mutex_t *mutex) {
+	DataPlane dp;
+	char *header = NULL;
+	char *buffer = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	char error = 1;
+	int fd_file = FD_NOT_FOUND;
+
+	asprintf(&buffer, "%s%c%s%c%lld%c%s%c%s", username, GPC_DATA_SEPARATOR, md5sum, GPC_DATA_SEPARATOR, file_size,
+	         GPC_DATA_SEPARATOR, filename, GPC_DATA_SEPARATOR, GPC_getCodecName(codec));
+
+	if (GCP_WRITE_KO != GPC_writeFrame(c->server_fd, GCP_BLOB_TYPE, GCP_BLOB_PUT_HEADER, buffer, strlen(buffer))) {
+	    free(buffer);
+		buffer = NULL;
+		GPC_readFrame(c->server_fd, &type, &header, &buffer);
+
+		if ((GCP_BLOB_TYPE == type) && (NULL != header) && (0 == strcmp(header, GCP_BLOB_OK_HEADER)) && (NULL == buffer)) {
+		    // Arda already has the content
+			error = 0;
+		} else if ((GCP_BLOB_TYPE == type) && (NULL != header) && (0 == strcmp(header, GCP_BLOB_OK_HEADER)) &&
+		           (FD_NOT_FOUND != (fd_file = open(path, O_RDONLY)))) {
+			// Arda tells whether the data can be compressed
+			DATAPLANE_init(&dp, c->server_fd, GPC_parseCodec(buffer), control);
+
+			if ((DATAPLANE_OK == DATAPLANE_sendFile(&dp, fd_file, file_size)) && (DATAPLANE_OK == DATAPLANE_drain(&dp))) {
+			    free(header);
+				header = NULL;
+				free(buffer);
+				buffer = NULL;
+				// result of the check of the upload
+				GPC_readFrame(c->server_fd, &type, &header, &buffer);
+				error = (GCP_BLOB_TYPE != type) || (NULL == header) || (0 != strcmp(header, GCP_BLOB_OK_HEADER));
+			}
+
+			DATAPLANE_free(&dp);
+			close(fd_file);
+		}
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	close(c->server_fd);
+
+	if (error) {
+	    asprintf(&buffer, UPLOAD_REFUSED_MSG, filename);
 		pthread_mutex_lock(mutex);
 		printMsg(COLOR_RED_TXT);
-		printMsg("ERROR: The file sent has lost its integrity\n");
+		printMsg(buffer);
 		printMsg(COLOR_DEFAULT_TXT);
 		pthread_mutex_unlock(mutex);
-		// free memory and close socket
-		free(header);
-		header = NULL;
-		close(c->server_fd);
-		return (1);
 	} else {
+	    asprintf(&buffer, UPLOAD_DONE_MSG, filename, md5sum);
+		pthread_mutex_lock(mutex);
+		printMsg(buffer);
+		pthread_mutex_unlock(mutex);
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Sends the manifest of a batch of files (as many BATCH_LIST
+*           frames as needed).
+* @Params: in: fd_socket = socket connected to the receiver
+*          in: files = files of the batch
+*          in: n_files = number of files of the batch
+* @Return: Returns 0 if no errors, otherwise 1.
+*********************************************************************/
+char sendBatchManifest(int fd_socket, BatchFile *files, int n_files) {
+	char *manifest = (char *) malloc(sizeof(char) * (GPC_BATCH_MAX_BYTES + 1));
+	char *entry = NULL;
+	int length = 0, entry_length = 0;
+	int i = 0;
+
+	manifest[0] = '\0';
+
+	for (i = 0; i <= n_files; i++) {
+		if (i < n_files) {
+		    entry_length = asprintf(&entry, "%s%c%lld%c%s", files[i].filename, GPC_DATA_SEPARATOR, files[i].file_size, GPC_DATA_SEPARATOR, files[i].md5sum);
+		}
+
+		// send the entries that fit in the frame
+		if ((0 < length) && ((i == n_files) || (length + 1 + entry_length > GPC_BATCH_MAX_BYTES))) {
+		    if (GCP_WRITE_KO == GPC_writeFrame(fd_socket, GCP_SEND_FILE_TYPE, GCP_BATCH_LIST_HEADER, manifest, length)) {
+			    if (NULL != entry) {
+				    free(entry);
+					entry = NULL;
+				}
+
+				free(manifest);
+				manifest = NULL;
+				return (1);
+			}
+
+			length = 0;
+		}
+
+		if (i < n_files) {
+		    length += sprintf(manifest + length, (0 == length) ? "%s" : "#%s", entry);
+			free(entry);
+			entry = NULL;
+		}
+	}
+
+	free(manifest);
+	manifest = NULL;
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Sends a batch of files like CLIENT_sendBatch, but keeps the
+*           connection open so more batches can be sent through it.
+* @Params: in/out: c = initialized instance of Client
+*          in: username = user who sends the files
+*          in: files = files of the batch
+*          in: n_files = number of files of the batch
+*          in: directory = directory of the files
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if all the files arrived correctly, otherwise 1.
+*********************************************************************/
+char CLIENT_streamBatch(Client *c, char *username, BatchFile *files, int n_files, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex) {
+	char *buffer = NULL;
+	char *need = NULL;
+	char *result = NULL;
+	char *header = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	DataPlane dp;
+	int fd_file = -1;
+	int n_sent = 0, n_present = 0, n_failed = 0;
+	int i = 0, no_delay = 1;
+
+	// small files are sent as a few small frames that must not wait for the ACK of the previous ones
+	setsockopt(c->server_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+	asprintf(&buffer, "%s%c%d%c%s", username, GPC_DATA_SEPARATOR, n_files, GPC_DATA_SEPARATOR, GPC_getCodecName(codec));
+
+	if ((GCP_WRITE_KO == GPC_writeFrame(c->server_fd, GCP_SEND_FILE_TYPE, GCP_SEND_BATCH_HEADER, buffer, strlen(buffer))) ||
+	    (0 != sendBatchManifest(c->server_fd, files, n_files))) {
+	    free(buffer);
+		buffer = NULL;
+		return (1);
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	// Wait for the codec agreed with the receiver and the files it does not have yet
+	GPC_readFrame(c->server_fd, &type, &header, &buffer);
+	need = (char *) malloc(sizeof(char) * n_files);
+
+	if ((NULL == header) || (0 != strcmp(header, GCP_SEND_FILE_SEND_HEADER)) ||
+	    (GCP_READ_KO == GPC_readBatchFlags(c->server_fd, GCP_BATCH_NEED_HEADER, need, n_files))) {
 	    pthread_mutex_lock(mutex);
-		printMsg("File correctly sent\n");
+		printMsg(COLOR_RED_TXT);
+		printMsg("ERROR: The receiver did not accept the files\n");
+		printMsg(COLOR_DEFAULT_TXT);
 		pthread_mutex_unlock(mutex);
+
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != buffer) {
+		    free(buffer);
+			buffer = NULL;
+		}
+
+		free(need);
+		need = NULL;
+		return (1);
 	}
 
-	// close socket and free memory
-	close(c->server_fd);
+	codec = GPC_parseCodec(buffer);
 	free(header);
 	header = NULL;
-	return (0);
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	// Send the needed files back to back (the window is kept between files)
+	DATAPLANE_init(&dp, c->server_fd, codec, control);
+
+	for (i = 0; i < n_files; i++) {
+	    if (GPC_BATCH_YES != need[i]) {
+		    continue;
+		}
+
+		// a cancelled batch is abandoned (the receiver discards the file in flight)
+		if ((NULL != control) && control->cancel) {
+		    DATAPLANE_free(&dp);
+			free(need);
+			need = NULL;
+			return (1);
+		}
+
+		asprintf(&buffer, ".%s/%s", directory, files[i].filename);
+		fd_file = open(buffer, O_RDONLY);
+		free(buffer);
+		buffer = NULL;
+		asprintf(&buffer, "%d", i);
+
+		if ((-1 == fd_file) ||
+		    (GCP_WRITE_KO == GPC_writeFrame(c->server_fd, GCP_SEND_FILE_TYPE, GCP_BATCH_FILE_HEADER, buffer, strlen(buffer))) ||
+			(DATAPLANE_KO == DATAPLANE_sendFile(&dp, fd_file, files[i].file_size))) {
+		    if (-1 != fd_file) {
+			    close(fd_file);
+			}
+
+			DATAPLANE_free(&dp);
+
+			free(buffer);
+			buffer = NULL;
+			free(need);
+			need = NULL;
+			return (1);
+		}
+
+		free(buffer);
+		buffer = NULL;
+		close(fd_file);
+	}
+
+	GPC_writeFrame(c->server_fd, GCP_SEND_FILE_TYPE, GCP_BATCH_END_HEADER, NULL, 0);
+	DATAPLANE_drain(&dp);
+	DATAPLANE_free(&dp);
+
+	// Get the result of every file
+	result = (char *) malloc(sizeof(char) * n_files);
+
+	if (GCP_READ_KO == GPC_readBatchFlags(c->server_fd, GCP_BATCH_RESULT_HEADER, result, n_files)) {
+	    memset(result, GPC_BATCH_NO, n_files);
+	}
+
+	for (i = 0; i < n_files; i++) {
+	    if (GPC_BATCH_YES != result[i]) {
+		    n_failed++;
+		} else if (GPC_BATCH_YES == need[i]) {
+		    n_sent++;
+		} else {
+		    n_present++;
+		}
+	}
+
+	asprintf(&buffer, BATCH_SENT_MSG, n_sent + n_present, n_present, n_failed);
+	pthread_mutex_lock(mutex);
+
+	if (0 < n_failed) {
+	    printMsg(COLOR_RED_TXT);
+		printMsg(buffer);
+		printMsg(COLOR_DEFAULT_TXT);
+	} else {
+	    printMsg(buffer);
+	}
+
+	pthread_mutex_unlock(mutex);
+
+	// free memory
+	free(buffer);
+	buffer = NULL;
+	free(need);
+	need = NULL;
+	free(result);
+	result = NULL;
+
+	return (0 < n_failed);
+}
+
+/*********************************************************************
+* @Purpose: Sends a batch of files to an IluvatarSon in different
+*           machines through a single connection. The manifest is sent
+*           first and the receiver answers with the files it needs,
+*           which are then sent one after the other without waiting
+*           for any reply.
+* @Params: in/out: c = initialized instance of Client
+*          in: username = user who sends the files
+*          in: files = files of the batch
+*          in: n_files = number of files of the batch
+*          in: directory = directory of the files
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if all the files arrived correctly, otherwise 1.
+*********************************************************************/
+char CLIENT_sendBatch(Client *c, char *username, BatchFile *files, int n_files, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex) {
+	char error = CLIENT_streamBatch(c, username, files, n_files, directory, codec, control, mutex);
+
+	close(c->server_fd);
+
+	return (error);
 }
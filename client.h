@@ -6,18 +6,25 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <fcntl.h>
 
 #include "definitions.h"
 #include "sharedFunctions.h"
 #include "bidirectionallist.h"
 #include "gpc.h"
+#include "delta.h"
+#include "dataplane.h"
+#include "treehash.h"
 
 #define FD_NOT_FOUND 	-1
 #define EXIT_ARDA_MSG	"\nDisconnecting from Arda. See you soon, son of Iluvatar\n\n"
+#define UPLOAD_DONE_MSG			"%s is in Arda, any user can download it with: GET FILE %s\n"
+#define UPLOAD_REFUSED_MSG		"ERROR: Arda did not accept %s (no blob cache, too big or wrong data)\n"
 
 typedef struct {
     int server_fd;
@@ -35,11 +42,13 @@ Client CLIENT_init(char *ip, int port);
 * @Purpose: Manages replies from Arda server.
 * @Params: in/out: c = initialized instance of Client
 *          in/out: users_list = list of users of the client
+*          out: has_list = data of a HAS_LIST reply (NULL if the reply
+*               is of another kind)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 1 if received EXIT, otherwise 0.
 *********************************************************************/
-char CLIENT_manageArdaServerAnswer(Client *c, BidirectionalList *users_list, pthread_mutex_t *mutex);
+char CLIENT_manageArdaServerAnswer(Client *c, BidirectionalList *users_list, char **has_list, pthread_mutex_t *mutex);
 
 /*********************************************************************
 * @Purpose: Sends a message to an IluvatarSon in different machines.
@@ -57,10 +66,70 @@ char CLIENT_sendMsg(Client *c, char **data, pthread_mutex_t *mutex);
 *          in/out: data = string with info about file to send
 *          in/out: fd_file = open file descriptor of the file to send
 *          in: file_size = size in bytes of the file to send
+*          in: tree = leaves of the file, sent after the data so the
+*              receiver can find the wrong ranges (no leaves if the
+*              file is hashed with MD5SUM)
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 0 if no errors, otherwise 1.
 *********************************************************************/
-char CLIENT_sendFile(Client *c, char **data, int *fd_file, int file_size, pthread_mutex_t *mutex);
+char CLIENT_sendFile(Client *c, char **data, int *fd_file, long long file_size, TreeHash *tree, TransferControl *control, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Uploads a file to the blob cache of Arda (BLOB_PUT), so
+*           that other sons can download it from Arda. Nothing is sent
+*           if Arda already has the content. Closes the connection.
+* @Params: in/out: c = instance of Client connected to Arda
+*          in: username = user who uploads the file
+*          in: path = path of the file
+*          in: filename = name of the file in Arda
+*          in: md5sum = content hash of the file
+*          in: file_size = size in bytes of the file
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the file is in Arda, otherwise 1.
+*********************************************************************/
+char CLIENT_uploadBlob(Client *c, char *username, char *path, char *filename, char *md5sum, long long file_size, char codec, TransferControl *control, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Sends a batch of files to an IluvatarSon in different
+*           machines through a single connection. The manifest is sent
+*           first and the receiver answers with the files it needs,
+*           which are then sent one after the other without waiting
+*           for any reply.
+* @Params: in/out: c = initialized instance of Client
+*          in: username = user who sends the files
+*          in: files = files of the batch
+*          in: n_files = number of files of the batch
+*          in: directory = directory of the files
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if all the files arrived correctly, otherwise 1.
+*********************************************************************/
+char CLIENT_sendBatch(Client *c, char *username, BatchFile *files, int n_files, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Sends a batch of files like CLIENT_sendBatch, but keeps the
+*           connection open so more batches can be sent through it.
+* @Params: in/out: c = initialized instance of Client
+*          in: username = user who sends the files
+*          in: files = files of the batch
+*          in: n_files = number of files of the batch
+*          in: directory = directory of the files
+*          in: codec = codec offered to compress the data
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if all the files arrived correctly, otherwise 1.
+*********************************************************************/
+char CLIENT_streamBatch(Client *c, char *username, BatchFile *files, int n_files, char *directory, char codec, TransferControl *control, pthread_mutex_t *mutex);
 
 #endif
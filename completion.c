@@ -0,0 +1,176 @@
+/*********************************************************************
+* @Purpose: Module that carries the replies of the receiver of a file
+*           to its sender, when both IluvatarSons are in the same
+*           machine. Every transfer has its own slot in shared memory,
+*           so the replies of different transfers are never mixed.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "completion.h"
+
+/*********************************************************************
+* @Purpose: Maps the reply slot of a transfer.
+* @Params: out: completion = instance of Completion to initialize
+*          in: fd = file descriptor of the shared memory
+* @Return: Returns COMPLETION_OK if no errors, otherwise COMPLETION_KO.
+*********************************************************************/
+char mapCompletion(Completion *completion, int fd) {
+	void *map = mmap(NULL, sizeof(CompletionSlot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	close(fd);
+
+	if (MAP_FAILED == map) {
+	    completion->slot = NULL;
+		return (COMPLETION_KO);
+	}
+
+	completion->slot = (CompletionSlot *) map;
+
+	return (COMPLETION_OK);
+}
+
+/*********************************************************************
+* @Purpose: Creates the reply slot of a transfer sent by this process.
+* @Params: out: completion = instance of Completion to initialize
+*          in: id = identifier of the transfer in this process
+* @Return: Returns COMPLETION_OK if no errors, otherwise COMPLETION_KO.
+*********************************************************************/
+char COMPLETION_create(Completion *completion, int id) {
+	char *name = NULL;
+	int fd = -1;
+
+	completion->slot = NULL;
+	completion->read = 0;
+	completion->owner_pid = getpid();
+	completion->id = id;
+	asprintf(&name, COMPLETION_NAME, completion->owner_pid, id);
+	// a slot with our PID can only be left by a process that died
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	// the new memory is filled with zeros, so no reply has been posted
+	if ((fd < 0) || (0 != ftruncate(fd, sizeof(CompletionSlot))) || (COMPLETION_KO == mapCompletion(completion, fd))) {
+	    if (fd >= 0) {
+		    close(fd);
+		}
+
+		shm_unlink(name);
+		free(name);
+		name = NULL;
+		return (COMPLETION_KO);
+	}
+
+	free(name);
+	name = NULL;
+
+	return (COMPLETION_OK);
+}
+
+/*********************************************************************
+* @Purpose: Opens the reply slot of a transfer received from another
+*           process of the machine. Its name is removed, so it
+*           disappears once both sides close it.
+* @Params: out: completion = instance of Completion to initialize
+*          in: pid = PID of the sender of the transfer
+*          in: id = identifier of the transfer in the sender
+* @Return: Returns COMPLETION_OK if no errors, otherwise COMPLETION_KO
+*          (e.g. the sender has died).
+*********************************************************************/
+char COMPLETION_open(Completion *completion, int pid, int id) {
+	struct stat st;
+	char *name = NULL;
+	int fd = -1;
+
+	completion->slot = NULL;
+	completion->read = 0;
+	completion->owner_pid = pid;
+	completion->id = id;
+	asprintf(&name, COMPLETION_NAME, pid, id);
+	fd = shm_open(name, O_RDWR, 0600);
+	shm_unlink(name);
+	free(name);
+	name = NULL;
+
+	if (fd < 0) {
+	    return (COMPLETION_KO);
+	}
+
+	if ((0 != fstat(fd, &st)) || ((long long) st.st_size != (long long) sizeof(CompletionSlot))) {
+	    close(fd);
+		return (COMPLETION_KO);
+	}
+
+	return (mapCompletion(completion, fd));
+}
+
+/*********************************************************************
+* @Purpose: Posts a reply for the sender and wakes it up.
+* @Params: in/out: completion = opened instance of Completion
+*          in: reply = string with the reply
+* @Return: ----
+*********************************************************************/
+void COMPLETION_post(Completion *completion, char *reply) {
+	// the sender reads the reply once it sees the counter change, and it does not post
+	// a new one until the sender has answered the previous one
+	strncpy(completion->slot->reply, reply, COMPLETION_REPLY_SIZE - 1);
+	completion->slot->reply[COMPLETION_REPLY_SIZE - 1] = '\0';
+	__atomic_add_fetch(&completion->slot->posted, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &completion->slot->posted, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*********************************************************************
+* @Purpose: Waits for the next reply of the receiver.
+* @Params: in/out: completion = created instance of Completion
+*          in: pid = PID of the receiver
+*          out: reply = string to store the reply
+* @Return: Returns COMPLETION_OK if a reply arrived, or COMPLETION_KO if
+*          the receiver has died.
+*********************************************************************/
+char COMPLETION_wait(Completion *completion, int pid, char **reply) {
+	struct timespec timeout;
+	unsigned int posted = __atomic_load_n(&completion->slot->posted, __ATOMIC_SEQ_CST);
+
+	while (posted == completion->read) {
+	    // the receiver is checked every COMPLETION_WAIT_TIME seconds
+		if ((0 != kill(pid, 0)) && (ESRCH == errno)) {
+		    *reply = NULL;
+			return (COMPLETION_KO);
+		}
+
+		timeout.tv_sec = COMPLETION_WAIT_TIME;
+		timeout.tv_nsec = 0;
+		syscall(SYS_futex, &completion->slot->posted, FUTEX_WAIT, posted, &timeout, NULL, 0);
+		posted = __atomic_load_n(&completion->slot->posted, __ATOMIC_SEQ_CST);
+	}
+
+	completion->read = posted;
+	*reply = strdup(completion->slot->reply);
+
+	return (COMPLETION_OK);
+}
+
+/*********************************************************************
+* @Purpose: Unmaps the reply slot. The sender also removes its name, in
+*           case the receiver never opened it.
+* @Params: in/out: completion = instance of Completion
+* @Return: ----
+*********************************************************************/
+void COMPLETION_close(Completion *completion) {
+	char *name = NULL;
+
+	if (NULL == completion->slot) {
+	    return;
+	}
+
+	if (getpid() == completion->owner_pid) {
+	    asprintf(&name, COMPLETION_NAME, completion->owner_pid, completion->id);
+		shm_unlink(name);
+		free(name);
+		name = NULL;
+	}
+
+	munmap(completion->slot, sizeof(CompletionSlot));
+	completion->slot = NULL;
+}
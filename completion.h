@@ -0,0 +1,86 @@
+#ifndef _COMPLETION_H_
+#define _COMPLETION_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* Constants */
+#define COMPLETION_NAME				"/iluvatar_reply_%d_%d"
+#define COMPLETION_REPLY_SIZE		64
+#define COMPLETION_WAIT_TIME		1
+#define COMPLETION_OK				0
+#define COMPLETION_KO				1
+
+// shared memory of a transfer: the receiver posts its replies and the
+// sender sleeps on the counter until the next one arrives
+typedef struct {
+	unsigned int posted;
+	char reply[COMPLETION_REPLY_SIZE];
+} CompletionSlot;
+
+// reply slot of a transfer between two sons of the same machine
+typedef struct {
+	CompletionSlot *slot;
+	unsigned int read;
+	int owner_pid;
+	int id;
+} Completion;
+
+/*********************************************************************
+* @Purpose: Creates the reply slot of a transfer sent by this process.
+* @Params: out: completion = instance of Completion to initialize
+*          in: id = identifier of the transfer in this process
+* @Return: Returns COMPLETION_OK if no errors, otherwise COMPLETION_KO.
+*********************************************************************/
+char COMPLETION_create(Completion *completion, int id);
+
+/*********************************************************************
+* @Purpose: Opens the reply slot of a transfer received from another
+*           process of the machine. Its name is removed, so it
+*           disappears once both sides close it.
+* @Params: out: completion = instance of Completion to initialize
+*          in: pid = PID of the sender of the transfer
+*          in: id = identifier of the transfer in the sender
+* @Return: Returns COMPLETION_OK if no errors, otherwise COMPLETION_KO
+*          (e.g. the sender has died).
+*********************************************************************/
+char COMPLETION_open(Completion *completion, int pid, int id);
+
+/*********************************************************************
+* @Purpose: Posts a reply for the sender and wakes it up.
+* @Params: in/out: completion = opened instance of Completion
+*          in: reply = string with the reply
+* @Return: ----
+*********************************************************************/
+void COMPLETION_post(Completion *completion, char *reply);
+
+/*********************************************************************
+* @Purpose: Waits for the next reply of the receiver.
+* @Params: in/out: completion = created instance of Completion
+*          in: pid = PID of the receiver
+*          out: reply = string to store the reply
+* @Return: Returns COMPLETION_OK if a reply arrived, or COMPLETION_KO if
+*          the receiver has died.
+*********************************************************************/
+char COMPLETION_wait(Completion *completion, int pid, char **reply);
+
+/*********************************************************************
+* @Purpose: Unmaps the reply slot. The sender also removes its name, in
+*           case the receiver never opened it.
+* @Params: in/out: completion = instance of Completion
+* @Return: ----
+*********************************************************************/
+void COMPLETION_close(Completion *completion);
+
+#endif
@@ -0,0 +1,668 @@
+/*********************************************************************
+* @Purpose: Module that moves the content of files through a socket
+*           with a sliding window (credits granted by the receiver
+*           through FILE_ACK frames) and a chunk size adapted to the
+*           measured throughput and round trip time, compressing the
+*           data when the receiver agreed to it and sending only the
+*           size of the parts of zeros.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "dataplane.h"
+
+/*********************************************************************
+* @Purpose: Initializes the flow control state of a connection. The
+*           same state is kept for all the files sent through it.
+* @Params: in/out: dp = instance of DataPlane to initialize
+*          in: fd_socket = socket connected to the other side
+*          in: codec = codec agreed with the receiver to compress the
+*              data (CODEC_NONE on the receiver side, which accepts
+*              any of them)
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+* @Return: ----
+*********************************************************************/
+void DATAPLANE_init(DataPlane *dp, int fd_socket, char codec, TransferControl *control) {
+	dp->fd_socket = fd_socket;
+	dp->bytes = 0;
+	dp->acked = 0;
+	// both sides know the initial window, so no extra round trip is needed
+	dp->window = DATAPLANE_INITIAL_WINDOW;
+	dp->chunk_size = DATAPLANE_INITIAL_CHUNK;
+	dp->rate = 0;
+	dp->rtt = 0;
+	dp->last_ack_time = 0;
+	dp->first_chunk = 0;
+	dp->n_chunks = 0;
+	dp->headers = NULL;
+	dp->codec = codec;
+	dp->packed = NULL;
+	dp->control = control;
+}
+
+/*********************************************************************
+* @Purpose: Updates the round trip time, the throughput and the chunk
+*           size with a new acknowledgement.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: acked = total bytes acknowledged by the receiver
+*          in: window = window granted by the receiver
+* @Return: ----
+*********************************************************************/
+void updateEstimates(DataPlane *dp, long long acked, long long window) {
+	long long now = SHAREDFUNCTIONS_getTimeMicros();
+	long long rtt = -1;
+	long long target = 0;
+	double rate = 0;
+
+	// the round trip time is measured with the last chunk fully acknowledged
+	while ((0 < dp->n_chunks) && (dp->inflight[dp->first_chunk].end_offset <= acked)) {
+	    rtt = now - dp->inflight[dp->first_chunk].send_time;
+		dp->first_chunk = (dp->first_chunk + 1) % DATAPLANE_MAX_INFLIGHT;
+		dp->n_chunks--;
+	}
+
+	if (0 <= rtt) {
+	    dp->rtt = (0 == dp->rtt) ? rtt : (7 * dp->rtt + rtt) / 8;
+	}
+
+	// the throughput is only measured while there was data in flight
+	if ((0 < dp->last_ack_time) && (now > dp->last_ack_time) && (acked > dp->acked)) {
+	    rate = (double) (acked - dp->acked) / (now - dp->last_ack_time);
+		dp->rate = (0 == dp->rate) ? rate : 0.75 * dp->rate + 0.25 * rate;
+	}
+
+	dp->last_ack_time = (0 < dp->n_chunks) ? now : 0;
+	dp->acked = acked;
+	dp->window = (window > DATAPLANE_MAX_WINDOW) ? DATAPLANE_MAX_WINDOW : window;
+
+	if (0 == dp->rate) {
+	    return;
+	}
+
+	// a quarter of the bandwidth-delay product, but at least the bytes of DATAPLANE_CHUNK_TIME
+	target = (long long) (dp->rate * dp->rtt / 4);
+
+	if (target < (long long) (dp->rate * DATAPLANE_CHUNK_TIME)) {
+	    target = (long long) (dp->rate * DATAPLANE_CHUNK_TIME);
+	}
+
+	if (target > DATAPLANE_MAX_CHUNK) {
+	    target = DATAPLANE_MAX_CHUNK;
+	}
+
+	if (target > dp->window / 2) {
+	    target = dp->window / 2;
+	}
+
+	target -= target % DATAPLANE_MIN_CHUNK;
+	dp->chunk_size = (target < DATAPLANE_MIN_CHUNK) ? DATAPLANE_MIN_CHUNK : (int) target;
+}
+
+/*********************************************************************
+* @Purpose: Reads a FILE_ACK frame from the receiver.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: wait = 1 to wait for the frame, 0 to return if there is
+*              nothing to read
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char readAck(DataPlane *dp, char wait) {
+	struct pollfd pfd;
+	char *header = NULL;
+	char *data = NULL;
+	char *acked = NULL;
+	char *window = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	int i = 0;
+
+	if (!wait) {
+	    pfd.fd = dp->fd_socket;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, 0) <= 0) {
+		    return (DATAPLANE_OK);
+		}
+	}
+
+	if ((0 == GPC_readFrame(dp->fd_socket, &type, &header, &data)) || (NULL == data) ||
+	    (0 != strcmp(header, GCP_FILE_ACK_HEADER))) {
+	    if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != data) {
+		    free(data);
+			data = NULL;
+		}
+
+		return (DATAPLANE_KO);
+	}
+
+	// data is in the format: acked + GPC_DATA_SEPARATOR + window
+	acked = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	window = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	updateEstimates(dp, atoll(acked), atoll(window));
+
+	// free memory
+	free(acked);
+	acked = NULL;
+	free(window);
+	window = NULL;
+	free(header);
+	header = NULL;
+	free(data);
+	data = NULL;
+
+	return (DATAPLANE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Sends a FILE_ACK frame with the bytes written to disk.
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char sendAck(DataPlane *dp) {
+	char *data = NULL;
+	char ok = 0;
+
+	asprintf(&data, "%lld%c%d", dp->bytes, GPC_DATA_SEPARATOR, DATAPLANE_MAX_WINDOW);
+	ok = GPC_writeFrame(dp->fd_socket, GCP_SEND_FILE_TYPE, GCP_FILE_ACK_HEADER, data, strlen(data));
+	dp->acked = dp->bytes;
+	free(data);
+	data = NULL;
+
+	return ((GCP_WRITE_OK == ok) ? DATAPLANE_OK : DATAPLANE_KO);
+}
+
+/*********************************************************************
+* @Purpose: Checks if a chunk only has zeros. The first bytes are
+*           checked one by one and the rest is compared with the bytes
+*           before it, so the work is done by memcmp (vectorized).
+* @Params: in: data = data of the chunk
+*          in: n = number of bytes of the chunk
+* @Return: Returns 1 if all the bytes are zero, otherwise 0.
+*********************************************************************/
+char isZeroBlock(char *data, int n) {
+	int i = 0;
+
+	for (i = 0; (i < n) && (i < DATAPLANE_ZERO_PREFIX); i++) {
+	    if (0 != data[i]) {
+		    return (0);
+		}
+	}
+
+	return ((n <= DATAPLANE_ZERO_PREFIX) || (0 == memcmp(data, data + DATAPLANE_ZERO_PREFIX, n - DATAPLANE_ZERO_PREFIX)));
+}
+
+/*********************************************************************
+* @Purpose: Sends a FILE_HOLE frame with the size of a part of the file
+*           that only has zeros (the receiver does not write it).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: length = number of bytes of the hole
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char sendHole(DataPlane *dp, long long length) {
+	char *data = NULL;
+	char ok = 0;
+
+	asprintf(&data, "%lld", length);
+	ok = GPC_writeFrame(dp->fd_socket, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_HOLE_HEADER, data, strlen(data));
+	free(data);
+	data = NULL;
+
+	if (NULL != dp->control) {
+	    dp->control->bytes += length;
+	}
+
+	return ((GCP_WRITE_OK == ok) ? DATAPLANE_OK : DATAPLANE_KO);
+}
+
+/*********************************************************************
+* @Purpose: Prepares the frames of a chunk: every piece of at most
+*           GPC_FILE_MAX_BYTES goes in a FILE_DATA frame that points to
+*           the data, or in a FILE_LZ frame if compressing it saves at
+*           least 1/DATAPLANE_MIN_SAVING of its size.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: data = data of the chunk
+*          in: n = number of bytes of the chunk
+*          out: size = number of bytes of the frames
+* @Return: Returns the number of entries of dp->iov used.
+*********************************************************************/
+int buildDataFrames(DataPlane *dp, char *data, int n, int *size) {
+	char *header = NULL;
+	char compress = 0;
+	int offset = 0, length = 0, packed = 0, i = 0;
+
+	// only the chunks that look compressible are tried
+	compress = (CODEC_LZ == dp->codec) && (NULL != dp->packed) && LZ_isCompressible(data, n);
+	*size = 0;
+
+	for (offset = 0; offset < n; offset += length, i += 2) {
+	    length = (n - offset > GPC_FILE_MAX_BYTES) ? GPC_FILE_MAX_BYTES : n - offset;
+		packed = compress ? LZ_compress(data + offset, length, dp->packed + offset, length - length / DATAPLANE_MIN_SAVING) : 0;
+		header = (0 < packed) ? GCP_SEND_FILE_LZ_HEADER : GCP_SEND_FILE_DATA_HEADER;
+		// the room of every header is the one of the longest (FILE_DATA)
+		dp->iov[i].iov_base = dp->headers + (i / 2) * GPC_FRAME_OVERHEAD(GCP_SEND_FILE_DATA_HEADER);
+		dp->iov[i].iov_len = GPC_buildFrameHeader(dp->iov[i].iov_base, GCP_SEND_FILE_TYPE, header, (0 < packed) ? packed : length);
+		dp->iov[i + 1].iov_base = (0 < packed) ? dp->packed + offset : data + offset;
+		dp->iov[i + 1].iov_len = (0 < packed) ? packed : length;
+		*size += dp->iov[i].iov_len + dp->iov[i + 1].iov_len;
+	}
+
+	return (i);
+}
+
+/*********************************************************************
+* @Purpose: Allocates the buffers used to send the frames of a chunk.
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: ----
+*********************************************************************/
+void allocateSendBuffers(DataPlane *dp) {
+	if (NULL == dp->headers) {
+	    dp->headers = (char *) malloc(sizeof(char) * DATAPLANE_MAX_FRAMES * GPC_FRAME_OVERHEAD(GCP_SEND_FILE_DATA_HEADER));
+	}
+
+	// the compressed frames of a chunk are kept until it is written
+	if ((CODEC_NONE != dp->codec) && (NULL == dp->packed)) {
+	    dp->packed = (char *) malloc(sizeof(char) * DATAPLANE_MAX_CHUNK);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Gets the size of the next chunk to send.
+* @Params: in: dp = initialized instance of DataPlane
+*          in: length = number of bytes left to send
+* @Return: Returns the number of bytes of the chunk.
+*********************************************************************/
+int getChunkSize(DataPlane *dp, long long length) {
+	int n = (length > dp->chunk_size) ? dp->chunk_size : (int) length;
+
+	// a limited transfer is paced in small chunks
+	if ((0 < SCHEDULER_chunkLimit(dp->control)) && (n > SCHEDULER_chunkLimit(dp->control))) {
+	    n = SCHEDULER_chunkLimit(dp->control);
+	}
+
+	return (n);
+}
+
+/*********************************************************************
+* @Purpose: Waits until the window has room for a chunk and consumes the
+*           acknowledgements already received.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: n = number of bytes of the chunk
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char waitWindow(DataPlane *dp, int n) {
+	char error = DATAPLANE_OK;
+
+	while ((DATAPLANE_OK == error) && ((dp->bytes - dp->acked + n > dp->window) || (DATAPLANE_MAX_INFLIGHT == dp->n_chunks))) {
+	    error = readAck(dp, 1);
+	}
+
+	return ((DATAPLANE_OK == error) ? readAck(dp, 0) : DATAPLANE_KO);
+}
+
+/*********************************************************************
+* @Purpose: Sends a chunk of data that fits in the window, as a hole if
+*           it only has zeros.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: data = data of the chunk
+*          in: n = number of bytes of the chunk
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char sendChunk(DataPlane *dp, char *data, int n) {
+	int size = 0, n_iov = 0;
+
+	// a chunk of zeros is sent as a hole too
+	if (isZeroBlock(data, n)) {
+	    return (sendHole(dp, n));
+	}
+
+	// a chunk bigger than a frame is sent as several frames in a single write (the data is not copied)
+	n_iov = buildDataFrames(dp, data, n, &size);
+
+	// wait for the turn of the chunk (the limits count the bytes sent, compressed or not)
+	if ((SCHEDULER_KO == SCHEDULER_acquire(dp->control, size)) || (size != SHAREDFUNCTIONS_writevFull(dp->fd_socket, dp->iov, n_iov))) {
+	    return (DATAPLANE_KO);
+	}
+
+	// remember the chunk to measure the round trip time
+	dp->bytes += n;
+	dp->inflight[(dp->first_chunk + dp->n_chunks) % DATAPLANE_MAX_INFLIGHT].end_offset = dp->bytes;
+	dp->inflight[(dp->first_chunk + dp->n_chunks) % DATAPLANE_MAX_INFLIGHT].send_time = SHAREDFUNCTIONS_getTimeMicros();
+	dp->n_chunks++;
+
+	if (0 == dp->last_ack_time) {
+	    dp->last_ack_time = SHAREDFUNCTIONS_getTimeMicros();
+	}
+
+	if (NULL != dp->control) {
+	    dp->control->bytes += n;
+	}
+
+	return (DATAPLANE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Sends a range of the content of a file, the same way as
+*           DATAPLANE_sendFile (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the whole file
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendRange(DataPlane *dp, int fd_file, long long file_size, long long offset, long long length) {
+	FileSource src;
+	char *data = NULL;
+	long long region = 0;
+	int n = 0;
+	char error = DATAPLANE_OK, hole = 0;
+
+	allocateSendBuffers(dp);
+
+	if (FILESOURCE_KO == FILESOURCE_open(&src, fd_file, file_size, DATAPLANE_MAX_CHUNK)) {
+	    return (DATAPLANE_KO);
+	}
+
+	FILESOURCE_skip(&src, offset);
+
+	while (length > 0) {
+	    if ((NULL != dp->control) && dp->control->cancel) {
+		    error = DATAPLANE_KO;
+			break;
+		}
+
+		// the holes of the file are not read, only their size is sent (they take no room in the window)
+		region = FILESOURCE_getRegion(&src, &hole);
+		region = (region > length) ? length : region;
+
+		if (hole) {
+		    if (DATAPLANE_KO == sendHole(dp, region)) {
+			    error = DATAPLANE_KO;
+				break;
+			}
+
+			FILESOURCE_skip(&src, region);
+			length -= region;
+			continue;
+		}
+
+	    n = getChunkSize(dp, length);
+		n = (region < n) ? (int) region : n;
+
+		// wait for credit if the window is full
+		if ((DATAPLANE_KO == waitWindow(dp, n)) || (NULL == (data = FILESOURCE_next(&src, n))) || (DATAPLANE_KO == sendChunk(dp, data, n))) {
+		    error = DATAPLANE_KO;
+			break;
+		}
+
+		length -= n;
+	}
+
+	FILESOURCE_close(&src);
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Sends data that is already in memory, the same way as
+*           DATAPLANE_sendFile (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: data = data to send
+*          in: length = number of bytes to send
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendBuffer(DataPlane *dp, char *data, long long length) {
+	int n = 0;
+
+	allocateSendBuffers(dp);
+
+	while (length > 0) {
+	    if ((NULL != dp->control) && dp->control->cancel) {
+		    return (DATAPLANE_KO);
+		}
+
+		n = getChunkSize(dp, length);
+
+		if ((DATAPLANE_KO == waitWindow(dp, n)) || (DATAPLANE_KO == sendChunk(dp, data, n))) {
+		    return (DATAPLANE_KO);
+		}
+
+		data += n;
+		length -= n;
+	}
+
+	return (DATAPLANE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Sends the content of a file in FILE_DATA frames, keeping
+*           at most the window granted by the receiver in flight and
+*           adapting the chunk size to the measured throughput and
+*           round trip time (sender side). The data is read ahead of
+*           the chunk in flight. With a codec, the frames of the chunks
+*           that look compressible are sent compressed (FILE_LZ) when
+*           it saves space. The holes of the file and the chunks of
+*           zeros are sent as FILE_HOLE frames with their size. Stops
+*           after the chunk in flight if the transfer is cancelled.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the file to send
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendFile(DataPlane *dp, int fd_file, long long file_size) {
+	return (DATAPLANE_sendRange(dp, fd_file, file_size, 0, file_size));
+}
+
+/*********************************************************************
+* @Purpose: Waits until the receiver has acknowledged all the data sent
+*           (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_drain(DataPlane *dp) {
+	while (dp->acked < dp->bytes) {
+	    if (DATAPLANE_KO == readAck(dp, 1)) {
+		    return (DATAPLANE_KO);
+		}
+	}
+
+	return (DATAPLANE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Gets the original data of a FILE_DATA, FILE_LZ or FILE_HOLE
+*           frame (a compressed frame is decompressed into dp->packed).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: header = header of the frame
+*          in: buffer = data of the frame
+*          in: length = number of bytes of the data of the frame
+*          out: data = original data (in buffer or in dp->packed), or
+*               NULL if the frame is a hole
+* @Return: Returns the number of bytes of original data (or of the
+*          hole), or DATAPLANE_NO_DATA if the frame is not valid.
+*********************************************************************/
+long long decodeDataFrame(DataPlane *dp, char *header, char *buffer, unsigned short length, char **data) {
+	long long n = DATAPLANE_NO_DATA;
+
+	if ((NULL == header) || (NULL == buffer)) {
+	    n = DATAPLANE_NO_DATA;
+	} else if (0 == strcmp(header, GCP_SEND_FILE_DATA_HEADER)) {
+	    *data = buffer;
+		n = length;
+	} else if (0 == strcmp(header, GCP_SEND_FILE_LZ_HEADER)) {
+	    if (NULL == dp->packed) {
+		    dp->packed = (char *) malloc(sizeof(char) * GPC_FILE_MAX_BYTES);
+		}
+
+		*data = dp->packed;
+		n = LZ_decompress(buffer, length, dp->packed, GPC_FILE_MAX_BYTES);
+		n = (LZ_KO == n) ? DATAPLANE_NO_DATA : n;
+	} else if (0 == strcmp(header, GCP_SEND_FILE_HOLE_HEADER)) {
+	    *data = NULL;
+		n = atoll(buffer);
+		n = (0 < n) ? n : DATAPLANE_NO_DATA;
+	}
+
+	return (n);
+}
+
+/*********************************************************************
+* @Purpose: Reads a FILE_DATA, FILE_LZ or FILE_HOLE frame and gets its
+*           original data.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          out: buffer = data of the frame (must be freed)
+*          out: data = original data (in buffer or in dp->packed), or
+*               NULL if the frame is a hole
+* @Return: Returns the number of bytes of original data (or of the
+*          hole), or DATAPLANE_NO_DATA if the frame is not valid.
+*********************************************************************/
+long long readDataFrame(DataPlane *dp, char **buffer, char **data) {
+	char *header = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	unsigned short length = 0;
+	long long n = DATAPLANE_NO_DATA;
+
+	if (0 != GPC_readFrameWithLength(dp->fd_socket, &type, &header, buffer, &length)) {
+	    n = decodeDataFrame(dp, header, *buffer, length, data);
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	return (n);
+}
+
+/*********************************************************************
+* @Purpose: Receives the content of a file sent in FILE_DATA (or
+*           FILE_LZ) frames and acknowledges it once handed to the
+*           writer (receiver side). FILE_HOLE frames become holes of
+*           the file.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in/out: writer = opened writer of the received file
+*          in: file_size = size in bytes of the file
+* @Return: Returns DATAPLANE_OK if the whole file was received,
+*          otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_receiveFile(DataPlane *dp, FileWriter *writer, long long file_size) {
+	char *buffer = NULL;
+	char *data = NULL;
+	long long length = 0;
+	char hole = 0;
+
+	while (file_size > 0) {
+		// Read the frame (the MD5SUM is checked later against the original data)
+		length = readDataFrame(dp, &buffer, &data);
+		hole = (NULL == data);
+
+		if ((DATAPLANE_NO_DATA == length) || (length > file_size) ||
+		    (hole && (FILEWRITER_KO == FILEWRITER_skip(writer, length))) ||
+			(!hole && (FILEWRITER_KO == FILEWRITER_write(writer, data, (int) length)))) {
+		    if (NULL != buffer) {
+			    free(buffer);
+				buffer = NULL;
+			}
+
+			return (DATAPLANE_KO);
+		}
+
+		// free memory
+		free(buffer);
+		buffer = NULL;
+		// next fragment (holes are not acknowledged, they take no room in the window)
+		dp->bytes += hole ? 0 : length;
+		file_size -= length;
+
+		// the data is acknowledged once handed to the writer, which blocks while its buffers are full
+		if ((dp->bytes - dp->acked >= DATAPLANE_ACK_BYTES) && (DATAPLANE_KO == sendAck(dp))) {
+		    return (DATAPLANE_KO);
+		}
+	}
+
+	return (DATAPLANE_acknowledge(dp));
+}
+
+/*********************************************************************
+* @Purpose: Checks if a frame carries file data (FILE_DATA, FILE_LZ or
+*           FILE_HOLE).
+* @Params: in: header = header of the frame
+* @Return: Returns 1 if it is a data frame, otherwise 0.
+*********************************************************************/
+char DATAPLANE_isDataFrame(char *header) {
+	return ((NULL != header) && ((0 == strcmp(header, GCP_SEND_FILE_DATA_HEADER)) ||
+	        (0 == strcmp(header, GCP_SEND_FILE_LZ_HEADER)) || (0 == strcmp(header, GCP_SEND_FILE_HOLE_HEADER))));
+}
+
+/*********************************************************************
+* @Purpose: Hands the data of a FILE_DATA, FILE_LZ or FILE_HOLE frame
+*           already read to the writer and acknowledges it like
+*           DATAPLANE_receiveFile (receiver side). The data is
+*           acknowledged even if it could not be written, so the sender
+*           is never left waiting for the window.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in/out: writer = opened writer of the received file (NULL to
+*                  discard the data)
+*          in: header = header of the frame
+*          in: buffer = data of the frame
+*          in: length = number of bytes of the data of the frame
+* @Return: Returns DATAPLANE_OK if the data was written, otherwise
+*          DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_receiveFrame(DataPlane *dp, FileWriter *writer, char *header, char *buffer, unsigned short length) {
+	char *data = NULL;
+	long long n = 0;
+	char error = DATAPLANE_OK;
+
+	n = decodeDataFrame(dp, header, buffer, length, &data);
+
+	if (DATAPLANE_NO_DATA == n) {
+	    return (DATAPLANE_KO);
+	}
+
+	if ((NULL == writer) || ((NULL == data) && (FILEWRITER_KO == FILEWRITER_skip(writer, n))) ||
+	    ((NULL != data) && (FILEWRITER_KO == FILEWRITER_write(writer, data, (int) n)))) {
+	    error = DATAPLANE_KO;
+	}
+
+	// holes are not acknowledged, they take no room in the window
+	dp->bytes += (NULL == data) ? 0 : n;
+
+	if ((dp->bytes - dp->acked >= DATAPLANE_ACK_BYTES) && (DATAPLANE_KO == sendAck(dp))) {
+	    error = DATAPLANE_KO;
+	}
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Acknowledges all the data received (receiver side).
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_acknowledge(DataPlane *dp) {
+	return ((dp->bytes > dp->acked) ? sendAck(dp) : DATAPLANE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Frees the memory of a DataPlane.
+* @Params: in/out: dp = instance of DataPlane to free
+* @Return: ----
+*********************************************************************/
+void DATAPLANE_free(DataPlane *dp) {
+	if (NULL != dp->headers) {
+	    free(dp->headers);
+		dp->headers = NULL;
+	}
+
+	if (NULL != dp->packed) {
+	    free(dp->packed);
+		dp->packed = NULL;
+	}
+}
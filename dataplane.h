@@ -0,0 +1,172 @@
+#ifndef _DATAPLANE_H_
+#define _DATAPLANE_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#include "sharedFunctions.h"
+#include "gpc.h"
+#include "filewriter.h"
+#include "filesource.h"
+#include "scheduler.h"
+#include "lz.h"
+
+/* Constants */
+#define DATAPLANE_MIN_CHUNK			4096
+#define DATAPLANE_MAX_CHUNK			1048576
+#define DATAPLANE_INITIAL_CHUNK		65536
+#define DATAPLANE_INITIAL_WINDOW	1048576
+#define DATAPLANE_MAX_WINDOW		8388608
+#define DATAPLANE_ACK_BYTES			262144
+#define DATAPLANE_MAX_INFLIGHT		256
+#define DATAPLANE_CHUNK_TIME		2000
+#define DATAPLANE_MAX_FRAMES		(DATAPLANE_MAX_CHUNK / GPC_FILE_MAX_BYTES + 1)
+#define DATAPLANE_MIN_SAVING		16
+#define DATAPLANE_NO_DATA			-1
+#define DATAPLANE_ZERO_PREFIX		16
+#define DATAPLANE_OK				0
+#define DATAPLANE_KO				1
+
+typedef struct {
+	long long end_offset;
+	long long send_time;
+} DataChunk;
+
+typedef struct {
+	int fd_socket;
+	long long bytes;
+	long long acked;
+	long long window;
+	int chunk_size;
+	double rate;
+	long long rtt;
+	long long last_ack_time;
+	DataChunk inflight[DATAPLANE_MAX_INFLIGHT];
+	int first_chunk;
+	int n_chunks;
+	char *headers;
+	char codec;
+	char *packed;
+	struct iovec iov[2 * DATAPLANE_MAX_FRAMES];
+	TransferControl *control;
+} DataPlane;
+
+/*********************************************************************
+* @Purpose: Initializes the flow control state of a connection. The
+*           same state is kept for all the files sent through it.
+* @Params: in/out: dp = instance of DataPlane to initialize
+*          in: fd_socket = socket connected to the other side
+*          in: codec = codec agreed with the receiver to compress the
+*              data (CODEC_NONE on the receiver side, which accepts
+*              any of them)
+*          in/out: control = progress and cancellation of the transfer
+*                  (can be NULL)
+* @Return: ----
+*********************************************************************/
+void DATAPLANE_init(DataPlane *dp, int fd_socket, char codec, TransferControl *control);
+
+/*********************************************************************
+* @Purpose: Sends the content of a file in FILE_DATA frames, keeping
+*           at most the window granted by the receiver in flight and
+*           adapting the chunk size to the measured throughput and
+*           round trip time (sender side). The data is read ahead of
+*           the chunk in flight. With a codec, the frames of the chunks
+*           that look compressible are sent compressed (FILE_LZ) when
+*           it saves space. The holes of the file and the chunks of
+*           zeros are sent as FILE_HOLE frames with their size. Stops
+*           after the chunk in flight if the transfer is cancelled.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the file to send
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendFile(DataPlane *dp, int fd_file, long long file_size);
+
+/*********************************************************************
+* @Purpose: Sends a range of the content of a file, the same way as
+*           DATAPLANE_sendFile (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the whole file
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendRange(DataPlane *dp, int fd_file, long long file_size, long long offset, long long length);
+
+/*********************************************************************
+* @Purpose: Sends data that is already in memory, the same way as
+*           DATAPLANE_sendFile (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in: data = data to send
+*          in: length = number of bytes to send
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_sendBuffer(DataPlane *dp, char *data, long long length);
+
+/*********************************************************************
+* @Purpose: Waits until the receiver has acknowledged all the data sent
+*           (sender side).
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_drain(DataPlane *dp);
+
+/*********************************************************************
+* @Purpose: Receives the content of a file sent in FILE_DATA (or
+*           FILE_LZ) frames and acknowledges it once handed to the
+*           writer (receiver side). FILE_HOLE frames become holes of
+*           the file.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in/out: writer = opened writer of the received file
+*          in: file_size = size in bytes of the file
+* @Return: Returns DATAPLANE_OK if the whole file was received,
+*          otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_receiveFile(DataPlane *dp, FileWriter *writer, long long file_size);
+
+/*********************************************************************
+* @Purpose: Checks if a frame carries file data (FILE_DATA, FILE_LZ or
+*           FILE_HOLE).
+* @Params: in: header = header of the frame
+* @Return: Returns 1 if it is a data frame, otherwise 0.
+*********************************************************************/
+char DATAPLANE_isDataFrame(char *header);
+
+/*********************************************************************
+* @Purpose: Hands the data of a FILE_DATA, FILE_LZ or FILE_HOLE frame
+*           already read to the writer and acknowledges it like
+*           DATAPLANE_receiveFile (receiver side). The data is
+*           acknowledged even if it could not be written, so the sender
+*           is never left waiting for the window.
+* @Params: in/out: dp = initialized instance of DataPlane
+*          in/out: writer = opened writer of the received file (NULL to
+*                  discard the data)
+*          in: header = header of the frame
+*          in: buffer = data of the frame
+*          in: length = number of bytes of the data of the frame
+* @Return: Returns DATAPLANE_OK if the data was written, otherwise
+*          DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_receiveFrame(DataPlane *dp, FileWriter *writer, char *header, char *buffer, unsigned short length);
+
+/*********************************************************************
+* @Purpose: Acknowledges all the data received (receiver side).
+* @Params: in/out: dp = initialized instance of DataPlane
+* @Return: Returns DATAPLANE_OK if no errors, otherwise DATAPLANE_KO.
+*********************************************************************/
+char DATAPLANE_acknowledge(DataPlane *dp);
+
+/*********************************************************************
+* @Purpose: Frees the memory of a DataPlane.
+* @Params: in/out: dp = instance of DataPlane to free
+* @Return: ----
+*********************************************************************/
+void DATAPLANE_free(DataPlane *dp);
+
+#endif
@@ -19,6 +19,14 @@
 #define ERROR_SELECT_MSG                "ERROR: Select failed\n"
 #define ERROR_CREATING_MQ_MSG           "ERROR: Message queue could not be created\n"
 #define ERROR_RECEIVING_MSG_MSG         "ERROR: Message could not be received\n"
+#define FILE_ALREADY_PRESENT_MSG        "File correctly sent (already present at destination, no data transferred)\n"
+#define BATCH_SENT_MSG                  "%d files correctly sent (%d already present at destination), %d failed\n"
+#define BATCH_RECIEVED_MSG              "\nNew files received!\n%s, from %s has sent %d files (%d already present)\n"
+#define FILE_DEDUPLICATED_MSG           "\nNew file received!\n%s has sent %s (content already present, no data transferred)\n"
+#define FILE_BAD_RANGES_MSG             "Wrong byte ranges: %s\n"
+#define SYNC_STARTED_MSG                "\nNew sync!\n%s, from %s is synchronizing %s\n"
+#define SYNC_DELETED_MSG                "\nSync of %s: %s, from %s has deleted %d files\n"
+#define SYNC_ENDED_MSG                  "\nSync of %s from %s has ended\n"
 /* Other constants */
 #define CMD_ID_BYTE				    	'$'
 #define CMD_LINE_PROMPT					"%s%c "
@@ -29,6 +37,31 @@
 #define FILE_MD5SUM_OK					1
 #define FILE_MD5SUM_KO					0
 #define MAX_FD_SET_SIZE                 1024
+#define DURABILITY_NONE					0
+#define DURABILITY_END					1
+#define DURABILITY_PERIODIC				2
+#define DEFAULT_SYNC_BYTES				67108864
+#define DELIVERY_CLONE					0
+#define DELIVERY_HARDLINK				1
+#define CODEC_NONE						0
+#define CODEC_LZ						1
+#define HOST_ID_LENGTH					32
+#define LOCAL_TRANSPORT_AUTO			0
+#define LOCAL_TRANSPORT_QUEUE			1
+#define LOCAL_TRANSPORT_TCP				2
+
+typedef struct {
+    char durability;
+	long long sync_bytes;
+	char local_delivery;
+} WritePolicy;
+
+// bytes per second of the transfers (0 = unlimited)
+typedef struct {
+    long long global;
+	long long peer;
+	long long transfer;
+} RateLimits;
 
 typedef struct {
     char *username;
@@ -37,12 +70,29 @@ typedef struct {
     int arda_port;
 	char *ip_address;
 	int port;
+	WritePolicy write_policy;
+	RateLimits rate_limits;
+	char codec;
+	char publish;
+	long queue_depth;
+	long queue_msg_size;
+	char local_transport;
+	char host_id[HOST_ID_LENGTH + 1];
 } IluvatarSon;
 
 typedef struct {
     char *ip_address;
 	int port;
     char *directory;
+	long long blob_cache;
 } Arda;
 
+typedef struct _Throttle Throttle;
+
+typedef struct {
+    volatile char cancel;
+	volatile long long bytes;
+	Throttle *throttle;
+} TransferControl;
+
 #endif
@@ -0,0 +1,490 @@
+/*********************************************************************
+* @Purpose: Module that sends updated versions of a file as a delta
+*           against the copy the receiver already holds (rsync-like
+*           rolling and strong block signatures).
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "delta.h"
+
+typedef struct {
+	uint32_t weak;
+	unsigned char strong[DELTA_STRONG_BYTES];
+} BlockSignature;
+
+/*********************************************************************
+* @Purpose: Chooses the size of the blocks for a file (around the
+*           square root of its size).
+* @Params: in: file_size = size in bytes of the file
+* @Return: Returns the block size.
+*********************************************************************/
+int getBlockSize(long long file_size) {
+	int block_size = DELTA_MIN_BLOCK_SIZE;
+
+	while ((block_size < DELTA_MAX_BLOCK_SIZE) && (((long long) block_size * block_size) < file_size)) {
+	    block_size <<= 1;
+	}
+
+	return (block_size);
+}
+
+/*********************************************************************
+* @Purpose: Computes the rolling checksum of a block.
+* @Params: in: data = bytes of the block
+*          in: length = number of bytes of the block
+*          in/out: a = first sum (needed to roll the checksum)
+*          in/out: b = second sum (needed to roll the checksum)
+* @Return: Returns the checksum.
+*********************************************************************/
+uint32_t weakChecksum(const unsigned char *data, int length, uint32_t *a, uint32_t *b) {
+	int i = 0;
+
+	*a = 0;
+	*b = 0;
+
+	for (i = 0; i < length; i++) {
+	    *a += data[i];
+		*b += (uint32_t) (length - i) * data[i];
+	}
+
+	return ((*a & 0xFFFF) | ((*b & 0xFFFF) << 16));
+}
+
+/*********************************************************************
+* @Purpose: Computes the strong signature of a block.
+* @Params: in: data = bytes of the block
+*          in: length = number of bytes of the block
+*          in/out: strong = array to store the signature
+* @Return: ----
+*********************************************************************/
+void strongChecksum(const unsigned char *data, int length, unsigned char strong[DELTA_STRONG_BYTES]) {
+	unsigned char digest[MD5_DIGEST_BYTES];
+
+	MD5_buffer(data, length, digest);
+	memcpy(strong, digest, DELTA_STRONG_BYTES);
+}
+
+/*********************************************************************
+* @Purpose: Sends the FILE_DELTA frame and the signatures of the blocks
+*           of the file the receiver already holds (receiver side).
+* @Params: in: fd_socket = socket connected to the sender
+*          in: path = path of the current copy of the file
+*          in: codec = codec to compress the literal data
+*          in/out: block_size = size of the blocks used
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_sendSignatures(int fd_socket, char *path, char codec, int *block_size) {
+	unsigned char *block = NULL;
+	char *frame = NULL;
+	char *buffer = NULL;
+	uint32_t a = 0, b = 0, weak = 0;
+	int fd_file = FD_NOT_FOUND;
+	long long file_size = 0;
+	int n_blocks = 0;
+	int i = 0, n_frame = 0, pos = 0;
+
+	fd_file = open(path, O_RDONLY);
+
+	if (FD_NOT_FOUND == fd_file) {
+	    return (DELTA_KO);
+	}
+
+	file_size = lseek(fd_file, 0, SEEK_END);
+	lseek(fd_file, 0, SEEK_SET);
+	*block_size = getBlockSize(file_size);
+	// only full blocks can be referenced
+	n_blocks = (int) (file_size / *block_size);
+
+	// tell the sender the geometry of the signatures and how to send the literal data
+	asprintf(&buffer, "%d%c%d%c%s", *block_size, GPC_DATA_SEPARATOR, n_blocks, GPC_DATA_SEPARATOR, GPC_getCodecName(codec));
+	GPC_writeFrame(fd_socket, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_DELTA_HEADER, buffer, strlen(buffer));
+	free(buffer);
+	buffer = NULL;
+
+	block = (unsigned char *) malloc (sizeof(unsigned char) * (*block_size));
+	frame = (char *) malloc (sizeof(char) * DELTA_SIGS_PER_FRAME * DELTA_SIG_BYTES);
+
+	for (i = 0; i < n_blocks; i++) {
+	    if (*block_size != read(fd_file, block, *block_size)) {
+		    // the file changed while reading it, send a signature that cannot match
+			memset(block, 0, *block_size);
+		}
+
+		// weak checksum (little endian) followed by the strong one
+		weak = weakChecksum(block, *block_size, &a, &b);
+		pos = n_frame * DELTA_SIG_BYTES;
+		frame[pos] = (char) (weak & 0xFF);
+		frame[pos + 1] = (char) ((weak >> 8) & 0xFF);
+		frame[pos + 2] = (char) ((weak >> 16) & 0xFF);
+		frame[pos + 3] = (char) ((weak >> 24) & 0xFF);
+		strongChecksum(block, *block_size, (unsigned char *) frame + pos + 4);
+		n_frame++;
+
+		if ((DELTA_SIGS_PER_FRAME == n_frame) || (i == n_blocks - 1)) {
+		    if (GCP_WRITE_KO == GPC_writeFrame(fd_socket, GCP_SEND_FILE_TYPE, GCP_DELTA_SIGS_HEADER, frame, n_frame * DELTA_SIG_BYTES)) {
+			    free(block);
+				free(frame);
+				close(fd_file);
+				return (DELTA_KO);
+			}
+
+			n_frame = 0;
+		}
+	}
+
+	free(block);
+	block = NULL;
+	free(frame);
+	frame = NULL;
+	close(fd_file);
+	return (DELTA_OK);
+}
+
+/*********************************************************************
+* @Purpose: Reads the signatures sent by the receiver.
+* @Params: in: fd_socket = socket connected to the receiver
+*          in: n_blocks = number of signatures to read
+* @Return: Returns the array of signatures or NULL if an error occurred.
+*********************************************************************/
+BlockSignature * readSignatures(int fd_socket, int n_blocks) {
+	BlockSignature *sigs = NULL;
+	unsigned char *bytes = NULL;
+	char *header = NULL;
+	char *data = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	unsigned short length = 0;
+	int n_read = 0, i = 0, n = 0;
+
+	sigs = (BlockSignature *) malloc (sizeof(BlockSignature) * n_blocks);
+
+	while (n_read < n_blocks) {
+	    if (GCP_READ_OK != GPC_readFrameWithLength(fd_socket, &type, &header, &data, &length) ||
+		    (NULL == header) || (0 != strcmp(header, GCP_DELTA_SIGS_HEADER)) || (NULL == data)) {
+		    if (NULL != header) {
+			    free(header);
+			}
+
+			if (NULL != data) {
+			    free(data);
+			}
+
+			free(sigs);
+			return (NULL);
+		}
+
+		n = length / DELTA_SIG_BYTES;
+		bytes = (unsigned char *) data;
+
+		for (i = 0; (i < n) && (n_read < n_blocks); i++) {
+		    sigs[n_read].weak = ((uint32_t) bytes[i * DELTA_SIG_BYTES]) |
+			                    ((uint32_t) bytes[i * DELTA_SIG_BYTES + 1] << 8) |
+			                    ((uint32_t) bytes[i * DELTA_SIG_BYTES + 2] << 16) |
+			                    ((uint32_t) bytes[i * DELTA_SIG_BYTES + 3] << 24);
+			memcpy(sigs[n_read].strong, bytes + (i * DELTA_SIG_BYTES) + 4, DELTA_STRONG_BYTES);
+			n_read++;
+		}
+
+		free(header);
+		header = NULL;
+		free(data);
+		data = NULL;
+	}
+
+	return (sigs);
+}
+
+/*********************************************************************
+* @Purpose: Sends a run of consecutive blocks that the receiver already
+*           has.
+* @Params: in: dp = data plane of the connection to the receiver
+*          in/out: first = first block of the run (reset after sending)
+*          in/out: count = number of blocks of the run (reset)
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char flushCopy(DataPlane *dp, int *first, int *count) {
+	char *buffer = NULL;
+	char ok = GCP_WRITE_OK;
+
+	if (0 < *count) {
+	    asprintf(&buffer, "%d%c%d", *first, GPC_DATA_SEPARATOR, *count);
+		ok = GPC_writeFrame(dp->fd_socket, GCP_SEND_FILE_TYPE, GCP_DELTA_COPY_HEADER, buffer, strlen(buffer));
+		free(buffer);
+		buffer = NULL;
+	}
+
+	*first = DELTA_NO_BLOCK;
+	*count = 0;
+	return ((GCP_WRITE_OK == ok) ? DELTA_OK : DELTA_KO);
+}
+
+/*********************************************************************
+* @Purpose: Sends bytes that the receiver does not have, through the
+*           data plane like the data of a full file (window, limits,
+*           codec and cancellation).
+* @Params: in/out: dp = data plane of the connection to the receiver
+*          in: data = bytes to send
+*          in: length = number of bytes to send
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char flushLiteral(DataPlane *dp, const unsigned char *data, long long length) {
+	return ((DATAPLANE_OK == DATAPLANE_sendBuffer(dp, (char *) data, length)) ? DELTA_OK : DELTA_KO);
+}
+
+/*********************************************************************
+* @Purpose: Reads the signatures of the receiver's copy and sends the
+*           file as a list of literal data and block references
+*           (sender side).
+* @Params: in/out: dp = initialized data plane of the connection to
+*                  the receiver (the literal data is sent through it
+*                  with the codec of the FILE_DELTA frame)
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the file to send
+*          in: delta_info = data of the FILE_DELTA frame
+*          in/out: literal_bytes = number of bytes sent as literal data
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_sendDelta(DataPlane *dp, int fd_file, long long file_size, char *delta_info, long long *literal_bytes) {
+	BlockSignature *sigs = NULL;
+	unsigned char *data = NULL;
+	unsigned char strong[DELTA_STRONG_BYTES];
+	char *buffer = NULL;
+	int *bucket_head = NULL, *bucket_next = NULL;
+	uint32_t a = 0, b = 0, weak = 0, mask = 0;
+	int block_size = 0, n_blocks = 0, n_buckets = 1;
+	long long pos = 0, literal_start = 0;
+	int match = DELTA_NO_BLOCK, strong_done = 0;
+	int copy_first = DELTA_NO_BLOCK, copy_count = 0;
+	int i = 0, j = 0;
+	char error = DELTA_OK;
+
+	*literal_bytes = 0;
+
+	// data is in the format: block_size + GPC_DATA_SEPARATOR + n_blocks + GPC_DATA_SEPARATOR + codec
+	buffer = SHAREDFUNCTIONS_splitString(delta_info, GPC_DATA_SEPARATOR, &i);
+	block_size = atoi(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(delta_info, GPC_DATA_SEPARATOR, &i);
+	n_blocks = atoi(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(delta_info, GPC_DATA_SEPARATOR, &i);
+	dp->codec = GPC_parseCodec(buffer);
+	free(buffer);
+	buffer = NULL;
+
+	if ((0 >= block_size) || (0 >= n_blocks) || (NULL == (sigs = readSignatures(dp->fd_socket, n_blocks)))) {
+	    return (DELTA_KO);
+	}
+
+	// an empty file cannot be mapped, its delta has no blocks and no data
+	if (0 == file_size) {
+	    free(sigs);
+		return ((GCP_WRITE_KO == GPC_writeFrame(dp->fd_socket, GCP_SEND_FILE_TYPE, GCP_DELTA_END_HEADER, NULL, 0)) ? DELTA_KO : DELTA_OK);
+	}
+
+	data = (unsigned char *) mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd_file, 0);
+
+	if (MAP_FAILED == data) {
+	    free(sigs);
+		return (DELTA_KO);
+	}
+
+	// hash table of the weak checksums
+	while (n_buckets < (n_blocks * 2)) {
+	    n_buckets <<= 1;
+	}
+
+	mask = (uint32_t) (n_buckets - 1);
+	bucket_head = (int *) malloc (sizeof(int) * n_buckets);
+	bucket_next = (int *) malloc (sizeof(int) * n_blocks);
+
+	for (i = 0; i < n_buckets; i++) {
+	    bucket_head[i] = DELTA_NO_BLOCK;
+	}
+
+	// insert in reverse order so that lower blocks are found first
+	for (i = n_blocks - 1; i >= 0; i--) {
+	    j = (int) ((sigs[i].weak ^ (sigs[i].weak >> 16)) & mask);
+		bucket_next[i] = bucket_head[j];
+		bucket_head[j] = i;
+	}
+
+	if (pos + block_size <= file_size) {
+	    weak = weakChecksum(data, block_size, &a, &b);
+	}
+
+	while ((pos + block_size <= file_size) && (DELTA_OK == error)) {
+	    match = DELTA_NO_BLOCK;
+		strong_done = 0;
+
+		for (i = bucket_head[(weak ^ (weak >> 16)) & mask]; (DELTA_NO_BLOCK != i) && (DELTA_NO_BLOCK == match); i = bucket_next[i]) {
+		    if (sigs[i].weak == weak) {
+			    if (!strong_done) {
+				    strongChecksum(data + pos, block_size, strong);
+					strong_done = 1;
+				}
+
+				if (0 == memcmp(strong, sigs[i].strong, DELTA_STRONG_BYTES)) {
+				    match = i;
+				}
+			}
+		}
+
+		if (DELTA_NO_BLOCK != match) {
+		    // send the pending literal data before the reference
+			if (literal_start < pos) {
+			    error = flushCopy(dp, &copy_first, &copy_count);
+
+				if (DELTA_OK == error) {
+				    error = flushLiteral(dp, data + literal_start, pos - literal_start);
+				}
+
+				*literal_bytes += pos - literal_start;
+			}
+
+			if ((DELTA_OK == error) && (0 < copy_count) && (match != copy_first + copy_count)) {
+			    error = flushCopy(dp, &copy_first, &copy_count);
+			}
+
+			if (0 == copy_count) {
+			    copy_first = match;
+			}
+
+			copy_count++;
+			pos += block_size;
+			literal_start = pos;
+
+			if (pos + block_size <= file_size) {
+			    weak = weakChecksum(data + pos, block_size, &a, &b);
+			}
+		} else {
+		    // roll the checksum one byte
+			if (pos + block_size < file_size) {
+			    a = a - data[pos] + data[pos + block_size];
+				b = b - ((uint32_t) block_size * data[pos]) + a;
+				weak = (a & 0xFFFF) | ((b & 0xFFFF) << 16);
+			}
+
+			pos++;
+		}
+	}
+
+	// send what is left
+	if (DELTA_OK == error) {
+	    error = flushCopy(dp, &copy_first, &copy_count);
+	}
+
+	if ((DELTA_OK == error) && (literal_start < file_size)) {
+	    error = flushLiteral(dp, data + literal_start, file_size - literal_start);
+		*literal_bytes += file_size - literal_start;
+	}
+
+	if ((DELTA_OK == error) && (GCP_WRITE_KO == GPC_writeFrame(dp->fd_socket, GCP_SEND_FILE_TYPE, GCP_DELTA_END_HEADER, NULL, 0))) {
+	    error = DELTA_KO;
+	}
+
+	munmap(data, file_size);
+	free(sigs);
+	free(bucket_head);
+	free(bucket_next);
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Rebuilds the new version of a file from the delta frames
+*           sent by the sender and the current copy (receiver side).
+* @Params: in: fd_socket = socket connected to the sender
+*          in: old_path = path of the current copy of the file
+*          in: new_path = path where to write the new version
+*          in: block_size = size of the blocks of the signatures
+*          in: file_size = size of the new version
+*          in: policy = durability policy of the received files
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_receiveDelta(int fd_socket, char *old_path, char *new_path, int block_size, long long file_size, WritePolicy *policy) {
+	char *header = NULL;
+	char *data = NULL;
+	char *block = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	unsigned short length = 0;
+	FileWriter writer;
+	DataPlane dp;
+	int fd_old = FD_NOT_FOUND;
+	int first = 0, count = 0, i = 0, n = 0;
+	char error = DELTA_OK, end = 0, writer_open = 0;
+
+	fd_old = open(old_path, O_RDONLY);
+	writer_open = (FILEWRITER_OK == FILEWRITER_open(&writer, new_path, file_size, policy));
+
+	if ((FD_NOT_FOUND == fd_old) || !writer_open) {
+	    error = DELTA_KO;
+	}
+
+	block = (char *) malloc (sizeof(char) * block_size);
+	// the literal data comes in the frames of the data plane, which must be acknowledged
+	DATAPLANE_init(&dp, fd_socket, CODEC_NONE, NULL);
+
+	// the frames must always be read, even after an error, to keep the connection in sync
+	while (!end) {
+	    if (GCP_READ_OK != GPC_readFrameWithLength(fd_socket, &type, &header, &data, &length) || (NULL == header)) {
+		    error = DELTA_KO;
+			end = 1;
+		} else if (DATAPLANE_isDataFrame(header)) {
+		    if (DATAPLANE_KO == DATAPLANE_receiveFrame(&dp, (DELTA_OK == error) ? &writer : NULL, header, data, length)) {
+			    error = DELTA_KO;
+			}
+		} else if (0 == strcmp(header, GCP_DELTA_COPY_HEADER)) {
+		    // data is in the format: first_block + GPC_DATA_SEPARATOR + n_blocks
+			i = 0;
+			free(header);
+			header = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+			first = atoi(header);
+			free(header);
+			header = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+			count = atoi(header);
+
+			for (i = 0; (i < count) && (DELTA_OK == error); i++) {
+			    n = pread(fd_old, block, block_size, (off_t) (first + i) * block_size);
+
+				if ((block_size != n) || (FILEWRITER_KO == FILEWRITER_write(&writer, block, n))) {
+				    error = DELTA_KO;
+				}
+			}
+		} else if (0 == strcmp(header, GCP_DELTA_END_HEADER)) {
+		    // the sender waits for the acknowledgement of all the literal data
+			if (DATAPLANE_KO == DATAPLANE_acknowledge(&dp)) {
+			    error = DELTA_KO;
+			}
+
+			end = 1;
+		} else {
+		    error = DELTA_KO;
+			end = 1;
+		}
+
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != data) {
+		    free(data);
+			data = NULL;
+		}
+	}
+
+	free(block);
+	block = NULL;
+	DATAPLANE_free(&dp);
+
+	if (FD_NOT_FOUND != fd_old) {
+	    close(fd_old);
+	}
+
+	if (writer_open && (FILEWRITER_KO == FILEWRITER_close(&writer))) {
+	    error = DELTA_KO;
+	}
+
+	return (error);
+}
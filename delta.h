@@ -0,0 +1,73 @@
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sharedFunctions.h"
+#include "gpc.h"
+#include "filewriter.h"
+#include "dataplane.h"
+#include "md5.h"
+
+/* Constants */
+#define DELTA_MIN_FILE_SIZE			4096
+#define DELTA_MIN_BLOCK_SIZE		1024
+#define DELTA_MAX_BLOCK_SIZE		65536
+#define DELTA_STRONG_BYTES			8
+#define DELTA_SIG_BYTES				(4 + DELTA_STRONG_BYTES)
+#define DELTA_SIGS_PER_FRAME		5000
+#define DELTA_NO_BLOCK				-1
+#define DELTA_OK					0
+#define DELTA_KO					1
+
+/* Messages */
+#define DELTA_SENT_MSG				"Delta transfer: %lld of %lld bytes sent as literal data\n"
+
+/*********************************************************************
+* @Purpose: Sends the FILE_DELTA frame and the signatures of the blocks
+*           of the file the receiver already holds (receiver side).
+* @Params: in: fd_socket = socket connected to the sender
+*          in: path = path of the current copy of the file
+*          in: codec = codec to compress the literal data
+*          in/out: block_size = size of the blocks used
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_sendSignatures(int fd_socket, char *path, char codec, int *block_size);
+
+/*********************************************************************
+* @Purpose: Reads the signatures of the receiver's copy and sends the
+*           file as a list of literal data and block references
+*           (sender side).
+* @Params: in/out: dp = initialized data plane of the connection to
+*                  the receiver (the literal data is sent through it
+*                  with the codec of the FILE_DELTA frame)
+*          in: fd_file = open file descriptor of the file to send
+*          in: file_size = size in bytes of the file to send
+*          in: delta_info = data of the FILE_DELTA frame
+*          in/out: literal_bytes = number of bytes sent as literal data
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_sendDelta(DataPlane *dp, int fd_file, long long file_size, char *delta_info, long long *literal_bytes);
+
+/*********************************************************************
+* @Purpose: Rebuilds the new version of a file from the delta frames
+*           sent by the sender and the current copy (receiver side).
+* @Params: in: fd_socket = socket connected to the sender
+*          in: old_path = path of the current copy of the file
+*          in: new_path = path where to write the new version
+*          in: block_size = size of the blocks of the signatures
+*          in: file_size = size of the new version
+*          in: policy = durability policy of the received files
+* @Return: Returns DELTA_OK if no errors, otherwise DELTA_KO.
+*********************************************************************/
+char DELTA_receiveDelta(int fd_socket, char *old_path, char *new_path, int block_size, long long file_size, WritePolicy *policy);
+
+#endif
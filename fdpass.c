@@ -0,0 +1,152 @@
+/*********************************************************************
+* @Purpose: Module that passes the file descriptors of the files sent
+*           between IluvatarSons in the same machine through Unix
+*           sockets, so the receiver copies the files in the kernel.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "fdpass.h"
+
+/*********************************************************************
+* @Purpose: Gets the address of the socket of a process.
+* @Params: out: addr = address to fill
+*          in: pid = PID of the process
+* @Return: Returns the length of the address.
+*********************************************************************/
+socklen_t getFdPassAddress(struct sockaddr_un *addr, int pid) {
+	memset(addr, 0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+	// the first byte of an abstract name is 0
+	snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, FDPASS_NAME, pid);
+
+	return ((socklen_t) (sizeof(sa_family_t) + 1 + strlen(addr->sun_path + 1)));
+}
+
+/*********************************************************************
+* @Purpose: Creates the socket of this process to receive the file
+*           descriptors of the files sent in the same machine (a Unix
+*           socket in the abstract namespace, removed when it closes).
+* @Params: ----
+* @Return: Returns the file descriptor of the socket, or -1 if it could
+*          not be created.
+*********************************************************************/
+int FDPASS_open() {
+	struct sockaddr_un addr;
+	socklen_t length = getFdPassAddress(&addr, getpid());
+	int sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	int on = 1;
+
+	// the kernel tells us the PID of the sender of every descriptor
+	if ((sock >= 0) && ((0 != setsockopt(sock, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on))) || (0 != bind(sock, (struct sockaddr *) &addr, length)))) {
+	    close(sock);
+		sock = -1;
+	}
+
+	return (sock);
+}
+
+/*********************************************************************
+* @Purpose: Passes the file descriptor of an open file to another
+*           process of the machine.
+* @Params: in: pid = PID of the receiver
+*          in: fd_file = file descriptor to pass
+*          in: file_size = size of the file
+* @Return: Returns FDPASS_OK if it was sent, otherwise FDPASS_KO.
+*********************************************************************/
+char FDPASS_send(int pid, int fd_file, long long file_size) {
+	char control[CMSG_SPACE(sizeof(int))];
+	struct sockaddr_un addr;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg = NULL;
+	int sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	ssize_t n = -1;
+
+	if (sock < 0) {
+	    return (FDPASS_KO);
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	memset(control, 0, sizeof(control));
+	iov.iov_base = &file_size;
+	iov.iov_len = sizeof(file_size);
+	msg.msg_name = &addr;
+	msg.msg_namelen = getFdPassAddress(&addr, pid);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd_file, sizeof(int));
+
+	n = sendmsg(sock, &msg, 0);
+	close(sock);
+
+	return ((n == (ssize_t) sizeof(file_size)) ? FDPASS_OK : FDPASS_KO);
+}
+
+/*********************************************************************
+* @Purpose: Waits for the file descriptor of a file passed by another
+*           process (for FDPASS_WAIT_TIME ms at most). The descriptors
+*           passed by other processes, or for other files, are closed.
+* @Params: in: sock = socket returned by FDPASS_open
+*          in: sender_pid = PID of the sender
+*          in: file_size = size of the file
+* @Return: Returns the received file descriptor, or -1 if none arrived.
+*********************************************************************/
+int FDPASS_receive(int sock, int sender_pid, long long file_size) {
+	char control[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct ucred))];
+	struct ucred cred;
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg = NULL;
+	struct pollfd pfd;
+	struct stat st;
+	long long size = 0;
+	int fd = -1;
+	int pid = 0;
+
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+
+	while (poll(&pfd, 1, FDPASS_WAIT_TIME) > 0) {
+	    memset(&msg, 0, sizeof(msg));
+		iov.iov_base = &size;
+		iov.iov_len = sizeof(size);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		fd = -1;
+		pid = 0;
+
+		if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != (ssize_t) sizeof(size)) {
+		    size = -1;
+		}
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); NULL != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		    if ((SOL_SOCKET == cmsg->cmsg_level) && (SCM_RIGHTS == cmsg->cmsg_type)) {
+			    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+			} else if ((SOL_SOCKET == cmsg->cmsg_level) && (SCM_CREDENTIALS == cmsg->cmsg_type)) {
+			    memcpy(&cred, CMSG_DATA(cmsg), sizeof(struct ucred));
+				pid = cred.pid;
+			}
+		}
+
+		// a descriptor left by a sender that gave up, or not a regular file
+		if ((pid == sender_pid) && (size == file_size) && (fd >= 0) && (0 == fstat(fd, &st)) && S_ISREG(st.st_mode)) {
+		    return (fd);
+		}
+
+		if (fd >= 0) {
+		    close(fd);
+		}
+	}
+
+	return (-1);
+}
@@ -0,0 +1,53 @@
+#ifndef _FDPASS_H_
+#define _FDPASS_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/* Constants */
+#define FDPASS_NAME				"iluvatar_fd_%d"
+#define FDPASS_WAIT_TIME		5000
+#define FDPASS_OK				0
+#define FDPASS_KO				1
+
+/*********************************************************************
+* @Purpose: Creates the socket of this process to receive the file
+*           descriptors of the files sent in the same machine (a Unix
+*           socket in the abstract namespace, removed when it closes).
+* @Params: ----
+* @Return: Returns the file descriptor of the socket, or -1 if it could
+*          not be created.
+*********************************************************************/
+int FDPASS_open();
+
+/*********************************************************************
+* @Purpose: Passes the file descriptor of an open file to another
+*           process of the machine.
+* @Params: in: pid = PID of the receiver
+*          in: fd_file = file descriptor to pass
+*          in: file_size = size of the file
+* @Return: Returns FDPASS_OK if it was sent, otherwise FDPASS_KO.
+*********************************************************************/
+char FDPASS_send(int pid, int fd_file, long long file_size);
+
+/*********************************************************************
+* @Purpose: Waits for the file descriptor of a file passed by another
+*           process (for FDPASS_WAIT_TIME ms at most). The descriptors
+*           passed by other processes, or for other files, are closed.
+* @Params: in: sock = socket returned by FDPASS_open
+*          in: sender_pid = PID of the sender
+*          in: file_size = size of the file
+* @Return: Returns the received file descriptor, or -1 if none arrived.
+*********************************************************************/
+int FDPASS_receive(int sock, int sender_pid, long long file_size);
+
+#endif
@@ -0,0 +1,784 @@
+/*********************************************************************
+* @Purpose: Module that keeps a persistent index of the contents of
+*           an IluvatarSon directory (MD5SUM -> filename) so that
+*           files already present do not have to be transferred again.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "fileindex.h"
+
+// the index can be used by the main thread and by the server threads
+pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+// indexes read from disk, kept while the process runs
+CachedIndex *cached_indexes = NULL;
+int n_cached_indexes = 0;
+
+/*********************************************************************
+* @Purpose: Frees dynamic memory allocated for an index.
+* @Params: in/out: index = index to free
+* @Return: ----
+*********************************************************************/
+void freeIndex(FileIndex *index) {
+	int i = 0;
+
+	for (i = 0; i < index->n_entries; i++) {
+	    free(index->entries[i].md5sum);
+		index->entries[i].md5sum = NULL;
+		free(index->entries[i].filename);
+		index->entries[i].filename = NULL;
+	}
+
+	if (NULL != index->entries) {
+	    free(index->entries);
+		index->entries = NULL;
+	}
+
+	index->n_entries = 0;
+}
+
+/*********************************************************************
+* @Purpose: Adds an entry at the end of an index.
+* @Params: in/out: index = index to update
+*          in: md5sum = MD5SUM of the file
+*          in: filename = name of the file
+*          in: size = size in bytes of the file
+*          in: mtime = last modification time of the file
+* @Return: ----
+*********************************************************************/
+void addEntry(FileIndex *index, char *md5sum, char *filename, long long size, long long mtime) {
+	index->entries = (IndexEntry *) realloc (index->entries, sizeof(IndexEntry) * (index->n_entries + 1));
+	index->entries[index->n_entries].md5sum = strdup(md5sum);
+	index->entries[index->n_entries].filename = strdup(filename);
+	index->entries[index->n_entries].size = size;
+	index->entries[index->n_entries].mtime = mtime;
+	(index->n_entries)++;
+}
+
+/*********************************************************************
+* @Purpose: Searches an entry by filename.
+* @Params: in: index = index where to search
+*          in: filename = name of the file
+* @Return: Returns the position of the entry, or -1 if not found.
+*********************************************************************/
+int searchByFilename(FileIndex *index, char *filename) {
+	int i = 0;
+
+	for (i = 0; i < index->n_entries; i++) {
+	    if (0 == strcmp(index->entries[i].filename, filename)) {
+		    return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/*********************************************************************
+* @Purpose: Sets the entry of a file in an index: it is updated, added
+*           if the file had none, or removed if there is no MD5SUM (the
+*           last entry takes its place).
+* @Params: in/out: index = index to update
+*          in: md5sum = MD5SUM of the file (empty to remove the entry)
+*          in: filename = name of the file
+*          in: size = size in bytes of the file
+*          in: mtime = last modification time of the file
+* @Return: ----
+*********************************************************************/
+void setEntry(FileIndex *index, char *md5sum, char *filename, long long size, long long mtime) {
+	int pos = searchByFilename(index, filename);
+
+	if (-1 == pos) {
+	    if ('\0' != md5sum[0]) {
+		    addEntry(index, md5sum, filename, size, mtime);
+		}
+
+		return;
+	}
+
+	free(index->entries[pos].md5sum);
+	index->entries[pos].md5sum = NULL;
+
+	if ('\0' == md5sum[0]) {
+	    free(index->entries[pos].filename);
+		index->entries[pos] = index->entries[index->n_entries - 1];
+		(index->n_entries)--;
+		return;
+	}
+
+	index->entries[pos].md5sum = strdup(md5sum);
+	index->entries[pos].size = size;
+	index->entries[pos].mtime = mtime;
+}
+
+/*********************************************************************
+* @Purpose: Sets the entry of a file in an index and appends it to the
+*           file of the index, so the file does not have to be written
+*           again.
+* @Params: in/out: index = index to update
+*          in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = MD5SUM of the file (empty to remove the entry)
+*          in: filename = name of the file
+*          in: size = size in bytes of the file
+*          in: mtime = last modification time of the file
+* @Return: ----
+*********************************************************************/
+void updateEntry(FileIndex *index, char *directory, char *md5sum, char *filename, long long size, long long mtime) {
+	char *path = NULL;
+	char *buffer = NULL;
+	int fd = FD_NOT_FOUND;
+
+	// the line is built first, removing the entry frees its filename
+	asprintf(&buffer, "%s%c%lld%c%lld%c%s\n", md5sum, FILEINDEX_SEPARATOR, size, FILEINDEX_SEPARATOR,
+	                                         mtime, FILEINDEX_SEPARATOR, filename);
+	setEntry(index, md5sum, filename, size, mtime);
+
+	asprintf(&path, ".%s/%s", directory, FILEINDEX_FILENAME);
+	fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+	free(path);
+	path = NULL;
+
+	if ((FD_NOT_FOUND == fd) || ((int) strlen(buffer) != write(fd, buffer, strlen(buffer)))) {
+	    // the whole index is written when it is closed
+		index->rewrite = 1;
+	} else {
+	    (index->n_records)++;
+	}
+
+	if (FD_NOT_FOUND != fd) {
+	    close(fd);
+	}
+
+	free(buffer);
+	buffer = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Reads the index stored in the given directory.
+* @Params: in: directory = string with the directory of the IluvatarSon
+* @Return: Returns the index (empty if it did not exist).
+*********************************************************************/
+FileIndex loadIndex(char *directory) {
+	FileIndex index;
+	char *path = NULL;
+	char *line = NULL;
+	char *md5sum = NULL;
+	char *filename = NULL;
+	char *buffer = NULL;
+	long long size = 0, mtime = 0;
+	int fd = FD_NOT_FOUND;
+	int i = 0;
+
+	index.entries = NULL;
+	index.n_entries = 0;
+	index.n_records = 0;
+	index.rewrite = 0;
+
+	asprintf(&path, ".%s/%s", directory, FILEINDEX_FILENAME);
+	fd = open(path, O_RDONLY);
+	free(path);
+	path = NULL;
+
+	if (FD_NOT_FOUND == fd) {
+	    return (index);
+	}
+
+	// each line has the format: md5sum&size&mtime&filename, and replaces the previous ones of
+	// the same file (a line without md5sum removes its entry)
+	while (NULL != (line = SHAREDFUNCTIONS_readUntil(fd, '\n'))) {
+	    i = 0;
+		md5sum = SHAREDFUNCTIONS_splitString(line, FILEINDEX_SEPARATOR, &i);
+		buffer = SHAREDFUNCTIONS_splitString(line, FILEINDEX_SEPARATOR, &i);
+		size = atoll(buffer);
+		free(buffer);
+		buffer = SHAREDFUNCTIONS_splitString(line, FILEINDEX_SEPARATOR, &i);
+		mtime = atoll(buffer);
+		free(buffer);
+		buffer = NULL;
+		filename = SHAREDFUNCTIONS_splitString(line, FILEINDEX_SEPARATOR, &i);
+
+		if (0 < strlen(filename)) {
+		    setEntry(&index, md5sum, filename, size, mtime);
+		}
+
+		(index.n_records)++;
+
+		free(md5sum);
+		md5sum = NULL;
+		free(filename);
+		filename = NULL;
+		free(line);
+		line = NULL;
+	}
+
+	close(fd);
+	return (index);
+}
+
+/*********************************************************************
+* @Purpose: Writes an index into the given directory. The index is
+*           first written to a temporary file and then renamed so that
+*           it is never left half written.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: index = index to store
+* @Return: ----
+*********************************************************************/
+void saveIndex(char *directory, FileIndex *index) {
+	char *path = NULL;
+	char *tmp_path = NULL;
+	char *buffer = NULL;
+	int fd = FD_NOT_FOUND;
+	int i = 0;
+
+	asprintf(&path, ".%s/%s", directory, FILEINDEX_FILENAME);
+	asprintf(&tmp_path, "%s%s", path, FILEINDEX_TMP_SUFFIX);
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (FD_NOT_FOUND != fd) {
+	    for (i = 0; i < index->n_entries; i++) {
+		    asprintf(&buffer, "%s%c%lld%c%lld%c%s\n", index->entries[i].md5sum, FILEINDEX_SEPARATOR,
+			                                         index->entries[i].size, FILEINDEX_SEPARATOR,
+													 index->entries[i].mtime, FILEINDEX_SEPARATOR,
+													 index->entries[i].filename);
+			write(fd, buffer, strlen(buffer));
+			free(buffer);
+			buffer = NULL;
+		}
+
+		close(fd);
+
+		if (0 == rename(tmp_path, path)) {
+		    index->n_records = index->n_entries;
+			index->rewrite = 0;
+		}
+	}
+
+	free(path);
+	path = NULL;
+	free(tmp_path);
+	tmp_path = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Checks that the file of an entry has not changed since it
+*           was hashed, hashing it again if it has. The entry of a file
+*           that no longer exists is removed (the last entry takes its
+*           place).
+* @Params: in/out: index = index with the entry
+*          in: directory = string with the directory of the IluvatarSon
+*          in: pos = position of the entry
+* @Return: Returns 1 if the entry is now current, or 0 if it was
+*          removed.
+*********************************************************************/
+char verifyEntry(FileIndex *index, char *directory, int pos) {
+	IndexEntry *entry = &index->entries[pos];
+	struct stat st;
+	char *path = NULL;
+	char *md5sum = NULL;
+
+	asprintf(&path, ".%s/%s", directory, entry->filename);
+
+	if ((0 == stat(path, &st)) && S_ISREG(st.st_mode)) {
+	    // only a stale entry is hashed again
+		if ((entry->size != (long long) st.st_size) || (entry->mtime != (long long) st.st_mtime) ||
+		    (TREEHASH_isTree(entry->md5sum) != (st.st_size >= TREEHASH_MIN_FILE_SIZE))) {
+		    md5sum = TREEHASH_getFileHash(path, NULL, NULL);
+		}
+
+		if (NULL != md5sum) {
+		    updateEntry(index, directory, md5sum, entry->filename, (long long) st.st_size, (long long) st.st_mtime);
+			free(md5sum);
+			md5sum = NULL;
+		}
+
+		free(path);
+		path = NULL;
+		return (1);
+	}
+
+	free(path);
+	path = NULL;
+	updateEntry(index, directory, "", entry->filename, 0, 0);
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Synchronizes an index with the current contents of the
+*           directory. Entries of deleted or modified files are dropped
+*           and files not yet indexed are hashed.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in/out: index = index to refresh
+* @Return: ----
+*********************************************************************/
+void refreshIndex(char *directory, FileIndex *index) {
+	FileIndex updated;
+	DIR *dir = NULL;
+	struct dirent *entry = NULL;
+	struct stat st;
+	char *dir_path = NULL;
+	char *path = NULL;
+	char *md5sum = NULL;
+	int pos = 0;
+
+	updated.entries = NULL;
+	updated.n_entries = 0;
+	updated.n_records = index->n_records;
+	updated.rewrite = index->rewrite;
+
+	asprintf(&dir_path, ".%s", directory);
+	dir = opendir(dir_path);
+	free(dir_path);
+	dir_path = NULL;
+
+	if (NULL == dir) {
+	    return;
+	}
+
+	while (NULL != (entry = readdir(dir))) {
+	    // skip hidden files (the index itself and temporary files)
+		if ('.' == entry->d_name[0]) {
+		    continue;
+		}
+
+		asprintf(&path, ".%s/%s", directory, entry->d_name);
+
+		if ((0 == stat(path, &st)) && S_ISREG(st.st_mode) && (0 < st.st_size)) {
+		    pos = searchByFilename(index, entry->d_name);
+
+			// an entry of a big file hashed before tree hashes existed is hashed again
+			if ((-1 != pos) && (index->entries[pos].size == (long long) st.st_size) && (index->entries[pos].mtime == (long long) st.st_mtime) &&
+			    (TREEHASH_isTree(index->entries[pos].md5sum) == (st.st_size >= TREEHASH_MIN_FILE_SIZE))) {
+			    // file did not change
+				addEntry(&updated, index->entries[pos].md5sum, entry->d_name, index->entries[pos].size, index->entries[pos].mtime);
+			} else {
+			    // new or modified file
+				md5sum = TREEHASH_getFileHash(path, NULL, NULL);
+
+				if (NULL != md5sum) {
+				    addEntry(&updated, md5sum, entry->d_name, (long long) st.st_size, (long long) st.st_mtime);
+					updated.rewrite = 1;
+					free(md5sum);
+					md5sum = NULL;
+				}
+			}
+		}
+
+		free(path);
+		path = NULL;
+	}
+
+	closedir(dir);
+
+	// files received inside subdirectories are kept while they do not change
+	for (pos = 0; pos < index->n_entries; pos++) {
+	    if (NULL == strchr(index->entries[pos].filename, '/')) {
+		    continue;
+		}
+
+		asprintf(&path, ".%s/%s", directory, index->entries[pos].filename);
+
+		if ((0 == stat(path, &st)) && (index->entries[pos].size == (long long) st.st_size) && (index->entries[pos].mtime == (long long) st.st_mtime)) {
+		    addEntry(&updated, index->entries[pos].md5sum, index->entries[pos].filename, index->entries[pos].size, index->entries[pos].mtime);
+		}
+
+		free(path);
+		path = NULL;
+	}
+
+	// the file is only written again if some entry was added, changed or dropped
+	if (updated.n_entries != index->n_entries) {
+	    updated.rewrite = 1;
+	}
+
+	freeIndex(index);
+	*index = updated;
+}
+
+/*********************************************************************
+* @Purpose: Copies the contents of a file into another one.
+* @Params: in: src_path = path of the file to copy
+*          in: dst_path = path of the new file
+* @Return: Returns 0 if no errors, otherwise 1.
+*********************************************************************/
+char copyFile(char *src_path, char *dst_path) {
+	char buffer[FILEINDEX_COPY_BYTES];
+	int fd_src = FD_NOT_FOUND, fd_dst = FD_NOT_FOUND;
+	int n = 0;
+
+	fd_src = open(src_path, O_RDONLY);
+
+	if (FD_NOT_FOUND == fd_src) {
+	    return (1);
+	}
+
+	fd_dst = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (FD_NOT_FOUND == fd_dst) {
+	    close(fd_src);
+		return (1);
+	}
+
+	while (0 < (n = read(fd_src, buffer, FILEINDEX_COPY_BYTES))) {
+	    if (n != write(fd_dst, buffer, n)) {
+		    close(fd_src);
+			close(fd_dst);
+			return (1);
+		}
+	}
+
+	close(fd_src);
+	close(fd_dst);
+	return ((n < 0) ? 1 : 0);
+}
+
+/*********************************************************************
+* @Purpose: Searches the index of a directory kept in memory.
+* @Params: in: directory = string with the directory of the IluvatarSon
+* @Return: Returns the position of the index, or -1 if it has not been
+*          read yet.
+*********************************************************************/
+int searchCachedIndex(char *directory) {
+	int i = 0;
+
+	for (i = 0; i < n_cached_indexes; i++) {
+	    if (0 == strcmp(cached_indexes[i].directory, directory)) {
+		    return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/*********************************************************************
+* @Purpose: Gets the path of the temporary file used to build a file
+*           before it replaces the final one. The temporary file is
+*           hidden and lives in the same directory as the final one.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file (relative to the directory)
+* @Return: Returns a new string with the path of the temporary file.
+*********************************************************************/
+char * FILEINDEX_getTmpPath(char *directory, char *filename) {
+	char *tmp_path = NULL;
+	char *slash = strrchr(filename, '/');
+
+	if (NULL == slash) {
+	    asprintf(&tmp_path, ".%s/.%s%s", directory, filename, FILEINDEX_TMP_SUFFIX);
+	} else {
+	    asprintf(&tmp_path, ".%s/%.*s.%s%s", directory, (int) (slash - filename + 1), filename, slash + 1, FILEINDEX_TMP_SUFFIX);
+	}
+
+	return (tmp_path);
+}
+
+/**********************************************************************
+* @Purpose: Locks the index of the given directory and loads it,
+*           optionally synchronized with the current contents of the
+*           directory. Must be followed by FILEINDEX_close.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: refresh = FILEINDEX_REFRESH to synchronize the index
+*              (needed to search it), otherwise FILEINDEX_NO_REFRESH
+* @Return: Returns the index.
+**********************************************************************/
+FileIndex FILEINDEX_open(char *directory, char refresh) {
+	FileIndex index;
+	int pos = 0;
+
+	pthread_mutex_lock(&index_mutex);
+	pos = searchCachedIndex(directory);
+
+	if (-1 == pos) {
+	    index = loadIndex(directory);
+	} else {
+	    index = cached_indexes[pos].index;
+	}
+
+	if (FILEINDEX_REFRESH == refresh) {
+	    refreshIndex(directory, &index);
+	}
+
+	return (index);
+}
+
+/**********************************************************************
+* @Purpose: Stores an index opened with FILEINDEX_open, frees it and
+*           unlocks it.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in/out: index = index to store
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_close(char *directory, FileIndex *index) {
+	int pos = searchCachedIndex(directory);
+
+	if (index->rewrite || (index->n_records > (2 * index->n_entries) + FILEINDEX_MIN_RECORDS)) {
+	    saveIndex(directory, index);
+	}
+
+	if (-1 == pos) {
+	    cached_indexes = (CachedIndex *) realloc (cached_indexes, sizeof(CachedIndex) * (n_cached_indexes + 1));
+		pos = n_cached_indexes;
+		cached_indexes[pos].directory = strdup(directory);
+		n_cached_indexes++;
+	}
+
+	cached_indexes[pos].index = *index;
+	pthread_mutex_unlock(&index_mutex);
+}
+
+/**********************************************************************
+* @Purpose: Frees the indexes kept in memory.
+* @Params: ----
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_free() {
+	int i = 0;
+
+	pthread_mutex_lock(&index_mutex);
+
+	for (i = 0; i < n_cached_indexes; i++) {
+	    free(cached_indexes[i].directory);
+		cached_indexes[i].directory = NULL;
+		freeIndex(&cached_indexes[i].index);
+	}
+
+	if (NULL != cached_indexes) {
+	    free(cached_indexes);
+		cached_indexes = NULL;
+	}
+
+	n_cached_indexes = 0;
+	pthread_mutex_unlock(&index_mutex);
+}
+
+/**********************************************************************
+* @Purpose: Searches an opened index for a file with the given content
+*           and, if found, makes it available under the given filename
+*           (by hardlink, or by copy if the link cannot be created).
+*           Only the files of the entries with that content are checked
+*           (and hashed again if they have changed).
+* @Params: in/out: index = index opened with FILEINDEX_open
+*          in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = MD5SUM of the wanted content
+*          in: size = size in bytes of the wanted content
+*          in: filename = name under which the content must be stored
+* @Return: Returns FILEINDEX_FOUND if the file is now present in the
+*          directory, otherwise FILEINDEX_NOT_FOUND.
+**********************************************************************/
+char FILEINDEX_materializeIn(FileIndex *index, char *directory, char *md5sum, long long size, char *filename) {
+	struct stat st;
+	char *src_path = NULL;
+	char *dst_path = NULL;
+	char *tmp_path = NULL;
+	char found = FILEINDEX_NOT_FOUND;
+	int i = 0, pos = -1;
+
+	// the file may already be there with the same name
+	pos = searchByFilename(index, filename);
+
+	if ((-1 != pos) && (0 == strcmp(index->entries[pos].md5sum, md5sum)) && (index->entries[pos].size == size) &&
+	    verifyEntry(index, directory, pos) && (0 == strcmp(index->entries[pos].md5sum, md5sum)) && (index->entries[pos].size == size)) {
+	    found = FILEINDEX_FOUND;
+	}
+
+	for (i = 0; (i < index->n_entries) && (FILEINDEX_NOT_FOUND == found); i++) {
+	    if ((0 != strcmp(index->entries[i].md5sum, md5sum)) || (index->entries[i].size != size)) {
+		    continue;
+		}
+
+		// a removed entry leaves the last one in its place
+		if (!verifyEntry(index, directory, i)) {
+		    i--;
+			continue;
+		}
+
+	    if ((0 == strcmp(index->entries[i].md5sum, md5sum)) && (index->entries[i].size == size)) {
+		    asprintf(&src_path, ".%s/%s", directory, index->entries[i].filename);
+			asprintf(&dst_path, ".%s/%s", directory, filename);
+			tmp_path = FILEINDEX_getTmpPath(directory, filename);
+			unlink(tmp_path);
+
+			// hardlink if possible, otherwise copy the content
+			if ((0 == link(src_path, tmp_path)) || (0 == copyFile(src_path, tmp_path))) {
+			    if (0 == rename(tmp_path, dst_path)) {
+				    found = FILEINDEX_FOUND;
+
+					if (0 == stat(dst_path, &st)) {
+					    updateEntry(index, directory, md5sum, filename, (long long) st.st_size, (long long) st.st_mtime);
+					}
+				}
+			}
+
+			unlink(tmp_path);
+			free(src_path);
+			src_path = NULL;
+			free(dst_path);
+			dst_path = NULL;
+			free(tmp_path);
+			tmp_path = NULL;
+		}
+	}
+
+	return (found);
+}
+
+/**********************************************************************
+* @Purpose: Searches the index of the given directory for a file with
+*           the given content and, if found, makes it available under
+*           the given filename (by hardlink, or by copy if the link
+*           cannot be created). The index is not refreshed: only the
+*           files with that content are checked.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = MD5SUM of the wanted content
+*          in: size = size in bytes of the wanted content
+*          in: filename = name under which the content must be stored
+* @Return: Returns FILEINDEX_FOUND if the file is now present in the
+*          directory, otherwise FILEINDEX_NOT_FOUND.
+**********************************************************************/
+char FILEINDEX_materialize(char *directory, char *md5sum, long long size, char *filename) {
+	FileIndex index;
+	char found = FILEINDEX_NOT_FOUND;
+
+	index = FILEINDEX_open(directory, FILEINDEX_NO_REFRESH);
+	found = FILEINDEX_materializeIn(&index, directory, md5sum, size, filename);
+	FILEINDEX_close(directory, &index);
+
+	return (found);
+}
+
+/**********************************************************************
+* @Purpose: Searches the index of the given directory for a file with
+*           the given content that has not changed since it was hashed.
+*           The index kept in memory is searched without refreshing or
+*           writing it, so it is cheap to call once per range of a file.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = content hash of the wanted file
+*          out: size = size in bytes of the file found
+* @Return: Returns a new string with the path of the file, or NULL if
+*          it is not in the directory.
+**********************************************************************/
+char * FILEINDEX_findPath(char *directory, char *md5sum, long long *size) {
+	FileIndex index;
+	struct stat st;
+	char *path = NULL;
+	int i = 0;
+
+	index = FILEINDEX_open(directory, FILEINDEX_NO_REFRESH);
+
+	for (i = 0; (i < index.n_entries) && (NULL == path); i++) {
+	    if (0 == strcmp(index.entries[i].md5sum, md5sum)) {
+		    asprintf(&path, ".%s/%s", directory, index.entries[i].filename);
+
+			// a file modified after being hashed is not served
+			if ((0 != stat(path, &st)) || ((long long) st.st_size != index.entries[i].size) || ((long long) st.st_mtime != index.entries[i].mtime)) {
+			    free(path);
+				path = NULL;
+			} else {
+			    *size = index.entries[i].size;
+			}
+		}
+	}
+
+	FILEINDEX_close(directory, &index);
+
+	return (path);
+}
+
+/**********************************************************************
+* @Purpose: Adds (or updates) a received file to an opened index.
+* @Params: in/out: index = index opened with FILEINDEX_open
+*          in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          in: md5sum = MD5SUM of the file
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_addIn(FileIndex *index, char *directory, char *filename, char *md5sum) {
+	struct stat st;
+	char *path = NULL;
+
+	asprintf(&path, ".%s/%s", directory, filename);
+
+	if (0 != stat(path, &st)) {
+	    free(path);
+		path = NULL;
+		return;
+	}
+
+	free(path);
+	path = NULL;
+	updateEntry(index, directory, md5sum, filename, (long long) st.st_size, (long long) st.st_mtime);
+}
+
+/**********************************************************************
+* @Purpose: Adds (or updates) a received file to the index of the
+*           given directory.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          in: md5sum = MD5SUM of the file
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_add(char *directory, char *filename, char *md5sum) {
+	FileIndex index;
+
+	index = FILEINDEX_open(directory, FILEINDEX_NO_REFRESH);
+	FILEINDEX_addIn(&index, directory, filename, md5sum);
+	FILEINDEX_close(directory, &index);
+}
+
+/**********************************************************************
+* @Purpose: Gets the content hash of a file of the directory. The hash
+*           of the index is used while the file does not change, so a
+*           file is only hashed once.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          out: hashed = status of the file the hash belongs to (its
+*               inode is 0 if the file changed while it was hashed),
+*               can be NULL
+* @Return: Returns a new string with the hash, or NULL if the file
+*          cannot be read.
+**********************************************************************/
+char * FILEINDEX_getHash(char *directory, char *filename, struct stat *hashed) {
+	FileIndex index;
+	struct stat st, st_after;
+	char *path = NULL;
+	char *md5sum = NULL;
+	int pos = -1;
+
+	asprintf(&path, ".%s/%s", directory, filename);
+
+	if (0 != stat(path, &st)) {
+	    free(path);
+		path = NULL;
+		return (NULL);
+	}
+
+	index = FILEINDEX_open(directory, FILEINDEX_NO_REFRESH);
+	pos = searchByFilename(&index, filename);
+
+	if ((-1 != pos) && (index.entries[pos].size == (long long) st.st_size) && (index.entries[pos].mtime == (long long) st.st_mtime) &&
+	    (TREEHASH_isTree(index.entries[pos].md5sum) == (st.st_size >= TREEHASH_MIN_FILE_SIZE))) {
+	    md5sum = strdup(index.entries[pos].md5sum);
+	}
+
+	FILEINDEX_close(directory, &index);
+
+	if (NULL == md5sum) {
+	    // the file is hashed without holding the index
+		md5sum = TREEHASH_getFileHash(path, NULL, NULL);
+
+		if ((NULL != md5sum) && (0 == stat(path, &st_after)) && (st_after.st_ino == st.st_ino) &&
+		    (st_after.st_size == st.st_size) && (st_after.st_mtime == st.st_mtime)) {
+		    FILEINDEX_add(directory, filename, md5sum);
+		} else {
+		    st.st_ino = 0;
+		}
+	}
+
+	if (NULL != hashed) {
+	    *hashed = st;
+	}
+
+	free(path);
+	path = NULL;
+
+	return (md5sum);
+}
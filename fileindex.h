@@ -0,0 +1,167 @@
+#ifndef _FILEINDEX_H_
+#define _FILEINDEX_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "sharedFunctions.h"
+#include "treehash.h"
+
+/* Constants */
+#define FILEINDEX_FILENAME			".iluvatar_index"
+#define FILEINDEX_TMP_SUFFIX		".iluvatar_tmp"
+#define FILEINDEX_SEPARATOR			'&'
+#define FILEINDEX_COPY_BYTES		4096
+#define FILEINDEX_FOUND				1
+#define FILEINDEX_NOT_FOUND			0
+#define FILEINDEX_REFRESH			1
+#define FILEINDEX_NO_REFRESH		0
+#define FILEINDEX_MIN_RECORDS		64
+
+typedef struct {
+	char *md5sum;
+	char *filename;
+	long long size;
+	long long mtime;
+} IndexEntry;
+
+typedef struct {
+	IndexEntry *entries;
+	int n_entries;
+	int n_records;		// lines of the file of the index (an entry may have several)
+	char rewrite;		// the file has to be written again when the index is closed
+} FileIndex;
+
+typedef struct {
+	char *directory;
+	FileIndex index;
+} CachedIndex;
+
+/*********************************************************************
+* @Purpose: Gets the path of the temporary file used to build a file
+*           before it replaces the final one. The temporary file is
+*           hidden and lives in the same directory as the final one.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file (relative to the directory)
+* @Return: Returns a new string with the path of the temporary file.
+*********************************************************************/
+char * FILEINDEX_getTmpPath(char *directory, char *filename);
+
+/**********************************************************************
+* @Purpose: Locks the index of the given directory and gets it,
+*           optionally synchronized with the current contents of the
+*           directory. It is read from disk only the first time, then
+*           it is kept in memory. Must be followed by FILEINDEX_close.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: refresh = FILEINDEX_REFRESH to synchronize the index
+*              (needed to search it), otherwise FILEINDEX_NO_REFRESH
+* @Return: Returns the index.
+**********************************************************************/
+FileIndex FILEINDEX_open(char *directory, char refresh);
+
+/**********************************************************************
+* @Purpose: Keeps in memory an index opened with FILEINDEX_open and
+*           unlocks it. Its changes are already appended to its file,
+*           which is only written again after a refresh that changed it
+*           or when most of its lines are outdated.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in/out: index = index to keep
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_close(char *directory, FileIndex *index);
+
+/**********************************************************************
+* @Purpose: Frees the indexes kept in memory.
+* @Params: ----
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_free();
+
+/**********************************************************************
+* @Purpose: Searches an opened index for a file with the given content
+*           and, if found, makes it available under the given filename
+*           (by hardlink, or by copy if the link cannot be created).
+*           Only the files of the entries with that content are checked
+*           (and hashed again if they have changed).
+* @Params: in/out: index = index opened with FILEINDEX_open
+*          in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = MD5SUM of the wanted content
+*          in: size = size in bytes of the wanted content
+*          in: filename = name under which the content must be stored
+* @Return: Returns FILEINDEX_FOUND if the file is now present in the
+*          directory, otherwise FILEINDEX_NOT_FOUND.
+**********************************************************************/
+char FILEINDEX_materializeIn(FileIndex *index, char *directory, char *md5sum, long long size, char *filename);
+
+/**********************************************************************
+* @Purpose: Searches the index of the given directory for a file with
+*           the given content and, if found, makes it available under
+*           the given filename (by hardlink, or by copy if the link
+*           cannot be created). The index is not refreshed: only the
+*           files with that content are checked.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = MD5SUM of the wanted content
+*          in: size = size in bytes of the wanted content
+*          in: filename = name under which the content must be stored
+* @Return: Returns FILEINDEX_FOUND if the file is now present in the
+*          directory, otherwise FILEINDEX_NOT_FOUND.
+**********************************************************************/
+char FILEINDEX_materialize(char *directory, char *md5sum, long long size, char *filename);
+
+/**********************************************************************
+* @Purpose: Searches the index of the given directory for a file with
+*           the given content that has not changed since it was hashed.
+*           The index kept in memory is searched without refreshing or
+*           writing it, so it is cheap to call once per range of a file.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: md5sum = content hash of the wanted file
+*          out: size = size in bytes of the file found
+* @Return: Returns a new string with the path of the file, or NULL if
+*          it is not in the directory.
+**********************************************************************/
+char * FILEINDEX_findPath(char *directory, char *md5sum, long long *size);
+
+/**********************************************************************
+* @Purpose: Adds (or updates) a received file to the index of the
+*           given directory.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          in: md5sum = MD5SUM of the file
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_add(char *directory, char *filename, char *md5sum);
+
+/**********************************************************************
+* @Purpose: Adds (or updates) a received file to an opened index.
+* @Params: in/out: index = index opened with FILEINDEX_open
+*          in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          in: md5sum = MD5SUM of the file
+* @Return: ----
+**********************************************************************/
+void FILEINDEX_addIn(FileIndex *index, char *directory, char *filename, char *md5sum);
+
+/**********************************************************************
+* @Purpose: Gets the content hash of a file of the directory. The hash
+*           of the index is used while the file does not change, so a
+*           file is only hashed once.
+* @Params: in: directory = string with the directory of the IluvatarSon
+*          in: filename = name of the file inside the directory
+*          out: hashed = status of the file the hash belongs to (its
+*               inode is 0 if the file changed while it was hashed),
+*               can be NULL
+* @Return: Returns a new string with the hash, or NULL if the file
+*          cannot be read.
+**********************************************************************/
+char * FILEINDEX_getHash(char *directory, char *filename, struct stat *hashed);
+
+#endif
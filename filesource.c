@@ -0,0 +1,143 @@
+/*********************************************************************
+* @Purpose: Module that hands out the content of a file to send in
+*           chunks, read ahead by the kernel.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "filesource.h"
+
+/*********************************************************************
+* @Purpose: Prepares a file to be read sequentially in chunks into a
+*           buffer. The file is not mapped, so a sender whose file is
+*           truncated meanwhile gets a read error instead of a SIGBUS.
+*           The kernel is told that the file is read sequentially, and
+*           the chunks after the one read are asked for in advance, so
+*           it reads ahead.
+* @Params: in/out: src = instance of FileSource to initialize
+*          in: fd_file = open file descriptor of the file
+*          in: file_size = size in bytes of the file
+*          in: max_chunk = biggest chunk that will be asked
+* @Return: Returns FILESOURCE_OK if no errors, otherwise FILESOURCE_KO.
+*********************************************************************/
+char FILESOURCE_open(FileSource *src, int fd_file, long long file_size, int max_chunk) {
+	src->fd = fd_file;
+	src->file_size = file_size;
+	src->offset = 0;
+	src->advised = 0;
+	src->buffer = NULL;
+	src->buffer_size = 0;
+	src->region_end = 0;
+	src->hole = 0;
+
+	posix_fadvise(fd_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	src->buffer_size = (file_size < max_chunk) ? (int) file_size : max_chunk;
+	src->buffer = (char *) malloc(sizeof(char) * (src->buffer_size + 1));
+
+	return ((NULL == src->buffer) ? FILESOURCE_KO : FILESOURCE_OK);
+}
+
+/*********************************************************************
+* @Purpose: Gets the next chunk of the file.
+* @Params: in/out: src = opened instance of FileSource
+*          in: length = number of bytes of the chunk (at most the
+*              max_chunk given when opening)
+* @Return: Returns a pointer to the data of the chunk (valid until the
+*          next call), or NULL if it could not be read (also when the
+*          file is shorter than expected).
+*********************************************************************/
+char * FILESOURCE_next(FileSource *src, int length) {
+	char *data = NULL;
+	int n = 0, r = 0;
+
+	if (src->offset + length > src->file_size) {
+	    return (NULL);
+	}
+
+	if (length > src->buffer_size) {
+	    return (NULL);
+	}
+
+	// the next chunks are read by the kernel while this one is sent
+	if (src->offset + length > src->advised) {
+	    posix_fadvise(src->fd, src->offset, (off_t) src->buffer_size * FILESOURCE_READ_AHEAD, POSIX_FADV_WILLNEED);
+		src->advised = src->offset + (long long) src->buffer_size * FILESOURCE_READ_AHEAD;
+	}
+
+	// a file truncated while it is sent ends before the expected size
+	for (n = 0; n < length; n += r) {
+	    r = pread(src->fd, src->buffer + n, length - n, src->offset + n);
+
+		if (r <= 0) {
+		    return (NULL);
+		}
+	}
+
+	data = src->buffer;
+	src->offset += length;
+
+	return (data);
+}
+
+/*********************************************************************
+* @Purpose: Gets the region (data or hole) of the file at the current
+*           offset, as reported by the file system. File systems
+*           without holes report all the file as data.
+* @Params: in/out: src = opened instance of FileSource
+*          out: hole = 1 if the region is a hole, otherwise 0
+* @Return: Returns the number of bytes from the current offset to the
+*          end of the region.
+*********************************************************************/
+long long FILESOURCE_getRegion(FileSource *src, char *hole) {
+	long long next = 0;
+
+	// the file system is only asked once per region
+	if (src->offset >= src->region_end) {
+	    next = lseek(src->fd, src->offset, SEEK_DATA);
+
+		if ((next < 0) && (ENXIO == errno)) {
+		    // there is no more data, the rest of the file is a hole
+			next = src->file_size;
+		} else if (next < 0) {
+		    next = src->offset;
+		}
+
+		if (next > src->offset) {
+		    src->hole = 1;
+			src->region_end = (next > src->file_size) ? src->file_size : next;
+		} else {
+		    next = lseek(src->fd, src->offset, SEEK_HOLE);
+			src->hole = 0;
+			src->region_end = ((next <= src->offset) || (next > src->file_size)) ? src->file_size : next;
+		}
+	}
+
+	*hole = src->hole;
+
+	return (src->region_end - src->offset);
+}
+
+/*********************************************************************
+* @Purpose: Skips a part of the file without reading it (a hole).
+* @Params: in/out: src = opened instance of FileSource
+*          in: length = number of bytes to skip
+* @Return: ----
+*********************************************************************/
+void FILESOURCE_skip(FileSource *src, long long length) {
+	src->offset += length;
+}
+
+/*********************************************************************
+* @Purpose: Releases the buffer of a FileSource. The file descriptor
+*           is not closed.
+* @Params: in/out: src = opened instance of FileSource
+* @Return: ----
+*********************************************************************/
+void FILESOURCE_close(FileSource *src) {
+	if (NULL != src->buffer) {
+	    free(src->buffer);
+		src->buffer = NULL;
+	}
+}
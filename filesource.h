@@ -0,0 +1,83 @@
+#ifndef _FILESOURCE_H_
+#define _FILESOURCE_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "sharedFunctions.h"
+
+/* Constants */
+#define FILESOURCE_READ_AHEAD		8
+#define FILESOURCE_OK				0
+#define FILESOURCE_KO				1
+
+typedef struct {
+	int fd;
+	long long file_size;
+	long long offset;
+	long long advised;
+	char *buffer;
+	int buffer_size;
+	long long region_end;
+	char hole;
+} FileSource;
+
+/*********************************************************************
+* @Purpose: Prepares a file to be read sequentially in chunks into a
+*           buffer. The file is not mapped, so a sender whose file is
+*           truncated meanwhile gets a read error instead of a SIGBUS.
+*           The kernel is told that the file is read sequentially, and
+*           the chunks after the one read are asked for in advance, so
+*           it reads ahead.
+* @Params: in/out: src = instance of FileSource to initialize
+*          in: fd_file = open file descriptor of the file
+*          in: file_size = size in bytes of the file
+*          in: max_chunk = biggest chunk that will be asked
+* @Return: Returns FILESOURCE_OK if no errors, otherwise FILESOURCE_KO.
+*********************************************************************/
+char FILESOURCE_open(FileSource *src, int fd_file, long long file_size, int max_chunk);
+
+/*********************************************************************
+* @Purpose: Gets the next chunk of the file.
+* @Params: in/out: src = opened instance of FileSource
+*          in: length = number of bytes of the chunk (at most the
+*              max_chunk given when opening)
+* @Return: Returns a pointer to the data of the chunk (valid until the
+*          next call), or NULL if it could not be read (also when the
+*          file is shorter than expected).
+*********************************************************************/
+char * FILESOURCE_next(FileSource *src, int length);
+
+/*********************************************************************
+* @Purpose: Gets the region (data or hole) of the file at the current
+*           offset, as reported by the file system. File systems
+*           without holes report all the file as data.
+* @Params: in/out: src = opened instance of FileSource
+*          out: hole = 1 if the region is a hole, otherwise 0
+* @Return: Returns the number of bytes from the current offset to the
+*          end of the region.
+*********************************************************************/
+long long FILESOURCE_getRegion(FileSource *src, char *hole);
+
+/*********************************************************************
+* @Purpose: Skips a part of the file without reading it (a hole).
+* @Params: in/out: src = opened instance of FileSource
+*          in: length = number of bytes to skip
+* @Return: ----
+*********************************************************************/
+void FILESOURCE_skip(FileSource *src, long long length);
+
+/*********************************************************************
+* @Purpose: Releases the buffer of a FileSource. The file descriptor
+*           is not closed.
+* @Params: in/out: src = opened instance of FileSource
+* @Return: ----
+*********************************************************************/
+void FILESOURCE_close(FileSource *src);
+
+#endif
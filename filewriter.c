@@ -0,0 +1,397 @@
+/*********************************************************************
+* @Purpose: Module that writes the received files: preallocates their
+*           size, writes them from a background thread in large
+*           sequential writes and applies the durability policy.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "filewriter.h"
+
+/*********************************************************************
+* @Purpose: Initializes the buffers and the state of an opened writer.
+* @Params: in/out: fw = instance of FileWriter with the file opened
+*          in: start = offset of the file where the data starts
+*          in: end = offset of the file where the data ends
+*          in: policy = durability policy of the received files
+* @Return: ----
+*********************************************************************/
+void initWriter(FileWriter *fw, long long start, long long end, WritePolicy *policy) {
+	int i = 0;
+
+	fw->file_size = end;
+	fw->written = start;
+	fw->unsynced = 0;
+	fw->policy = *policy;
+
+	for (i = 0; i < FILEWRITER_N_BUFFERS; i++) {
+	    fw->buffers[i] = NULL;
+		fw->lengths[i] = 0;
+		fw->holes[i] = 0;
+	}
+
+	fw->buffers[0] = (char *) malloc(sizeof(char) * FILEWRITER_BUFFER_SIZE);
+	fw->head = 0;
+	fw->tail = 0;
+	fw->count = 0;
+	fw->error = 0;
+	fw->closing = 0;
+	// small files are written without starting the thread
+	fw->has_thread = 0;
+	pthread_mutex_init(&fw->mutex, NULL);
+	pthread_cond_init(&fw->cond, NULL);
+}
+
+/*********************************************************************
+* @Purpose: Creates (or truncates) a file to receive and reserves the
+*           disk space of its announced size.
+* @Params: in/out: fw = instance of FileWriter to initialize
+*          in: path = path of the file
+*          in: file_size = announced size of the file (0 if unknown)
+*          in: policy = durability policy of the received files
+* @Return: Returns FILEWRITER_OK if the file is ready, otherwise
+*          FILEWRITER_KO (the file could not be created or there is
+*          not enough space for it).
+*********************************************************************/
+char FILEWRITER_open(FileWriter *fw, char *path, long long file_size, WritePolicy *policy) {
+	fw->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (FD_NOT_FOUND == fw->fd) {
+	    return (FILEWRITER_KO);
+	}
+
+	// the size is kept, so a partial file never looks complete (file systems without support are ignored)
+	if ((file_size > 0) && (0 != fallocate(fw->fd, FALLOC_FL_KEEP_SIZE, 0, file_size)) && (ENOSPC == errno)) {
+	    close(fw->fd);
+		fw->fd = FD_NOT_FOUND;
+		unlink(path);
+		return (FILEWRITER_KO);
+	}
+
+	initWriter(fw, 0, file_size, policy);
+
+	return (FILEWRITER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Opens an existing file to receive a range of it (the file
+*           already has its final size, so several writers can fill
+*           different ranges at the same time).
+* @Params: in/out: fw = instance of FileWriter to initialize
+*          in: path = path of the file
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+*          in: policy = durability policy of the received files
+* @Return: Returns FILEWRITER_OK if the file is ready, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_openRange(FileWriter *fw, char *path, long long offset, long long length, WritePolicy *policy) {
+	fw->fd = open(path, O_WRONLY);
+
+	if (FD_NOT_FOUND == fw->fd) {
+	    return (FILEWRITER_KO);
+	}
+
+	if (offset != lseek(fw->fd, offset, SEEK_SET)) {
+	    close(fw->fd);
+		fw->fd = FD_NOT_FOUND;
+		return (FILEWRITER_KO);
+	}
+
+	initWriter(fw, offset, offset + length, policy);
+
+	return (FILEWRITER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Writes a buffer to the file, followed by its hole, and
+*           syncs it when the periodic policy requires it.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: i = index of the buffer
+* @Return: Returns 1 if no errors, otherwise 0.
+*********************************************************************/
+char writeBuffer(FileWriter *fw, int i) {
+	struct stat st;
+
+	if (fw->lengths[i] != SHAREDFUNCTIONS_writeFull(fw->fd, fw->buffers[i], fw->lengths[i])) {
+	    return (0);
+	}
+
+	fw->written += fw->lengths[i];
+	fw->unsynced += fw->lengths[i];
+
+	// the space reserved for a hole is released (inside the file, some file systems ignore it beyond the end)
+	if (0 < fw->holes[i]) {
+	    // the file is only extended, other writers may be filling the ranges after this one
+	    if ((0 != fstat(fw->fd, &st)) || ((st.st_size < fw->written + fw->holes[i]) && (0 != ftruncate(fw->fd, fw->written + fw->holes[i]))) ||
+		    (0 > lseek(fw->fd, fw->holes[i], SEEK_CUR))) {
+		    return (0);
+		}
+
+		fallocate(fw->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, fw->written, fw->holes[i]);
+
+		fw->written += fw->holes[i];
+	}
+
+	if ((DURABILITY_PERIODIC == fw->policy.durability) && (fw->unsynced >= fw->policy.sync_bytes)) {
+	    fw->unsynced = 0;
+
+		if (0 != fdatasync(fw->fd)) {
+		    return (0);
+		}
+	}
+
+	return (1);
+}
+
+/*********************************************************************
+* @Purpose: Writes the full buffers in order (thread function).
+* @Params: in/out: args = opened instance of FileWriter
+* @Return: Returns NULL.
+*********************************************************************/
+void *writeBehind(void *args) {
+	FileWriter *fw = (FileWriter *) args;
+	char ok = 1;
+
+	pthread_mutex_lock(&fw->mutex);
+
+	while ((fw->count > 0) || !fw->closing) {
+	    if (0 == fw->count) {
+		    pthread_cond_wait(&fw->cond, &fw->mutex);
+			continue;
+		}
+
+		pthread_mutex_unlock(&fw->mutex);
+
+		// after an error the data is discarded
+		if (ok) {
+		    ok = writeBuffer(fw, fw->tail);
+		}
+
+		pthread_mutex_lock(&fw->mutex);
+
+		if (!ok) {
+		    fw->error = 1;
+		}
+
+		fw->tail = (fw->tail + 1) % FILEWRITER_N_BUFFERS;
+		(fw->count)--;
+		pthread_cond_signal(&fw->cond);
+	}
+
+	pthread_mutex_unlock(&fw->mutex);
+
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Hands the current buffer to the write-behind thread and
+*           waits until the next one is free.
+* @Params: in/out: fw = opened instance of FileWriter
+* @Return: ----
+*********************************************************************/
+void queueBuffer(FileWriter *fw) {
+	if (!fw->has_thread) {
+	    if (0 == pthread_create(&fw->thread, NULL, writeBehind, fw)) {
+		    fw->has_thread = 1;
+		} else {
+		    // without thread the data is written directly
+			if (!writeBuffer(fw, fw->head)) {
+			    fw->error = 1;
+			}
+
+			fw->lengths[fw->head] = 0;
+			fw->holes[fw->head] = 0;
+			return;
+		}
+	}
+
+	pthread_mutex_lock(&fw->mutex);
+	(fw->count)++;
+	fw->head = (fw->head + 1) % FILEWRITER_N_BUFFERS;
+	pthread_cond_signal(&fw->cond);
+
+	while (FILEWRITER_N_BUFFERS == fw->count) {
+	    pthread_cond_wait(&fw->cond, &fw->mutex);
+	}
+
+	pthread_mutex_unlock(&fw->mutex);
+
+	if (NULL == fw->buffers[fw->head]) {
+	    fw->buffers[fw->head] = (char *) malloc(sizeof(char) * FILEWRITER_BUFFER_SIZE);
+	}
+
+	fw->lengths[fw->head] = 0;
+	fw->holes[fw->head] = 0;
+}
+
+/*********************************************************************
+* @Purpose: Adds data at the end of the file. The data is copied into
+*           a buffer and written in background in large sequential
+*           writes; it only blocks when all the buffers are pending.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: data = data to write
+*          in: length = number of bytes of data
+* @Return: Returns FILEWRITER_OK if no errors so far, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_write(FileWriter *fw, char *data, int length) {
+	char error = 0;
+	int n = 0;
+
+	while (length > 0) {
+	    n = FILEWRITER_BUFFER_SIZE - fw->lengths[fw->head];
+
+		if (n > length) {
+		    n = length;
+		}
+
+		memcpy(fw->buffers[fw->head] + fw->lengths[fw->head], data, n);
+		fw->lengths[fw->head] += n;
+		data += n;
+		length -= n;
+
+		if (FILEWRITER_BUFFER_SIZE == fw->lengths[fw->head]) {
+		    queueBuffer(fw);
+		}
+	}
+
+	pthread_mutex_lock(&fw->mutex);
+	error = fw->error;
+	pthread_mutex_unlock(&fw->mutex);
+
+	return (error ? FILEWRITER_KO : FILEWRITER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Adds a hole (a part of zeros) at the end of the file. The
+*           hole is not written: its disk space is released, so the
+*           file is sparse.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: length = number of bytes of the hole
+* @Return: Returns FILEWRITER_OK if no errors so far, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_skip(FileWriter *fw, long long length) {
+	char error = 0;
+
+	// the hole goes after the data of the current buffer, the next data in a new one
+	fw->holes[fw->head] += length;
+	queueBuffer(fw);
+
+	pthread_mutex_lock(&fw->mutex);
+	error = fw->error;
+	pthread_mutex_unlock(&fw->mutex);
+
+	return (error ? FILEWRITER_KO : FILEWRITER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Adds the data of another file at the end of the file
+*           without reading it: the blocks are shared (reflink) when
+*           the file system allows it, otherwise the kernel copies
+*           them. It must be called before any data is written.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: fd_src = file descriptor of the file to copy
+*          in: length = number of bytes to copy from its beginning
+* @Return: Returns FILEWRITER_CLONED if the blocks are shared,
+*          FILEWRITER_OK if all the data was copied, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_copy(FileWriter *fw, int fd_src, long long length) {
+	struct stat st;
+	loff_t offset_src = 0;
+	loff_t offset_dst = fw->written;
+	ssize_t n = 0;
+
+	// a whole file is cloned
+	if ((0 == fw->written) && (0 == fstat(fd_src, &st)) && ((long long) st.st_size == length) && (0 == ioctl(fw->fd, FICLONE, fd_src))) {
+	    fw->written = length;
+		return (FILEWRITER_CLONED);
+	}
+
+	while (offset_src < length) {
+	    n = copy_file_range(fd_src, &offset_src, fw->fd, &offset_dst, length - offset_src, 0);
+
+		if ((n < 0) && (0 == offset_src) && ((EXDEV == errno) || (ENOSYS == errno) || (EINVAL == errno) || (EOPNOTSUPP == errno))) {
+		    // copies between some file systems are not supported by the kernel
+			lseek(fw->fd, offset_dst, SEEK_SET);
+
+			while (offset_src < length) {
+			    n = sendfile(fw->fd, fd_src, &offset_src, length - offset_src);
+
+				if (n <= 0) {
+				    fw->error = 1;
+					break;
+				}
+			}
+
+			fw->written = offset_dst + offset_src;
+			return (fw->error ? FILEWRITER_KO : FILEWRITER_OK);
+		}
+
+		if (n <= 0) {
+		    // the file to copy is shorter than expected
+			fw->error = 1;
+			break;
+		}
+	}
+
+	fw->written = offset_dst;
+
+	return (fw->error ? FILEWRITER_KO : FILEWRITER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Writes the pending data, applies the durability policy and
+*           closes the file.
+* @Params: in/out: fw = opened instance of FileWriter
+* @Return: Returns FILEWRITER_OK if all the data reached the file,
+*          otherwise FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_close(FileWriter *fw) {
+	int i = 0;
+
+	if (fw->has_thread) {
+	    pthread_mutex_lock(&fw->mutex);
+
+		if ((fw->lengths[fw->head] > 0) || (fw->holes[fw->head] > 0)) {
+		    (fw->count)++;
+		}
+
+		fw->closing = 1;
+		pthread_cond_signal(&fw->cond);
+		pthread_mutex_unlock(&fw->mutex);
+		pthread_join(fw->thread, NULL);
+	} else if (((fw->lengths[fw->head] > 0) || (fw->holes[fw->head] > 0)) && !writeBuffer(fw, fw->head)) {
+	    fw->error = 1;
+	}
+
+	// the space reserved for data that never arrived is released
+	if (fw->written < fw->file_size) {
+	    fallocate(fw->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, fw->written, fw->file_size - fw->written);
+	}
+
+	if (!fw->error && (DURABILITY_NONE != fw->policy.durability) && (0 != fdatasync(fw->fd))) {
+	    fw->error = 1;
+	}
+
+	if (0 != close(fw->fd)) {
+	    fw->error = 1;
+	}
+
+	fw->fd = FD_NOT_FOUND;
+
+	for (i = 0; i < FILEWRITER_N_BUFFERS; i++) {
+	    if (NULL != fw->buffers[i]) {
+		    free(fw->buffers[i]);
+			fw->buffers[i] = NULL;
+		}
+	}
+
+	pthread_mutex_destroy(&fw->mutex);
+	pthread_cond_destroy(&fw->cond);
+
+	return (fw->error ? FILEWRITER_KO : FILEWRITER_OK);
+}
@@ -0,0 +1,120 @@
+#ifndef _FILEWRITER_H_
+#define _FILEWRITER_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+
+#include "definitions.h"
+#include "sharedFunctions.h"
+
+/* Constants */
+#define FILEWRITER_BUFFER_SIZE		1048576
+#define FILEWRITER_N_BUFFERS		4
+#define FILEWRITER_OK				0
+#define FILEWRITER_KO				1
+#define FILEWRITER_CLONED			2
+
+typedef struct {
+	int fd;
+	long long file_size;
+	long long written;
+	long long unsynced;
+	WritePolicy policy;
+	char *buffers[FILEWRITER_N_BUFFERS];
+	int lengths[FILEWRITER_N_BUFFERS];
+	long long holes[FILEWRITER_N_BUFFERS];
+	int head;
+	int tail;
+	int count;
+	char error;
+	char closing;
+	char has_thread;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} FileWriter;
+
+/*********************************************************************
+* @Purpose: Creates (or truncates) a file to receive and reserves the
+*           disk space of its announced size.
+* @Params: in/out: fw = instance of FileWriter to initialize
+*          in: path = path of the file
+*          in: file_size = announced size of the file (0 if unknown)
+*          in: policy = durability policy of the received files
+* @Return: Returns FILEWRITER_OK if the file is ready, otherwise
+*          FILEWRITER_KO (the file could not be created or there is
+*          not enough space for it).
+*********************************************************************/
+char FILEWRITER_open(FileWriter *fw, char *path, long long file_size, WritePolicy *policy);
+
+/*********************************************************************
+* @Purpose: Opens an existing file to receive a range of it (the file
+*           already has its final size, so several writers can fill
+*           different ranges at the same time).
+* @Params: in/out: fw = instance of FileWriter to initialize
+*          in: path = path of the file
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+*          in: policy = durability policy of the received files
+* @Return: Returns FILEWRITER_OK if the file is ready, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_openRange(FileWriter *fw, char *path, long long offset, long long length, WritePolicy *policy);
+
+/*********************************************************************
+* @Purpose: Adds data at the end of the file. The data is copied into
+*           a buffer and written in background in large sequential
+*           writes; it only blocks when all the buffers are pending.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: data = data to write
+*          in: length = number of bytes of data
+* @Return: Returns FILEWRITER_OK if no errors so far, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_write(FileWriter *fw, char *data, int length);
+
+/*********************************************************************
+* @Purpose: Adds a hole (a part of zeros) at the end of the file. The
+*           hole is not written: its disk space is released, so the
+*           file is sparse.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: length = number of bytes of the hole
+* @Return: Returns FILEWRITER_OK if no errors so far, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_skip(FileWriter *fw, long long length);
+
+/*********************************************************************
+* @Purpose: Adds the data of another file at the end of the file
+*           without reading it: the blocks are shared (reflink) when
+*           the file system allows it, otherwise the kernel copies
+*           them. It must be called before any data is written.
+* @Params: in/out: fw = opened instance of FileWriter
+*          in: fd_src = file descriptor of the file to copy
+*          in: length = number of bytes to copy from its beginning
+* @Return: Returns FILEWRITER_CLONED if the blocks are shared,
+*          FILEWRITER_OK if all the data was copied, otherwise
+*          FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_copy(FileWriter *fw, int fd_src, long long length);
+
+/*********************************************************************
+* @Purpose: Writes the pending data, applies the durability policy and
+*           closes the file.
+* @Params: in/out: fw = opened instance of FileWriter
+* @Return: Returns FILEWRITER_OK if all the data reached the file,
+*          otherwise FILEWRITER_KO.
+*********************************************************************/
+char FILEWRITER_close(FileWriter *fw);
+
+#endif
@@ -3,7 +3,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 11/12/2022
-* @Last change: 09/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "gpc.h"
 
@@ -91,19 +91,72 @@ char GCP_checkFrameFormat(char type, char *header, char *data) {
 			
 			return (checkFrameEmptyData(GPC_HEADER_MSGKO, header, length));
 		case GCP_SEND_FILE_TYPE:
-		    // header can be NEW_FILE or FILE_DATA
-			if (GCP_FRAME_KO == checkFrameDataNotEmpty(GCP_SEND_FILE_INFO_HEADER, header, length)) {
-			    return (checkFrameDataNotEmpty(GCP_SEND_FILE_DATA_HEADER, header, length));
+		    // header can be NEW_FILE, FILE_DATA, FILE_LZ, FILE_HOLE, FILE_TREE, FILE_DELTA, DELTA_SIGS, DELTA_COPY,
+			// NEW_BATCH, BATCH_LIST, BATCH_NEED, BATCH_FILE, BATCH_RESULT, FILE_ACK, FILE_HAVE, FILE_SEND,
+			// GET_RANGE, RANGE_OK, RANGE_KO, SYNC_START, SYNC_OK, SYNC_KO, SYNC_DELETE, BATCH_END or DELTA_END
+			if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_INFO_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_DATA_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_LZ_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_HOLE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_TREE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_DELTA_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_DELTA_SIGS_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_DELTA_COPY_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_BATCH_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BATCH_LIST_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BATCH_NEED_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BATCH_FILE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BATCH_RESULT_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_FILE_ACK_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_GET_RANGE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_RANGE_OK_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_RANGE_KO_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SYNC_START_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_SYNC_OK_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_SYNC_KO_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SYNC_DELETE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_BATCH_END_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_SEND_FILE_HAVE_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_SEND_FILE_SEND_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_SEND_FILE_SEND_HEADER, header, length)) {
+			    // FILE_SEND can carry the codec of the data
+				return (GCP_FRAME_OK);
 			}
 			
-			return (GCP_FRAME_OK);
+			return (checkFrameEmptyData(GCP_DELTA_END_HEADER, header, length));
 		case GCP_MD5SUM_TYPE:
-			// header can be CHECK_OK or CHECK_KO
-			if (GCP_FRAME_KO == checkFrameEmptyData(GPC_SEND_FILE_HEADER_OK_OUT, header, length)) {
-			    return (checkFrameEmptyData(GPC_SEND_FILE_HEADER_KO_OUT, header, length));
+			// header can be CHECK_OK or CHECK_KO (that can carry the wrong byte ranges)
+			if (GCP_FRAME_OK == checkFrameEmptyData(GPC_SEND_FILE_HEADER_OK_OUT, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GPC_SEND_FILE_HEADER_KO_OUT, header, length)) {
+			    return (GCP_FRAME_OK);
 			}
-		    
-			return (GCP_FRAME_OK);
+
+			return (checkFrameEmptyData(GPC_SEND_FILE_HEADER_KO_OUT, header, length));
 		case GCP_EXIT_TYPE:
 		    // header can be EXIT, CONOK or CONKO
 			if (GCP_FRAME_OK == checkFrameDataNotEmpty(GPC_EXIT_HEADER, header, length)) {
@@ -115,6 +168,30 @@ char GCP_checkFrameFormat(char type, char *header, char *data) {
 			return (checkFrameEmptyData(GPC_HEADER_CONKO, header, length));
 		case GCP_COUNT_TYPE:
 			return (checkFrameDataNotEmpty(GCP_COUNT_MSG_HEADER, header, length));
+		case GCP_SWARM_TYPE:
+		    // header can be INVENTORY, INVENTORY_ADD, WHO_HAS or HAS_LIST
+			if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_INVENTORY_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_INVENTORY_ADD_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_WHO_HAS_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			}
+
+			return (checkFrameDataNotEmpty(GCP_HAS_LIST_HEADER, header, length));
+		case GCP_BLOB_TYPE:
+		    // header can be BLOB_PUT, BLOB_GET, BLOB_OK (with the codec of an upload or not) or BLOB_KO
+			if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BLOB_PUT_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BLOB_GET_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameDataNotEmpty(GCP_BLOB_OK_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			} else if (GCP_FRAME_OK == checkFrameEmptyData(GCP_BLOB_OK_HEADER, header, length)) {
+			    return (GCP_FRAME_OK);
+			}
+
+			return (checkFrameEmptyData(GCP_BLOB_KO_HEADER, header, length));
 		default:
 			return (checkFrameEmptyData(GCP_UNKNOWN_CMD_HEADER, header, length));
 	}
@@ -122,6 +199,66 @@ char GCP_checkFrameFormat(char type, char *header, char *data) {
 	return (GCP_FRAME_KO);
 }
 
+/*********************************************************************
+* @Purpose: Gets the type of a frame from its first byte (a hexadecimal
+*           digit).
+* @Params: in: byte = first byte of the frame
+* @Return: Returns the type of the frame.
+*********************************************************************/
+char decodeFrameType(char byte) {
+	char type = 0;
+
+	switch (byte) {
+	    case 'A':
+		    type = 0x0A;
+			break;
+		case 'B':
+		    type = 0x0B;
+			break;
+		case 'C':
+		    type = 0x0C;
+			break;
+		case 'D':
+		    type = 0x0D;
+			break;
+		case 'E':
+		    type = 0x0E;
+			break;
+		case 'F':
+		    type = 0x0F;
+			break;
+		default:
+		    type = byte - '0';
+			break;
+	}
+
+	return (type);
+}
+
+/*********************************************************************
+* @Purpose: Reads exactly the given number of bytes from a file
+*           descriptor, unless the connection is closed before.
+* @Params: in: fd = file descriptor to read from
+*          in/out: buffer = buffer to store the bytes
+*		   in: size = number of bytes to read
+* @Return: Returns the number of bytes read.
+*********************************************************************/
+int readFullData(int fd, char *buffer, int size) {
+	int total = 0, n = 0;
+
+	while (total < size) {
+	    n = read(fd, buffer + total, size - total);
+
+		if (n <= 0) {
+		    return (total);
+		}
+
+		total += n;
+	}
+
+	return (total);
+}
+
 /**********************************************************************
 * @Purpose: Reads a frame sent through the network.
 * @Params: in: fd = file descriptor to read from.
@@ -131,6 +268,20 @@ char GCP_checkFrameFormat(char type, char *header, char *data) {
 * @Return: Returns 1.
 ***********************************************************************/
 char GPC_readFrame(int fd, char *type, char **header, char **data) {
+	return (GPC_readFrameWithLength(fd, type, header, data, NULL));
+}
+
+/**********************************************************************
+* @Purpose: Reads a frame sent through the network and gets the length
+*           of its data field (needed when the data is binary).
+* @Params: in: fd = file descriptor to read from.
+*          in/out: type = type of frame received.
+*          in/out: header = header to get from frame.
+*          in/out: data = data to get from frame.
+*          in/out: data_length = length of the data (can be NULL).
+* @Return: Returns GCP_READ_OK, or 0 if the connection was closed.
+***********************************************************************/
+char GPC_readFrameWithLength(int fd, char *type, char **header, char **data, unsigned short *data_length) {
 	char byte = 0x07;
 	unsigned short length = 0;
 	int n;
@@ -141,66 +292,98 @@ char GPC_readFrame(int fd, char *type, char **header, char **data) {
 		return (0);
 	}
 
-	switch (byte) {
-	    case 'A':
-		    *type = 0x0A;
-			break;
-		case 'B':
-		    *type = 0x0B;
-			break;
-		case 'C':
-		    *type = 0x0C;
-			break;
-		case 'D':
-		    *type = 0x0D;
-			break;
-		case 'E':
-		    *type = 0x0E;
-			break;
-		case 'F':
-		    *type = 0x0F;
-			break;
-		default:
-		    *type = byte - '0';
-			break;
-	}
+	*type = decodeFrameType(byte);
 
 	// skip '['
 	read(fd, &byte, sizeof(char));
 	// read header
 	*header = SHAREDFUNCTIONS_readUntil(fd, ']');
 	// read lenght (2 bytes)
-	read(fd, &length, 2);
+	readFullData(fd, (char *) &length, 2);
 
 	// read data (lenght bytes)
 	if (0 < length) {
 	    *data = (char *) malloc (sizeof(char) * (length + 1));
 		
-		read(fd, *data, sizeof(char) * length);
+		// a socket may deliver the data field in several parts
+		readFullData(fd, *data, sizeof(char) * length);
 		(*data)[length] = '\0';
 	}
 
+	if (NULL != data_length) {
+	    *data_length = length;
+	}
+
 	return (GCP_READ_OK);
 }
 
 /**********************************************************************
-* @Purpose: Write a frame to the given file descriptor.
-* @Params: in: fd = file descriptor to write.
-* 		   in: type = type of frame to send.
-* 		   in: header = header of frame to send.
-* 		   in: data = data to send.
-* @Return: Returns GCP_WRITE_OK if no errors, otherwise GCP_WRITE_KO.
-**********************************************************************/
-char GPC_writeFrame(int fd, char type, char *header, char *data, unsigned short length) {
-	char *frame = NULL;
- 	char byte = 0;
-	char length_lsB = 0, length_msB = 0;
-	int i = 0, j = 0;
+* @Purpose: Decodes a frame from a buffer that may only hold part of it
+*           (e.g. the bytes read from a socket without blocking).
+* @Params: in: buffer = bytes received
+*          in: length = number of bytes in the buffer
+*          in/out: type = type of frame received.
+*          in/out: header = header to get from frame (NULL if the frame
+*                  is not complete).
+*          in/out: data = data to get from frame (NULL if it has none).
+* @Return: Returns the number of bytes of the frame, 0 if it has not
+*          arrived completely, or -1 if the bytes are not a frame.
+***********************************************************************/
+int GPC_parseFrame(char *buffer, int length, char *type, char **header, char **data) {
+	char *end = NULL;
+	unsigned short data_length = 0;
 	int size = 0;
 
-	// get frame size
-	size = 1 + ((int) strlen(header)) + 2 + 2 + length;
-	frame = (char *) malloc (sizeof(char) * size);
+	*header = NULL;
+	*data = NULL;
+
+	if (length < 2) {
+	    return (0);
+	}
+
+	if ('[' != buffer[1]) {
+	    return (-1);
+	}
+
+	end = (char *) memchr(buffer + 2, ']', length - 2);
+
+	// the header and the length (2 bytes, LSB first) go before the data
+	if ((NULL == end) || (end + 3 > buffer + length)) {
+	    return (0);
+	}
+
+	data_length = (unsigned short) ((unsigned char) end[1] | ((unsigned char) end[2] << 8));
+	size = (end - buffer) + 3;
+
+	if (size + data_length > length) {
+	    return (0);
+	}
+
+	*type = decodeFrameType(buffer[0]);
+	*header = strndup(buffer + 2, end - buffer - 2);
+
+	if (0 < data_length) {
+	    *data = (char *) malloc (sizeof(char) * (data_length + 1));
+		memcpy(*data, buffer + size, data_length);
+		(*data)[data_length] = '\0';
+	}
+
+	return (size + data_length);
+}
+
+/**********************************************************************
+* @Purpose: Encodes the type, header and length of a frame into a
+*           buffer, so that the data can be sent from where it is.
+* @Params: in/out: buffer = buffer to store the frame (must have room
+*                  for GPC_FRAME_OVERHEAD(header) bytes)
+* 		   in: type = type of frame.
+* 		   in: header = header of frame.
+* 		   in: length = number of bytes of data that will follow.
+* @Return: Returns the number of bytes encoded.
+**********************************************************************/
+int GPC_buildFrameHeader(char *buffer, char type, char *header, unsigned short length) {
+ 	char byte = 0;
+	int i = 0;
 
 	// write type (1 byte)
 	switch (type) {
@@ -227,28 +410,62 @@ char GPC_writeFrame(int fd, char type, char *header, char *data, unsigned short
 			break;
 	}
 
-	i = sprintf(frame, "%c[%s]", byte, header);
-
-	// write lenght (2 bytes)
-	if (data != NULL) {
-		length_msB = (char) ((length >> 8) & 0x00FF); 	// shift MSB
-		length_lsB = (char) (length & 0x00FF);			// store LSB
-		frame[i] = length_lsB;
-		frame[i + 1] = length_msB;
-		i += 2;
-		// write data (length bytes)
-		for (j = 0; j < length; j++) {
-		    frame[i] = data[j];
-			i++;
-		}
-	} else {
-		frame[i] = 0;
-		frame[i + 1] = 0;
-		i += 2;
+	i = sprintf(buffer, "%c[%s]", byte, header);
+
+	// write lenght (2 bytes, LSB first)
+	buffer[i] = (char) (length & 0x00FF);
+	buffer[i + 1] = (char) ((length >> 8) & 0x00FF);
+
+	return (i + 2);
+}
+
+/**********************************************************************
+* @Purpose: Encodes a frame into a buffer, so that several frames can be
+*           sent with a single write.
+* @Params: in/out: buffer = buffer to store the frame (must have room
+*                  for GPC_FRAME_OVERHEAD(header) + length bytes)
+* 		   in: type = type of frame.
+* 		   in: header = header of frame.
+* 		   in: data = data of the frame (can be NULL).
+* 		   in: length = number of bytes of data.
+* @Return: Returns the number of bytes of the encoded frame.
+**********************************************************************/
+int GPC_buildFrame(char *buffer, char type, char *header, char *data, unsigned short length) {
+	int i = 0;
+
+	if (NULL == data) {
+	    length = 0;
 	}
 
+	i = GPC_buildFrameHeader(buffer, type, header, length);
+
+	// write data (length bytes)
+	if (0 < length) {
+	    memcpy(buffer + i, data, length);
+		i += length;
+	}
+
+	return (i);
+}
+
+/**********************************************************************
+* @Purpose: Write a frame to the given file descriptor.
+* @Params: in: fd = file descriptor to write.
+* 		   in: type = type of frame to send.
+* 		   in: header = header of frame to send.
+* 		   in: data = data to send.
+* @Return: Returns GCP_WRITE_OK if no errors, otherwise GCP_WRITE_KO.
+**********************************************************************/
+char GPC_writeFrame(int fd, char type, char *header, char *data, unsigned short length) {
+	char *frame = NULL;
+	int size = 0;
+
+	// get frame size
+	frame = (char *) malloc (sizeof(char) * (GPC_FRAME_OVERHEAD(header) + ((NULL == data) ? 0 : length) + 1));
+	size = GPC_buildFrame(frame, type, header, data, length);
+
 	// write entire frame
-	if (-1 == write(fd, frame, size)) {
+	if (size != SHAREDFUNCTIONS_writeFull(fd, frame, size)) {
 	    free(frame);
 		frame = NULL;
 		return (GCP_WRITE_KO);
@@ -262,8 +479,8 @@ char GPC_writeFrame(int fd, char type, char *header, char *data, unsigned short
 /**********************************************************************
 * @Purpose: Given the data of a frame containing the attributes of a
 *           user, parses the user and stores it in list element.
-* @Params: in: data = data containing the name, IP, port and PID of the
-*              user.
+* @Params: in: data = data containing the name, IP, port, PID and host
+*              id of the user.
 * 		   in/out: e = instance of Element to store user.
 * @Return: Returns 1.
 **********************************************************************/
@@ -285,6 +502,12 @@ void GPC_parseUserFromFrame(char *data, Element *e) {
 	e->pid = atoi(buffer);
 	free(buffer);
 	buffer = NULL;
+	// get host id (empty if the son does not send it)
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	snprintf(e->host_id, HOST_ID_LENGTH + 1, "%s", buffer);
+	free(buffer);
+	buffer = NULL;
+	e->route = 0;
 }
 
 /**********************************************************************
@@ -327,21 +550,164 @@ char GPC_updateUsersList(BidirectionalList *list, char *users) {
 * 		    in/out: filename = the name of the file that the origin user sends
 * 		    in/out: file_size = the size of the file that the origin user sends
 * 		    in/out: md5sum = the MD5SUM of the file that the origin user sends
+* 		    in/out: codec = the codec offered to compress the data
 * @Return: ----
 **********************************************************************/
-void GPC_parseSendFileInfo(char *data, char **origin_user, char **filename, int *file_size, char **md5sum) {
+void GPC_parseSendFileInfo(char *data, char **origin_user, char **filename, long long *file_size, char **md5sum, char *codec) {
 	int i = 0;
 	char *file_size_str = NULL;
+	char *codec_str = NULL;
 
-	//data is in the format: originUser + GPC_DATA_SEPARATOR + filename + GPC_DATA_SEPARATOR + file_size + GPC_DATA_SEPARATOR + md5sum
+	//data is in the format: originUser + GPC_DATA_SEPARATOR + filename + GPC_DATA_SEPARATOR + file_size + GPC_DATA_SEPARATOR + md5sum [+ GPC_DATA_SEPARATOR + codec]
 	*origin_user = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
 	*filename = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
 	file_size_str = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
 	*md5sum = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
-	*file_size = atoi(file_size_str);
+	codec_str = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	*file_size = atoll(file_size_str);
+	*codec = GPC_parseCodec(codec_str);
+	free(file_size_str);
+	free(codec_str);
+}
+
+/**********************************************************************
+* @Purpose: Given the data of a GET_RANGE frame, gets the user who asks
+*           for the range, the content hash, the range and the codec.
+* @Params: in: data = the data of a GET_RANGE frame
+* 		   in/out: origin_user = the user who asks for the range
+* 		   in/out: md5sum = the content hash of the file
+* 		   in/out: offset = the offset of the first byte of the range
+* 		   in/out: length = the number of bytes of the range
+* 		   in/out: codec = the codec accepted to compress the data
+* @Return: ----
+**********************************************************************/
+void GPC_parseRangeRequest(char *data, char **origin_user, char **md5sum, long long *offset, long long *length, char *codec) {
+	int i = 0;
+	char *buffer = NULL;
+
+	// data is in the format: originUser + GPC_DATA_SEPARATOR + md5sum + GPC_DATA_SEPARATOR + offset + GPC_DATA_SEPARATOR + length + GPC_DATA_SEPARATOR + codec
+	*origin_user = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	*md5sum = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	*offset = atoll(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	*length = atoll(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &i);
+	*codec = GPC_parseCodec(buffer);
+	free(buffer);
+	buffer = NULL;
+}
+
+/**********************************************************************
+* @Purpose: Given an entry of the manifest of a batch of files, gets
+*           the filename, the size of the file and the MD5SUM.
+* @Params: in: entry = entry of a BATCH_LIST frame
+* 		   in/out: file = instance of BatchFile to store the file
+* @Return: ----
+**********************************************************************/
+void GPC_parseBatchEntry(char *entry, BatchFile *file) {
+	int i = 0;
+	char *file_size_str = NULL;
+
+	// entry is in the format: filename + GPC_DATA_SEPARATOR + file_size + GPC_DATA_SEPARATOR + md5sum
+	file->filename = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	file_size_str = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	file->md5sum = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	file->file_size = atoll(file_size_str);
 	free(file_size_str);
 }
 
+/**********************************************************************
+* @Purpose: Sends a list of flags (one per file of a batch) split in
+*           as many frames as needed.
+* @Params: in: fd = file descriptor to write.
+* 		   in: header = header of the frames (BATCH_NEED or
+*              BATCH_RESULT)
+* 		   in: flags = string with a GPC_BATCH_YES or GPC_BATCH_NO per
+*              file
+* 		   in: n_files = number of files of the batch
+* @Return: Returns GCP_WRITE_OK if no errors, otherwise GCP_WRITE_KO.
+**********************************************************************/
+char GPC_writeBatchFlags(int fd, char *header, char *flags, int n_files) {
+	int sent = 0, length = 0;
+
+	while (sent < n_files) {
+	    length = (n_files - sent > GPC_BATCH_MAX_BYTES) ? GPC_BATCH_MAX_BYTES : (n_files - sent);
+
+		if (GCP_WRITE_KO == GPC_writeFrame(fd, GCP_SEND_FILE_TYPE, header, flags + sent, (unsigned short) length)) {
+		    return (GCP_WRITE_KO);
+		}
+
+		sent += length;
+	}
+
+	return (GCP_WRITE_OK);
+}
+
+/**********************************************************************
+* @Purpose: Reads the list of flags (one per file of a batch) sent with
+*           GPC_writeBatchFlags.
+* @Params: in: fd = file descriptor to read from.
+* 		   in: header = expected header of the frames
+* 		   in/out: flags = string to store the flags (n_files bytes)
+* 		   in: n_files = number of files of the batch
+* @Return: Returns GCP_READ_OK if no errors, otherwise GCP_READ_KO.
+**********************************************************************/
+char GPC_readBatchFlags(int fd, char *header, char *flags, int n_files) {
+	char *frame_header = NULL;
+	char *data = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	unsigned short length = 0;
+	int received = 0;
+
+	while (received < n_files) {
+	    if (0 == GPC_readFrameWithLength(fd, &type, &frame_header, &data, &length)) {
+		    return (GCP_READ_KO);
+		}
+
+		if ((NULL == data) || (0 != strcmp(frame_header, header)) || (received + length > n_files)) {
+		    free(frame_header);
+			frame_header = NULL;
+
+			if (NULL != data) {
+			    free(data);
+				data = NULL;
+			}
+
+			return (GCP_READ_KO);
+		}
+
+		memcpy(flags + received, data, length);
+		received += length;
+		free(frame_header);
+		frame_header = NULL;
+		free(data);
+		data = NULL;
+	}
+
+	return (GCP_READ_OK);
+}
+
+/**********************************************************************
+* @Purpose: Gets the name of a codec to send it in a frame.
+* @Params: in: codec = CODEC_NONE or CODEC_LZ
+* @Return: Returns the name of the codec.
+**********************************************************************/
+char * GPC_getCodecName(char codec) {
+	return ((CODEC_LZ == codec) ? GPC_CODEC_LZ : GPC_CODEC_NONE);
+}
+
+/**********************************************************************
+* @Purpose: Gets the codec of a name received in a frame.
+* @Params: in: name = name of the codec (can be NULL)
+* @Return: Returns CODEC_LZ, or CODEC_NONE if the codec is unknown.
+**********************************************************************/
+char GPC_parseCodec(char *name) {
+	return (((NULL != name) && (0 == strcmp(name, GPC_CODEC_LZ))) ? CODEC_LZ : CODEC_NONE);
+}
+
 /**********************************************************************
 * @Purpose: Given the data of a SEND MSG frame, gets the origin user
 *           and the message.
@@ -381,10 +747,10 @@ char * GPC_getUsersFromList(BidirectionalList blist) {
 		element = BIDIRECTIONALLIST_get(&blist);
 
 		if (flag_first) {
-			size = asprintf(&data, "%s&%s&%d&%d", element.username, element.ip_network, element.port, (int) element.pid);
+			size = asprintf(&data, "%s&%s&%d&%d&%s", element.username, element.ip_network, element.port, (int) element.pid, element.host_id);
 			flag_first = 0;
 		} else {
-			n = asprintf(&buffer, "#%s&%s&%d&%d", element.username, element.ip_network, element.port, (int) element.pid);
+			n = asprintf(&buffer, "#%s&%s&%d&%d&%s", element.username, element.ip_network, element.port, (int) element.pid, element.host_id);
 			size += n + 1;
 			data = (char *) realloc (data, sizeof(char) * size);
 			strcat(data, buffer);
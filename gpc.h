@@ -20,6 +20,8 @@
 #define GCP_EXIT_TYPE					0x06
 #define GCP_UNKNOWN_TYPE				0x07
 #define GCP_COUNT_TYPE					0x08
+#define GCP_SWARM_TYPE					0x09
+#define GCP_BLOB_TYPE					0x0A
 
 /* Headers */
 #define GCP_CONNECT_HEADER				"NEW_SON\0" 
@@ -28,6 +30,37 @@
 #define GCP_SEND_MSG_HEADER		        "MSG\0"
 #define GCP_SEND_FILE_INFO_HEADER		"NEW_FILE\0"
 #define GCP_SEND_FILE_DATA_HEADER		"FILE_DATA\0"
+#define GCP_SEND_FILE_LZ_HEADER			"FILE_LZ\0"
+#define GCP_SEND_FILE_HOLE_HEADER		"FILE_HOLE\0"
+#define GCP_SEND_FILE_TREE_HEADER		"FILE_TREE\0"
+#define GCP_SEND_FILE_HAVE_HEADER		"FILE_HAVE\0"
+#define GCP_SEND_FILE_SEND_HEADER		"FILE_SEND\0"
+#define GCP_SEND_FILE_DELTA_HEADER		"FILE_DELTA\0"
+#define GCP_DELTA_SIGS_HEADER			"DELTA_SIGS\0"
+#define GCP_DELTA_COPY_HEADER			"DELTA_COPY\0"
+#define GCP_DELTA_END_HEADER			"DELTA_END\0"
+#define GCP_SEND_BATCH_HEADER			"NEW_BATCH\0"
+#define GCP_BATCH_LIST_HEADER			"BATCH_LIST\0"
+#define GCP_BATCH_NEED_HEADER			"BATCH_NEED\0"
+#define GCP_BATCH_FILE_HEADER			"BATCH_FILE\0"
+#define GCP_BATCH_END_HEADER			"BATCH_END\0"
+#define GCP_BATCH_RESULT_HEADER			"BATCH_RESULT\0"
+#define GCP_FILE_ACK_HEADER				"FILE_ACK\0"
+#define GCP_GET_RANGE_HEADER			"GET_RANGE\0"
+#define GCP_RANGE_OK_HEADER				"RANGE_OK\0"
+#define GCP_RANGE_KO_HEADER				"RANGE_KO\0"
+#define GCP_SYNC_START_HEADER			"SYNC_START\0"
+#define GCP_SYNC_OK_HEADER				"SYNC_OK\0"
+#define GCP_SYNC_KO_HEADER				"SYNC_KO\0"
+#define GCP_SYNC_DELETE_HEADER			"SYNC_DELETE\0"
+#define GCP_INVENTORY_HEADER			"INVENTORY\0"
+#define GCP_INVENTORY_ADD_HEADER		"INVENTORY_ADD\0"
+#define GCP_WHO_HAS_HEADER				"WHO_HAS\0"
+#define GCP_HAS_LIST_HEADER				"HAS_LIST\0"
+#define GCP_BLOB_PUT_HEADER				"BLOB_PUT\0"
+#define GCP_BLOB_GET_HEADER				"BLOB_GET\0"
+#define GCP_BLOB_OK_HEADER				"BLOB_OK\0"
+#define GCP_BLOB_KO_HEADER				"BLOB_KO\0"
 #define GPC_SEND_FILE_HEADER_OK_OUT	    "CHECK_OK\0"
 #define GPC_SEND_FILE_HEADER_KO_OUT	    "CHECK_KO\0"
 #define GPC_HEADER_CONOK            	"CONOK\0"
@@ -45,13 +78,26 @@
 /* Other constants */
 #define GPC_DATA_SEPARATOR				'&'
 #define GPC_USERS_SEPARATOR				'#'
-#define GPC_FILE_MAX_BYTES			    512
+#define GPC_CODEC_LZ					"lz\0"
+#define GPC_CODEC_NONE					"none\0"
+#define GPC_FILE_MAX_BYTES			    65535
+#define GPC_FRAME_OVERHEAD(header)		(1 + 2 + (int) strlen(header) + 2)
 #define GCP_FRAME_OK					1
 #define GCP_FRAME_KO					0
 #define GCP_WRITE_OK					1
 #define GCP_WRITE_KO					0
 #define GCP_READ_OK						1
 #define GCP_READ_KO						0
+#define GPC_BATCH_MAX_BYTES				65000
+#define GPC_BATCH_YES					'1'
+#define GPC_BATCH_NO					'0'
+#define GPC_BLOB_PEER_NAME				""
+
+typedef struct {
+	char *filename;
+	long long file_size;
+	char *md5sum;
+} BatchFile;
 
 /*********************************************************************
 * @Purpose: Checks the header and data fields of a frame to be sent.
@@ -71,6 +117,57 @@ char GCP_checkFrameFormat(char type, char *header, char *data);
 ***********************************************************************/
 char GPC_readFrame(int fd, char *type, char **header, char **data);
 
+/**********************************************************************
+* @Purpose: Reads a frame sent through the network and gets the length
+*           of its data field (needed when the data is binary).
+* @Params: in: fd = file descriptor to read from.
+*          in/out: type = type of frame received.
+*          in/out: header = header to get from frame.
+*          in/out: data = data to get from frame.
+*          in/out: data_length = length of the data (can be NULL).
+* @Return: Returns GCP_READ_OK, or 0 if the connection was closed.
+***********************************************************************/
+char GPC_readFrameWithLength(int fd, char *type, char **header, char **data, unsigned short *data_length);
+
+/**********************************************************************
+* @Purpose: Decodes a frame from a buffer that may only hold part of it
+*           (e.g. the bytes read from a socket without blocking).
+* @Params: in: buffer = bytes received
+*          in: length = number of bytes in the buffer
+*          in/out: type = type of frame received.
+*          in/out: header = header to get from frame (NULL if the frame
+*                  is not complete).
+*          in/out: data = data to get from frame (NULL if it has none).
+* @Return: Returns the number of bytes of the frame, 0 if it has not
+*          arrived completely, or -1 if the bytes are not a frame.
+***********************************************************************/
+int GPC_parseFrame(char *buffer, int length, char *type, char **header, char **data);
+
+/**********************************************************************
+* @Purpose: Encodes a frame into a buffer, so that several frames can be
+*           sent with a single write.
+* @Params: in/out: buffer = buffer to store the frame (must have room
+*                  for GPC_FRAME_OVERHEAD(header) + length bytes)
+* 		   in: type = type of frame.
+* 		   in: header = header of frame.
+* 		   in: data = data of the frame (can be NULL).
+* 		   in: length = number of bytes of data.
+* @Return: Returns the number of bytes of the encoded frame.
+**********************************************************************/
+int GPC_buildFrame(char *buffer, char type, char *header, char *data, unsigned short length);
+
+/**********************************************************************
+* @Purpose: Encodes the type, header and length of a frame into a
+*           buffer, so that the data can be sent from where it is.
+* @Params: in/out: buffer = buffer to store the frame (must have room
+*                  for GPC_FRAME_OVERHEAD(header) bytes)
+* 		   in: type = type of frame.
+* 		   in: header = header of frame.
+* 		   in: length = number of bytes of data that will follow.
+* @Return: Returns the number of bytes encoded.
+**********************************************************************/
+int GPC_buildFrameHeader(char *buffer, char type, char *header, unsigned short length);
+
 /**********************************************************************
 * @Purpose: Write a frame to the given file descriptor.
 * @Params: in: fd = file descriptor to write.
@@ -108,9 +205,70 @@ char GPC_updateUsersList(BidirectionalList *list, char *users);
 * 		    in/out: filename = the name of the file that the origin user sends
 * 		    in/out: file_size = the size of the file that the origin user sends
 * 		    in/out: md5sum = the MD5SUM of the file that the origin user sends
+* 		    in/out: codec = the codec offered to compress the data
+* @Return: ----
+**********************************************************************/
+void GPC_parseSendFileInfo(char *data, char **origin_user, char **filename, long long *file_size, char **md5sum, char *codec);
+
+/**********************************************************************
+* @Purpose: Given the data of a GET_RANGE frame, gets the user who asks
+*           for the range, the content hash, the range and the codec.
+* @Params: in: data = the data of a GET_RANGE frame
+* 		   in/out: origin_user = the user who asks for the range
+* 		   in/out: md5sum = the content hash of the file
+* 		   in/out: offset = the offset of the first byte of the range
+* 		   in/out: length = the number of bytes of the range
+* 		   in/out: codec = the codec accepted to compress the data
+* @Return: ----
+**********************************************************************/
+void GPC_parseRangeRequest(char *data, char **origin_user, char **md5sum, long long *offset, long long *length, char *codec);
+
+/**********************************************************************
+* @Purpose: Given an entry of the manifest of a batch of files, gets
+*           the filename, the size of the file and the MD5SUM.
+* @Params: in: entry = entry of a BATCH_LIST frame
+* 		   in/out: file = instance of BatchFile to store the file
 * @Return: ----
 **********************************************************************/
-void GPC_parseSendFileInfo(char *data, char **origin_user, char **filename, int *file_size, char **md5sum);
+void GPC_parseBatchEntry(char *entry, BatchFile *file);
+
+/**********************************************************************
+* @Purpose: Sends a list of flags (one per file of a batch) split in
+*           as many frames as needed.
+* @Params: in: fd = file descriptor to write.
+* 		   in: header = header of the frames (BATCH_NEED or
+*              BATCH_RESULT)
+* 		   in: flags = string with a GPC_BATCH_YES or GPC_BATCH_NO per
+*              file
+* 		   in: n_files = number of files of the batch
+* @Return: Returns GCP_WRITE_OK if no errors, otherwise GCP_WRITE_KO.
+**********************************************************************/
+char GPC_writeBatchFlags(int fd, char *header, char *flags, int n_files);
+
+/**********************************************************************
+* @Purpose: Reads the list of flags (one per file of a batch) sent with
+*           GPC_writeBatchFlags.
+* @Params: in: fd = file descriptor to read from.
+* 		   in: header = expected header of the frames
+* 		   in/out: flags = string to store the flags (n_files bytes)
+* 		   in: n_files = number of files of the batch
+* @Return: Returns GCP_READ_OK if no errors, otherwise GCP_READ_KO.
+**********************************************************************/
+char GPC_readBatchFlags(int fd, char *header, char *flags, int n_files);
+
+/**********************************************************************
+* @Purpose: Gets the name of a codec to send it in a frame.
+* @Params: in: codec = CODEC_NONE or CODEC_LZ
+* @Return: Returns the name of the codec.
+**********************************************************************/
+char * GPC_getCodecName(char codec);
+
+/**********************************************************************
+* @Purpose: Gets the codec of a name received in a frame.
+* @Params: in: name = name of the codec (can be NULL)
+* @Return: Returns CODEC_LZ, or CODEC_NONE if the codec is unknown.
+**********************************************************************/
+char GPC_parseCodec(char *name);
 
 /**********************************************************************
 * @Purpose: Given the data of a SEND MSG frame, gets the origin user
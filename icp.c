@@ -4,12 +4,1172 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 04/01/2023
-* @Last change: 08/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "icp.h"
 
+int icp_transfer_id = 0;			// identifier of the last file sent, to name its reply slot
+IcpChannel **icp_channels = NULL;	// queues of the other sons of the machine kept open
+int icp_n_channels = 0;
+pthread_mutex_t icp_channels_mutex = PTHREAD_MUTEX_INITIALIZER;
+ShmBus icp_bus;						// bus of the sons of the machine (header NULL if not opened)
+int icp_bus_pipe[2] = {-1, -1};		// wakes up the main loop when the bus has new messages
+pthread_t icp_bus_thread;
+int icp_msg_sock = -1;				// socket of the messages of the sons of the machine
+IcpMsgConn *icp_msg_conns = NULL;	// connections accepted from the other sons
+int icp_n_msg_conns = 0;
+
+/*********************************************************************
+* @Purpose: Reads a limit of the message queues of the system.
+* @Params: in: path = file of /proc/sys/fs/mqueue with the limit
+*          in: fallback = value if the file cannot be read
+* @Return: Returns the value of the limit.
+*********************************************************************/
+long readMqueueLimit(char *path, long fallback) {
+	char buffer[32];
+	long value = fallback;
+	int fd = open(path, O_RDONLY);
+	int n = 0;
+
+	if (fd >= 0) {
+	    // the files of /proc/sys are read in a single call
+		n = read(fd, buffer, sizeof(buffer) - 1);
+		buffer[(n > 0) ? n : 0] = '\0';
+
+		if (atol(buffer) > 0) {
+		    value = atol(buffer);
+		}
+
+		close(fd);
+	}
+
+	return (value);
+}
+
+/*********************************************************************
+* @Purpose: Creates the queue of this process to receive the messages
+*           and files of the sons of the same machine. It is opened
+*           without blocking, so every frame waiting can be read at
+*           once.
+* @Params: in: depth = maximum number of messages of the queue (0 = the
+*              default of the system)
+*          in: msg_size = maximum size of every message (0 = the default
+*              of the system)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns the descriptor of the queue, or -1 if it could not be
+*          created.
+*********************************************************************/
+mqd_t ICP_createQueue(long depth, long msg_size, pthread_mutex_t *mutex) {
+	struct mq_attr attr;
+	char *name = NULL;
+	char *buffer = NULL;
+	long max_depth = readMqueueLimit(MQUEUE_MSG_MAX_PATH, depth);
+	long max_msg_size = readMqueueLimit(MQUEUE_MSGSIZE_MAX_PATH, msg_size);
+	mqd_t qfd;
+
+	asprintf(&name, "/%d", getpid());
+
+	if ((depth > 0) || (msg_size > 0)) {
+	    memset(&attr, 0, sizeof(attr));
+		attr.mq_maxmsg = (depth > 0) ? depth : readMqueueLimit(MQUEUE_MSG_DEFAULT_PATH, max_depth);
+		attr.mq_msgsize = (msg_size > 0) ? msg_size : readMqueueLimit(MQUEUE_MSGSIZE_DEFAULT_PATH, max_msg_size);
+
+		// the fragments of the files need room for their header and some data
+		attr.mq_msgsize = (attr.mq_msgsize < ICP_MIN_MSG_SIZE) ? ICP_MIN_MSG_SIZE : attr.mq_msgsize;
+
+		// a process without privileges cannot go over the limits of the system
+		if ((attr.mq_maxmsg > max_depth) || (attr.mq_msgsize > max_msg_size)) {
+		    attr.mq_maxmsg = (attr.mq_maxmsg > max_depth) ? max_depth : attr.mq_maxmsg;
+			attr.mq_msgsize = (attr.mq_msgsize > max_msg_size) ? max_msg_size : attr.mq_msgsize;
+			asprintf(&buffer, QUEUE_LIMITED_MSG, attr.mq_maxmsg, attr.mq_msgsize);
+			pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(buffer);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			free(buffer);
+			buffer = NULL;
+		}
+
+		qfd = mq_open(name, O_RDONLY | O_CREAT | O_EXCL | O_NONBLOCK, 0600, &attr);
+
+		if ((mqd_t) -1 != qfd) {
+		    free(name);
+			name = NULL;
+			return (qfd);
+		}
+
+		// e.g. the queues of the user are over RLIMIT_MSGQUEUE
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(QUEUE_DEFAULT_MSG);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+	}
+
+	qfd = mq_open(name, O_RDONLY | O_CREAT | O_EXCL | O_NONBLOCK, 0600, NULL);
+	free(name);
+	name = NULL;
+
+	return (qfd);
+}
+
+/*********************************************************************
+* @Purpose: Puts a frame in the queue of another son of the machine.
+* @Params: in: qfd = descriptor of the queue
+*          in: pid = PID of the son
+*          in: data = frame to send
+*          in: length = number of bytes of the frame
+*          in: wait = seconds to wait if the queue is full (0 = none,
+*              ICP_WAIT_FOREVER = while the son is alive)
+* @Return: Returns 0 if the frame was sent, otherwise 1.
+*********************************************************************/
+char sendQueueFrame(mqd_t qfd, int pid, char *data, int length, int wait) {
+	struct timespec deadline;
+	int waited = 0;
+
+	while (1) {
+	    // with an expired deadline the frame is only sent if there is room for it
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += (0 != wait) ? 1 : 0;
+
+		if (0 == mq_timedsend(qfd, data, length, 0, &deadline)) {
+		    return (0);
+		}
+
+		waited++;
+
+		if ((ETIMEDOUT != errno) || (0 == wait) || ((wait > 0) && (waited >= wait)) || ((0 != kill(pid, 0)) && (ESRCH == errno))) {
+		    return (1);
+		}
+	}
+}
+
+/*********************************************************************
+* @Purpose: Sends the messages packed in a channel as a single message
+*           of the queue. The caller holds the lock of the channel.
+* @Params: in/out: channel = channel with the messages
+*          in: wait = seconds to wait if the queue is full (0 = none,
+*              ICP_WAIT_FOREVER = while the son is alive)
+* @Return: Returns 0 if the messages were sent (or there were none),
+*          otherwise 1 (they are kept in the channel).
+*********************************************************************/
+char flushPack(IcpChannel *channel, int wait) {
+	if (0 == channel->pack_length) {
+	    return (0);
+	}
+
+	if (0 == sendQueueFrame(channel->qfd, channel->pid, channel->pack, channel->pack_length, wait)) {
+	    channel->pack_length = 0;
+		return (0);
+	}
+
+	return (1);
+}
+
+/*********************************************************************
+* @Purpose: Writes the messages kept for the socket of a channel while
+*           it was full. The socket never blocks, a frame can be left
+*           halfway and finished later. The caller holds the lock of
+*           the channel.
+* @Params: in/out: channel = channel with the messages
+*          in: wait = seconds to wait if the socket is full (0 = none,
+*              ICP_WAIT_FOREVER = while the son is alive)
+* @Return: Returns 0 if the messages were written (or there were none),
+*          otherwise 1 (they are kept in the channel, unless the son
+*          has closed the connection).
+*********************************************************************/
+char flushSocket(IcpChannel *channel, int wait) {
+	struct pollfd pfd;
+	ssize_t n = 0;
+	int waited = 0;
+
+	while (channel->sock_length > 0) {
+	    n = send(channel->sock, channel->sock_out, channel->sock_length, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (n > 0) {
+		    channel->sock_length -= n;
+			memmove(channel->sock_out, channel->sock_out + n, channel->sock_length);
+		} else if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)) {
+		    // the son has closed its end, nobody will read them
+			close(channel->sock);
+			channel->sock = -1;
+			channel->sock_length = 0;
+			return (1);
+		} else if ((0 == wait) || ((wait > 0) && (waited >= wait)) || ((0 != kill(channel->pid, 0)) && (ESRCH == errno))) {
+		    return (1);
+		} else {
+		    pfd.fd = channel->sock;
+			pfd.events = POLLOUT;
+			poll(&pfd, 1, 1000);
+			waited++;
+		}
+	}
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Gets the address of the socket of messages of a process.
+* @Params: out: addr = address to fill
+*          in: pid = PID of the process
+* @Return: Returns the length of the address.
+*********************************************************************/
+socklen_t getMsgSocketAddress(struct sockaddr_un *addr, int pid) {
+	memset(addr, 0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+	// the first byte of an abstract name is 0
+	snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, ICP_MSG_SOCKET_NAME, pid);
+
+	return ((socklen_t) (sizeof(sa_family_t) + 1 + strlen(addr->sun_path + 1)));
+}
+
+/*********************************************************************
+* @Purpose: Connects to the socket of messages of another son of the
+*           machine, without waiting if it cannot accept it.
+* @Params: in: pid = PID of the son
+* @Return: Returns the file descriptor of the connection, or -1 if the
+*          son has no socket.
+*********************************************************************/
+int connectMsgSocket(int pid) {
+	struct sockaddr_un addr;
+	socklen_t length = getMsgSocketAddress(&addr, pid);
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if (sock < 0) {
+	    return (-1);
+	}
+
+	if (0 != connect(sock, (struct sockaddr *) &addr, length)) {
+	    close(sock);
+		return (-1);
+	}
+
+	return (sock);
+}
+
+/*********************************************************************
+* @Purpose: Removes the channels that are no longer valid and nobody
+*           is using, closing their queues. The caller holds
+*           icp_channels_mutex.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void purgeChannels() {
+	IcpChannel *channel = NULL;
+	int i = 0;
+
+	while (i < icp_n_channels) {
+	    channel = icp_channels[i];
+
+		// the messages packed for a son are not lost because the users change, unless it has died
+		if ((channel->stale) && (0 == channel->users) &&
+		    (((0 == channel->pack_length) && (0 == channel->sock_length)) || ((0 != kill(channel->pid, 0)) && (ESRCH == errno)))) {
+		    mq_close(channel->qfd);
+			free(channel->pack);
+			free(channel->sock_out);
+
+			if (channel->sock >= 0) {
+			    close(channel->sock);
+			}
+
+			pthread_mutex_destroy(&channel->lock);
+			free(channel);
+			channel = NULL;
+			icp_channels[i] = icp_channels[icp_n_channels - 1];
+			icp_n_channels--;
+		} else {
+		    i++;
+		}
+	}
+
+	if (0 == icp_n_channels) {
+	    free(icp_channels);
+		icp_channels = NULL;
+	}
+}
+
+/*********************************************************************
+* @Purpose: Finds the channel of a queue. The caller holds
+*           icp_channels_mutex.
+* @Params: in: qfd = descriptor of the queue
+* @Return: Returns the channel, or NULL if the queue is not cached.
+*********************************************************************/
+IcpChannel * findChannel(mqd_t qfd) {
+	int i = 0;
+
+	for (i = 0; i < icp_n_channels; i++) {
+	    if (qfd == icp_channels[i]->qfd) {
+		    return (icp_channels[i]);
+		}
+	}
+
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Gets the channel of a queue got with openChannel (it is not
+*           removed while it is in use).
+* @Params: in: qfd = descriptor of the queue
+* @Return: Returns the channel, or NULL if the queue is not cached.
+*********************************************************************/
+IcpChannel * getChannel(mqd_t qfd) {
+	IcpChannel *channel = NULL;
+
+	pthread_mutex_lock(&icp_channels_mutex);
+	channel = findChannel(qfd);
+	pthread_mutex_unlock(&icp_channels_mutex);
+
+	return (channel);
+}
+
+/*********************************************************************
+* @Purpose: Takes the lock of a channel, waiting ICP_MSG_WAIT_TIME
+*           seconds at most (another thread may be waiting for room
+*           in the queue of the same son).
+* @Params: in/out: channel = channel to lock
+* @Return: Returns 0 if the lock was taken, otherwise 1.
+*********************************************************************/
+char lockChannel(IcpChannel *channel) {
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ICP_MSG_WAIT_TIME;
+
+	return (0 != pthread_mutex_timedlock(&channel->lock, &deadline));
+}
+
+/*********************************************************************
+* @Purpose: Gets a channel to the queue of another son of the machine.
+*           The queue is opened the first time and kept open for the
+*           next messages and files sent to the same son.
+* @Params: in: pid = PID of the son
+* @Return: Returns the descriptor of the queue, or -1 if it could not
+*          be opened.
+*********************************************************************/
+mqd_t openChannel(int pid) {
+	IcpChannel **channels = NULL;
+	IcpChannel *channel = NULL;
+	struct mq_attr attr;
+	char *buffer = NULL;
+	mqd_t qfd;
+	int i = 0;
+
+	pthread_mutex_lock(&icp_channels_mutex);
+
+	for (i = 0; i < icp_n_channels; i++) {
+	    if ((!icp_channels[i]->stale) && (pid == icp_channels[i]->pid)) {
+		    // a son that died without updating the list leaves a queue nobody reads
+			if ((0 != kill(pid, 0)) && (ESRCH == errno)) {
+			    icp_channels[i]->stale = 1;
+				continue;
+			}
+
+			icp_channels[i]->users++;
+			qfd = icp_channels[i]->qfd;
+			pthread_mutex_unlock(&icp_channels_mutex);
+			return (qfd);
+		}
+	}
+
+	purgeChannels();
+
+	asprintf(&buffer, "/%d", pid);
+	qfd = mq_open(buffer, O_WRONLY);
+	free(buffer);
+	buffer = NULL;
+
+	if ((mqd_t) -1 != qfd) {
+	    channels = (IcpChannel **) realloc(icp_channels, sizeof(IcpChannel *) * (icp_n_channels + 1));
+		channel = (NULL != channels) ? (IcpChannel *) malloc(sizeof(IcpChannel)) : NULL;
+
+		if (NULL != channels) {
+		    icp_channels = channels;
+		}
+
+		// without memory the queue is used once and closed
+		if (NULL != channel) {
+		    channel->pid = pid;
+			channel->qfd = qfd;
+			channel->users = 1;
+			channel->stale = 0;
+			// every son can have its own size of message
+			channel->msg_size = (0 == mq_getattr(qfd, &attr)) ? attr.mq_msgsize : 0;
+			channel->pack = NULL;
+			channel->pack_length = 0;
+			channel->sock = connectMsgSocket(pid);
+			channel->sock_out = NULL;
+			channel->sock_length = 0;
+			pthread_mutex_init(&channel->lock, NULL);
+			icp_channels[icp_n_channels] = channel;
+			icp_n_channels++;
+		}
+	}
+
+	pthread_mutex_unlock(&icp_channels_mutex);
+
+	return (qfd);
+}
+
+/*********************************************************************
+* @Purpose: Releases a channel got with openChannel. The queue is only
+*           closed if it is not cached or the channel is no longer
+*           valid.
+* @Params: in: qfd = descriptor of the queue
+* @Return: ----
+*********************************************************************/
+void releaseChannel(mqd_t qfd) {
+	IcpChannel *channel = NULL;
+
+	if ((mqd_t) -1 == qfd) {
+	    return;
+	}
+
+	pthread_mutex_lock(&icp_channels_mutex);
+	channel = findChannel(qfd);
+
+	if (NULL != channel) {
+	    channel->users--;
+		purgeChannels();
+	} else {
+	    mq_close(qfd);
+	}
+
+	pthread_mutex_unlock(&icp_channels_mutex);
+}
+
+/*********************************************************************
+* @Purpose: Sends a message through a channel. If the queue of the
+*           receiver is full, the message is packed with the next ones
+*           into a single message of the queue, which is sent once
+*           there is room (or when it is full). It never waits more
+*           than ICP_MSG_WAIT_TIME seconds for the queue: if the pack
+*           cannot be sent by then, the message is refused and the
+*           pack is kept.
+* @Params: in: qfd = descriptor of the queue
+*          in: pid = PID of the receiver
+*          in: frame = ICP frame of the message
+* @Return: Returns 0 if the message was sent or packed, otherwise 1.
+*********************************************************************/
+char sendChannelMsg(mqd_t qfd, int pid, char *frame) {
+	IcpChannel *channel = getChannel(qfd);
+	int length = strlen(frame) + 1;
+	char error = 0;
+
+	if (NULL == channel) {
+	    return (sendQueueFrame(qfd, pid, frame, length, ICP_MSG_WAIT_TIME));
+	}
+
+	if (0 != lockChannel(channel)) {
+	    return (1);
+	}
+
+	if (length + (int) sizeof(ICP_PACK_TYPE) > channel->msg_size) {
+	    // a message that cannot be packed goes after the ones waiting
+		error = (0 != flushPack(channel, ICP_MSG_WAIT_TIME)) || (0 != sendQueueFrame(qfd, pid, frame, length, ICP_MSG_WAIT_TIME));
+		pthread_mutex_unlock(&channel->lock);
+		return (error);
+	}
+
+	// the messages waiting go first, so the order is kept
+	flushPack(channel, 0);
+
+	if (0 == channel->pack_length) {
+	    error = sendQueueFrame(qfd, pid, frame, length, 0);
+
+		// only a full queue makes the message wait
+		if ((0 == error) || (ETIMEDOUT != errno)) {
+		    pthread_mutex_unlock(&channel->lock);
+			return (error);
+		}
+	}
+
+	// the pack is sent when it cannot hold another message
+	if ((channel->pack_length + length > channel->msg_size) && (0 != flushPack(channel, ICP_MSG_WAIT_TIME))) {
+	    pthread_mutex_unlock(&channel->lock);
+		return (1);
+	}
+
+	if (NULL == channel->pack) {
+	    channel->pack = (char *) malloc(channel->msg_size);
+	}
+
+	if (0 == channel->pack_length) {
+	    memcpy(channel->pack, ICP_PACK_TYPE, sizeof(ICP_PACK_TYPE));
+		channel->pack_length = sizeof(ICP_PACK_TYPE);
+	}
+
+	memcpy(channel->pack + channel->pack_length, frame, length);
+	channel->pack_length += length;
+	pthread_mutex_unlock(&channel->lock);
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Sends the messages packed in a channel, or kept for its
+*           socket, waiting for room while the receiver is alive.
+* @Params: in: qfd = descriptor of the queue
+* @Return: ----
+*********************************************************************/
+void flushChannel(mqd_t qfd) {
+	IcpChannel *channel = getChannel(qfd);
+
+	// only the sends to the same son wait meanwhile (it only fails if the son has died)
+	if (NULL != channel) {
+	    pthread_mutex_lock(&channel->lock);
+
+		if ((0 != flushPack(channel, ICP_WAIT_FOREVER)) || (0 != flushSocket(channel, ICP_WAIT_FOREVER))) {
+		    channel->pack_length = 0;
+			channel->sock_length = 0;
+		}
+
+		pthread_mutex_unlock(&channel->lock);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Sends the messages packed for the other sons of the machine
+*           (or kept for their sockets) if they have room for them. The messages for the
+*           sons that have died are dropped. The channels that another
+*           thread is using are skipped, that thread sends them.
+* @Params: in: wait = seconds to wait for every queue that is full
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void ICP_flushChannels(int wait, pthread_mutex_t *mutex) {
+	IcpChannel **channels = NULL;
+	int n_channels = 0;
+	int i = 0;
+
+	// the channels are kept while the queues are waited for, without holding the list
+	pthread_mutex_lock(&icp_channels_mutex);
+	channels = (IcpChannel **) malloc(sizeof(IcpChannel *) * (icp_n_channels + 1));
+
+	for (i = 0; (NULL != channels) && (i < icp_n_channels); i++) {
+	    icp_channels[i]->users++;
+		channels[n_channels] = icp_channels[i];
+		n_channels++;
+	}
+
+	pthread_mutex_unlock(&icp_channels_mutex);
+
+	for (i = 0; i < n_channels; i++) {
+	    if (0 != pthread_mutex_trylock(&channels[i]->lock)) {
+		    continue;
+		}
+
+		if (((0 != flushPack(channels[i], wait)) || (0 != flushSocket(channels[i], wait))) &&
+		    ((0 != wait) || ((0 != kill(channels[i]->pid, 0)) && (ESRCH == errno)))) {
+		    channels[i]->pack_length = 0;
+			channels[i]->sock_length = 0;
+			pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(SEND_MSG_MQ_ERROR);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+		}
+
+		pthread_mutex_unlock(&channels[i]->lock);
+	}
+
+	pthread_mutex_lock(&icp_channels_mutex);
+
+	for (i = 0; i < n_channels; i++) {
+	    channels[i]->users--;
+	}
+
+	purgeChannels();
+	pthread_mutex_unlock(&icp_channels_mutex);
+	free(channels);
+	channels = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Checks if there are messages waiting for room in the queue
+*           or the socket of their receivers.
+* @Params: ----
+* @Return: Returns 1 if there are messages waiting, otherwise 0.
+*********************************************************************/
+char ICP_hasPendingMsgs() {
+	char pending = 0;
+	int i = 0;
+
+	pthread_mutex_lock(&icp_channels_mutex);
+
+	// a channel in use by another thread may be waiting for its queue
+	for (i = 0; (i < icp_n_channels) && (!pending); i++) {
+	    if (0 == pthread_mutex_trylock(&icp_channels[i]->lock)) {
+		    pending = (icp_channels[i]->pack_length > 0) || (icp_channels[i]->sock_length > 0);
+			pthread_mutex_unlock(&icp_channels[i]->lock);
+		} else {
+		    pending = 1;
+		}
+	}
+
+	pthread_mutex_unlock(&icp_channels_mutex);
+
+	return (pending);
+}
+
+/*********************************************************************
+* @Purpose: Invalidates the channels to the other sons of the machine
+*           (e.g. when the list of users changes). The queues in use
+*           are closed when their senders release them.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_invalidateChannels() {
+	int i = 0;
+
+	pthread_mutex_lock(&icp_channels_mutex);
+
+	for (i = 0; i < icp_n_channels; i++) {
+	    icp_channels[i]->stale = 1;
+	}
+
+	purgeChannels();
+	pthread_mutex_unlock(&icp_channels_mutex);
+}
+
+/*********************************************************************
+* @Purpose: Waits for the messages published in the bus and wakes up
+*           the main loop through a pipe (thread function).
+* @Params: in: args = unused
+* @Return: Returns NULL.
+*********************************************************************/
+void *busListener(void *args) {
+	unsigned int head = SHMBUS_head(&icp_bus);
+	sigset_t set;
+
+	(void) args;
+	// SIGINT must be handled by the main thread
+	sigemptyset(&set);
+	sigaddset(&set, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	while (1) {
+	    SHMBUS_wait(&icp_bus, head);
+		pthread_testcancel();
+
+		// if the pipe is full, the main loop has not read the previous wake up yet
+		if (head != SHMBUS_head(&icp_bus)) {
+		    head = SHMBUS_head(&icp_bus);
+			write(icp_bus_pipe[1], "b", 1);
+		}
+	}
+
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Subscribes this process to the bus of the sons of the
+*           machine connected to the same Arda.
+* @Params: in: arda_ip = IP address of Arda
+*          in: arda_port = port of Arda
+* @Return: Returns a file descriptor that is readable when the bus has
+*          new messages, or -1 if the bus could not be opened (the
+*          messages to this son then go through its queue).
+*********************************************************************/
+int ICP_openBus(char *arda_ip, int arda_port) {
+	if (SHMBUS_KO == SHMBUS_open(&icp_bus, arda_ip, arda_port)) {
+	    icp_bus.header = NULL;
+		return (-1);
+	}
+
+	if (0 != pipe2(icp_bus_pipe, O_NONBLOCK | O_CLOEXEC)) {
+	    SHMBUS_close(&icp_bus);
+		return (-1);
+	}
+
+	if (0 != pthread_create(&icp_bus_thread, NULL, busListener, NULL)) {
+	    SHMBUS_close(&icp_bus);
+		close(icp_bus_pipe[0]);
+		close(icp_bus_pipe[1]);
+		icp_bus_pipe[0] = -1;
+		icp_bus_pipe[1] = -1;
+		return (-1);
+	}
+
+	return (icp_bus_pipe[0]);
+}
+
+/*********************************************************************
+* @Purpose: Unsubscribes this process from the bus of the sons of the
+*           machine.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_closeBus() {
+	if (NULL == icp_bus.header) {
+	    return;
+	}
+
+	pthread_cancel(icp_bus_thread);
+	pthread_join(icp_bus_thread, NULL);
+	SHMBUS_close(&icp_bus);
+	close(icp_bus_pipe[0]);
+	close(icp_bus_pipe[1]);
+	icp_bus_pipe[0] = -1;
+	icp_bus_pipe[1] = -1;
+}
+
+/*********************************************************************
+* @Purpose: Creates the socket of this process to receive the messages
+*           of the sons of the same machine as GPC frames (a Unix socket
+*           in the abstract namespace, removed when it closes).
+* @Params: ----
+* @Return: Returns the file descriptor of the socket, or -1 if it could
+*          not be created (the messages then go through the queue).
+*********************************************************************/
+int ICP_openMsgSocket() {
+	struct sockaddr_un addr;
+	socklen_t length = getMsgSocketAddress(&addr, getpid());
+
+	icp_msg_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	if ((icp_msg_sock >= 0) && ((0 != bind(icp_msg_sock, (struct sockaddr *) &addr, length)) || (0 != listen(icp_msg_sock, SOMAXCONN)))) {
+	    close(icp_msg_sock);
+		icp_msg_sock = -1;
+	}
+
+	return (icp_msg_sock);
+}
+
+/*********************************************************************
+* @Purpose: Adds the socket of messages and the connections accepted
+*           from the other sons to a set of file descriptors.
+* @Params: in/out: fds = set of file descriptors for select
+* @Return: ----
+*********************************************************************/
+void ICP_setMsgSockets(fd_set *fds) {
+	int i = 0;
+
+	if (icp_msg_sock < 0) {
+	    return;
+	}
+
+	FD_SET(icp_msg_sock, fds);
+
+	for (i = 0; i < icp_n_msg_conns; i++) {
+	    FD_SET(icp_msg_conns[i].fd, fds);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Checks if the socket of messages or any of its connections
+*           is in a set of file descriptors returned by select.
+* @Params: in: fds = set of file descriptors
+* @Return: Returns 1 if any of them is ready, otherwise 0.
+*********************************************************************/
+char ICP_isMsgSocketSet(fd_set *fds) {
+	int i = 0;
+
+	if (icp_msg_sock < 0) {
+	    return (0);
+	}
+
+	for (i = 0; i < icp_n_msg_conns; i++) {
+	    if (FD_ISSET(icp_msg_conns[i].fd, fds)) {
+		    return (1);
+		}
+	}
+
+	return (FD_ISSET(icp_msg_sock, fds));
+}
+
+/*********************************************************************
+* @Purpose: Reads everything waiting in a connection of another son and
+*           shows the messages of the frames that have arrived whole.
+*           The part of a frame that has not arrived yet is kept for
+*           the next time. The connection is closed when the son closes
+*           it or sends something that is not a frame.
+* @Params: in/out: fds = set of file descriptors returned by select
+*          in: i = position of the connection
+*          in: shown = 1 if a message has already been shown
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 1 if something has been shown, otherwise 0.
+*********************************************************************/
+char receiveConnMsgs(fd_set *fds, int i, char shown, pthread_mutex_t *mutex) {
+	IcpMsgConn *conn = &icp_msg_conns[i];
+	char *origin_user = NULL;
+	char *message = NULL;
+	char *header = NULL;
+	char *data = NULL;
+	char *buffer = NULL;
+	char type = 0;
+	char closed = 0;
+	ssize_t n = 0;
+	int size = 0;
+
+	// the connection never blocks, it is read until it is empty
+	do {
+	    n = read(conn->fd, conn->buffer + conn->length, ICP_MSG_FRAME_MAX - conn->length);
+		closed = (0 == n) || ((n < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno));
+		conn->length += (n > 0) ? n : 0;
+
+		while ((size = GPC_parseFrame(conn->buffer, conn->length, &type, &header, &data)) > 0) {
+		    if ((GCP_SEND_MSG_TYPE == type) && (0 == strcmp(header, GCP_SEND_MSG_HEADER)) && (NULL != data)) {
+			    GPC_parseSendMessage(data, &origin_user, &message);
+				asprintf(&buffer, ICP_SOCKET_MSG_RECEIVED_MSG, origin_user, message);
+				pthread_mutex_lock(mutex);
+
+				// reset command line once for all of them
+				if (!shown) {
+				    printMsg(COLOR_DEFAULT_TXT);
+				}
+
+				printMsg(buffer);
+				pthread_mutex_unlock(mutex);
+				shown = 1;
+				// free memory
+				free(buffer);
+				buffer = NULL;
+				free(origin_user);
+				origin_user = NULL;
+				free(message);
+				message = NULL;
+			}
+
+			free(header);
+			header = NULL;
+
+			if (NULL != data) {
+			    free(data);
+				data = NULL;
+			}
+
+			conn->length -= size;
+			memmove(conn->buffer, conn->buffer + size, conn->length);
+		}
+
+		// a whole frame always fits in the buffer
+		closed |= (size < 0) || (ICP_MSG_FRAME_MAX == conn->length);
+	} while ((n > 0) && (!closed));
+
+	if (closed) {
+	    FD_CLR(conn->fd, fds);
+		close(conn->fd);
+		free(conn->buffer);
+		conn->buffer = NULL;
+		icp_msg_conns[i] = icp_msg_conns[icp_n_msg_conns - 1];
+		icp_n_msg_conns--;
+	}
+
+	return (shown);
+}
+
+/*********************************************************************
+* @Purpose: Accepts the connections of the other sons and shows every
+*           message waiting in the ones that are ready. Only the
+*           processes of the same user can connect.
+* @Params: in/out: fds = set of file descriptors returned by select
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 1 if something was shown, otherwise 0.
+*********************************************************************/
+char ICP_receiveSocketMsgs(fd_set *fds, pthread_mutex_t *mutex) {
+	IcpMsgConn *conns = NULL;
+	struct ucred cred;
+	socklen_t cred_length = sizeof(cred);
+	char *buffer = NULL;
+	char shown = 0;
+	int conn = -1;
+	int i = 0;
+
+	if (icp_msg_sock < 0) {
+	    return (0);
+	}
+
+	// the connections of the sons that have just opened a channel
+	if (FD_ISSET(icp_msg_sock, fds)) {
+	    while ((conn = accept4(icp_msg_sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		    // the abstract namespace has no permissions, the user is checked instead
+			cred_length = sizeof(cred);
+
+			if ((0 != getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_length)) || (geteuid() != cred.uid)) {
+			    close(conn);
+				continue;
+			}
+
+			conns = (IcpMsgConn *) realloc(icp_msg_conns, sizeof(IcpMsgConn) * (icp_n_msg_conns + 1));
+			buffer = (NULL != conns) ? (char *) malloc(sizeof(char) * ICP_MSG_FRAME_MAX) : NULL;
+
+			if (NULL != conns) {
+			    icp_msg_conns = conns;
+			}
+
+			if (NULL == buffer) {
+			    close(conn);
+				break;
+			}
+
+			icp_msg_conns[icp_n_msg_conns].fd = conn;
+			icp_msg_conns[icp_n_msg_conns].buffer = buffer;
+			icp_msg_conns[icp_n_msg_conns].length = 0;
+			icp_n_msg_conns++;
+			buffer = NULL;
+			// its first messages may already be waiting
+			FD_SET(conn, fds);
+		}
+	}
+
+	// the last connection takes the place of a closed one
+	for (i = icp_n_msg_conns - 1; i >= 0; i--) {
+	    if (FD_ISSET(icp_msg_conns[i].fd, fds)) {
+		    shown = receiveConnMsgs(fds, i, shown, mutex);
+		}
+	}
+
+	return (shown);
+}
+
+/*********************************************************************
+* @Purpose: Closes the socket of messages and its connections.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_closeMsgSocket() {
+	int i = 0;
+
+	for (i = 0; i < icp_n_msg_conns; i++) {
+	    close(icp_msg_conns[i].fd);
+		free(icp_msg_conns[i].buffer);
+	}
+
+	if (NULL != icp_msg_conns) {
+	    free(icp_msg_conns);
+		icp_msg_conns = NULL;
+	}
+
+	icp_n_msg_conns = 0;
+
+	if (icp_msg_sock >= 0) {
+	    close(icp_msg_sock);
+		icp_msg_sock = -1;
+	}
+}
+
+/*********************************************************************
+* @Purpose: Sends a message to several users of the same machine. It is
+*           published once in the bus for all the ones subscribed to
+*           it, and sent through the queue of the others.
+* @Params: in: pids = PIDs of the users that will receive the message
+*          in: n_pids = number of users
+* 		   in: message = string containing the message to send
+* 		   in: origin_username = string with the name of the sender
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the message was sent to all of them, otherwise 1.
+*********************************************************************/
+char ICP_broadcastMsg(int *pids, int n_pids, char *message, char *origin_username, pthread_mutex_t *mutex) {
+	char *buffer = NULL;
+	char *data = NULL;
+	char published = 0;
+	char error = 0;
+	int length = 0;
+	mqd_t qfd;
+	int i = 0;
+
+	// check message not empty
+	if (strlen(message) == 2) {
+	    return (1);
+	}
+
+	// same frame as a single message, so the receivers show it the same way
+	asprintf(&buffer, "msg%c%s%c%s", ICP_DATA_SEPARATOR, origin_username, ICP_DATA_SEPARATOR, message);
+
+	if (NULL != icp_bus.header) {
+	    // the frame is followed by the PIDs of its receivers, as the bus reaches every son of the machine
+		length = strlen(buffer) + 1;
+		data = (char *) malloc(length + sizeof(int) * n_pids);
+		memcpy(data, buffer, length);
+
+		for (i = 0; i < n_pids; i++) {
+		    if (SHMBUS_isSubscriber(&icp_bus, pids[i])) {
+			    memcpy(data + length, &pids[i], sizeof(int));
+				length += sizeof(int);
+			}
+		}
+
+		// if it does not fit in the bus, it goes through the queues
+		published = (length > (int) strlen(buffer) + 1) && (SHMBUS_OK == SHMBUS_publish(&icp_bus, data, length));
+		free(data);
+		data = NULL;
+	}
+
+	for (i = 0; i < n_pids; i++) {
+	    if ((!published) || (!SHMBUS_isSubscriber(&icp_bus, pids[i]))) {
+		    qfd = openChannel(pids[i]);
+			error |= ((mqd_t) -1 == qfd) || (0 != sendChannelMsg(qfd, pids[i], buffer));
+			releaseChannel(qfd);
+		}
+	}
+
+	free(buffer);
+	buffer = NULL;
+
+	pthread_mutex_lock(mutex);
+
+	if (error) {
+	    printMsg(COLOR_RED_TXT);
+		printMsg(SEND_MSG_MQ_ERROR);
+		printMsg(COLOR_DEFAULT_TXT);
+	} else {
+	    printMsg(SEND_MSG_OK_MSG);
+	}
+
+	pthread_mutex_unlock(mutex);
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Checks if a message published in the bus is for this
+*           process.
+* @Params: in: data = message of the bus
+*          in: length = number of bytes of the message
+* @Return: Returns 1 if it is for this process, otherwise 0.
+*********************************************************************/
+char isBusReceiver(char *data, int length) {
+	int i = strlen(data) + 1;
+	int pid = 0;
+
+	for (; i + (int) sizeof(int) <= length; i += sizeof(int)) {
+	    memcpy(&pid, data + i, sizeof(int));
+
+		if (getpid() == pid) {
+		    return (1);
+		}
+	}
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Shows the messages published in the bus by the other sons
+*           of the machine since the last call.
+* @Params: in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 1 if something was shown, otherwise 0.
+*********************************************************************/
+char ICP_receiveBus(pthread_mutex_t *mutex) {
+	char data[SHMBUS_SLOT_SIZE];
+	char *buffer = NULL;
+	char shown = 0;
+	int length = 0;
+	int lost = 0;
+
+	// the wake ups are only a hint, every message waiting is read
+	while (read(icp_bus_pipe[0], data, sizeof(data)) > 0);
+
+	do {
+	    length = SHMBUS_read(&icp_bus, data, &lost);
+
+		// reset command line once for all of them
+		if ((!shown) && ((lost > 0) || (length > 0))) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			shown = 1;
+		}
+
+		if (lost > 0) {
+		    asprintf(&buffer, BUS_LOST_MSG, lost);
+			pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(buffer);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			free(buffer);
+			buffer = NULL;
+		}
+
+		// the frame ends with '\0' and is followed by the PIDs of its receivers
+		if ((length > 0) && (NULL != memchr(data, '\0', length)) && isBusReceiver(data, length)) {
+		    ICP_receiveMsg(data, mutex);
+		}
+	} while ((length > 0) || (lost > 0));
+
+	return (shown);
+}
+
+/*********************************************************************
+* @Purpose: Sends a message as a GPC frame (the one sent to the users
+*           of other machines) through the socket of a channel. The
+*           socket is only used once the receiver has read the frames
+*           sent through its queue, so the messages keep their order.
+*           If the socket is full, the frame is kept in the channel and
+*           the next messages follow it.
+* @Params: in: qfd = descriptor of the queue of the channel
+* 		   in: message = string containing the message to send (between
+*              quotes)
+* 		   in: origin_username = string with the name of the sender
+* @Return: Returns ICP_SOCKET_SENT if the message was sent (or kept),
+*          ICP_SOCKET_UNUSED if it must go through the queue, otherwise
+*          ICP_SOCKET_KO.
+*********************************************************************/
+char sendSocketMsg(mqd_t qfd, char *message, char *origin_username) {
+	IcpChannel *channel = getChannel(qfd);
+	struct mq_attr attr;
+	char *data = NULL;
+	int length = 0, size = 0;
+
+	if (NULL == channel) {
+	    return (ICP_SOCKET_UNUSED);
+	}
+
+	if (0 != lockChannel(channel)) {
+	    return (ICP_SOCKET_KO);
+	}
+
+	// while the queue holds frames (maybe ours), the messages follow them
+	if ((channel->sock < 0) || ((0 == channel->sock_length) &&
+	    ((0 != channel->pack_length) || (0 != mq_getattr(qfd, &attr)) || (0 != attr.mq_curmsgs)))) {
+	    pthread_mutex_unlock(&channel->lock);
+		return (ICP_SOCKET_UNUSED);
+	}
+
+	// the quotes are removed, as in the messages sent through the network
+	length = asprintf(&data, "%s%c%.*s", origin_username, GPC_DATA_SEPARATOR, (int) strlen(message) - 2, message + 1);
+	size = GPC_FRAME_OVERHEAD(GCP_SEND_MSG_HEADER) + length;
+
+	// the messages kept for the socket are written first, to make room
+	if ((length > GPC_FILE_MAX_BYTES) || ((channel->sock_length + size > ICP_MSG_SOCKET_MAX) && (0 != flushSocket(channel, ICP_MSG_WAIT_TIME)))) {
+	    // only an empty socket (e.g. closed by the son) lets the message go through the queue
+		size = ((0 == channel->sock_length) && (length <= GPC_FILE_MAX_BYTES)) ? ICP_SOCKET_UNUSED : ICP_SOCKET_KO;
+		pthread_mutex_unlock(&channel->lock);
+		free(data);
+		data = NULL;
+		return (size);
+	}
+
+	if (NULL == channel->sock_out) {
+	    channel->sock_out = (char *) malloc(sizeof(char) * ICP_MSG_SOCKET_MAX);
+	}
+
+	channel->sock_length += GPC_buildFrame(channel->sock_out + channel->sock_length, GCP_SEND_MSG_TYPE, GCP_SEND_MSG_HEADER, data, (unsigned short) length);
+	free(data);
+	data = NULL;
+
+	// what does not fit now is written by ICP_flushChannels
+	if ((0 != flushSocket(channel, 0)) && (channel->sock < 0)) {
+	    pthread_mutex_unlock(&channel->lock);
+		return (ICP_SOCKET_KO);
+	}
+
+	pthread_mutex_unlock(&channel->lock);
+
+	return (ICP_SOCKET_SENT);
+}
+
 /*********************************************************************
-* @Purpose: Sends a message to a user using message queues.
+* @Purpose: Sends a message to a user of the same machine, as a GPC
+*           frame through its socket, or through its queue while the
+*           socket cannot be used.
 * @Params: in: pid = PID of the user that will receive the message
 * 		   in: message = string containing the message to send
 * 		   in: origin_username = string with the name of the sender
@@ -20,25 +1180,39 @@
 char ICP_sendMsg(int pid, char *message, char *origin_username, pthread_mutex_t *mutex) {
 	mqd_t qfd;
 	char *buffer = NULL;
+	char error = ICP_SOCKET_UNUSED;
 
-	// open queue
-	asprintf(&buffer, "/%d", pid);
-	qfd = mq_open(buffer, O_RDWR);
-	free(buffer);
-	buffer = NULL;
-			
 	// check message not empty
 	if (strlen(message) == 2) {
 	    // invalid message
-		mq_close(qfd);
 		return (1);
 	}
+
+	// the queue of the receiver stays open for the next messages
+	qfd = openChannel(pid);
+	error = sendSocketMsg(qfd, message, origin_username);
+
+	if (ICP_SOCKET_UNUSED != error) {
+	    pthread_mutex_lock(mutex);
+
+		if (ICP_SOCKET_KO == error) {
+		    printMsg(COLOR_RED_TXT);
+			printMsg(SEND_MSG_MQ_ERROR);
+			printMsg(COLOR_DEFAULT_TXT);
+		} else {
+		    printMsg(SEND_MSG_OK_MSG);
+		}
+
+		pthread_mutex_unlock(mutex);
+		releaseChannel(qfd);
+		return (ICP_SOCKET_KO == error);
+	}
 			
 	// prepare data for frame
 	asprintf(&buffer, "msg%c%s%c%s", ICP_DATA_SEPARATOR, origin_username, ICP_DATA_SEPARATOR, message);
 
 	// send message
-	if (mq_send(qfd, buffer, strlen(buffer) + 1, 0) == -1) {
+	if (((mqd_t) -1 == qfd) || (0 != sendChannelMsg(qfd, pid, buffer))) {
 		pthread_mutex_lock(mutex);
 		printMsg(COLOR_RED_TXT);
 		printMsg(SEND_MSG_MQ_ERROR);
@@ -50,7 +1224,7 @@ char ICP_sendMsg(int pid, char *message, char *origin_username, pthread_mutex_t
 			buffer = NULL;
 		}
 
-		mq_close(qfd);
+		releaseChannel(qfd);
 		return (1);
 	} else {
 		pthread_mutex_lock(mutex);
@@ -64,32 +1238,84 @@ char ICP_sendMsg(int pid, char *message, char *origin_username, pthread_mutex_t
 		buffer = NULL;
 	}
 
-	mq_close(qfd);
+	releaseChannel(qfd);
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Waits for the receiver of a file to post a reply in the
+*           slot of the transfer and reads it.
+* @Params: in/out: completion = reply slot of the transfer
+*          in: pid = PID of the receiver
+*          in/out: reply = string to store the reply
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the reply was received, otherwise 1.
+*********************************************************************/
+char waitFileReply(Completion *completion, int pid, char **reply, pthread_mutex_t *mutex) {
+	if (COMPLETION_KO == COMPLETION_wait(completion, pid, reply)) {
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(RECEIVER_GONE_ERROR);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		return (1);
+	}
+
 	return (0);
 }
 
 /*********************************************************************
 * @Purpose: Sends a file to a user using message queues.
-* @Params: in/out: qfd = file descriptor of the message queue
-* 		   in/out: path = path of the file to send
+* @Params: in/out: qfd = channel to the queue of the receiver
+* 		   in: pid = PID of the user that will receive the file
+* 		   in: directory = string with the directory of the file
 * 		   in: filename = name of the file to send
 * 		   in/out: fd_file = file descriptor of the file to send
 * 		   in: username = string containing the name of the sender
 * 		   in: file_size = size of the file to send
+* 		   in/out: completion = reply slot of the transfer
+* 		   in/out: already_present = set to 1 if the receiver already
+* 		           had the content and no data was sent
+* 		   in/out: ring = locked ring of the receiver (no ring if its
+* 		           header is NULL)
+* 		   in/out: control = progress of the transfer (can be NULL)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 0 if the file was sent successfully, otherwise 1.
 *********************************************************************/
-char sendFileFrames(mqd_t *qfd, char **path, char *filename, int *fd_file, char *username, int file_size, pthread_mutex_t *mutex) {
+char sendFileFrames(mqd_t *qfd, int pid, char *directory, char *filename, int *fd_file, char *username, long long file_size,
+                    Completion *completion, char *already_present, ShmRing *ring, TransferControl *control, pthread_mutex_t *mutex) {
+	struct mq_attr attr;
+	struct stat hashed;
+	FileSource src;
+	IcpChunkHeader header;
 	char *md5sum = NULL;
 	char *buffer = NULL;
+	char *chunk = NULL;
+	int length = 0;
+	int chunk_size = 0;
+	char use_ring = 0;
 
-	// Get the MD5SUM
-	md5sum = SHAREDFUNCTIONS_getMD5Sum(*path);
-	// Prepare the message to send
-	asprintf(&buffer, "file%c%s%c%s%c%d%c%s", ICP_DATA_SEPARATOR, username, ICP_DATA_SEPARATOR, filename, ICP_DATA_SEPARATOR, file_size, ICP_DATA_SEPARATOR, md5sum);
-	free(*path);
-	*path = NULL;
+	// Get the MD5SUM (a tree hash for big files), from the index if the file did not change
+	md5sum = FILEINDEX_getHash(directory, filename, &hashed);
+
+	if (NULL == md5sum) {
+	    close(*fd_file);
+		return (1);
+	}
+
+	// the hash only belongs to the file we send if it has the size we send
+	if ((long long) hashed.st_size != file_size) {
+	    hashed.st_ino = 0;
+	}
+
+	// Prepare the message to send (our PID lets the receiver take the file descriptor and,
+	// with the identifier of the transfer, open its reply slot; the ring field tells if we hold its ring;
+	// the inode and modification time of the hashed file let it trust the hash of a file it links or clones)
+	asprintf(&buffer, "file%c%s%c%s%c%lld%c%s%c%d%c%d%c%d%c%llu%c%lld", ICP_DATA_SEPARATOR, username, ICP_DATA_SEPARATOR, filename, ICP_DATA_SEPARATOR, file_size, ICP_DATA_SEPARATOR, md5sum,
+	         ICP_DATA_SEPARATOR, getpid(), ICP_DATA_SEPARATOR, (NULL != ring->header) ? 1 : 0, ICP_DATA_SEPARATOR, completion->id,
+			 ICP_DATA_SEPARATOR, (unsigned long long) hashed.st_ino, ICP_DATA_SEPARATOR, (long long) hashed.st_mtime);
 	free(md5sum);
 	md5sum = NULL;
 	
@@ -103,8 +1329,6 @@ char sendFileFrames(mqd_t *qfd, char **path, char *filename, int *fd_file, char
 		// free memory
 		free(buffer);
 		buffer = NULL;
-		// close queue
-		mq_close(*qfd);
 		close(*fd_file);
 		return (1);
 	}
@@ -112,80 +1336,155 @@ char sendFileFrames(mqd_t *qfd, char **path, char *filename, int *fd_file, char
 	free(buffer);
 	buffer = NULL;
 
-	// Send the file in fragments if bigger than ICP_FILE_MAX_BYTES
-	while (file_size > ICP_FILE_MAX_BYTES) {
-		buffer = (char *) malloc(sizeof(char) * ICP_FILE_MAX_BYTES);
-		read(*fd_file, buffer, ICP_FILE_MAX_BYTES);
-		
-		if (mq_send(*qfd, buffer, ICP_FILE_MAX_BYTES, 0) == -1) {
+	// Wait until the receiver tells us whether it already has the content
+	if (0 != waitFileReply(completion, pid, &buffer, mutex)) {
+		close(*fd_file);
+		return (1);
+	}
+
+	if (0 == strcmp(buffer, FILE_HAVE_REPLY)) {
+	    *already_present = 1;
+		free(buffer);
+		buffer = NULL;
+		close(*fd_file);
+		return (0);
+	}
+
+	// the receiver can refuse the file before any data is sent (e.g. not enough space)
+	if (0 == strcmp(buffer, FILE_KO_REPLY)) {
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(SEND_FILE_REFUSED_ERROR);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		close(*fd_file);
+		return (1);
+	}
+
+	// the receiver copies the file itself, its final reply tells if it worked
+	if (0 == strcmp(buffer, FILE_FD_REPLY)) {
+	    free(buffer);
+		buffer = NULL;
+
+		// the receiver is waiting for the descriptor, not for the queue, so there is no fallback
+		if (FDPASS_KO == FDPASS_send(pid, *fd_file, file_size)) {
 		    pthread_mutex_lock(mutex);
 			printMsg(COLOR_RED_TXT);
-			printMsg(SEND_FILE_MQ_ERROR);
+			printMsg(FD_NOT_SENT_ERROR);
 			printMsg(COLOR_DEFAULT_TXT);
 			pthread_mutex_unlock(mutex);
-			free(buffer);
-			buffer = NULL;
-			// close queue
-			mq_close(*qfd);
 			close(*fd_file);
 			return (1);
 		}
-		
-		free(buffer);
-		buffer = NULL;
-		file_size -= ICP_FILE_MAX_BYTES;
+
+		if (NULL != control) {
+		    control->bytes += file_size;
+		}
+
+		close(*fd_file);
+		return (0);
 	}
-	
-	// Send the last part of the file
-	buffer = (char *) malloc(sizeof(char) * file_size);
-	read(*fd_file, buffer, file_size);
 
-	if (mq_send(*qfd, buffer, file_size, 0) == -1) {
+	use_ring = (0 == strcmp(buffer, FILE_RING_REPLY)) && (NULL != ring->header);
+	free(buffer);
+	buffer = NULL;
+
+	// Send the file in fragments as big as the messages of the queue (the
+	// depth of the queue limits the fragments in flight), tagged with the
+	// stream of this transfer so they can be mixed with the ones of other
+	// files, or in bigger chunks copied into the ring of the receiver
+	if (mq_getattr(*qfd, &attr) == -1) {
 		pthread_mutex_lock(mutex);
 		printMsg(COLOR_RED_TXT);
-		printMsg(SEND_FILE_MQ_ERROR);
+		printMsg(MQ_ATTR_ERROR_MSG);
 		printMsg(COLOR_DEFAULT_TXT);
 		pthread_mutex_unlock(mutex);
-		free(buffer);
-		buffer = NULL;
-		// close queue
-		mq_close(*qfd);
 		close(*fd_file);
 		return (1);
 	}
 
-	free(buffer);
+	chunk_size = use_ring ? ICP_RING_CHUNK_SIZE : (int) (attr.mq_msgsize - sizeof(IcpChunkHeader));
+	memset(&header, 0, sizeof(IcpChunkHeader));
+	strcpy(header.type, ICP_CHUNK_TYPE);
+	header.sender_pid = getpid();
+	header.transfer_id = completion->id;
+	chunk = use_ring ? NULL : (char *) malloc(attr.mq_msgsize);
+
+	// the fragments are read ahead of the one in flight
+	if ((chunk_size <= 0) || (!use_ring && (NULL == chunk)) || (FILESOURCE_KO == FILESOURCE_open(&src, *fd_file, file_size, chunk_size))) {
+		free(chunk);
+		chunk = NULL;
+		close(*fd_file);
+		return (1);
+	}
+
+	while (file_size > 0) {
+	    length = (file_size > chunk_size) ? chunk_size : (int) file_size;
+		// a file in a queue is never interrupted, so a cancellation only stops the waiting
+		SCHEDULER_acquire(control, length);
+		buffer = FILESOURCE_next(&src, length);
+
+		if ((NULL != buffer) && !use_ring) {
+		    memcpy(chunk, &header, sizeof(IcpChunkHeader));
+			memcpy(chunk + sizeof(IcpChunkHeader), buffer, length);
+			header.seq++;
+		}
+		
+		if ((NULL == buffer) || (use_ring ? (SHMRING_KO == SHMRING_write(ring, buffer, length)) : (mq_send(*qfd, chunk, sizeof(IcpChunkHeader) + length, 0) == -1))) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(SEND_FILE_MQ_ERROR);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			FILESOURCE_close(&src);
+			buffer = NULL;
+			free(chunk);
+			chunk = NULL;
+			close(*fd_file);
+			return (1);
+		}
+		
+		if (NULL != control) {
+		    control->bytes += length;
+		}
+
+		file_size -= length;
+	}
+
+	FILESOURCE_close(&src);
 	buffer = NULL;
+	free(chunk);
+	chunk = NULL;
 	close(*fd_file);
 	return (0);
 }
 
 /*********************************************************************
-* @Purpose: Sends a file to a user using message queues.
-* @Params: in: pid = PID of the user that will receive the file
+* @Purpose: Sends a file to a user using message queues (and the ring
+*           of the receiver for the data, if it has one).
+* @Params: in: qfd = channel to the queue of the receiver
+*          in: pid = PID of the user that will receive the file
 * 		   in: filename = name of the file to send
 * 		   in: directory = string with the directory of the file
 * 		   in: username = string containing the name of the sender
+* 		   in/out: ring = locked ring of the receiver (no ring if its
+* 		           header is NULL)
+* 		   in/out: completion = reply slot of the transfer
+*          in/out: control = progress of the transfer (can be NULL)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 0 if the file was sent successfully, otherwise 1.
 *********************************************************************/
-char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthread_mutex_t *mutex) {
+char sendLocalFile(mqd_t qfd, int pid, char *filename, char *directory, char *username, ShmRing *ring, Completion *completion, TransferControl *control, pthread_mutex_t *mutex) {
 	char *filename_path = NULL;
-	int file_size = 0;
+	struct stat st;
+	long long file_size = 0;
 	int fd_file = FD_NOT_FOUND;
-	mqd_t qfd;
-	semaphore sem_queue;
-	struct mq_attr attr;
 	char *buffer = NULL;
+	char already_present = 0;
 
-	// open queue
-	asprintf(&buffer, "/%d", pid);
-	qfd = mq_open(buffer, O_RDWR);
-	free(buffer);
-	buffer = NULL;
-	// create semaphore
-	SEM_constructor_with_name(&sem_queue, pid);
 	// open the file to send
 	asprintf(&filename_path, ".%s/%s", directory, filename);
 	fd_file = open(filename_path, O_RDONLY);
@@ -203,14 +1502,12 @@ char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthr
 		buffer = NULL;
 		free(filename_path);
 		filename_path = NULL;
-		// close queue
-		mq_close(qfd);
 		return (1);
 	}
 
 	// get file size
-	file_size = (int) lseek(fd_file, 0, SEEK_END);
-	lseek(fd_file, 0, SEEK_SET);
+	fstat(fd_file, &st);
+	file_size = st.st_size;
 	
 	if (file_size == 0) {
 		pthread_mutex_lock(mutex);
@@ -221,48 +1518,25 @@ char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthr
 		// free memory
 		free(filename_path);
 		filename_path = NULL;
-		// close queue
-		mq_close(qfd);
 		return (1);
 	}
 
-	if (0 != sendFileFrames(&qfd, &filename_path, filename, &fd_file, username, file_size, mutex)) {
-		// close queue
-		mq_close(qfd);
+	free(filename_path);
+	filename_path = NULL;
+
+	if (0 != sendFileFrames(&qfd, pid, directory, filename, &fd_file, username, file_size, completion, &already_present, ring, control, mutex)) {
 	    return (1);
 	}
-	
-	// get the attributes of the queue
-	if (mq_getattr(qfd, &attr) == -1) {
+
+	if (already_present) {
 		pthread_mutex_lock(mutex);
-		printMsg(COLOR_RED_TXT);
-		printMsg(MQ_ATTR_ERROR_MSG);
-		printMsg(COLOR_DEFAULT_TXT);
+		printMsg(FILE_ALREADY_PRESENT_MSG);
 		pthread_mutex_unlock(mutex);
-		perror("mq_getattr");
-		// close queue
-		mq_close(qfd);
-		return (1);
+		return (0);
 	}
 	
-	// wait for queue to be ready
-	SEM_wait(&sem_queue);
 	// Receive the answer
-	buffer = (char *) malloc((attr.mq_msgsize + 1) * sizeof(char));
-	
-	if (mq_receive(qfd, buffer, attr.mq_msgsize, NULL) == -1) {
-		pthread_mutex_lock(mutex);
-		printMsg(COLOR_RED_TXT);
-		printMsg("ERROR: The message could not be received\n");
-		printMsg(COLOR_DEFAULT_TXT);
-		perror("woefdhaspfdc");
-		pthread_mutex_unlock(mutex);
-		free(buffer);
-		buffer = NULL;
-		// close queue
-		mq_close(qfd);
-		// unblock receiver process
-		SEM_signal(&sem_queue);
+	if (0 != waitFileReply(completion, pid, &buffer, mutex)) {
 		return (1);
 	}
 
@@ -278,23 +1552,65 @@ char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthr
 		pthread_mutex_unlock(mutex);
 		free(buffer);
 		buffer = NULL;
-		// close queue
-		mq_close(qfd);
-		// unblock receiver process
-		SEM_signal(&sem_queue);
 		return (1);
 	}
 
 	free(buffer);
 	buffer = NULL;
 
-	// close queue
-	mq_close(qfd);
-	// unblock receiver process
-	SEM_signal(&sem_queue);
 	return (0);
 }
 
+/*********************************************************************
+* @Purpose: Sends a file to a user using message queues.
+* @Params: in: pid = PID of the user that will receive the file
+* 		   in: filename = name of the file to send
+* 		   in: directory = string with the directory of the file
+* 		   in: username = string containing the name of the sender
+*          in/out: control = progress of the transfer (can be NULL)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the file was sent successfully, otherwise 1.
+*********************************************************************/
+char ICP_sendFile(int pid, char *filename, char *directory, char *username, TransferControl *control, pthread_mutex_t *mutex) {
+	Completion completion;
+	ShmRing ring;
+	mqd_t qfd;
+	char error = 0;
+
+	// the replies of the receiver come through a slot of this transfer
+	if (COMPLETION_KO == COMPLETION_create(&completion, __atomic_add_fetch(&icp_transfer_id, 1, __ATOMIC_SEQ_CST))) {
+	    pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(SEND_FILE_MQ_ERROR);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		return (1);
+	}
+
+	// the ring is held until the receiver has checked the file, so the files of
+	// different sons are not mixed; if another son has it, the file goes through
+	// the queue (mixed with the others) instead of waiting
+	if ((SHMRING_OK == SHMRING_open(&ring, pid)) && (SHMRING_KO == SHMRING_trylock(&ring))) {
+	    SHMRING_close(&ring);
+	}
+
+	qfd = openChannel(pid);
+	// the messages packed for the receiver arrive before the file
+	flushChannel(qfd);
+	error = sendLocalFile(qfd, pid, filename, directory, username, &ring, &completion, control, mutex);
+	releaseChannel(qfd);
+
+	if (NULL != ring.header) {
+	    SHMRING_unlock(&ring);
+		SHMRING_close(&ring);
+	}
+
+	COMPLETION_close(&completion);
+
+	return (error);
+}
+
 /**********************************************************************
 * @Purpose: Receives a message from another process in the same machine
 *           and prints it.
@@ -330,6 +1646,26 @@ void ICP_receiveMsg(char *frame, pthread_mutex_t *mutex) {
 	origin_user = NULL;
 }
 
+/**********************************************************************
+* @Purpose: Receives several messages packed by another process in the
+*           same machine into a single message of the queue and prints
+*           them in order.
+* @Params: in: frame = ICP frame with the messages
+*          in: length = number of bytes of the frame
+* 		   in/out: mutex = screen mutex to prevent printing to screen
+*                  by different users at the same time
+* @Return: ----
+**********************************************************************/
+void ICP_receivePack(char *frame, int length, pthread_mutex_t *mutex) {
+	int i = sizeof(ICP_PACK_TYPE);
+
+	// every message keeps the format of a single one, ended by '\0'
+	while ((i < length) && (NULL != memchr(frame + i, '\0', length - i))) {
+	    ICP_receiveMsg(frame + i, mutex);
+		i += strlen(frame + i) + 1;
+	}
+}
+
 /**********************************************************************
 * @Purpose: Parses the frame containing the initial data of a received
 *           file by a user in the same machine following the ICP.
@@ -338,8 +1674,16 @@ void ICP_receiveMsg(char *frame, pthread_mutex_t *mutex) {
 * 		   in/out: filename = string to store the name of the file
 * 		   in/out: file_size = total size of the file in bytes
 * 		   in/out: md5sum = string to store the checksum of the file
+* 		   in/out: sender_pid = PID of the sender (0 if it is not sent)
+* 		   in/out: ring_locked = set to 1 if the sender holds the ring
+* 		   in/out: transfer_id = identifier of the transfer in the
+* 		           sender, to open its reply slot
+* 		   in/out: inode = inode of the file hashed by the sender (0 if
+* 		           it is not sent)
+* 		   in/out: mtime = last modification time of that file
 **********************************************************************/
-void parseInitialSendFileFrame(char *frame, char **origin_user, char **filename, int *file_size, char **md5sum) {
+void parseInitialSendFileFrame(char *frame, char **origin_user, char **filename, long long *file_size, char **md5sum, int *sender_pid, char *ring_locked, int *transfer_id,
+                               unsigned long long *inode, long long *mtime) {
 	int i = 0;	
 	char *aux = NULL;
 
@@ -351,55 +1695,108 @@ void parseInitialSendFileFrame(char *frame, char **origin_user, char **filename,
 	*origin_user = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
 	*filename = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
 	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
-	*file_size = atoi(aux);
+	*file_size = atoll(aux);
 	free(aux);
 	aux = NULL;
 	*md5sum = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	*sender_pid = atoi(aux);
+	free(aux);
+	aux = NULL;
+	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	*ring_locked = (1 == atoi(aux));
+	free(aux);
+	aux = NULL;
+	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	*transfer_id = atoi(aux);
+	free(aux);
+	aux = NULL;
+	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	*inode = strtoull(aux, NULL, 10);
+	free(aux);
+	aux = NULL;
+	aux = SHAREDFUNCTIONS_splitString(frame, ICP_DATA_SEPARATOR, &i);
+	*mtime = atoll(aux);
+	free(aux);
+	aux = NULL;
 }
 
 /**********************************************************************
-* @Purpose: Read a frame containing a file or part of a file and copy
-*           the contents into another file.
-* @Params: in: file_fd = file descriptor of the file to write
-*          in: qfd = file descriptor of the message queue from which
-*		       to read frames
-*		   in/out: frame = string to store frame containing the file
-*		           or part of it
-*		   in: msg_size = size of Message in message queue
-*		   in: file_size = number of bytes to read from the file
+* @Purpose: Reads the data of a file from the ring of this son and
+*           writes it into the file, straight from the shared memory.
+* @Params: in/out: writer = opened writer of the file
+*          in/out: ring = ring of this son
+*          in: sender_pid = PID of the son sending the file
+*		   in/out: file_size = number of bytes of the file still to
+*		           receive
 *		   in/out: mutex = screen mutex to prevent writing to screen
 *		           simultaneously
-* @Return: Returns the MD5SUM of the file.
+* @Return: Returns ICP_READ_FRAME_NO_ERROR if all the data was read,
+*          otherwise ICP_READ_FRAME_ERROR.
 **********************************************************************/
-char readFileFrame(int file_fd, int qfd, char **frame, int msg_size, int file_size, pthread_mutex_t *mutex) {
-	*frame = (char *) malloc((msg_size + 1) * sizeof(char));
+char readRingData(FileWriter *writer, ShmRing *ring, int sender_pid, long long *file_size, pthread_mutex_t *mutex) {
+	char *data = NULL;
+	int length = 0;
 
-	if (NULL == *frame) {
-	    return (ICP_READ_FRAME_ERROR);
-	}
-	
-	if (mq_receive(qfd, *frame, msg_size, NULL) == -1) {
-		pthread_mutex_lock(mutex);
-		printMsg(COLOR_RED_TXT);
-		printMsg(ERROR_RECEIVING_MSG_MSG);
-		printMsg(COLOR_DEFAULT_TXT);
-		pthread_mutex_unlock(mutex);
-		// free memory
-		free(*frame);
-		*frame = NULL;
-		return (ICP_READ_FRAME_ERROR);
-	} else {
-		// copy file
-		if (*frame != NULL) {
-			write(file_fd, *frame, file_size);
+	while (*file_size > 0) {
+	    length = SHMRING_peek(ring, sender_pid, &data);
+
+		if (-1 == length) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(RING_SENDER_GONE_ERROR);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			return (ICP_READ_FRAME_ERROR);
+		}
+
+		if (length > *file_size) {
+		    length = (int) *file_size;
 		}
+
+		// a failed write is reported when the file is closed, the data is
+		// still drained so that the sender waits for the reply
+		FILEWRITER_write(writer, data, length);
+		SHMRING_release(ring, length);
+		*file_size -= length;
 	}
 
-	free(*frame);
-	*frame = NULL;
 	return (ICP_READ_FRAME_NO_ERROR);
 }
 
+/**********************************************************************
+* @Purpose: Accepts a received file with the MD5SUM sent by the sender:
+*           it is added to the index and shown.
+* @Params: in/out: filename = string containing the name of the
+*		           received file
+*		   in/out: md5sum = string with the MD5SUM of the received file
+*		   in/out: user = string containing the name of the sender
+*		   in: directory = string containing the directory of the file
+*		   in/out mutex = screen mutex to prevent writing on screen
+*		          simultaneously
+* @Return: Returns FILE_MD5SUM_OK.
+**********************************************************************/
+char acceptReceivedFile(char **filename, char **md5sum, char **user, char *directory, pthread_mutex_t *mutex) {
+	char *buffer = NULL;
+
+	// remember the content for future transfers
+	FILEINDEX_add(directory, *filename, *md5sum);
+	asprintf(&buffer, ICP_FILE_RECEIVED_MSG, *user, *filename);
+	pthread_mutex_lock(mutex);
+	printMsg(buffer);
+	pthread_mutex_unlock(mutex);
+	// free memory
+	free(buffer);
+	buffer = NULL;
+	free(*filename);
+	*filename = NULL;
+	free(*user);
+	*user = NULL;
+	free(*md5sum);
+	*md5sum = NULL;
+	return (FILE_MD5SUM_OK);
+}
+
 /**********************************************************************
 * @Purpose: Checks that the MD5SUM of the copied file and the received
 *           one match.
@@ -408,37 +1805,25 @@ char readFileFrame(int file_fd, int qfd, char **frame, int msg_size, int file_si
 *		           received file
 *		   in/out: md5sum = string with the MD5SUM of the received file
 *		   in/out: user = string containing the name of the sender
+*		   in: directory = string containing the directory of the file
 *		   in/out mutex = screen mutex to prevent writing on screen
 *		          simultaneously
 * @Return: Returns FILE_MD5SUM_OK if the checksums match, otherwise
 *          FILE_MD5SUM_KO.
 **********************************************************************/
-char checkMD5Sum(char **path, char **filename, char **md5sum, char **user, pthread_mutex_t *mutex) {
+char checkMD5Sum(char **path, char **filename, char **md5sum, char **user, char *directory, pthread_mutex_t *mutex) {
 	char *buffer = NULL;
 
-	// get current file MD5SUM
-	buffer = SHAREDFUNCTIONS_getMD5Sum(*path);
+	// get current file MD5SUM, of the same kind as the original one
+	buffer = TREEHASH_getFileHash(*path, *md5sum, mutex);
 	free(*path);
 	*path = NULL;
 
 	// compare with original MD5SUM
-	if (strcmp(buffer, *md5sum) == 0) {
-		free(buffer);
-		buffer = NULL;
-		asprintf(&buffer, ICP_FILE_RECEIVED_MSG, *user, *filename);
-		pthread_mutex_lock(mutex);
-		printMsg(buffer);
-		pthread_mutex_unlock(mutex);
-		// free memory
+	if ((NULL != buffer) && (strcmp(buffer, *md5sum) == 0)) {
 		free(buffer);
 		buffer = NULL;
-		free(*filename);
-		*filename = NULL;
-		free(*user);
-		*user = NULL;
-		free(*md5sum);
-		*md5sum = NULL;
-		return (FILE_MD5SUM_OK);
+		return (acceptReceivedFile(filename, md5sum, user, directory, mutex));
 	}
 
 	// mismatch in MD5SUM
@@ -454,6 +1839,366 @@ char checkMD5Sum(char **path, char **filename, char **md5sum, char **user, pthre
 	return (FILE_MD5SUM_KO);
 }
 
+/**********************************************************************
+* @Purpose: Frees the strings of a received file.
+* @Params: in/out: path = string containing the path of the file
+*          in/out: filename = string containing the name of the file
+*		   in/out: md5sum = string with the MD5SUM of the file
+*		   in/out: user = string containing the name of the sender
+* @Return: ----
+**********************************************************************/
+void freeReceivedFile(char **path, char **filename, char **md5sum, char **user) {
+	free(*path);
+	*path = NULL;
+	free(*filename);
+	*filename = NULL;
+	free(*md5sum);
+	*md5sum = NULL;
+	free(*user);
+	*user = NULL;
+}
+
+/**********************************************************************
+* @Purpose: Receives the file descriptor of the file to receive and
+*           delivers the file in the kernel. In the same filesystem the
+*           file is hardlinked (if configured) or cloned sharing its
+*           blocks, otherwise it is copied. A linked or cloned file that
+*           is still the one the sender hashed (same inode, size and
+*           modification time) is not hashed again; a copied one is
+*           checked against the hash sent by the sender.
+* @Params: in/out: path = string containing the path of the file
+*          in/out: filename = string containing the name of the
+*		           received file
+*		   in/out: md5sum = string with the MD5SUM of the received file
+*		   in/out: user = string containing the name of the sender
+*		   in: directory = string containing the directory of the file
+*          in: policy = write policy of the received files
+*          in: fd_socket = socket to receive file descriptors
+*          in: sender_pid = PID of the son sending the file
+*		   in: file_size = size of the file
+*		   in: inode = inode of the file hashed by the sender (0 if
+*		       unknown)
+*		   in: mtime = last modification time of that file
+*		   in/out: mutex = screen mutex to prevent writing to screen
+*		           simultaneously
+* @Return: Returns FILE_MD5SUM_OK if the file was delivered, otherwise
+*          FILE_MD5SUM_KO.
+**********************************************************************/
+char receivePassedFile(char **path, char **filename, char **md5sum, char **user, char *directory, WritePolicy *policy, int fd_socket, int sender_pid, long long file_size,
+                       unsigned long long inode, long long mtime, pthread_mutex_t *mutex) {
+	struct stat st_src, st_dir;
+	FileWriter writer;
+	char *buffer = NULL;
+	char *tmp_path = NULL;
+	char same_fs = 0;
+	char delivered = 0;
+	char shared = 0;
+	int fd_src = FDPASS_receive(fd_socket, sender_pid, file_size);
+
+	if (fd_src < 0) {
+	    pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(FD_NOT_RECEIVED_ERROR);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		freeReceivedFile(path, filename, md5sum, user);
+		return (FILE_MD5SUM_KO);
+	}
+
+	asprintf(&buffer, ".%s", directory);
+	same_fs = (0 == fstat(fd_src, &st_src)) && (0 == stat(buffer, &st_dir)) && (st_src.st_dev == st_dir.st_dev);
+	free(buffer);
+	buffer = NULL;
+
+	if (same_fs && (DELIVERY_HARDLINK == policy->local_delivery)) {
+	    // both sons share the file: it is replaced, never modified, when it changes
+		tmp_path = FILEINDEX_getTmpPath(directory, *filename);
+		asprintf(&buffer, "/proc/self/fd/%d", fd_src);
+		unlink(tmp_path);
+		delivered = (0 == linkat(AT_FDCWD, buffer, AT_FDCWD, tmp_path, AT_SYMLINK_FOLLOW)) && (0 == rename(tmp_path, *path));
+		shared = delivered;
+		unlink(tmp_path);
+		free(buffer);
+		buffer = NULL;
+		free(tmp_path);
+		tmp_path = NULL;
+	}
+
+	// a clone shares the blocks of the sender, so no space is reserved for it
+	if (!delivered && (FILEWRITER_OK == FILEWRITER_open(&writer, *path, same_fs ? 0 : file_size, policy))) {
+	    shared = (FILEWRITER_CLONED == FILEWRITER_copy(&writer, fd_src, file_size));
+		delivered = (FILEWRITER_OK == FILEWRITER_close(&writer));
+	}
+
+	if (!delivered) {
+	    close(fd_src);
+		unlink(*path);
+		freeReceivedFile(path, filename, md5sum, user);
+		return (FILE_MD5SUM_KO);
+	}
+
+	// the blocks linked or cloned are the ones hashed if the file has not changed since (checked
+	// after the delivery, so a change during it is seen); a copy is read again to check it
+	if (shared && (0 != inode) && (0 == fstat(fd_src, &st_src)) && ((unsigned long long) st_src.st_ino == inode) &&
+	    ((long long) st_src.st_size == file_size) && ((long long) st_src.st_mtime == mtime)) {
+	    close(fd_src);
+		free(*path);
+		*path = NULL;
+		return (acceptReceivedFile(filename, md5sum, user, directory, mutex));
+	}
+
+	close(fd_src);
+
+	return (checkMD5Sum(path, filename, md5sum, user, directory, mutex));
+}
+
+/**********************************************************************
+* @Purpose: Posts a reply for the sender of a file in the slot of the
+*           transfer. The slot is closed after the last reply.
+* @Params: in/out: completion = reply slot of the transfer
+*          in: reply = string with the reply to send
+*          in: last = 1 if the transfer ends with this reply
+* @Return: Returns ICP_READ_FRAME_NO_ERROR.
+**********************************************************************/
+char sendFileReply(Completion *completion, char *reply, char last) {
+	COMPLETION_post(completion, reply);
+
+	if (last) {
+	    COMPLETION_close(completion);
+	}
+
+	return (ICP_READ_FRAME_NO_ERROR);
+}
+
+/**********************************************************************
+* @Purpose: Removes a file from the table of files received through the
+*           queue and frees it.
+* @Params: in/out: streams = files being received through the queue
+*          in: i = position of the file in the table
+* @Return: ----
+**********************************************************************/
+void removeStream(IcpStreams *streams, int i) {
+	IcpStream *stream = streams->streams[i];
+
+	freeReceivedFile(&stream->path, &stream->filename, &stream->md5sum, &stream->origin_user);
+	COMPLETION_close(&stream->completion);
+	free(stream);
+	stream = NULL;
+	streams->n_streams--;
+	streams->streams[i] = streams->streams[streams->n_streams];
+}
+
+/**********************************************************************
+* @Purpose: Drops a file received through the queue before all its
+*           fragments have arrived, removing what was written.
+* @Params: in/out: streams = files being received through the queue
+*          in: i = position of the file in the table
+*          in: reply = 1 to tell the sender that the file failed
+* @Return: ----
+**********************************************************************/
+void dropStream(IcpStreams *streams, int i, char reply) {
+	IcpStream *stream = streams->streams[i];
+
+	FILEWRITER_close(&stream->writer);
+	unlink(stream->path);
+
+	if (reply) {
+	    COMPLETION_post(&stream->completion, FILE_KO_REPLY);
+	}
+
+	removeStream(streams, i);
+}
+
+/**********************************************************************
+* @Purpose: Drops the files received through the queue whose senders
+*           have died.
+* @Params: in/out: streams = files being received through the queue
+*		   in/out mutex = screen mutex to prevent writing on screen
+*		          simultaneously
+* @Return: ----
+**********************************************************************/
+void dropDeadStreams(IcpStreams *streams, pthread_mutex_t *mutex) {
+	int i = 0;
+
+	while (i < streams->n_streams) {
+	    if ((0 != kill(streams->streams[i]->sender_pid, 0)) && (ESRCH == errno)) {
+		    pthread_mutex_lock(mutex);
+			printMsg(COLOR_RED_TXT);
+			printMsg(RING_SENDER_GONE_ERROR);
+			printMsg(COLOR_DEFAULT_TXT);
+			pthread_mutex_unlock(mutex);
+			dropStream(streams, i, 0);
+		} else {
+		    i++;
+		}
+	}
+}
+
+/**********************************************************************
+* @Purpose: Starts receiving a file through the queue: its fragments
+*           are written as they arrive, mixed with the ones of other
+*           files, while the son keeps attending its queue.
+* @Params: in/out: streams = files being received through the queue
+*          in/out: path = string containing the path of the file
+*          in/out: filename = string containing the name of the file
+*		   in/out: md5sum = string with the MD5SUM of the file
+*		   in/out: user = string containing the name of the sender
+*		   in: file_size = size of the file
+*		   in: sender_pid = PID of the son sending the file
+*		   in: transfer_id = identifier of the transfer in the sender
+*          in: policy = write policy of the received files
+*          in: completion = opened reply slot of the transfer
+* @Return: Returns ICP_READ_FRAME_NO_ERROR.
+**********************************************************************/
+char openStream(IcpStreams *streams, char **path, char **filename, char **md5sum, char **user, long long file_size, int sender_pid, int transfer_id, WritePolicy *policy, Completion *completion) {
+	IcpStream *stream = (IcpStream *) malloc(sizeof(IcpStream));
+	IcpStream **aux = NULL;
+
+	// the writer has a thread pointing to it, so it is never moved
+	if ((NULL == stream) || (FILEWRITER_KO == FILEWRITER_open(&stream->writer, *path, file_size, policy))) {
+	    // the file is refused before any data is sent (e.g. not enough space)
+		free(stream);
+		stream = NULL;
+		freeReceivedFile(path, filename, md5sum, user);
+		return (sendFileReply(completion, FILE_KO_REPLY, 1));
+	}
+
+	aux = (IcpStream **) realloc(streams->streams, (streams->n_streams + 1) * sizeof(IcpStream *));
+
+	if (NULL == aux) {
+	    FILEWRITER_close(&stream->writer);
+		unlink(*path);
+		free(stream);
+		stream = NULL;
+		freeReceivedFile(path, filename, md5sum, user);
+		return (sendFileReply(completion, FILE_KO_REPLY, 1));
+	}
+
+	stream->sender_pid = sender_pid;
+	stream->transfer_id = transfer_id;
+	stream->next_seq = 0;
+	stream->remaining = file_size;
+	stream->path = *path;
+	*path = NULL;
+	stream->filename = *filename;
+	*filename = NULL;
+	stream->md5sum = *md5sum;
+	*md5sum = NULL;
+	stream->origin_user = *user;
+	*user = NULL;
+	stream->completion = *completion;
+	streams->streams = aux;
+	streams->streams[streams->n_streams] = stream;
+	streams->n_streams++;
+
+	// ask for the data
+	COMPLETION_post(&stream->completion, FILE_SEND_REPLY);
+
+	return (ICP_READ_FRAME_NO_ERROR);
+}
+
+/**********************************************************************
+* @Purpose: Creates an empty table of files received through the queue.
+* @Params: ----
+* @Return: Returns the initialized IcpStreams.
+**********************************************************************/
+IcpStreams ICP_initStreams() {
+	IcpStreams streams;
+
+	streams.streams = NULL;
+	streams.n_streams = 0;
+
+	return (streams);
+}
+
+/**********************************************************************
+* @Purpose: Writes a fragment of a file received through the queue into
+*           its file. The file is checked once all its fragments have
+*           arrived.
+* @Params: in: frame = fragment with its IcpChunkHeader
+*          in: length = number of bytes of the frame
+*          in/out: streams = files being received through the queue
+*          in: directory = string containing the directory of the files
+*		   in/out mutex = screen mutex to prevent writing on screen
+*		          simultaneously
+* @Return: Returns 1 if the file has ended (and something was shown),
+*          otherwise 0.
+**********************************************************************/
+char ICP_receiveChunk(char *frame, int length, IcpStreams *streams, char *directory, pthread_mutex_t *mutex) {
+	IcpChunkHeader header;
+	IcpStream *stream = NULL;
+	char *buffer = NULL;
+	int i = 0;
+
+	if (length < (int) sizeof(IcpChunkHeader)) {
+	    return (0);
+	}
+
+	memcpy(&header, frame, sizeof(IcpChunkHeader));
+	length -= sizeof(IcpChunkHeader);
+
+	for (i = 0; (i < streams->n_streams) && ((streams->streams[i]->sender_pid != header.sender_pid) || (streams->streams[i]->transfer_id != header.transfer_id)); i++);
+
+	// the rest of a file that has been dropped
+	if (i == streams->n_streams) {
+	    return (0);
+	}
+
+	stream = streams->streams[i];
+
+	if (header.seq != stream->next_seq) {
+	    asprintf(&buffer, CHUNK_LOST_ERROR, stream->filename);
+		pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg(buffer);
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		dropStream(streams, i, 1);
+		return (1);
+	}
+
+	if (length > stream->remaining) {
+	    length = (int) stream->remaining;
+	}
+
+	// a failed write is reported when the file is closed
+	FILEWRITER_write(&stream->writer, frame + sizeof(IcpChunkHeader), length);
+	stream->next_seq++;
+	stream->remaining -= length;
+
+	if (stream->remaining > 0) {
+	    return (0);
+	}
+
+	// check md5sum once all the data is in the file and send the reply
+	if ((FILEWRITER_OK == FILEWRITER_close(&stream->writer)) &&
+	    (FILE_MD5SUM_OK == checkMD5Sum(&stream->path, &stream->filename, &stream->md5sum, &stream->origin_user, directory, mutex))) {
+	    COMPLETION_post(&stream->completion, FILE_OK_REPLY);
+	} else {
+	    COMPLETION_post(&stream->completion, FILE_KO_REPLY);
+	}
+
+	removeStream(streams, i);
+	return (1);
+}
+
+/**********************************************************************
+* @Purpose: Drops the files that were being received through the queue
+*           and frees the table.
+* @Params: in/out: streams = files being received through the queue
+* @Return: ----
+**********************************************************************/
+void ICP_closeStreams(IcpStreams *streams) {
+	while (streams->n_streams > 0) {
+	    dropStream(streams, streams->n_streams - 1, 1);
+	}
+
+	free(streams->streams);
+	streams->streams = NULL;
+}
+
 /**********************************************************************
 * @Purpose: Gets the file sent by another user in the same machine and
 *           checks it. If there are no errors, copies the file into the
@@ -464,90 +2209,153 @@ char checkMD5Sum(char **path, char **filename, char **md5sum, char **user, pthre
 *				   file and the checksum of the file
 *          in: directory = string containing the name of the directory
 *		       in which to copy the file
-*		   in/out: attr = attributes of the message queue
-*		   in: qfd = file descriptor of the message queue
+*          in: policy = write policy of the received files
+*		   in/out: streams = files being received through the queue
+*		   in/out: ring = ring of this son (no ring if its header is
+*		           NULL)
+*		   in: fd_socket = socket to receive file descriptors (-1 if
+*		       there is none)
 *		   in/out mutex = screen mutex to prevent writing on screen
 *		          simultaneously
 * @Return: Returns ICP_READ_FRAME_NO_ERROR if the file was received
 *          correctly, otherwise ICP_READ_FRAME_ERROR.
 **********************************************************************/
-char ICP_receiveFile(char **frame, char *directory, struct mq_attr *attr, int qfd, int pid, pthread_mutex_t *mutex) {
+char ICP_receiveFile(char **frame, char *directory, WritePolicy *policy, IcpStreams *streams, ShmRing *ring, int fd_socket, pthread_mutex_t *mutex) {
 	char *origin_user = NULL;
 	char *filename = NULL;
 	char *filename_path = NULL;
 	char *md5sum = NULL;
-	semaphore sem_queue;
-	int file_size = 0;
-	int file_fd = -1;
+	Completion completion;
+	FileWriter writer;
+	long long file_size = 0;
+	unsigned long long inode = 0;
+	long long mtime = 0;
+	int sender_pid = 0;
+	int transfer_id = 0;
+	int i = 0;
+	char ring_locked = 0;
+	char transport = ICP_DATA_QUEUE;
+	char error = ICP_READ_FRAME_NO_ERROR;
 
-	// create semaphore
-	SEM_constructor_with_name(&sem_queue, pid);
 	// get file frames
-	parseInitialSendFileFrame(*frame, &origin_user, &filename, &file_size, &md5sum);
+	parseInitialSendFileFrame(*frame, &origin_user, &filename, &file_size, &md5sum, &sender_pid, &ring_locked, &transfer_id, &inode, &mtime);
 	free(*frame);
 	*frame = NULL;
-	// open file
+	// the files of senders that died are not completed
+	dropDeadStreams(streams, mutex);
+
+	// the replies go to the slot of the transfer (the sender sends no data before the
+	// first one, so nothing is left in the queue if it has stopped)
+	if (COMPLETION_KO == COMPLETION_open(&completion, sender_pid, transfer_id)) {
+	    free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		free(md5sum);
+		md5sum = NULL;
+		return (ICP_READ_FRAME_NO_ERROR);
+	}
+
+	// files sent from a subdirectory keep it (names leaving the directory are refused)
+	if (!SHAREDFUNCTIONS_createFileDirectories(directory, filename)) {
+	    free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		free(md5sum);
+		md5sum = NULL;
+		return (sendFileReply(&completion, FILE_KO_REPLY, 1));
+	}
+
+	// check if the content is already in the directory
+	if (FILEINDEX_FOUND == FILEINDEX_materialize(directory, md5sum, file_size, filename)) {
+		asprintf(&filename_path, ICP_FILE_RECEIVED_MSG, origin_user, filename);
+		pthread_mutex_lock(mutex);
+		printMsg(filename_path);
+		pthread_mutex_unlock(mutex);
+		// free memory
+		free(filename_path);
+		filename_path = NULL;
+		free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		free(md5sum);
+		md5sum = NULL;
+		return (sendFileReply(&completion, FILE_HAVE_REPLY, 1));
+	}
+
+	// open file (a previous file with the same name may be a hardlink, or still be arriving)
 	asprintf(&filename_path, ".%s/%s", directory, filename);
-	file_fd = open(filename_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-	
-	while (file_size > ICP_FILE_MAX_BYTES) {
-		// Read frame
-		if (ICP_READ_FRAME_ERROR == readFileFrame(file_fd, qfd, frame, attr->mq_msgsize, ICP_FILE_MAX_BYTES, mutex)) {
-			// signal that queue is ready
-			SEM_signal(&sem_queue);
-		    return (ICP_READ_FRAME_ERROR);
+
+	for (i = 0; i < streams->n_streams; i++) {
+	    if (0 == strcmp(streams->streams[i]->path, filename_path)) {
+		    dropStream(streams, i, 1);
+			break;
 		}
+	}
 
-		file_size -= ICP_FILE_MAX_BYTES;
+	unlink(filename_path);
+
+	// the file is taken from its file descriptor when possible, otherwise
+	// the data comes through the ring or the queue
+	if ((0 != sender_pid) && (fd_socket >= 0)) {
+	    transport = ICP_DATA_FD;
+	} else if (ring_locked && (NULL != ring->header)) {
+	    transport = ICP_DATA_RING;
 	}
 
-	// Read the last frame
-	if (ICP_READ_FRAME_ERROR == readFileFrame(file_fd, qfd, frame, attr->mq_msgsize, file_size, mutex)) {
-		// signal that queue is ready
-		SEM_signal(&sem_queue);
-	    return (ICP_READ_FRAME_ERROR);
+	if (ICP_DATA_FD == transport) {
+	    // the file is not opened until its descriptor arrives
+		sendFileReply(&completion, FILE_FD_REPLY, 0);
+		error = receivePassedFile(&filename_path, &filename, &md5sum, &origin_user, directory, policy, fd_socket, sender_pid, file_size, inode, mtime, mutex);
+		return (sendFileReply(&completion, (FILE_MD5SUM_OK == error) ? FILE_OK_REPLY : FILE_KO_REPLY, 1));
 	}
-	
-	close(file_fd);
-	
-	// check md5sum
-	if (FILE_MD5SUM_OK == checkMD5Sum(&filename_path, &filename, &md5sum, &origin_user, mutex)) {
-		// send reply of success
-		if (mq_send(qfd, FILE_OK_REPLY, strlen(FILE_OK_REPLY) + 1,  0) == -1) {
-		    pthread_mutex_lock(mutex);
-			printMsg(COLOR_RED_TXT);
-			printMsg("ERROR: The message could not be sent\n");
-			printMsg(COLOR_DEFAULT_TXT);
-			pthread_mutex_unlock(mutex);
-			// signal that queue is ready
-			SEM_signal(&sem_queue);
-			// wait for sender to receive reply
-			SEM_wait(&sem_queue);
-			return (ICP_READ_FRAME_ERROR);
-		}
-	    
-		// signal that queue is ready
-		SEM_signal(&sem_queue);
-	} else {
-		// send reply of failure
-		if (mq_send(qfd, FILE_KO_REPLY, strlen(FILE_KO_REPLY) + 1,  0) == -1) {
-		    pthread_mutex_lock(mutex);
-			printMsg(COLOR_RED_TXT);
-			printMsg("ERROR: The message could not be sent\n");
-			printMsg(COLOR_DEFAULT_TXT);
-			pthread_mutex_unlock(mutex);
-			// signal that queue is ready
-			SEM_signal(&sem_queue);
-			// wait for sender to receive reply
-			SEM_wait(&sem_queue);
-			return (ICP_READ_FRAME_ERROR);
-		}
 
-	    // signal that queue is ready
-		SEM_signal(&sem_queue);
+	if (ICP_DATA_QUEUE == transport) {
+	    return (openStream(streams, &filename_path, &filename, &md5sum, &origin_user, file_size, sender_pid, transfer_id, policy, &completion));
 	}
 
-	// wait for sender to receive reply
-	SEM_wait(&sem_queue);
-	return (ICP_READ_FRAME_NO_ERROR);
+	if (FILEWRITER_KO == FILEWRITER_open(&writer, filename_path, file_size, policy)) {
+	    // the file is refused before any data is sent (e.g. not enough space)
+		free(filename_path);
+		filename_path = NULL;
+		free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		free(md5sum);
+		md5sum = NULL;
+		return (sendFileReply(&completion, FILE_KO_REPLY, 1));
+	}
+
+	// the data of a sender that died may be left in the ring
+	SHMRING_reset(ring);
+	// ask for the data
+	sendFileReply(&completion, FILE_RING_REPLY, 0);
+
+	if (ICP_READ_FRAME_ERROR == readRingData(&writer, ring, sender_pid, &file_size, mutex)) {
+	    // the queue still works, the sender through the ring has died
+		FILEWRITER_close(&writer);
+		unlink(filename_path);
+		freeReceivedFile(&filename_path, &filename, &md5sum, &origin_user);
+		COMPLETION_close(&completion);
+		return (ICP_READ_FRAME_NO_ERROR);
+	}
+	
+	// check md5sum once all the data is in the file and send the reply
+	if (FILEWRITER_KO == FILEWRITER_close(&writer)) {
+		free(filename_path);
+		filename_path = NULL;
+		free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		free(md5sum);
+		md5sum = NULL;
+	} else if (FILE_MD5SUM_OK == checkMD5Sum(&filename_path, &filename, &md5sum, &origin_user, directory, mutex)) {
+		return (sendFileReply(&completion, FILE_OK_REPLY, 1));
+	}
+
+	return (sendFileReply(&completion, FILE_KO_REPLY, 1));
 }
@@ -11,27 +11,228 @@
 
 #include "definitions.h"
 #include "sharedFunctions.h"
-#include "semaphore_v2.h"
+#include "gpc.h"
+#include "fileindex.h"
+#include "filewriter.h"
+#include "filesource.h"
+#include "scheduler.h"
+#include "treehash.h"
+#include "shmring.h"
+#include "fdpass.h"
+#include "completion.h"
+#include "shmbus.h"
 
 #define ICP_DATA_SEPARATOR		 	'&'
-#define ICP_FILE_MAX_BYTES		 	512
 #define ICP_READ_FRAME_ERROR	 	0
 #define ICP_READ_FRAME_NO_ERROR	 	1
 #define FILE_OK_REPLY				"FILE OK\0"
 #define FILE_KO_REPLY				"FILE KO\0"
+#define FILE_HAVE_REPLY				"FILE HAVE\0"
+#define FILE_SEND_REPLY				"FILE SEND\0"
+#define FILE_RING_REPLY				"FILE RING\0"
+#define FILE_FD_REPLY				"FILE FD\0"
+#define ICP_RING_CHUNK_SIZE			262144
+#define ICP_DATA_QUEUE				0
+#define ICP_DATA_RING				1
+#define ICP_DATA_FD					2
+#define ICP_CHUNK_TYPE				"data"
+#define ICP_PACK_TYPE				"msgs"
+#define ICP_MIN_MSG_SIZE			1024
+#define ICP_WAIT_FOREVER			-1
+#define ICP_EXIT_WAIT_TIME			2
+#define ICP_MSG_WAIT_TIME			2
+#define ICP_FLUSH_TIME				5000
+#define ICP_MSG_SOCKET_NAME			"iluvatar_msg_%d"
+#define ICP_MSG_SOCKET_MAX			131072
+#define ICP_MSG_FRAME_MAX			(GPC_FRAME_OVERHEAD(GCP_SEND_MSG_HEADER) + GPC_FILE_MAX_BYTES)
+#define ICP_SOCKET_SENT				0
+#define ICP_SOCKET_UNUSED			1
+#define ICP_SOCKET_KO				2
+#define MQUEUE_MSG_MAX_PATH			"/proc/sys/fs/mqueue/msg_max"
+#define MQUEUE_MSGSIZE_MAX_PATH		"/proc/sys/fs/mqueue/msgsize_max"
+#define MQUEUE_MSG_DEFAULT_PATH		"/proc/sys/fs/mqueue/msg_default"
+#define MQUEUE_MSGSIZE_DEFAULT_PATH	"/proc/sys/fs/mqueue/msgsize_default"
+
+// header of every fragment of a file sent through the queue: the stream (the
+// sender and its transfer) and the position of the fragment in it
+typedef struct {
+	char type[8];
+	int sender_pid;
+	int transfer_id;
+	unsigned int seq;
+} IcpChunkHeader;
+
+// file being received through the queue, its fragments can come mixed
+// with the ones of other files
+typedef struct {
+	int sender_pid;
+	int transfer_id;
+	unsigned int next_seq;
+	long long remaining;
+	char *origin_user;
+	char *filename;
+	char *path;
+	char *md5sum;
+	FileWriter writer;
+	Completion completion;
+} IcpStream;
+
+// files being received through the queue
+typedef struct {
+	IcpStream **streams;
+	int n_streams;
+} IcpStreams;
+
+// queue of another son of the machine kept open between sends, with the
+// messages packed while it is full (the list of channels has its own lock,
+// the lock of a channel is the only one held while waiting for its queue)
+typedef struct {
+	int pid;
+	mqd_t qfd;
+	int users;
+	char stale;
+	long msg_size;
+	char *pack;
+	int pack_length;
+	int sock;
+	char *sock_out;
+	int sock_length;
+	pthread_mutex_t lock;
+} IcpChannel;
+
+// connection of another son to the socket of messages, with the part of
+// a frame that has not arrived yet
+typedef struct {
+	int fd;
+	char *buffer;
+	int length;
+} IcpMsgConn;
 
 /* Messages */
 #define MQ_ATTR_ERROR_MSG			"ERROR: The attributes of the queue could not be obtained\n"
 #define ICP_MSG_RECEIVED_MSG     	"\nNew message received!\nYour neighbor %s says:\n%s\n"
+#define ICP_SOCKET_MSG_RECEIVED_MSG	"\nNew message received!\nYour neighbor %s says:\n\"%s\"\n"
 #define ICP_FILE_RECEIVED_MSG    	"\nNew file received!\nYour neighbor %s has sent:\n%s\n"
 #define SEND_MSG_MQ_ERROR			"ERROR: Message Queue failed to send the message\n"
 #define SEND_MSG_OK_MSG				"Message correctly sent\n"
 #define SEND_FILE_OPEN_FILE_ERROR	"ERROR: Could not open %s\n"
 #define SEND_FILE_EMPTY_FILE_ERROR	"ERROR: Cannot send an empty file\n"
 #define SEND_FILE_MQ_ERROR			"ERROR: Message Queue failed to send the file\n"
+#define SEND_FILE_REFUSED_ERROR		"ERROR: The receiver did not accept the file\n"
+#define RING_SENDER_GONE_ERROR		"ERROR: The sender of the file has stopped\n"
+#define FD_NOT_RECEIVED_ERROR		"ERROR: The file descriptor of the file did not arrive\n"
+#define FD_NOT_SENT_ERROR			"ERROR: The file descriptor of the file could not be passed to the receiver\n"
+#define RECEIVER_GONE_ERROR			"ERROR: The receiver of the file has stopped\n"
+#define QUEUE_LIMITED_MSG			"WARNING: The queue is limited to %ld messages of %ld bytes\n"
+#define QUEUE_DEFAULT_MSG			"WARNING: The queue could not be created as configured, using the default one\n"
+#define BUS_LOST_MSG				"WARNING: %d messages of your neighbors were lost\n"
+#define CHUNK_LOST_ERROR			"ERROR: A fragment of the file %s was lost\n"
+
+/*********************************************************************
+* @Purpose: Creates the queue of this process to receive the messages
+*           and files of the sons of the same machine. It is opened
+*           without blocking, so every frame waiting can be read at
+*           once.
+* @Params: in: depth = maximum number of messages of the queue (0 = the
+*              default of the system)
+*          in: msg_size = maximum size of every message (0 = the default
+*              of the system)
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns the descriptor of the queue, or -1 if it could not be
+*          created.
+*********************************************************************/
+mqd_t ICP_createQueue(long depth, long msg_size, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Subscribes this process to the bus of the sons of the
+*           machine connected to the same Arda.
+* @Params: in: arda_ip = IP address of Arda
+*          in: arda_port = port of Arda
+* @Return: Returns a file descriptor that is readable when the bus has
+*          new messages, or -1 if the bus could not be opened (the
+*          messages to this son then go through its queue).
+*********************************************************************/
+int ICP_openBus(char *arda_ip, int arda_port);
+
+/*********************************************************************
+* @Purpose: Unsubscribes this process from the bus of the sons of the
+*           machine.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_closeBus();
+
+/*********************************************************************
+* @Purpose: Creates the socket of this process to receive the messages
+*           of the sons of the same machine as GPC frames (a Unix socket
+*           in the abstract namespace, removed when it closes).
+* @Params: ----
+* @Return: Returns the file descriptor of the socket, or -1 if it could
+*          not be created (the messages then go through the queue).
+*********************************************************************/
+int ICP_openMsgSocket();
+
+/*********************************************************************
+* @Purpose: Adds the socket of messages and the connections accepted
+*           from the other sons to a set of file descriptors.
+* @Params: in/out: fds = set of file descriptors for select
+* @Return: ----
+*********************************************************************/
+void ICP_setMsgSockets(fd_set *fds);
+
+/*********************************************************************
+* @Purpose: Checks if the socket of messages or any of its connections
+*           is in a set of file descriptors returned by select.
+* @Params: in: fds = set of file descriptors
+* @Return: Returns 1 if any of them is ready, otherwise 0.
+*********************************************************************/
+char ICP_isMsgSocketSet(fd_set *fds);
+
+/*********************************************************************
+* @Purpose: Accepts the connections of the other sons and shows every
+*           message waiting in the ones that are ready.
+* @Params: in/out: fds = set of file descriptors returned by select
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 1 if something was shown, otherwise 0.
+*********************************************************************/
+char ICP_receiveSocketMsgs(fd_set *fds, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Closes the socket of messages and its connections.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_closeMsgSocket();
+
+/*********************************************************************
+* @Purpose: Sends a message to several users of the same machine. It is
+*           published once in the bus for all the ones subscribed to
+*           it, and sent through the queue of the others.
+* @Params: in: pids = PIDs of the users that will receive the message
+*          in: n_pids = number of users
+* 		   in: message = string containing the message to send
+* 		   in: origin_username = string with the name of the sender
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 0 if the message was sent to all of them, otherwise 1.
+*********************************************************************/
+char ICP_broadcastMsg(int *pids, int n_pids, char *message, char *origin_username, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Shows the messages published in the bus by the other sons
+*           of the machine since the last call.
+* @Params: in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns 1 if something was shown, otherwise 0.
+*********************************************************************/
+char ICP_receiveBus(pthread_mutex_t *mutex);
 
 /*********************************************************************
-* @Purpose: Sends a message to a user using message queues.
+* @Purpose: Sends a message to a user of the same machine, as a GPC
+*           frame through its socket if it can take it at once, or
+*           through its queue otherwise.
 * @Params: in: pid = PID of the user that will receive the message
 * 		   in: message = string containing the message to send
 * 		   in: origin_username = string with the name of the sender
@@ -47,11 +248,40 @@ char ICP_sendMsg(int pid, char *message, char *origin_username, pthread_mutex_t
 * 		   in: filename = name of the file to send
 * 		   in: directory = string with the directory of the file
 * 		   in: username = string containing the name of the sender
+*          in/out: control = progress of the transfer (can be NULL)
 *          in/out: mutex = screen mutex to prevent writing to screen
 *                  simultaneously
 * @Return: Returns 0 if the file was sent successfully, otherwise 1.
 *********************************************************************/
-char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthread_mutex_t *mutex);
+char ICP_sendFile(int pid, char *filename, char *directory, char *username, TransferControl *control, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Sends the messages packed for the other sons of the machine
+*           if their queues have room for them. The messages for the
+*           sons that have died are dropped.
+* @Params: in: wait = seconds to wait for every queue that is full
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void ICP_flushChannels(int wait, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Checks if there are messages packed waiting for room in the
+*           queue of their receivers.
+* @Params: ----
+* @Return: Returns 1 if there are messages waiting, otherwise 0.
+*********************************************************************/
+char ICP_hasPendingMsgs();
+
+/*********************************************************************
+* @Purpose: Invalidates the channels to the other sons of the machine
+*           (e.g. when the list of users changes). The queues in use
+*           are closed when their senders release them.
+* @Params: ----
+* @Return: ----
+*********************************************************************/
+void ICP_invalidateChannels();
 
 /**********************************************************************
 * @Purpose: Receives a message from another process in the same machine
@@ -64,6 +294,18 @@ char ICP_sendFile(int pid, char *filename, char *directory, char *username, pthr
 **********************************************************************/
 void ICP_receiveMsg(char *frame, pthread_mutex_t *mutex);
 
+/**********************************************************************
+* @Purpose: Receives several messages packed by another process in the
+*           same machine into a single message of the queue and prints
+*           them in order.
+* @Params: in: frame = ICP frame with the messages
+*          in: length = number of bytes of the frame
+* 		   in/out: mutex = screen mutex to prevent printing to screen
+*                  by different users at the same time
+* @Return: ----
+**********************************************************************/
+void ICP_receivePack(char *frame, int length, pthread_mutex_t *mutex);
+
 /**********************************************************************
 * @Purpose: Gets the file sent by another user in the same machine and
 *           checks it. If there are no errors, copies the file into the
@@ -74,13 +316,47 @@ void ICP_receiveMsg(char *frame, pthread_mutex_t *mutex);
 *				   file and the checksum of the file
 *          in: directory = string containing the name of the directory
 *		       in which to copy the file
-*		   in/out: attr = attributes of the message queue
-*		   in: qfd = file descriptor of the message queue
+*          in: policy = write policy of the received files
+*		   in/out: streams = files being received through the queue
+*		   in/out: ring = ring of this son (no ring if its header is
+*		           NULL)
+*		   in: fd_socket = socket to receive file descriptors (-1 if
+*		       there is none)
 *		   in/out mutex = screen mutex to prevent writing on screen
 *		          simultaneously
 * @Return: Returns ICP_READ_FRAME_NO_ERROR if the file was received
 *          correctly, otherwise ICP_READ_FRAME_ERROR.
 **********************************************************************/
-char ICP_receiveFile(char **frame, char *directory, struct mq_attr *attr, int qfd, int pid, pthread_mutex_t *mutex);
+char ICP_receiveFile(char **frame, char *directory, WritePolicy *policy, IcpStreams *streams, ShmRing *ring, int fd_socket, pthread_mutex_t *mutex);
+
+/**********************************************************************
+* @Purpose: Creates an empty table of files received through the queue.
+* @Params: ----
+* @Return: Returns the initialized IcpStreams.
+**********************************************************************/
+IcpStreams ICP_initStreams();
+
+/**********************************************************************
+* @Purpose: Writes a fragment of a file received through the queue into
+*           its file. The file is checked once all its fragments have
+*           arrived.
+* @Params: in: frame = fragment with its IcpChunkHeader
+*          in: length = number of bytes of the frame
+*          in/out: streams = files being received through the queue
+*          in: directory = string containing the directory of the files
+*		   in/out mutex = screen mutex to prevent writing on screen
+*		          simultaneously
+* @Return: Returns 1 if the file has ended (and something was shown),
+*          otherwise 0.
+**********************************************************************/
+char ICP_receiveChunk(char *frame, int length, IcpStreams *streams, char *directory, pthread_mutex_t *mutex);
+
+/**********************************************************************
+* @Purpose: Drops the files that were being received through the queue
+*           and frees the table.
+* @Params: in/out: streams = files being received through the queue
+* @Return: ----
+**********************************************************************/
+void ICP_closeStreams(IcpStreams *streams);
 
 #endif
@@ -0,0 +1,265 @@
+/*********************************************************************
+* @Purpose: Module with a fast LZ codec to compress the data of the
+*           files sent between machines. A block is a sequence of
+*           literals and matches: every sequence starts with a token
+*           (literal length in the high 4 bits, match length minus
+*           LZ_MIN_MATCH in the low 4 bits), followed by the extra
+*           length bytes, the literals and the 2 bytes of the offset.
+*           The last sequence only has literals.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "lz.h"
+
+/*********************************************************************
+* @Purpose: Estimates if a chunk of data is worth compressing, from
+*           the byte frequencies of a few samples of it. Data whose
+*           collision entropy is close to 8 bits per byte (compressed
+*           or encrypted files) is not compressed.
+* @Params: in: data = data of the chunk
+*          in: length = number of bytes of data
+* @Return: Returns 1 if the chunk looks compressible, otherwise 0.
+*********************************************************************/
+char LZ_isCompressible(char *data, int length) {
+	int count[256];
+	long long sum = 0, n = 0;
+	int step = 0, i = 0, j = 0, size = 0;
+
+	memset(count, 0, sizeof(count));
+	step = length / LZ_SAMPLE_BLOCKS;
+
+	// a block of every part of the chunk
+	for (i = 0; i < LZ_SAMPLE_BLOCKS; i++) {
+	    size = (length - i * step < LZ_SAMPLE_BLOCK_SIZE) ? length - i * step : LZ_SAMPLE_BLOCK_SIZE;
+
+		for (j = 0; j < size; j++) {
+		    count[(unsigned char) data[i * step + j]]++;
+		}
+
+		n += size;
+	}
+
+	for (i = 0; i < 256; i++) {
+	    sum += (long long) count[i] * count[i];
+	}
+
+	// the collision entropy -log2(sum(p^2)) is below 7.5 bits (2^7.5 ~ LZ_ENTROPY_DIVISOR)
+	return (sum * LZ_ENTROPY_DIVISOR > n * n);
+}
+
+/*********************************************************************
+* @Purpose: Reads 4 bytes of a block to compare and hash them.
+* @Params: in: p = pointer to the bytes
+* @Return: Returns the 4 bytes as an integer.
+*********************************************************************/
+unsigned int readLzWord(unsigned char *p) {
+	unsigned int word = 0;
+
+	memcpy(&word, p, sizeof(word));
+
+	return (word);
+}
+
+/*********************************************************************
+* @Purpose: Writes the extra bytes of a length that does not fit in
+*           the 4 bits of the token.
+* @Params: in/out: dst = compressed data
+*          in/out: out = position in dst
+*          in: length = length minus LZ_LENGTH_MASK
+* @Return: ----
+*********************************************************************/
+void writeLzLength(unsigned char *dst, int *out, int length) {
+	while (length >= 255) {
+	    dst[(*out)++] = 255;
+		length -= 255;
+	}
+
+	dst[(*out)++] = (unsigned char) length;
+}
+
+/*********************************************************************
+* @Purpose: Writes a sequence of literals followed by a match.
+* @Params: in/out: dst = compressed data
+*          in/out: out = position in dst
+*          in: capacity = maximum number of bytes of dst
+*          in: literals = literals of the sequence
+*          in: n_literals = number of literals
+*          in: offset = distance back to the match (0 if the sequence
+*              is the last one)
+*          in: match = length of the match
+* @Return: Returns 1 if the sequence fits in dst, otherwise 0.
+*********************************************************************/
+char writeLzSequence(unsigned char *dst, int *out, int capacity, unsigned char *literals, int n_literals, int offset, int match) {
+	int token = 0;
+
+	// worst case of the token, the extra length bytes and the offset
+	if (*out + 1 + n_literals + n_literals / 255 + 1 + 2 + match / 255 + 1 > capacity) {
+	    return (0);
+	}
+
+	token = (n_literals >= LZ_LENGTH_MASK) ? LZ_LENGTH_MASK : n_literals;
+
+	if (0 < offset) {
+	    match -= LZ_MIN_MATCH;
+		token = (token << 4) | ((match >= LZ_LENGTH_MASK) ? LZ_LENGTH_MASK : match);
+	} else {
+	    token = token << 4;
+	}
+
+	dst[(*out)++] = (unsigned char) token;
+
+	if (n_literals >= LZ_LENGTH_MASK) {
+	    writeLzLength(dst, out, n_literals - LZ_LENGTH_MASK);
+	}
+
+	memcpy(dst + *out, literals, n_literals);
+	*out += n_literals;
+
+	if (0 < offset) {
+	    dst[(*out)++] = (unsigned char) (offset & 0xFF);
+		dst[(*out)++] = (unsigned char) (offset >> 8);
+
+		if (match >= LZ_LENGTH_MASK) {
+		    writeLzLength(dst, out, match - LZ_LENGTH_MASK);
+		}
+	}
+
+	return (1);
+}
+
+/*********************************************************************
+* @Purpose: Compresses a block of data as a sequence of literals and
+*           matches (offset of at most LZ_MAX_OFFSET bytes back).
+* @Params: in: src = data to compress
+*          in: length = number of bytes of src
+*          out: dst = buffer to store the compressed data
+*          in: capacity = maximum number of bytes of dst
+* @Return: Returns the number of bytes of the compressed data, or 0 if
+*          it does not fit in the capacity.
+*********************************************************************/
+int LZ_compress(char *src, int length, char *dst, int capacity) {
+	unsigned char *in = (unsigned char *) src;
+	unsigned char *out_data = (unsigned char *) dst;
+	int table[1 << LZ_HASH_BITS];
+	unsigned int word = 0, hash = 0;
+	int i = 0, anchor = 0, candidate = 0, match = 0, out = 0;
+
+	// positions are stored plus one, so 0 is an empty entry
+	memset(table, 0, sizeof(table));
+
+	while (i + LZ_MIN_MATCH <= length) {
+	    word = readLzWord(in + i);
+		hash = (word * 2654435761U) >> (32 - LZ_HASH_BITS);
+		candidate = table[hash] - 1;
+		table[hash] = i + 1;
+
+		if ((candidate < 0) || (i - candidate > LZ_MAX_OFFSET) || (readLzWord(in + candidate) != word)) {
+		    // the longer without matches, the bigger the step (incompressible data is skipped fast)
+			i += 1 + ((i - anchor) >> 6);
+			continue;
+		}
+
+		for (match = LZ_MIN_MATCH; (i + match < length) && (in[candidate + match] == in[i + match]); match++);
+
+		if (!writeLzSequence(out_data, &out, capacity, in + anchor, i - anchor, i - candidate, match)) {
+		    return (0);
+		}
+
+		i += match;
+		anchor = i;
+	}
+
+	if (!writeLzSequence(out_data, &out, capacity, in + anchor, length - anchor, 0, 0)) {
+	    return (0);
+	}
+
+	return (out);
+}
+
+/*********************************************************************
+* @Purpose: Reads the extra bytes of a length of a sequence.
+* @Params: in: src = compressed data
+*          in: length = number of bytes of src
+*          in/out: pos = position in src
+*          in: value = length stored in the token
+* @Return: Returns the full length, or LZ_KO if the data ends before.
+*********************************************************************/
+int readLzLength(unsigned char *src, int length, int *pos, int value) {
+	int byte = 255;
+
+	if (LZ_LENGTH_MASK != value) {
+	    return (value);
+	}
+
+	while (255 == byte) {
+	    if (*pos >= length) {
+		    return (LZ_KO);
+		}
+
+		byte = src[(*pos)++];
+		value += byte;
+	}
+
+	return (value);
+}
+
+/*********************************************************************
+* @Purpose: Decompresses a block compressed with LZ_compress.
+* @Params: in: src = compressed data
+*          in: length = number of bytes of src
+*          out: dst = buffer to store the original data
+*          in: capacity = maximum number of bytes of dst
+* @Return: Returns the number of bytes of the original data, or LZ_KO
+*          if the block is malformed or does not fit in the capacity.
+*********************************************************************/
+int LZ_decompress(char *src, int length, char *dst, int capacity) {
+	unsigned char *in = (unsigned char *) src;
+	int pos = 0, out = 0, token = 0, n = 0, offset = 0, i = 0;
+
+	while (pos < length) {
+	    token = in[pos++];
+		n = readLzLength(in, length, &pos, token >> 4);
+
+		if ((LZ_KO == n) || (pos + n > length) || (out + n > capacity)) {
+		    return (LZ_KO);
+		}
+
+		memcpy(dst + out, in + pos, n);
+		pos += n;
+		out += n;
+
+		// the last sequence has no match
+		if (pos == length) {
+		    break;
+		}
+
+		if (pos + 2 > length) {
+		    return (LZ_KO);
+		}
+
+		offset = in[pos] | (in[pos + 1] << 8);
+		pos += 2;
+		n = readLzLength(in, length, &pos, token & LZ_LENGTH_MASK);
+
+		if ((LZ_KO == n) || (0 == offset) || (offset > out) || (out + n + LZ_MIN_MATCH > capacity)) {
+		    return (LZ_KO);
+		}
+
+		n += LZ_MIN_MATCH;
+
+		// the match can overlap the bytes it produces
+		if (offset >= n) {
+		    memcpy(dst + out, dst + out - offset, n);
+		} else {
+		    for (i = 0; i < n; i++) {
+			    dst[out + i] = dst[out - offset + i];
+			}
+		}
+
+		out += n;
+	}
+
+	return (out);
+}
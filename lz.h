@@ -0,0 +1,53 @@
+#ifndef _LZ_H_
+#define _LZ_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+#define LZ_MIN_MATCH				4
+#define LZ_MAX_OFFSET				65535
+#define LZ_HASH_BITS				12
+#define LZ_LENGTH_MASK				15
+#define LZ_SAMPLE_BLOCKS			16
+#define LZ_SAMPLE_BLOCK_SIZE		256
+#define LZ_ENTROPY_DIVISOR			181
+#define LZ_KO						-1
+
+/*********************************************************************
+* @Purpose: Estimates if a chunk of data is worth compressing, from
+*           the byte frequencies of a few samples of it. Data whose
+*           collision entropy is close to 8 bits per byte (compressed
+*           or encrypted files) is not compressed.
+* @Params: in: data = data of the chunk
+*          in: length = number of bytes of data
+* @Return: Returns 1 if the chunk looks compressible, otherwise 0.
+*********************************************************************/
+char LZ_isCompressible(char *data, int length);
+
+/*********************************************************************
+* @Purpose: Compresses a block of data as a sequence of literals and
+*           matches (offset of at most LZ_MAX_OFFSET bytes back).
+* @Params: in: src = data to compress
+*          in: length = number of bytes of src
+*          out: dst = buffer to store the compressed data
+*          in: capacity = maximum number of bytes of dst
+* @Return: Returns the number of bytes of the compressed data, or 0 if
+*          it does not fit in the capacity.
+*********************************************************************/
+int LZ_compress(char *src, int length, char *dst, int capacity);
+
+/*********************************************************************
+* @Purpose: Decompresses a block compressed with LZ_compress.
+* @Params: in: src = compressed data
+*          in: length = number of bytes of src
+*          out: dst = buffer to store the original data
+*          in: capacity = maximum number of bytes of dst
+* @Return: Returns the number of bytes of the original data, or LZ_KO
+*          if the block is malformed or does not fit in the capacity.
+*********************************************************************/
+int LZ_decompress(char *src, int length, char *dst, int capacity);
+
+#endif
@@ -0,0 +1,235 @@
+/*********************************************************************
+* @Purpose: Module that computes MD5 digests in process (RFC 1321),
+*           so that hashing does not require forking md5sum.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "md5.h"
+
+#define ROTATE_LEFT(x, c)	(((x) << (c)) | ((x) >> (32 - (c))))
+
+// per-round shift amounts
+static const uint32_t md5_shifts[64] = {
+	7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+	4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+// integer part of the sines of integers (in radians) * 2^32
+static const uint32_t md5_constants[64] = {
+	0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+/*********************************************************************
+* @Purpose: Processes a single 64-byte block.
+* @Params: in/out: state = the four words of the digest state
+*          in: block = 64 bytes to process
+* @Return: ----
+*********************************************************************/
+void processBlock(uint32_t state[4], const unsigned char *block) {
+	uint32_t words[16];
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t f = 0, tmp = 0;
+	int i = 0, g = 0;
+
+	// words are stored in little endian
+	for (i = 0; i < 16; i++) {
+	    words[i] = ((uint32_t) block[i * 4]) | ((uint32_t) block[i * 4 + 1] << 8) |
+		           ((uint32_t) block[i * 4 + 2] << 16) | ((uint32_t) block[i * 4 + 3] << 24);
+	}
+
+	for (i = 0; i < 64; i++) {
+	    if (i < 16) {
+		    f = (b & c) | (~b & d);
+			g = i;
+		} else if (i < 32) {
+		    f = (d & b) | (~d & c);
+			g = (5 * i + 1) % 16;
+		} else if (i < 48) {
+		    f = b ^ c ^ d;
+			g = (3 * i + 5) % 16;
+		} else {
+		    f = c ^ (b | ~d);
+			g = (7 * i) % 16;
+		}
+
+		tmp = d;
+		d = c;
+		c = b;
+		b = b + ROTATE_LEFT(a + f + md5_constants[i] + words[g], md5_shifts[i]);
+		a = tmp;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+/*********************************************************************
+* @Purpose: Initializes an MD5 context.
+* @Params: in/out: ctx = context to initialize
+* @Return: ----
+*********************************************************************/
+void MD5_init(MD5Context *ctx) {
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->n_bytes = 0;
+}
+
+/*********************************************************************
+* @Purpose: Adds data to the digest being computed.
+* @Params: in/out: ctx = initialized context
+*          in: data = bytes to add
+*          in: length = number of bytes to add
+* @Return: ----
+*********************************************************************/
+void MD5_update(MD5Context *ctx, const void *data, size_t length) {
+	const unsigned char *bytes = (const unsigned char *) data;
+	size_t used = (size_t) (ctx->n_bytes % MD5_BLOCK_BYTES);
+	size_t fill = 0;
+
+	ctx->n_bytes += length;
+
+	// complete the pending block
+	if (used > 0) {
+	    fill = MD5_BLOCK_BYTES - used;
+
+		if (length < fill) {
+		    memcpy(ctx->block + used, bytes, length);
+			return;
+		}
+
+		memcpy(ctx->block + used, bytes, fill);
+		processBlock(ctx->state, ctx->block);
+		bytes += fill;
+		length -= fill;
+	}
+
+	// full blocks are processed directly from the input
+	while (length >= MD5_BLOCK_BYTES) {
+	    processBlock(ctx->state, bytes);
+		bytes += MD5_BLOCK_BYTES;
+		length -= MD5_BLOCK_BYTES;
+	}
+
+	if (length > 0) {
+	    memcpy(ctx->block, bytes, length);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Finishes the digest.
+* @Params: in/out: ctx = initialized context
+*          in/out: digest = array to store the 16 bytes of the digest
+* @Return: ----
+*********************************************************************/
+void MD5_final(MD5Context *ctx, unsigned char digest[MD5_DIGEST_BYTES]) {
+	unsigned char padding[MD5_BLOCK_BYTES * 2];
+	uint64_t n_bits = ctx->n_bytes * 8;
+	size_t used = (size_t) (ctx->n_bytes % MD5_BLOCK_BYTES);
+	size_t pad_length = (used < 56) ? (56 - used) : (120 - used);
+	int i = 0;
+
+	// 0x80 followed by zeros and the length in bits (little endian)
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	for (i = 0; i < 8; i++) {
+	    padding[pad_length + i] = (unsigned char) ((n_bits >> (8 * i)) & 0xFF);
+	}
+
+	MD5_update(ctx, padding, pad_length + 8);
+
+	for (i = 0; i < 4; i++) {
+	    digest[i * 4] = (unsigned char) (ctx->state[i] & 0xFF);
+		digest[i * 4 + 1] = (unsigned char) ((ctx->state[i] >> 8) & 0xFF);
+		digest[i * 4 + 2] = (unsigned char) ((ctx->state[i] >> 16) & 0xFF);
+		digest[i * 4 + 3] = (unsigned char) ((ctx->state[i] >> 24) & 0xFF);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Computes the digest of a buffer in a single call.
+* @Params: in: data = bytes to hash
+*          in: length = number of bytes
+*          in/out: digest = array to store the 16 bytes of the digest
+* @Return: ----
+*********************************************************************/
+void MD5_buffer(const void *data, size_t length, unsigned char digest[MD5_DIGEST_BYTES]) {
+	MD5Context ctx;
+
+	MD5_init(&ctx);
+	MD5_update(&ctx, data, length);
+	MD5_final(&ctx, digest);
+}
+
+/*********************************************************************
+* @Purpose: Turns a digest into the hexadecimal string used by md5sum.
+* @Params: in: digest = the 16 bytes of the digest
+* @Return: Returns a new string with the digest.
+*********************************************************************/
+char * MD5_toString(const unsigned char digest[MD5_DIGEST_BYTES]) {
+	char *output = (char *) malloc (sizeof(char) * (MD5_STRING_LENGTH + 1));
+	int i = 0;
+
+	if (NULL == output) {
+	    return (NULL);
+	}
+
+	for (i = 0; i < MD5_DIGEST_BYTES; i++) {
+	    sprintf(output + (i * 2), "%02x", digest[i]);
+	}
+
+	output[MD5_STRING_LENGTH] = '\0';
+	return (output);
+}
+
+/*********************************************************************
+* @Purpose: Computes the digest of a file.
+* @Params: in: path = path of the file
+* @Return: Returns a new string with the digest (as md5sum would show
+*          it), or NULL if the file could not be read.
+*********************************************************************/
+char * MD5_file(char *path) {
+	MD5Context ctx;
+	unsigned char digest[MD5_DIGEST_BYTES];
+	char *buffer = NULL;
+	int fd = -1, n = 0;
+
+	fd = open(path, O_RDONLY);
+
+	if (-1 == fd) {
+	    return (NULL);
+	}
+
+	buffer = (char *) malloc (sizeof(char) * MD5_READ_BYTES);
+	MD5_init(&ctx);
+
+	while (0 < (n = read(fd, buffer, MD5_READ_BYTES))) {
+	    MD5_update(&ctx, buffer, n);
+	}
+
+	free(buffer);
+	buffer = NULL;
+	close(fd);
+
+	if (n < 0) {
+	    return (NULL);
+	}
+
+	MD5_final(&ctx, digest);
+	return (MD5_toString(digest));
+}
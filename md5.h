@@ -0,0 +1,72 @@
+#ifndef _MD5_H_
+#define _MD5_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* Constants */
+#define MD5_DIGEST_BYTES		16
+#define MD5_BLOCK_BYTES			64
+#define MD5_STRING_LENGTH		32
+#define MD5_READ_BYTES			65536
+
+typedef struct {
+	uint32_t state[4];
+	uint64_t n_bytes;
+	unsigned char block[MD5_BLOCK_BYTES];
+} MD5Context;
+
+/*********************************************************************
+* @Purpose: Initializes an MD5 context.
+* @Params: in/out: ctx = context to initialize
+* @Return: ----
+*********************************************************************/
+void MD5_init(MD5Context *ctx);
+
+/*********************************************************************
+* @Purpose: Adds data to the digest being computed.
+* @Params: in/out: ctx = initialized context
+*          in: data = bytes to add
+*          in: length = number of bytes to add
+* @Return: ----
+*********************************************************************/
+void MD5_update(MD5Context *ctx, const void *data, size_t length);
+
+/*********************************************************************
+* @Purpose: Finishes the digest.
+* @Params: in/out: ctx = initialized context
+*          in/out: digest = array to store the 16 bytes of the digest
+* @Return: ----
+*********************************************************************/
+void MD5_final(MD5Context *ctx, unsigned char digest[MD5_DIGEST_BYTES]);
+
+/*********************************************************************
+* @Purpose: Computes the digest of a buffer in a single call.
+* @Params: in: data = bytes to hash
+*          in: length = number of bytes
+*          in/out: digest = array to store the 16 bytes of the digest
+* @Return: ----
+*********************************************************************/
+void MD5_buffer(const void *data, size_t length, unsigned char digest[MD5_DIGEST_BYTES]);
+
+/*********************************************************************
+* @Purpose: Turns a digest into the hexadecimal string used by md5sum.
+* @Params: in: digest = the 16 bytes of the digest
+* @Return: Returns a new string with the digest.
+*********************************************************************/
+char * MD5_toString(const unsigned char digest[MD5_DIGEST_BYTES]);
+
+/*********************************************************************
+* @Purpose: Computes the digest of a file.
+* @Params: in: path = path of the file
+* @Return: Returns a new string with the digest (as md5sum would show
+*          it), or NULL if the file could not be read.
+*********************************************************************/
+char * MD5_file(char *path);
+
+#endif
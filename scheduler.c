@@ -0,0 +1,298 @@
+/*********************************************************************
+* @Purpose: Module that schedules the data of the transfers: token
+*           buckets limit the rate of every transfer, of every peer and
+*           of all of them, and interactive frames go before any new
+*           chunk of file data.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "scheduler.h"
+
+/*********************************************************************
+* @Purpose: Initializes a token bucket. The bucket can hold the bytes
+*           of 1/SCHEDULER_SLICES seconds, and starts full.
+* @Params: out: b = token bucket to initialize
+*          in: rate = bytes per second (0 = unlimited)
+* @Return: ----
+*********************************************************************/
+void initBucket(TokenBucket *b, long long rate) {
+	b->rate = rate;
+	b->tokens = (double) rate / SCHEDULER_SLICES;
+	b->last_time = SHAREDFUNCTIONS_getTimeMicros();
+}
+
+/*********************************************************************
+* @Purpose: Adds the tokens earned since the last refill.
+* @Params: in/out: b = token bucket
+*          in: now = current time in microseconds
+* @Return: ----
+*********************************************************************/
+void refillBucket(TokenBucket *b, long long now) {
+	if (0 < b->rate) {
+	    b->tokens += (double) b->rate * (now - b->last_time) / 1000000;
+
+		if (b->tokens > (double) b->rate / SCHEDULER_SLICES) {
+		    b->tokens = (double) b->rate / SCHEDULER_SLICES;
+		}
+	}
+
+	b->last_time = now;
+}
+
+/*********************************************************************
+* @Purpose: Gets the time until a bucket has no debt (a chunk may take
+*           more tokens than the bucket holds, and is paid afterwards).
+* @Params: in: b = token bucket
+* @Return: Returns the time in microseconds.
+*********************************************************************/
+long long getBucketWait(TokenBucket *b) {
+	if ((0 == b->rate) || (b->tokens >= 0)) {
+	    return (0);
+	}
+
+	return ((long long) (-b->tokens * 1000000 / b->rate) + 1);
+}
+
+/*********************************************************************
+* @Purpose: Initializes a scheduler without rate limits.
+* @Params: in/out: s = instance of Scheduler to initialize
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_init(Scheduler *s) {
+	s->limits.global = 0;
+	s->limits.peer = 0;
+	s->limits.transfer = 0;
+	initBucket(&s->global, 0);
+	s->peers = NULL;
+	s->n_peers = 0;
+	s->urgent = 0;
+	pthread_mutex_init(&s->mutex, NULL);
+	pthread_cond_init(&s->cond, NULL);
+}
+
+/*********************************************************************
+* @Purpose: Sets the rate limits of the transfers.
+* @Params: in/out: s = initialized instance of Scheduler
+*          in: limits = global, per peer and per transfer limits
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_setLimits(Scheduler *s, RateLimits *limits) {
+	int i = 0;
+
+	pthread_mutex_lock(&s->mutex);
+	s->limits = *limits;
+	initBucket(&s->global, limits->global);
+
+	for (i = 0; i < s->n_peers; i++) {
+	    initBucket(&s->peers[i].bucket, limits->peer);
+	}
+
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Prepares the rate limits of a new transfer.
+* @Params: in/out: s = initialized instance of Scheduler
+*          out: t = throttle of the transfer
+*          in: ip = IP address of the receiver
+*          in: port = port of the receiver
+*          in: network = 1 if the data goes through the network (only
+*              then the global limit applies), otherwise 0
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_openThrottle(Scheduler *s, Throttle *t, char *ip, int port, char network) {
+	char *peer = NULL;
+	int i = 0;
+
+	asprintf(&peer, "%s:%d", ip, port);
+	pthread_mutex_lock(&s->mutex);
+
+	// the transfers to the same peer share its bucket
+	for (i = 0; (i < s->n_peers) && (0 != strcmp(s->peers[i].peer, peer)); i++);
+
+	if (i == s->n_peers) {
+	    s->peers = (PeerBucket *) realloc (s->peers, sizeof(PeerBucket) * (s->n_peers + 1));
+		s->peers[i].peer = peer;
+		initBucket(&s->peers[i].bucket, s->limits.peer);
+		(s->n_peers)++;
+	} else {
+	    free(peer);
+	}
+
+	peer = NULL;
+	t->scheduler = s;
+	t->peer = i;
+	t->network = network;
+	initBucket(&t->bucket, s->limits.transfer);
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Gets the biggest chunk a transfer should send at once, so
+*           that a limited transfer is paced in small steps.
+* @Params: in: control = progress of the transfer (can be NULL)
+* @Return: Returns the number of bytes, or 0 if there is no limit.
+*********************************************************************/
+int SCHEDULER_chunkLimit(TransferControl *control) {
+	Throttle *t = NULL;
+	long long rate = 0;
+
+	if ((NULL == control) || (NULL == control->throttle)) {
+	    return (0);
+	}
+
+	t = control->throttle;
+	rate = t->bucket.rate;
+
+	if ((0 < t->scheduler->limits.peer) && ((0 == rate) || (t->scheduler->limits.peer < rate))) {
+	    rate = t->scheduler->limits.peer;
+	}
+
+	if (t->network && (0 < t->scheduler->limits.global) && ((0 == rate) || (t->scheduler->limits.global < rate))) {
+	    rate = t->scheduler->limits.global;
+	}
+
+	if (0 == rate) {
+	    return (0);
+	}
+
+	rate /= SCHEDULER_SLICES;
+
+	return ((rate < SCHEDULER_MIN_CHUNK) ? SCHEDULER_MIN_CHUNK : (int) rate);
+}
+
+/*********************************************************************
+* @Purpose: Waits until a transfer can send a chunk: no interactive
+*           frame is being sent and the chunk fits in the transfer,
+*           peer and global limits. The bytes are then consumed.
+* @Params: in/out: control = progress of the transfer (can be NULL)
+*          in: bytes = size of the chunk
+* @Return: Returns SCHEDULER_OK when the chunk can be sent, or
+*          SCHEDULER_KO if the transfer was cancelled while waiting.
+*********************************************************************/
+char SCHEDULER_acquire(TransferControl *control, int bytes) {
+	struct timespec deadline;
+	Throttle *t = NULL;
+	Scheduler *s = NULL;
+	TokenBucket *peer = NULL;
+	long long now = 0, wait = 0;
+
+	if ((NULL == control) || (NULL == control->throttle)) {
+	    return (SCHEDULER_OK);
+	}
+
+	t = control->throttle;
+	s = t->scheduler;
+	pthread_mutex_lock(&s->mutex);
+
+	while (!control->cancel) {
+	    // the array of peers can grow while waiting
+		peer = &s->peers[t->peer].bucket;
+	    now = SHAREDFUNCTIONS_getTimeMicros();
+		refillBucket(&t->bucket, now);
+		refillBucket(peer, now);
+		refillBucket(&s->global, now);
+
+		// interactive frames go first
+		if (0 < s->urgent) {
+		    wait = SCHEDULER_MAX_WAIT;
+		} else {
+		    wait = getBucketWait(&t->bucket);
+
+			if (getBucketWait(peer) > wait) {
+			    wait = getBucketWait(peer);
+			}
+
+			if (t->network && (getBucketWait(&s->global) > wait)) {
+			    wait = getBucketWait(&s->global);
+			}
+		}
+
+		if (0 == wait) {
+		    break;
+		}
+
+		// the wait is cut so a cancellation is noticed soon
+		if (wait > SCHEDULER_MAX_WAIT) {
+		    wait = SCHEDULER_MAX_WAIT;
+		}
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += (wait % 1000000) * 1000;
+		deadline.tv_sec += wait / 1000000 + deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+		pthread_cond_timedwait(&s->cond, &s->mutex, &deadline);
+	}
+
+	if (control->cancel) {
+	    pthread_mutex_unlock(&s->mutex);
+		return (SCHEDULER_KO);
+	}
+
+	// the chunk is paid even if it leaves the buckets in debt
+	if (0 < t->bucket.rate) {
+	    t->bucket.tokens -= bytes;
+	}
+
+	if (0 < peer->rate) {
+	    peer->tokens -= bytes;
+	}
+
+	if (t->network && (0 < s->global.rate)) {
+	    s->global.tokens -= bytes;
+	}
+
+	pthread_mutex_unlock(&s->mutex);
+
+	return (SCHEDULER_OK);
+}
+
+/*********************************************************************
+* @Purpose: Marks the start of an interactive send (messages and
+*           frames to Arda). The transfers do not send new chunks until
+*           it ends.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_beginUrgent(Scheduler *s) {
+	pthread_mutex_lock(&s->mutex);
+	(s->urgent)++;
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Marks the end of an interactive send.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_endUrgent(Scheduler *s) {
+	pthread_mutex_lock(&s->mutex);
+	(s->urgent)--;
+	pthread_cond_broadcast(&s->cond);
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Frees the memory of a scheduler.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_close(Scheduler *s) {
+	int i = 0;
+
+	for (i = 0; i < s->n_peers; i++) {
+	    free(s->peers[i].peer);
+		s->peers[i].peer = NULL;
+	}
+
+	if (NULL != s->peers) {
+	    free(s->peers);
+		s->peers = NULL;
+	}
+
+	s->n_peers = 0;
+	pthread_mutex_destroy(&s->mutex);
+	pthread_cond_destroy(&s->cond);
+}
@@ -0,0 +1,118 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "definitions.h"
+#include "sharedFunctions.h"
+
+/* Constants */
+#define SCHEDULER_SLICES			10
+#define SCHEDULER_MIN_CHUNK			4096
+#define SCHEDULER_MAX_WAIT			100000
+#define SCHEDULER_OK				0
+#define SCHEDULER_KO				1
+
+typedef struct {
+	long long rate;
+	double tokens;
+	long long last_time;
+} TokenBucket;
+
+typedef struct {
+	char *peer;
+	TokenBucket bucket;
+} PeerBucket;
+
+typedef struct {
+	RateLimits limits;
+	TokenBucket global;
+	PeerBucket *peers;
+	int n_peers;
+	int urgent;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} Scheduler;
+
+struct _Throttle {
+	Scheduler *scheduler;
+	TokenBucket bucket;
+	int peer;
+	char network;
+};
+
+/*********************************************************************
+* @Purpose: Initializes a scheduler without rate limits.
+* @Params: in/out: s = instance of Scheduler to initialize
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_init(Scheduler *s);
+
+/*********************************************************************
+* @Purpose: Sets the rate limits of the transfers.
+* @Params: in/out: s = initialized instance of Scheduler
+*          in: limits = global, per peer and per transfer limits
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_setLimits(Scheduler *s, RateLimits *limits);
+
+/*********************************************************************
+* @Purpose: Prepares the rate limits of a new transfer.
+* @Params: in/out: s = initialized instance of Scheduler
+*          out: t = throttle of the transfer
+*          in: ip = IP address of the receiver
+*          in: port = port of the receiver
+*          in: network = 1 if the data goes through the network (only
+*              then the global limit applies), otherwise 0
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_openThrottle(Scheduler *s, Throttle *t, char *ip, int port, char network);
+
+/*********************************************************************
+* @Purpose: Gets the biggest chunk a transfer should send at once, so
+*           that a limited transfer is paced in small steps.
+* @Params: in: control = progress of the transfer (can be NULL)
+* @Return: Returns the number of bytes, or 0 if there is no limit.
+*********************************************************************/
+int SCHEDULER_chunkLimit(TransferControl *control);
+
+/*********************************************************************
+* @Purpose: Waits until a transfer can send a chunk: no interactive
+*           frame is being sent and the chunk fits in the transfer,
+*           peer and global limits. The bytes are then consumed.
+* @Params: in/out: control = progress of the transfer (can be NULL)
+*          in: bytes = size of the chunk
+* @Return: Returns SCHEDULER_OK when the chunk can be sent, or
+*          SCHEDULER_KO if the transfer was cancelled while waiting.
+*********************************************************************/
+char SCHEDULER_acquire(TransferControl *control, int bytes);
+
+/*********************************************************************
+* @Purpose: Marks the start of an interactive send (messages and
+*           frames to Arda). The transfers do not send new chunks until
+*           it ends.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_beginUrgent(Scheduler *s);
+
+/*********************************************************************
+* @Purpose: Marks the end of an interactive send.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_endUrgent(Scheduler *s);
+
+/*********************************************************************
+* @Purpose: Frees the memory of a scheduler.
+* @Params: in/out: s = initialized instance of Scheduler
+* @Return: ----
+*********************************************************************/
+void SCHEDULER_close(Scheduler *s);
+
+#endif
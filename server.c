@@ -4,7 +4,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 10/12/2022
-* @Last change: 09/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "server.h"
 
@@ -18,6 +18,7 @@
 Server SERVER_init(char *ip, int port, int n_msg) {
     Server s;
 	struct sockaddr_in server;
+	int reuse = 1;
 
 	// init Server
 	s.listen_fd = FD_NOT_FOUND;
@@ -31,6 +32,9 @@ Server SERVER_init(char *ip, int port, int n_msg) {
 	s.mutex_print = NULL;
 	s.n_clients = 0;
 	s.clients = BIDIRECTIONALLIST_create();
+	s.inventories = NULL;
+	s.n_inventories = 0;
+	s.blobs = NULL;
 
     // Creating the server socket
 	if ((s.listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
@@ -40,6 +44,9 @@ Server SERVER_init(char *ip, int port, int n_msg) {
 		return (s);
 	}
 
+	// the connections are closed by the server, so the port may have connections in TIME_WAIT
+	setsockopt(s.listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     // Clear and assign the values to the server structure
     bzero(&server, sizeof(server));
     server.sin_port = htons(port);
@@ -186,6 +193,433 @@ void answerListPetition(Server *s, char **data, int client_fd) {
 	buffer = NULL;
 }
 
+/*********************************************************************
+* @Purpose: Frees the entries of an inventory.
+* @Params: in/out: inventory = inventory of a son
+* @Return: ----
+*********************************************************************/
+void freeInventoryEntries(Inventory *inventory) {
+	int i = 0;
+
+	for (i = 0; i < inventory->n_entries; i++) {
+	    free(inventory->entries[i].md5sum);
+		inventory->entries[i].md5sum = NULL;
+		free(inventory->entries[i].filename);
+		inventory->entries[i].filename = NULL;
+	}
+
+	if (NULL != inventory->entries) {
+	    free(inventory->entries);
+		inventory->entries = NULL;
+	}
+
+	inventory->n_entries = 0;
+}
+
+/*********************************************************************
+* @Purpose: Searches the inventory of a son. The mutex of the server
+*           must be locked.
+* @Params: in: s = instance of Server
+*          in: username = name of the son
+* @Return: Returns the position of the inventory, or -1 if the son has
+*          not published it.
+*********************************************************************/
+int searchInventory(Server *s, char *username) {
+	int i = 0;
+
+	for (i = 0; i < s->n_inventories; i++) {
+	    if (0 == strcmp(s->inventories[i].username, username)) {
+		    return (i);
+		}
+	}
+
+	return (-1);
+}
+
+/*********************************************************************
+* @Purpose: Removes the inventory of a son that has left Arda.
+* @Params: in/out: s = instance of Server
+*          in: username = name of the son
+* @Return: ----
+*********************************************************************/
+void removeInventory(Server *s, char *username) {
+	int pos = 0;
+
+	pthread_mutex_lock(&s->mutex);
+	pos = searchInventory(s, username);
+
+	if (-1 != pos) {
+	    freeInventoryEntries(&s->inventories[pos]);
+		free(s->inventories[pos].username);
+		s->inventories[pos] = s->inventories[s->n_inventories - 1];
+		(s->n_inventories)--;
+	}
+
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/*********************************************************************
+* @Purpose: Stores the inventory published by a son. An INVENTORY
+*           frame replaces the previous inventory of the son and the
+*           INVENTORY_ADD frames that follow it add more entries.
+* @Params: in/out: s = instance of Server
+*          in: header = header of the frame
+*          in: data = data of the frame (username#hash&size&filename#...)
+* @Return: ----
+*********************************************************************/
+void answerInventory(Server *s, char *header, char *data) {
+	Inventory *inventory = NULL;
+	InventoryEntry entry;
+	char *username = NULL;
+	char *buffer = NULL;
+	char *size = NULL;
+	int pos = 0, i = 0, n_entries = 0;
+
+	username = SHAREDFUNCTIONS_splitString(data, GPC_USERS_SEPARATOR, &pos);
+	pthread_mutex_lock(&s->mutex);
+	i = searchInventory(s, username);
+
+	if (-1 == i) {
+	    s->inventories = (Inventory *) realloc(s->inventories, sizeof(Inventory) * (s->n_inventories + 1));
+		i = s->n_inventories;
+		s->inventories[i].username = strdup(username);
+		s->inventories[i].entries = NULL;
+		s->inventories[i].n_entries = 0;
+		(s->n_inventories)++;
+	}
+
+	inventory = &s->inventories[i];
+
+	if (0 == strcmp(header, GCP_INVENTORY_HEADER)) {
+	    freeInventoryEntries(inventory);
+	}
+
+	while (pos < (int) strlen(data)) {
+	    buffer = SHAREDFUNCTIONS_splitString(data, GPC_USERS_SEPARATOR, &pos);
+		i = 0;
+		entry.md5sum = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &i);
+		size = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &i);
+		entry.size = atoll(size);
+		free(size);
+		size = NULL;
+		entry.filename = SHAREDFUNCTIONS_splitString(buffer, GPC_DATA_SEPARATOR, &i);
+		inventory->entries = (InventoryEntry *) realloc(inventory->entries, sizeof(InventoryEntry) * (inventory->n_entries + 1));
+		inventory->entries[inventory->n_entries] = entry;
+		(inventory->n_entries)++;
+		free(buffer);
+		buffer = NULL;
+	}
+
+	n_entries = inventory->n_entries;
+	pthread_mutex_unlock(&s->mutex);
+
+	asprintf(&buffer, INVENTORY_MSG, username, n_entries);
+	pthread_mutex_lock(s->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->mutex_print);
+	free(buffer);
+	buffer = NULL;
+	free(username);
+	username = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Searches a connected son in the list of clients.
+* @Params: in: clients = list of clients of the server
+*          in: username = name of the son
+*          out: e = element of the son (to free if found)
+* @Return: Returns 1 if the son is connected, otherwise 0.
+*********************************************************************/
+char searchArdaClient(BidirectionalList clients, char *username, Element *e) {
+	if (BIDIRECTIONALLIST_isEmpty(clients)) {
+	    return (0);
+	}
+
+	BIDIRECTIONALLIST_goToHead(&clients);
+
+	while (BIDIRECTIONALLIST_isValid(clients)) {
+	    *e = BIDIRECTIONALLIST_get(&clients);
+
+		if (0 == strcmp(e->username, username)) {
+		    return (1);
+		}
+
+		free(e->username);
+		e->username = NULL;
+		free(e->ip_network);
+		e->ip_network = NULL;
+		BIDIRECTIONALLIST_next(&clients);
+	}
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Sends the sons that hold a content (HAS_LIST reply), in
+*           the format hash&size&filename#user&ip&port#... (only the
+*           hash if nobody else holds it). If the content is in the
+*           blob cache, Arda is the first user (with an empty name and
+*           the address the son connected to).
+* @Params: in/out: s = instance of Server
+*          in: data = data of the WHO_HAS frame (username&hash)
+*          in: client_fd = file descriptor of the client
+* @Return: ----
+*********************************************************************/
+void answerWhoHas(Server *s, char *data, int client_fd) {
+	Element e;
+	struct sockaddr_in addr;
+	socklen_t addr_size = sizeof(struct sockaddr_in);
+	char *username = NULL;
+	char *md5sum = NULL;
+	char *filename = NULL;
+	char *reply = NULL;
+	char *buffer = NULL;
+	long long size = 0;
+	int pos = 0, i = 0, j = 0, length = 0, n = 0, n_users = 0;
+
+	username = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	md5sum = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	length = asprintf(&reply, "%s", md5sum);
+
+	if ((NULL != s->blobs) && (BLOBCACHE_FOUND == BLOBCACHE_lookup(s->blobs, md5sum, &size, &filename)) &&
+	    (0 == getsockname(client_fd, (struct sockaddr *) &addr, &addr_size))) {
+		length = asprintf(&buffer, "%s%c%lld%c%s%c%s%c%s%c%d", md5sum, GPC_DATA_SEPARATOR, size, GPC_DATA_SEPARATOR, filename, GPC_USERS_SEPARATOR,
+		                  GPC_BLOB_PEER_NAME, GPC_DATA_SEPARATOR, inet_ntoa(addr.sin_addr), GPC_DATA_SEPARATOR, ntohs(addr.sin_port));
+		free(reply);
+		reply = buffer;
+		buffer = NULL;
+		n_users++;
+	}
+
+	if (NULL != filename) {
+	    free(filename);
+		filename = NULL;
+	}
+
+	pthread_mutex_lock(&s->mutex);
+
+	for (i = 0; i < s->n_inventories; i++) {
+	    if (0 == strcmp(s->inventories[i].username, username)) {
+		    continue;
+		}
+
+		for (j = 0; j < s->inventories[i].n_entries; j++) {
+		    if ((0 == strcmp(s->inventories[i].entries[j].md5sum, md5sum)) && searchArdaClient(s->clients, s->inventories[i].username, &e)) {
+			    // the first son also gives the size and the name of the file
+				if (0 == n_users) {
+				    n = asprintf(&buffer, "%c%lld%c%s", GPC_DATA_SEPARATOR, s->inventories[i].entries[j].size,
+					             GPC_DATA_SEPARATOR, s->inventories[i].entries[j].filename);
+					reply = (char *) realloc(reply, sizeof(char) * (length + n + 1));
+					memcpy(reply + length, buffer, n + 1);
+					length += n;
+					free(buffer);
+					buffer = NULL;
+				}
+
+				n = asprintf(&buffer, "%c%s%c%s%c%d", GPC_USERS_SEPARATOR, e.username, GPC_DATA_SEPARATOR, e.ip_network, GPC_DATA_SEPARATOR, e.port);
+
+				if (length + n <= GPC_FILE_MAX_BYTES) {
+				    reply = (char *) realloc(reply, sizeof(char) * (length + n + 1));
+					memcpy(reply + length, buffer, n + 1);
+					length += n;
+					n_users++;
+				}
+
+				free(buffer);
+				buffer = NULL;
+				free(e.username);
+				e.username = NULL;
+				free(e.ip_network);
+				e.ip_network = NULL;
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&s->mutex);
+	GPC_writeFrame(client_fd, GCP_SWARM_TYPE, GCP_HAS_LIST_HEADER, reply, strlen(reply));
+
+	asprintf(&buffer, PETITION_WHO_HAS_MSG, username, md5sum, n_users);
+	pthread_mutex_lock(s->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->mutex_print);
+	free(buffer);
+	buffer = NULL;
+	free(reply);
+	reply = NULL;
+	free(md5sum);
+	md5sum = NULL;
+	free(username);
+	username = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Receives a file that a son uploads to the blob cache
+*           (BLOB_PUT petition, data user&hash&size&filename&codec). The
+*           file is checked with its hash before it is added.
+* @Params: in/out: s = instance of Server
+*          in: data = data of the BLOB_PUT frame
+*          in: client_fd = file descriptor of the client
+* @Return: ----
+*********************************************************************/
+void answerBlobPut(Server *s, char *data, int client_fd) {
+	DataPlane dp;
+	FileWriter writer;
+	WritePolicy policy;
+	char *username = NULL;
+	char *md5sum = NULL;
+	char *filename = NULL;
+	char *path = NULL;
+	char *buffer = NULL;
+	long long size = 0;
+	char codec = CODEC_NONE;
+	char error = 1;
+	int pos = 0;
+
+	username = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	md5sum = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	size = atoll(buffer);
+	free(buffer);
+	buffer = NULL;
+	filename = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	codec = GPC_parseCodec(buffer);
+	free(buffer);
+	buffer = NULL;
+
+	if ((NULL != s->blobs) && (BLOBCACHE_FOUND == BLOBCACHE_lookup(s->blobs, md5sum, NULL, NULL))) {
+	    // already uploaded, nothing to transfer
+		GPC_writeFrame(client_fd, GCP_BLOB_TYPE, GCP_BLOB_OK_HEADER, NULL, 0);
+		error = 0;
+	} else if ((NULL != s->blobs) && BLOBCACHE_checkNames(md5sum, filename) && (0 < size) && (size <= s->blobs->capacity)) {
+	    // the son is told which codec to use, like in FILE_SEND
+		GPC_writeFrame(client_fd, GCP_BLOB_TYPE, GCP_BLOB_OK_HEADER, GPC_getCodecName(codec), strlen(GPC_getCodecName(codec)));
+		path = BLOBCACHE_getUploadPath(s->blobs);
+		policy.durability = DURABILITY_NONE;
+		policy.sync_bytes = 0;
+		policy.local_delivery = DELIVERY_CLONE;
+
+		if (FILEWRITER_OK == FILEWRITER_open(&writer, path, size, &policy)) {
+		    DATAPLANE_init(&dp, client_fd, CODEC_NONE, NULL);
+			error = (DATAPLANE_KO == DATAPLANE_receiveFile(&dp, &writer, size));
+			error = (FILEWRITER_KO == FILEWRITER_close(&writer)) || error;
+		}
+
+		if (!error) {
+		    buffer = TREEHASH_getFileHash(path, md5sum, s->mutex_print);
+			error = (NULL == buffer) || (0 != strcmp(buffer, md5sum)) || (BLOBCACHE_KO == BLOBCACHE_add(s->blobs, path, md5sum, filename, size));
+		}
+
+		if (error) {
+		    unlink(path);
+		}
+
+		// result of the upload
+		GPC_writeFrame(client_fd, GCP_BLOB_TYPE, error ? GCP_BLOB_KO_HEADER : GCP_BLOB_OK_HEADER, NULL, 0);
+	} else {
+	    GPC_writeFrame(client_fd, GCP_BLOB_TYPE, GCP_BLOB_KO_HEADER, NULL, 0);
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	if (error) {
+	    asprintf(&buffer, BLOB_REFUSED_MSG, username, filename);
+	} else {
+	    asprintf(&buffer, BLOB_UPLOADED_MSG, username, md5sum, size);
+	}
+
+	pthread_mutex_lock(s->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->mutex_print);
+
+	// free memory
+	free(buffer);
+	buffer = NULL;
+
+	if (NULL != path) {
+	    free(path);
+		path = NULL;
+	}
+
+	free(filename);
+	filename = NULL;
+	free(md5sum);
+	md5sum = NULL;
+	free(username);
+	username = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Sends a range of a blob to a son (BLOB_GET petition, data
+*           user&hash&offset&length). After BLOB_OK the range goes raw
+*           through the socket with sendfile, without copying it
+*           through Arda.
+* @Params: in/out: s = instance of Server
+*          in: data = data of the BLOB_GET frame
+*          in: client_fd = file descriptor of the client
+* @Return: ----
+*********************************************************************/
+void answerBlobGet(Server *s, char *data, int client_fd) {
+	char *username = NULL;
+	char *md5sum = NULL;
+	char *buffer = NULL;
+	long long offset = 0, length = 0, size = 0, sent = 0;
+	off_t position = 0;
+	ssize_t n = 0;
+	int fd_blob = FD_NOT_FOUND;
+	int pos = 0;
+
+	username = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	md5sum = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	offset = atoll(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(data, GPC_DATA_SEPARATOR, &pos);
+	length = atoll(buffer);
+	free(buffer);
+	buffer = NULL;
+
+	if (NULL != s->blobs) {
+	    fd_blob = BLOBCACHE_open(s->blobs, md5sum, &size);
+	}
+
+	if ((FD_NOT_FOUND == fd_blob) || (offset < 0) || (length <= 0) || (offset + length > size)) {
+	    GPC_writeFrame(client_fd, GCP_BLOB_TYPE, GCP_BLOB_KO_HEADER, NULL, 0);
+	} else if (GCP_WRITE_KO != GPC_writeFrame(client_fd, GCP_BLOB_TYPE, GCP_BLOB_OK_HEADER, NULL, 0)) {
+	    position = (off_t) offset;
+
+		while (sent < length) {
+		    n = sendfile(client_fd, fd_blob, &position, (size_t) (length - sent));
+
+			if (n <= 0) {
+			    break;
+			}
+
+			sent += n;
+		}
+
+		asprintf(&buffer, BLOB_SENT_MSG, sent, md5sum, username);
+		pthread_mutex_lock(s->mutex_print);
+		printMsg(buffer);
+		pthread_mutex_unlock(s->mutex_print);
+		free(buffer);
+		buffer = NULL;
+	}
+
+	if (FD_NOT_FOUND != fd_blob) {
+	    close(fd_blob);
+	}
+
+	free(md5sum);
+	md5sum = NULL;
+	free(username);
+	username = NULL;
+}
+
 /*********************************************************************
 * @Purpose: Sends Exit Petition reply.
 * @Params: in/out: server = instance of Server
@@ -200,6 +634,7 @@ void answerExitPetition(Server *s, char **data, int client_fd) {
 	int found = 0;
 
 	// data is the username
+	removeInventory(s, *data);
 	asprintf(&buffer, PETITION_EXIT_MSG, *data);
 	pthread_mutex_lock(s->mutex_print);
 	printMsg(buffer);
@@ -297,6 +732,40 @@ void *ardaClient(void *args) {
                 answerListPetition(s, &data, client_fd);
                 break;
             
+            // Inventory of a son or search of a content
+            case GCP_SWARM_TYPE:
+                if ((NULL != header) && (NULL != data) && (0 == strcmp(header, GCP_WHO_HAS_HEADER))) {
+                    answerWhoHas(s, data, client_fd);
+                } else if ((NULL != header) && (NULL != data)) {
+                    answerInventory(s, header, data);
+                }
+
+                break;
+
+            // Upload or download of a blob (one per connection)
+            case GCP_BLOB_TYPE:
+                if ((NULL != header) && (NULL != data) && (0 == strcmp(header, GCP_BLOB_PUT_HEADER))) {
+                    answerBlobPut(s, data, client_fd);
+                } else if ((NULL != header) && (NULL != data) && (0 == strcmp(header, GCP_BLOB_GET_HEADER))) {
+                    answerBlobGet(s, data, client_fd);
+                }
+
+				if (NULL != data) {
+				    free(data);
+					data = NULL;
+				}
+				if (NULL != header) {
+				    free(header);
+					header = NULL;
+				}
+				close(client_fd);
+				pthread_mutex_lock(&s->mutex);
+				(s->n_clients)--;
+				s->thread[index_thread].terminated = 1;
+				pthread_mutex_unlock(&s->mutex);
+				pthread_detach(pthread_self());
+                return NULL;
+
             // New message has been sent
             case GCP_COUNT_TYPE:
 				pthread_mutex_lock(&s->n_msg_mutex);
@@ -358,9 +827,9 @@ char answerSendMsg(ServerIluvatar *s, char **data) {
 	// Reply message petition
 	if (message != NULL && s->server->clients.error == LIST_NO_ERROR) {
 		// Send the OK frame
-		GPC_writeFrame(s->server->client_fd, GCP_SEND_MSG_TYPE, GPC_HEADER_MSGOK, NULL, 0);
+		GPC_writeFrame(s->client_fd, GCP_SEND_MSG_TYPE, GPC_HEADER_MSGOK, NULL, 0);
 		// Print the message
-		asprintf(&buffer, MSG_RECIEVED_MSG, origin_user, s->server->client_ip, message);
+		asprintf(&buffer, MSG_RECIEVED_MSG, origin_user, s->client_ip, message);
 		pthread_mutex_lock(s->server->mutex_print);
 		printMsg(buffer);
 		pthread_mutex_unlock(s->server->mutex_print);
@@ -368,7 +837,7 @@ char answerSendMsg(ServerIluvatar *s, char **data) {
 		buffer = NULL;
 	} else {
 		// Send the KO frame
-		GPC_writeFrame(s->server->client_fd, GCP_SEND_MSG_TYPE, GPC_HEADER_MSGKO, NULL, 0);
+		GPC_writeFrame(s->client_fd, GCP_SEND_MSG_TYPE, GPC_HEADER_MSGKO, NULL, 0);
 		
 		// free memory
 		if (origin_user != NULL) {
@@ -399,104 +868,664 @@ char answerSendMsg(ServerIluvatar *s, char **data) {
 }
 
 /*********************************************************************
-* @Purpose: Receives the file and sends a reply.
+* @Purpose: Compares the MD5SUM of a received file with the original
+*           one, sends the reply and frees the file information.
 * @Params: in/out: server = instance of ServerIluvatar
-*          in/out: data = string with data from send file initial frame
-* @Return: ----
+*          in/out: received_md5sum = MD5SUM of the received file (can
+*                  be NULL if the file could not be received)
+*          in/out: md5sum = MD5SUM sent by the origin user
+*          in/out: origin_user = user who sends the file
+*          in/out: filename = name of the received file
+*          in: ranges = wrong byte ranges sent with the KO frame (can
+*              be NULL)
+* @Return: Returns 1 if the file is correct, otherwise 0.
 *********************************************************************/
-char answerSendFile(ServerIluvatar *s, char **data) {
+char replyFileCheck(ServerIluvatar *s, char **received_md5sum, char **md5sum, char **origin_user, char **filename, char *ranges) {
 	char *buffer = NULL;
-	char *filename = NULL;
-	char *md5sum = NULL;
-	char *path = NULL;
-	char *origin_user = NULL;
-	char *header = NULL;
-	char type = GCP_UNKNOWN_TYPE;
-	int file_size = 0;
-	int file_fd = -1;
-
-	// parsing the file information
-	GPC_parseSendFileInfo(*data, &origin_user, &filename, &file_size, &md5sum);
-	free(*data);
-	*data = NULL;
-	// create file to copy received file
-	asprintf(&path, ".%s/%s", s->iluvatar->directory, filename);
-	file_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-			
-	while (file_size > GPC_FILE_MAX_BYTES) {
-		// Read the frame
-		GPC_readFrame(s->server->client_fd, &type, &header, &buffer);
-		write(file_fd, buffer, GPC_FILE_MAX_BYTES);
-
-		// free memory
-		if (buffer != NULL) {
-		    free(buffer);
-			buffer = NULL;
-		}
-
-		free(header);
-		header = NULL;
-		// next fragment
-		file_size -= GPC_FILE_MAX_BYTES;
-	}
-
-	// Read the last frame
-	GPC_readFrame(s->server->client_fd, &type, &header, &buffer);
-	write(file_fd, buffer, file_size);
-		
-	// free memory
-	if (buffer != NULL) {
-	    free(buffer);
-		buffer = NULL;
-	}
+	char ok = 0;
 
-	free(header);
-	header = NULL;
-	// close file
-	close(file_fd);
-	// check the md5sum
-	buffer = SHAREDFUNCTIONS_getMD5Sum(path);
-	free(path);
-	path = NULL;
-			
-	if (strcmp(buffer, md5sum) == 0) {
+	if ((NULL != *received_md5sum) && (strcmp(*received_md5sum, *md5sum) == 0)) {
+		// remember the content for future transfers
+		FILEINDEX_add(s->iluvatar->directory, *filename, *md5sum);
 		// Send OK frame
-		GPC_writeFrame(s->server->client_fd, GCP_SEND_FILE_TYPE, GPC_SEND_FILE_HEADER_OK_OUT, NULL, 0);
-		free(buffer);
-		buffer = NULL;
+		GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GPC_SEND_FILE_HEADER_OK_OUT, NULL, 0);
 		// Print the message
-		asprintf(&buffer, FILE_RECIEVED_MSG, origin_user, s->server->client_ip, filename);
+		asprintf(&buffer, FILE_RECIEVED_MSG, *origin_user, s->client_ip, *filename);
 		pthread_mutex_lock(s->server->mutex_print);
 		printMsg(buffer);
 		pthread_mutex_unlock(s->server->mutex_print);
 		free(buffer);
 		buffer = NULL;
+		ok = 1;
 	} else {
 		// Send KO frame
-		GPC_writeFrame(s->server->client_fd, GCP_SEND_FILE_TYPE, GPC_SEND_FILE_HEADER_KO_OUT, NULL, 0);
-		// free memory
-		free(buffer);
-		buffer = NULL;
-		free(md5sum);
-		md5sum = NULL;
-		free(origin_user);
-		origin_user = NULL;
-		free(filename);
-		filename = NULL;
-		return (0);
+		GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GPC_SEND_FILE_HEADER_KO_OUT, ranges, (NULL == ranges) ? 0 : strlen(ranges));
 	}
-			
+
 	// free memory
-	free(buffer);
-	buffer = NULL;
-	free(md5sum);
-	md5sum = NULL;
-	free(origin_user);
-	origin_user = NULL;
-	free(filename);
-	filename = NULL;
+	if (NULL != *received_md5sum) {
+	    free(*received_md5sum);
+		*received_md5sum = NULL;
+	}
 
-	return (1);
+	free(*md5sum);
+	*md5sum = NULL;
+	free(*origin_user);
+	*origin_user = NULL;
+	free(*filename);
+	*filename = NULL;
+
+	return (ok);
+}
+
+/*********************************************************************
+* @Purpose: Receives the new version of a file as a delta against the
+*           current copy. The new version is built in a temporary file
+*           that only replaces the current copy if it is correct.
+* @Params: in/out: server = instance of ServerIluvatar
+*          in: path = path of the current copy of the file
+*          in: filename = name of the file
+*          in: block_size = size of the blocks of the signatures sent
+*          in: file_size = size of the new version
+*          in: md5sum_origin = MD5SUM sent by the origin user
+* @Return: Returns the MD5SUM of the new version, or NULL if it could
+*          not be received.
+*********************************************************************/
+char * receiveFileDelta(ServerIluvatar *s, char *path, char *filename, int block_size, long long file_size, char *md5sum_origin) {
+	char *tmp_path = NULL;
+	char *md5sum = NULL;
+
+	tmp_path = FILEINDEX_getTmpPath(s->iluvatar->directory, filename);
+
+	if (DELTA_OK == DELTA_receiveDelta(s->client_fd, path, tmp_path, block_size, file_size, &s->iluvatar->write_policy)) {
+	    md5sum = TREEHASH_getFileHash(tmp_path, md5sum_origin, s->server->mutex_print);
+	}
+
+	// keep the new version only if it is correct
+	if ((NULL == md5sum) || (0 != strcmp(md5sum, md5sum_origin)) || (0 != rename(tmp_path, path))) {
+	    unlink(tmp_path);
+	}
+
+	free(tmp_path);
+	tmp_path = NULL;
+	return (md5sum);
+}
+
+/*********************************************************************
+* @Purpose: Hashes a file received as a tree and, if it is wrong, finds
+*           the ranges whose leaves are different from the sent ones.
+* @Params: in: path = path of the received file
+*          in: sent = leaves sent by the origin user
+*          in: file_size = size of the file
+*          in: md5sum_origin = root sent by the origin user
+*          out: ranges = wrong byte ranges (NULL if the file is correct)
+* @Return: Returns the root of the received file, or NULL if it could
+*          not be computed.
+*********************************************************************/
+char * checkReceivedTree(char *path, TreeHash *sent, long long file_size, char *md5sum_origin, char **ranges) {
+	TreeHash received;
+	char *md5sum = NULL;
+	int fd_file = open(path, O_RDONLY);
+
+	if ((0 <= fd_file) && (TREEHASH_OK == TREEHASH_compute(&received, fd_file, file_size))) {
+	    md5sum = TREEHASH_getRoot(&received);
+
+		if (0 != strcmp(md5sum, md5sum_origin)) {
+		    *ranges = TREEHASH_getBadRanges(sent, &received, file_size);
+		}
+
+		TREEHASH_free(&received);
+	}
+
+	if (0 <= fd_file) {
+	    close(fd_file);
+	}
+
+	return (md5sum);
+}
+
+/*********************************************************************
+* @Purpose: Receives the file and sends a reply.
+* @Params: in/out: server = instance of ServerIluvatar
+*          in/out: data = string with data from send file initial frame
+* @Return: ----
+*********************************************************************/
+char answerSendFile(ServerIluvatar *s, char **data) {
+	DataPlane dp;
+	FileWriter writer;
+	char *buffer = NULL;
+	char *filename = NULL;
+	char *md5sum = NULL;
+	char *path = NULL;
+	char *origin_user = NULL;
+	struct stat st;
+	long long file_size = 0;
+	int block_size = 0;
+	char codec = CODEC_NONE;
+	char error = DATAPLANE_OK;
+	char *ranges = NULL;
+	TreeHash sent;
+
+	sent.leaves = NULL;
+	sent.n_leaves = 0;
+
+	// parsing the file information
+	GPC_parseSendFileInfo(*data, &origin_user, &filename, &file_size, &md5sum, &codec);
+	free(*data);
+	*data = NULL;
+
+	// names that would leave the directory are rejected before anything is written
+	if (!SHAREDFUNCTIONS_createFileDirectories(s->iluvatar->directory, filename)) {
+	    return (replyFileCheck(s, &buffer, &md5sum, &origin_user, &filename, NULL));
+	}
+
+	// check if the content is already in the directory
+	if (FILEINDEX_FOUND == FILEINDEX_materialize(s->iluvatar->directory, md5sum, file_size, filename)) {
+	    GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_HAVE_HEADER, NULL, 0);
+		// Print the message
+		asprintf(&buffer, FILE_DEDUPLICATED_MSG, origin_user, filename);
+		pthread_mutex_lock(s->server->mutex_print);
+		printMsg(buffer);
+		pthread_mutex_unlock(s->server->mutex_print);
+		// free memory
+		free(buffer);
+		buffer = NULL;
+		free(md5sum);
+		md5sum = NULL;
+		free(origin_user);
+		origin_user = NULL;
+		free(filename);
+		filename = NULL;
+		return (1);
+	}
+
+	asprintf(&path, ".%s/%s", s->iluvatar->directory, filename);
+	// the data is compressed if both sides want it
+	codec = (CODEC_NONE == s->iluvatar->codec) ? CODEC_NONE : codec;
+
+	// an older version of the file can be used to receive only the differences
+	if ((0 == stat(path, &st)) && S_ISREG(st.st_mode) && (DELTA_MIN_FILE_SIZE <= st.st_size) &&
+	    (DELTA_OK == DELTA_sendSignatures(s->client_fd, path, codec, &block_size))) {
+		buffer = receiveFileDelta(s, path, filename, block_size, file_size, md5sum);
+		free(path);
+		path = NULL;
+		return (replyFileCheck(s, &buffer, &md5sum, &origin_user, &filename, NULL));
+	}
+
+	// create file to copy received file (a previous file with the same name may be a hardlink)
+	unlink(path);
+
+	if (FILEWRITER_KO == FILEWRITER_open(&writer, path, file_size, &s->iluvatar->write_policy)) {
+	    // the file is refused before any data is sent (e.g. not enough space)
+		free(path);
+		path = NULL;
+		return (replyFileCheck(s, &buffer, &md5sum, &origin_user, &filename, NULL));
+	}
+
+	// ask for the data
+	GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_SEND_HEADER, GPC_getCodecName(codec), strlen(GPC_getCodecName(codec)));
+	DATAPLANE_init(&dp, s->client_fd, CODEC_NONE, NULL);
+	error = DATAPLANE_receiveFile(&dp, &writer, file_size);
+
+	// a file hashed as a tree is followed by the leaves of the sender
+	if ((DATAPLANE_OK == error) && TREEHASH_isTree(md5sum) && (TREEHASH_KO == TREEHASH_readLeaves(s->client_fd, &sent, file_size))) {
+	    error = DATAPLANE_KO;
+	}
+
+	// check the md5sum once all the data is in the file
+	if ((FILEWRITER_OK == FILEWRITER_close(&writer)) && (DATAPLANE_OK == error)) {
+	    buffer = (0 < sent.n_leaves) ? checkReceivedTree(path, &sent, file_size, md5sum, &ranges) : TREEHASH_getFileHash(path, md5sum, s->server->mutex_print);
+	}
+
+	free(path);
+	path = NULL;
+	TREEHASH_free(&sent);
+	error = replyFileCheck(s, &buffer, &md5sum, &origin_user, &filename, ranges);
+
+	if (NULL != ranges) {
+	    free(ranges);
+		ranges = NULL;
+	}
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Reads the manifest of a batch of files.
+* @Params: in: fd_socket = socket connected to the sender
+*          in/out: files = array to store the files of the batch
+*          in: n_files = number of files of the batch
+* @Return: Returns 1 if the manifest was received, otherwise 0.
+*********************************************************************/
+char readBatchManifest(int fd_socket, BatchFile *files, int n_files) {
+	char *header = NULL;
+	char *data = NULL;
+	char *entry = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	int n = 0, i = 0;
+
+	while (n < n_files) {
+	    if ((0 == GPC_readFrame(fd_socket, &type, &header, &data)) || (NULL == data) ||
+		    (0 != strcmp(header, GCP_BATCH_LIST_HEADER))) {
+		    if (NULL != header) {
+			    free(header);
+				header = NULL;
+			}
+
+			if (NULL != data) {
+			    free(data);
+				data = NULL;
+			}
+
+			return (0);
+		}
+
+		// entries are separated by '#'
+		i = 0;
+
+		while ((i < (int) strlen(data)) && (n < n_files)) {
+		    entry = SHAREDFUNCTIONS_splitString(data, GPC_USERS_SEPARATOR, &i);
+			GPC_parseBatchEntry(entry, &files[n]);
+			free(entry);
+			entry = NULL;
+			n++;
+		}
+
+		free(header);
+		header = NULL;
+		free(data);
+		data = NULL;
+	}
+
+	return (1);
+}
+
+/*********************************************************************
+* @Purpose: Receives a batch of files through a single connection and
+*           sends the result of every file.
+* @Params: in/out: server = instance of ServerIluvatar
+*          in/out: data = string with data from new batch frame
+* @Return: Returns 1 if all the files are correct, otherwise 0.
+*********************************************************************/
+char answerSendBatch(ServerIluvatar *s, char **data) {
+	BatchFile *files = NULL;
+	DataPlane dp;
+	FileWriter writer;
+	FileIndex index;
+	char *origin_user = NULL;
+	char *buffer = NULL;
+	char *header = NULL;
+	char *path = NULL;
+	char *need = NULL;
+	char *result = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	int n_files = 0, n_present = 0, n_ok = 0;
+	int i = 0, j = 0;
+	char codec = CODEC_NONE, has_codec = 0;
+
+	// data is in the format: originUser + GPC_DATA_SEPARATOR + n_files [+ GPC_DATA_SEPARATOR + codec]
+	origin_user = SHAREDFUNCTIONS_splitString(*data, GPC_DATA_SEPARATOR, &i);
+	buffer = SHAREDFUNCTIONS_splitString(*data, GPC_DATA_SEPARATOR, &i);
+	n_files = atoi(buffer);
+	free(buffer);
+	buffer = NULL;
+	buffer = SHAREDFUNCTIONS_splitString(*data, GPC_DATA_SEPARATOR, &i);
+	has_codec = ('\0' != buffer[0]);
+	codec = (CODEC_NONE == s->iluvatar->codec) ? CODEC_NONE : GPC_parseCodec(buffer);
+	free(buffer);
+	buffer = NULL;
+	free(*data);
+	*data = NULL;
+
+	if (n_files <= 0) {
+	    free(origin_user);
+		origin_user = NULL;
+		return (0);
+	}
+
+	files = (BatchFile *) calloc(n_files, sizeof(BatchFile));
+	need = (char *) malloc(sizeof(char) * n_files);
+	result = (char *) malloc(sizeof(char) * n_files);
+	memset(need, GPC_BATCH_NO, n_files);
+	memset(result, GPC_BATCH_NO, n_files);
+
+	if (readBatchManifest(s->client_fd, files, n_files)) {
+		// check which contents are already in the directory (the index is loaded only once)
+		index = FILEINDEX_open(s->iluvatar->directory, FILEINDEX_NO_REFRESH);
+
+		for (i = 0; i < n_files; i++) {
+			// names that would leave the directory are rejected
+			if (!SHAREDFUNCTIONS_createFileDirectories(s->iluvatar->directory, files[i].filename)) {
+			    free(files[i].filename);
+				files[i].filename = NULL;
+			    continue;
+			}
+
+			if (FILEINDEX_FOUND == FILEINDEX_materializeIn(&index, s->iluvatar->directory, files[i].md5sum, files[i].file_size, files[i].filename)) {
+			    result[i] = GPC_BATCH_YES;
+				n_present++;
+			} else {
+			    need[i] = GPC_BATCH_YES;
+
+				// a content repeated in the batch is only transferred once
+				for (j = 0; (j < i) && (GPC_BATCH_YES == need[i]); j++) {
+				    if ((GPC_BATCH_YES == need[j]) && (files[j].file_size == files[i].file_size) && (0 == strcmp(files[j].md5sum, files[i].md5sum))) {
+					    need[i] = GPC_BATCH_NO;
+					}
+				}
+			}
+		}
+
+		FILEINDEX_close(s->iluvatar->directory, &index);
+
+		// a sender that offers a codec is told whether it can compress the data
+		if (has_codec) {
+		    GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_SEND_HEADER, GPC_getCodecName(codec), strlen(GPC_getCodecName(codec)));
+		}
+
+		GPC_writeBatchFlags(s->client_fd, GCP_BATCH_NEED_HEADER, need, n_files);
+
+		// receive the needed files until the end of the batch
+		DATAPLANE_init(&dp, s->client_fd, CODEC_NONE, NULL);
+
+		while ((0 != GPC_readFrame(s->client_fd, &type, &header, &buffer)) &&
+		       (0 != strcmp(header, GCP_BATCH_END_HEADER)) && (NULL != buffer)) {
+			i = atoi(buffer);
+			free(buffer);
+			buffer = NULL;
+			free(header);
+			header = NULL;
+
+			if ((i < 0) || (i >= n_files) || (GPC_BATCH_YES != need[i])) {
+			    break;
+			}
+
+			// a previous file with the same name may be a hardlink
+			asprintf(&path, ".%s/%s", s->iluvatar->directory, files[i].filename);
+			unlink(path);
+
+			if (FILEWRITER_KO == FILEWRITER_open(&writer, path, files[i].file_size, &s->iluvatar->write_policy)) {
+			    free(path);
+				path = NULL;
+				break;
+			}
+
+			if (DATAPLANE_KO == DATAPLANE_receiveFile(&dp, &writer, files[i].file_size)) {
+			    FILEWRITER_close(&writer);
+				free(path);
+				path = NULL;
+				break;
+			}
+
+			if (FILEWRITER_OK == FILEWRITER_close(&writer)) {
+			    buffer = TREEHASH_getFileHash(path, files[i].md5sum, s->server->mutex_print);
+			}
+
+			if ((NULL != buffer) && (0 == strcmp(buffer, files[i].md5sum))) {
+			    result[i] = GPC_BATCH_YES;
+			}
+
+			if (NULL != buffer) {
+			    free(buffer);
+				buffer = NULL;
+			}
+
+			free(path);
+			path = NULL;
+		}
+
+		// remember the received contents for future transfers
+		index = FILEINDEX_open(s->iluvatar->directory, FILEINDEX_NO_REFRESH);
+
+		for (i = 0; i < n_files; i++) {
+		    if ((GPC_BATCH_YES == result[i]) && (GPC_BATCH_YES == need[i])) {
+			    FILEINDEX_addIn(&index, s->iluvatar->directory, files[i].filename, files[i].md5sum);
+			}
+		}
+
+		// repeated contents are copied from the received ones
+		for (i = 0; i < n_files; i++) {
+		    if ((GPC_BATCH_NO == result[i]) && (GPC_BATCH_NO == need[i]) && (NULL != files[i].filename) &&
+			    (FILEINDEX_FOUND == FILEINDEX_materializeIn(&index, s->iluvatar->directory, files[i].md5sum, files[i].file_size, files[i].filename))) {
+				result[i] = GPC_BATCH_YES;
+				n_present++;
+			}
+		}
+
+		FILEINDEX_close(s->iluvatar->directory, &index);
+		GPC_writeBatchFlags(s->client_fd, GCP_BATCH_RESULT_HEADER, result, n_files);
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	for (i = 0; i < n_files; i++) {
+	    if (GPC_BATCH_YES == result[i]) {
+		    n_ok++;
+		}
+
+		if (NULL != files[i].filename) {
+		    free(files[i].filename);
+			files[i].filename = NULL;
+		}
+
+		if (NULL != files[i].md5sum) {
+		    free(files[i].md5sum);
+			files[i].md5sum = NULL;
+		}
+	}
+
+	// Print the message
+	asprintf(&buffer, BATCH_RECIEVED_MSG, origin_user, s->client_ip, n_ok, n_present);
+	pthread_mutex_lock(s->server->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->server->mutex_print);
+
+	// free memory
+	free(buffer);
+	buffer = NULL;
+	free(origin_user);
+	origin_user = NULL;
+	free(files);
+	files = NULL;
+	free(need);
+	need = NULL;
+	free(result);
+	result = NULL;
+
+	return (n_ok == n_files);
+}
+
+/*********************************************************************
+* @Purpose: Sends a range of a file of the directory to a son that is
+*           downloading it from several sons (GET_RANGE petition).
+* @Params: in/out: server = instance of ServerIluvatar
+*          in/out: data = string with data from get range frame
+* @Return: Returns 0 (the command line is not reopened).
+*********************************************************************/
+char answerGetRange(ServerIluvatar *s, char **data) {
+	DataPlane dp;
+	char *origin_user = NULL;
+	char *md5sum = NULL;
+	char *path = NULL;
+	long long offset = 0, length = 0, file_size = 0;
+	char codec = CODEC_NONE;
+	int fd_file = FD_NOT_FOUND;
+
+	GPC_parseRangeRequest(*data, &origin_user, &md5sum, &offset, &length, &codec);
+	free(*data);
+	*data = NULL;
+	path = FILEINDEX_findPath(s->iluvatar->directory, md5sum, &file_size);
+
+	// the range must be inside a file that has not changed since it was published
+	if ((NULL == path) || (offset < 0) || (length <= 0) || (offset + length > file_size) || (FD_NOT_FOUND == (fd_file = open(path, O_RDONLY)))) {
+	    GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_RANGE_KO_HEADER, NULL, 0);
+	} else if (GCP_WRITE_KO != GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_RANGE_OK_HEADER, NULL, 0)) {
+	    // compressed if both sides want it
+		codec = (CODEC_NONE == s->iluvatar->codec) ? CODEC_NONE : codec;
+		DATAPLANE_init(&dp, s->client_fd, codec, NULL);
+
+		if (DATAPLANE_OK == DATAPLANE_sendRange(&dp, fd_file, file_size, offset, length)) {
+		    DATAPLANE_drain(&dp);
+		}
+
+		DATAPLANE_free(&dp);
+	}
+
+	if (FD_NOT_FOUND != fd_file) {
+	    close(fd_file);
+	}
+
+	if (NULL != path) {
+	    free(path);
+		path = NULL;
+	}
+
+	free(md5sum);
+	md5sum = NULL;
+	free(origin_user);
+	origin_user = NULL;
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Deletes the files of a SYNC_DELETE frame (only the ones in
+*           the synchronized subdirectory).
+* @Params: in/out: server = instance of ServerIluvatar
+*          in: subdir = synchronized subdirectory
+*          in: names = string with the names separated by
+*              GPC_USERS_SEPARATOR
+* @Return: Returns the number of deleted files.
+*********************************************************************/
+int deleteSyncFiles(ServerIluvatar *s, char *subdir, char *names) {
+	char *filename = NULL;
+	char *path = NULL;
+	int i = 0, n_deleted = 0;
+	size_t length = strlen(subdir);
+
+	while ('\0' != names[i]) {
+	    filename = SHAREDFUNCTIONS_splitString(names, GPC_USERS_SEPARATOR, &i);
+
+		if (SHAREDFUNCTIONS_isInsideDirectory(filename) && (0 == strncmp(filename, subdir, length)) && ('/' == filename[length])) {
+		    asprintf(&path, ".%s/%s", s->iluvatar->directory, filename);
+
+			if (0 == unlink(path)) {
+			    n_deleted++;
+			}
+
+			free(path);
+			path = NULL;
+		}
+
+		free(filename);
+		filename = NULL;
+	}
+
+	return (n_deleted);
+}
+
+/*********************************************************************
+* @Purpose: Answers a sync petition. The connection stays open while
+*           the sender keeps the subdirectory synchronized: it sends a
+*           batch (NEW_BATCH) with the created or modified files and a
+*           SYNC_DELETE frame with the deleted ones, until it closes it.
+* @Params: in/out: server = instance of ServerIluvatar
+*          in/out: data = string with data from sync start frame
+* @Return: Returns 1 if the sync has been accepted, otherwise 0.
+*********************************************************************/
+char answerSync(ServerIluvatar *s, char **data) {
+	char *origin_user = NULL;
+	char *subdir = NULL;
+	char *header = NULL;
+	char *buffer = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	int i = 0;
+
+	// data is in the format: originUser + GPC_DATA_SEPARATOR + subdir
+	origin_user = SHAREDFUNCTIONS_splitString(*data, GPC_DATA_SEPARATOR, &i);
+	subdir = SHAREDFUNCTIONS_splitString(*data, GPC_DATA_SEPARATOR, &i);
+	free(*data);
+	*data = NULL;
+
+	// the subdirectory must be inside the directory
+	if (('\0' == subdir[0]) || !SHAREDFUNCTIONS_isInsideDirectory(subdir)) {
+	    GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_SYNC_KO_HEADER, NULL, 0);
+		free(subdir);
+		subdir = NULL;
+		free(origin_user);
+		origin_user = NULL;
+		return (0);
+	}
+
+	GPC_writeFrame(s->client_fd, GCP_SEND_FILE_TYPE, GCP_SYNC_OK_HEADER, NULL, 0);
+	asprintf(&buffer, SYNC_STARTED_MSG, origin_user, s->client_ip, subdir);
+	pthread_mutex_lock(s->server->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->server->mutex_print);
+	free(buffer);
+	buffer = NULL;
+
+	while ((0 != GPC_readFrame(s->client_fd, &type, &header, &buffer)) && (GCP_SEND_FILE_TYPE == type) && (NULL != buffer)) {
+	    if (0 == strcmp(header, GCP_SEND_BATCH_HEADER)) {
+		    answerSendBatch(s, &buffer);
+		} else if (0 == strcmp(header, GCP_SYNC_DELETE_HEADER)) {
+		    i = deleteSyncFiles(s, subdir, buffer);
+			free(buffer);
+			buffer = NULL;
+			asprintf(&buffer, SYNC_DELETED_MSG, subdir, origin_user, s->client_ip, i);
+			pthread_mutex_lock(s->server->mutex_print);
+			printMsg(buffer);
+			pthread_mutex_unlock(s->server->mutex_print);
+			free(buffer);
+			buffer = NULL;
+		} else {
+		    break;
+		}
+
+		free(header);
+		header = NULL;
+
+		// open again the command line
+		asprintf(&buffer, CMD_LINE_PROMPT, COLOR_CLI_TXT, CMD_ID_BYTE);
+		pthread_mutex_lock(s->server->mutex_print);
+		printMsg(buffer);
+		pthread_mutex_unlock(s->server->mutex_print);
+		free(buffer);
+		buffer = NULL;
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	asprintf(&buffer, SYNC_ENDED_MSG, subdir, origin_user);
+	pthread_mutex_lock(s->server->mutex_print);
+	printMsg(buffer);
+	pthread_mutex_unlock(s->server->mutex_print);
+
+	// free memory
+	free(buffer);
+	buffer = NULL;
+	free(subdir);
+	subdir = NULL;
+	free(origin_user);
+	origin_user = NULL;
+
+	return (1);
 }
 
 /*********************************************************************
@@ -506,16 +1535,21 @@ char answerSendFile(ServerIluvatar *s, char **data) {
 * @Return: ----
 *********************************************************************/
 void *iluvatarClient(void *args) {
-    ServerIluvatar *s = (ServerIluvatar *) args;
+    ServerIluvatar client = *((ServerIluvatar *) args);
+    ServerIluvatar *s = &client;
     char type = GCP_UNKNOWN_TYPE;
     char *header = NULL;
     char *data = NULL;
 	char *buffer = NULL;
 	int received_OK = 1;
+	int index_thread = s->server->n_threads - 1;
 	
+	// the connection is copied before the next client can overwrite it
+	s->client_fd = s->server->client_fd;
+	s->client_ip = s->server->client_ip;
 	pthread_mutex_unlock(&s->server->client_fd_mutex);
 	// get frame
-	GPC_readFrame(s->server->client_fd, &type, &header, &data);
+	GPC_readFrame(s->client_fd, &type, &header, &data);
 	pthread_mutex_lock(s->server->mutex_print);
 	// reset command line
 	printMsg(COLOR_DEFAULT_TXT);
@@ -529,7 +1563,16 @@ void *iluvatarClient(void *args) {
 
 		// Send file petition
 		case GCP_SEND_FILE_TYPE:
-			received_OK = answerSendFile(s, &data);
+			if ((NULL != header) && (0 == strcmp(header, GCP_SEND_BATCH_HEADER))) {
+			    received_OK = answerSendBatch(s, &data);
+			} else if ((NULL != header) && (NULL != data) && (0 == strcmp(header, GCP_GET_RANGE_HEADER))) {
+			    received_OK = answerGetRange(s, &data);
+			} else if ((NULL != header) && (NULL != data) && (0 == strcmp(header, GCP_SYNC_START_HEADER))) {
+			    received_OK = answerSync(s, &data);
+			} else {
+			    received_OK = answerSendFile(s, &data);
+			}
+
 			break;
 
 		// Unknown command
@@ -560,6 +1603,14 @@ void *iluvatarClient(void *args) {
 		buffer = NULL;
 	}
 
+	// close the connection
+	close(s->client_fd);
+	free(s->client_ip);
+	s->client_ip = NULL;
+	pthread_mutex_lock(&s->server->mutex);
+	s->server->thread[index_thread].terminated = 1;
+	pthread_mutex_unlock(&s->server->mutex);
+
     return (NULL);
 }
 
@@ -573,8 +1624,19 @@ void *iluvatarClient(void *args) {
 *********************************************************************/
 void SERVER_runArda(Arda *arda, Server *server) {
 	pthread_mutex_t mutex_print = PTHREAD_MUTEX_INITIALIZER;
+	char *buffer = NULL;
 	server->mutex_print = &mutex_print;
 
+	// the directory of Arda keeps the blobs uploaded by the sons
+	if (0 < arda->blob_cache) {
+	    server->blobs = (BlobCache *) malloc(sizeof(BlobCache));
+		BLOBCACHE_init(server->blobs, arda->directory, arda->blob_cache);
+		asprintf(&buffer, BLOB_CACHE_MSG, server->blobs->n_entries, server->blobs->used, server->blobs->capacity);
+		printMsg(buffer);
+		free(buffer);
+		buffer = NULL;
+	}
+
 	while (1) {
 		// We need a mutex to save the client_fd in the thread before it changes to the next client
 		pthread_mutex_lock(&server->client_fd_mutex);
@@ -673,7 +1735,7 @@ void SERVER_runIluvatar(IluvatarSon *iluvatarSon, Server *server, pthread_mutex_
 		}
 		pthread_mutex_lock(&server->mutex);
 		// Getting the client IP
-		server->client_ip = SERVER_getClientIP(server->client_fd);
+		server->client_ip = strdup(SERVER_getClientIP(server->client_fd));
 		if (server->n_threads > 0) {
 			// add thread to array
 			(server->n_clients)++;
@@ -732,7 +1794,25 @@ void SERVER_close(Server *server) {
     }
 
     BIDIRECTIONALLIST_destroy(&server->clients);
+
+	// inventories published by the sons
+	for (i = 0; i < server->n_inventories; i++) {
+	    freeInventoryEntries(&server->inventories[i]);
+		free(server->inventories[i].username);
+		server->inventories[i].username = NULL;
+	}
+
+	if (NULL != server->inventories) {
+	    free(server->inventories);
+		server->inventories = NULL;
+	}
 	
+	if (NULL != server->blobs) {
+	    BLOBCACHE_free(server->blobs);
+		free(server->blobs);
+		server->blobs = NULL;
+	}
+
 	// We terminate and realease the resources of the not finished threads
 	for (i = 0; i < server->n_threads; i++) {
 		if(server->thread[i].terminated != 1) {
@@ -9,12 +9,19 @@
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <pthread.h>
 
 #include "definitions.h"
 #include "sharedFunctions.h"
 #include "bidirectionallist.h"
 #include "gpc.h"
+#include "fileindex.h"
+#include "delta.h"
+#include "dataplane.h"
+#include "treehash.h"
+#include "blobcache.h"
 
 /* Messages */
 #define ERROR_BINDING_SOCKET_MSG		"ERROR: Server could not bind the server socket\n"
@@ -28,6 +35,12 @@
 #define RESPONSE_SENT_LIST_MSG          "Response sent\n\n"
 #define PETITION_UPDATE_MSG             "New petition: %s demands the user's list\nSending user's list to %s\n\n"
 #define PETITION_EXIT_MSG               "New exit petition: %s has left Arda\n"
+#define INVENTORY_MSG                   "New inventory: %s holds %d files\n\n"
+#define PETITION_WHO_HAS_MSG            "New petition: %s looks for %s\nSending %d users\n\n"
+#define BLOB_UPLOADED_MSG               "New blob: %s has uploaded %s (%lld bytes)\n\n"
+#define BLOB_REFUSED_MSG                "Blob refused: %s cannot upload %s\n\n"
+#define BLOB_SENT_MSG                   "Blob sent: %lld bytes of %s to %s\n\n"
+#define BLOB_CACHE_MSG                  "Blob cache: %d blobs, %lld of %lld bytes\n"
 
 /* Constants */
 #define BACKLOG     					10
@@ -37,6 +50,19 @@ typedef struct {
 	int terminated;
 } ThreadInfo;
 
+typedef struct {
+	char *md5sum;
+	long long size;
+	char *filename;
+} InventoryEntry;
+
+// content hashes published by a son
+typedef struct {
+	char *username;
+	InventoryEntry *entries;
+	int n_entries;
+} Inventory;
+
 typedef struct {
     int listen_fd;
 	int client_fd;
@@ -50,11 +76,16 @@ typedef struct {
 	pthread_mutex_t *mutex_print;
 	BidirectionalList clients;
 	int n_clients;
+	Inventory *inventories;
+	int n_inventories;
+	BlobCache *blobs;
 } Server;
 
 typedef struct {
     IluvatarSon *iluvatar;
 	Server *server;
+	int client_fd;
+	char *client_ip;
 } ServerIluvatar;
 
 /*********************************************************************
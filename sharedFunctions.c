@@ -4,7 +4,7 @@
 * @Authors: Claudia Lajara Silvosa
 *           Angel Garcia Gascon
 * @Date: 18/10/2022
-* @Last change: 05/01/2023
+* @Last change: 19/10/2026
 *********************************************************************/
 #include "sharedFunctions.h"
 
@@ -170,12 +170,12 @@ char * SHAREDFUNCTIONS_writeDataFieldUpdate(BidirectionalList blist) {
 	while(BIDIRECTIONALLIST_isValid(blist)) {
 		element = BIDIRECTIONALLIST_get(&blist);
 		if(flag_first) {
-			asprintf(&buffer, "%s&%s&%d&%d", element.username, element.ip_network, element.port, (int) element.pid);
+			asprintf(&buffer, "%s&%s&%d&%d&%s", element.username, element.ip_network, element.port, (int) element.pid, element.host_id);
 			// reserve memory for the data field
 			data = (char *) malloc (sizeof(char) * (strlen(buffer) + 1));
 			data[strlen(buffer)] = '\0';
 		} else{
-			asprintf(&buffer, "#%s&%s&%d&%d", element.username, element.ip_network, element.port, (int) element.pid);
+			asprintf(&buffer, "#%s&%s&%d&%d&%s", element.username, element.ip_network, element.port, (int) element.pid, element.host_id);
 			new_size = strlen(data) + strlen(buffer) + 1;
 			data = (char *) realloc (data, sizeof(char) * new_size);
 			data[new_size] = '\0';
@@ -195,36 +195,211 @@ char * SHAREDFUNCTIONS_writeDataFieldUpdate(BidirectionalList blist) {
 **********************************************************************/
 char * SHAREDFUNCTIONS_getMD5Sum(char *filename) {
 	char *md5sum = NULL;
-	int fd_pipe[2];
-	int status = 0;
-	int pid = 0;
 
-	// create pipe
-	if (pipe(fd_pipe) == -1) {
-		printMsg("ERROR: The Pipe to check the MD5SUM of the file could not be created\n");
-		return (NULL);
-	}
+	// computed in process, hashing many files must not fork md5sum for each one
+	md5sum = MD5_file(filename);
 
-	pid = fork();
-	
-	if (0 == pid) {
-		// parent process, executes md5sum linux command
-		close(fd_pipe[0]);
-		dup2(fd_pipe[1], 1);
-		execlp("md5sum", "md5sum", filename, NULL);
-		close(fd_pipe[1]);
-		exit(1);
-	} else if (pid > 0) {
-		// child process, gets md5sum from parent
-		close(fd_pipe[1]);
-		md5sum = SHAREDFUNCTIONS_readUntil(fd_pipe[0], ' ');
-		waitpid(pid, &status, 0);
-		close(fd_pipe[0]);
-	} else {
-		// error creating fork
-		printMsg("ERROR: The fork to check the MD5SUM of the file could not be created\n");
-		return (NULL);
+	if (NULL == md5sum) {
+		printMsg("ERROR: The MD5SUM of the file could not be computed\n");
 	}
 
 	return (md5sum);
 }
+
+/**********************************************************************
+* @Purpose: Checks that a filename received from another IluvatarSon
+*           stays inside the directory (not absolute and without "..").
+* @Params: in: filename = name of the file (relative to the directory)
+* @Return: Returns 1 if the filename is valid, otherwise 0.
+**********************************************************************/
+char SHAREDFUNCTIONS_isInsideDirectory(char *filename) {
+	if (('\0' == filename[0]) || ('/' == filename[0]) || (0 == strcmp(filename, "..")) ||
+	    (0 == strncmp(filename, "../", 3)) || (NULL != strstr(filename, "/../")) ||
+		((strlen(filename) >= 3) && (0 == strcmp(filename + strlen(filename) - 3, "/..")))) {
+	    return (0);
+	}
+
+	return (1);
+}
+
+/**********************************************************************
+* @Purpose: Creates the subdirectories of a received file.
+* @Params: in: directory = directory of the IluvatarSon
+*          in: filename = name of the file (relative to the directory)
+* @Return: Returns 1 if the filename is valid, otherwise 0.
+**********************************************************************/
+char SHAREDFUNCTIONS_createFileDirectories(char *directory, char *filename) {
+	char *path = NULL;
+	char *slash = NULL;
+
+	// the file must stay inside the directory
+	if (!SHAREDFUNCTIONS_isInsideDirectory(filename)) {
+	    return (0);
+	}
+
+	asprintf(&path, ".%s/%s", directory, filename);
+	slash = strchr(path + strlen(directory) + 2, '/');
+
+	while (NULL != slash) {
+	    *slash = '\0';
+		mkdir(path, 0777);
+		*slash = '/';
+		slash = strchr(slash + 1, '/');
+	}
+
+	free(path);
+	path = NULL;
+	return (1);
+}
+
+/**********************************************************************
+* @Purpose: Writes the whole buffer to a file descriptor, even if the
+*           kernel accepts it in several parts.
+* @Params: in: fd = file descriptor to write
+*          in: buffer = bytes to write
+*          in: size = number of bytes to write
+* @Return: Returns the number of bytes written (less than size only if
+*          an error occurred).
+**********************************************************************/
+int SHAREDFUNCTIONS_writeFull(int fd, char *buffer, int size) {
+	int total = 0, n = 0;
+
+	while (total < size) {
+	    n = write(fd, buffer + total, size - total);
+
+		if (n <= 0) {
+		    return (total);
+		}
+
+		total += n;
+	}
+
+	return (total);
+}
+
+/**********************************************************************
+* @Purpose: Writes all the buffers of an I/O vector to a file
+*           descriptor, even if the kernel accepts them in several
+*           parts.
+* @Params: in: fd = file descriptor to write
+*          in/out: iov = buffers to write (modified while writing)
+*          in: n_iov = number of buffers
+* @Return: Returns the number of bytes written.
+**********************************************************************/
+int SHAREDFUNCTIONS_writevFull(int fd, struct iovec *iov, int n_iov) {
+	int total = 0, n = 0;
+
+	while (n_iov > 0) {
+	    n = writev(fd, iov, n_iov);
+
+		if (n <= 0) {
+		    return (total);
+		}
+
+		total += n;
+
+		// skip the buffers already written
+		while ((n_iov > 0) && (n >= (int) iov->iov_len)) {
+		    n -= iov->iov_len;
+			iov++;
+			n_iov--;
+		}
+
+		if (n_iov > 0) {
+		    iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return (total);
+}
+
+/**********************************************************************
+* @Purpose: Gets the current time of a monotonic clock.
+* @Params: ----
+* @Return: Returns the time in microseconds.
+**********************************************************************/
+long long SHAREDFUNCTIONS_getTimeMicros() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((long long) now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+/**********************************************************************
+* @Purpose: Appends the contents of a small system file to a buffer.
+* @Params: in: path = path of the file
+*          in/out: buffer = buffer with the data read so far
+*          in: length = number of bytes already in the buffer
+*          in: size = size of the buffer
+* @Return: Returns the new number of bytes in the buffer.
+**********************************************************************/
+int appendSystemFile(char *path, char *buffer, int length, int size) {
+	int fd = open(path, O_RDONLY);
+	int n = 0;
+
+	if (fd < 0) {
+	    return (length);
+	}
+
+	// these files are read in one go, they are shorter than the buffer
+	n = read(fd, buffer + length, size - length);
+	close(fd);
+
+	return ((n > 0) ? length + n : length);
+}
+
+/**********************************************************************
+* @Purpose: Gets an identifier of this machine that is the same for all
+*           its processes until it reboots (the MD5 of its machine and
+*           boot ids, or of its hostname if they cannot be read).
+* @Params: out: host_id = buffer of HOST_ID_LENGTH + 1 bytes for the
+*               identifier
+* @Return: ----
+**********************************************************************/
+void SHAREDFUNCTIONS_getHostId(char *host_id) {
+	unsigned char digest[MD5_DIGEST_BYTES];
+	char buffer[256];
+	char *hex = NULL;
+	int length = 0;
+
+	length = appendSystemFile(MACHINE_ID_PATH, buffer, length, sizeof(buffer));
+	length = appendSystemFile(BOOT_ID_PATH, buffer, length, sizeof(buffer));
+
+	if ((0 == length) && (0 == gethostname(buffer, sizeof(buffer) - 1))) {
+	    buffer[sizeof(buffer) - 1] = '\0';
+		length = strlen(buffer);
+	}
+
+	MD5_buffer(buffer, length, digest);
+	hex = MD5_toString(digest);
+	snprintf(host_id, HOST_ID_LENGTH + 1, "%s", hex);
+	free(hex);
+	hex = NULL;
+}
+
+/**********************************************************************
+* @Purpose: Gets an identifier of a machine where only this process is
+*           (the MD5 of the one of this machine and the PID), so the
+*           other sons take it as a son of another machine.
+* @Params: out: host_id = buffer of HOST_ID_LENGTH + 1 bytes for the
+*               identifier
+* @Return: ----
+**********************************************************************/
+void SHAREDFUNCTIONS_getProcessHostId(char *host_id) {
+	unsigned char digest[MD5_DIGEST_BYTES];
+	char *buffer = NULL;
+	char *hex = NULL;
+	int length = 0;
+
+	SHAREDFUNCTIONS_getHostId(host_id);
+	length = asprintf(&buffer, "%s%d", host_id, getpid());
+	MD5_buffer(buffer, length, digest);
+	free(buffer);
+	buffer = NULL;
+	hex = MD5_toString(digest);
+	snprintf(host_id, HOST_ID_LENGTH + 1, "%s", hex);
+	free(hex);
+	hex = NULL;
+}
@@ -7,13 +7,20 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <string.h>
 
 #include "bidirectionallist.h" 
+#include "md5.h"
 
 /* Constants */
 #define READ_FILE_OK 	0
 #define READ_FILE_KO 	-1
 #define FD_NOT_FOUND 	-1
+#define MACHINE_ID_PATH	"/etc/machine-id"
+#define BOOT_ID_PATH	"/proc/sys/kernel/random/boot_id"
 
 #define printMsg(x) write(1, x, strlen(x)) 
 
@@ -77,4 +84,69 @@ char * SHAREDFUNCTIONS_writeDataFieldUpdate(BidirectionalList blist);
 **********************************************************************/
 char * SHAREDFUNCTIONS_getMD5Sum(char *filename);
 
+/**********************************************************************
+* @Purpose: Checks that a filename received from another IluvatarSon
+*           stays inside the directory (not absolute and without "..").
+* @Params: in: filename = name of the file (relative to the directory)
+* @Return: Returns 1 if the filename is valid, otherwise 0.
+**********************************************************************/
+char SHAREDFUNCTIONS_isInsideDirectory(char *filename);
+
+/**********************************************************************
+* @Purpose: Creates the subdirectories of a received file.
+* @Params: in: directory = directory of the IluvatarSon
+*          in: filename = name of the file (relative to the directory)
+* @Return: Returns 1 if the filename is valid, otherwise 0.
+**********************************************************************/
+char SHAREDFUNCTIONS_createFileDirectories(char *directory, char *filename);
+
+/**********************************************************************
+* @Purpose: Writes the whole buffer to a file descriptor, even if the
+*           kernel accepts it in several parts.
+* @Params: in: fd = file descriptor to write
+*          in: buffer = bytes to write
+*          in: size = number of bytes to write
+* @Return: Returns the number of bytes written (less than size only if
+*          an error occurred).
+**********************************************************************/
+int SHAREDFUNCTIONS_writeFull(int fd, char *buffer, int size);
+
+/**********************************************************************
+* @Purpose: Writes all the buffers of an I/O vector to a file
+*           descriptor, even if the kernel accepts them in several
+*           parts.
+* @Params: in: fd = file descriptor to write
+*          in/out: iov = buffers to write (modified while writing)
+*          in: n_iov = number of buffers
+* @Return: Returns the number of bytes written.
+**********************************************************************/
+int SHAREDFUNCTIONS_writevFull(int fd, struct iovec *iov, int n_iov);
+
+/**********************************************************************
+* @Purpose: Gets the current time of a monotonic clock.
+* @Params: ----
+* @Return: Returns the time in microseconds.
+**********************************************************************/
+long long SHAREDFUNCTIONS_getTimeMicros();
+
+/**********************************************************************
+* @Purpose: Gets an identifier of this machine that is the same for all
+*           its processes until it reboots (the MD5 of its machine and
+*           boot ids, or of its hostname if they cannot be read).
+* @Params: out: host_id = buffer of HOST_ID_LENGTH + 1 bytes for the
+*               identifier
+* @Return: ----
+**********************************************************************/
+void SHAREDFUNCTIONS_getHostId(char *host_id);
+
+/**********************************************************************
+* @Purpose: Gets an identifier of a machine where only this process is
+*           (the MD5 of the one of this machine and the PID), so the
+*           other sons take it as a son of another machine.
+* @Params: out: host_id = buffer of HOST_ID_LENGTH + 1 bytes for the
+*               identifier
+* @Return: ----
+**********************************************************************/
+void SHAREDFUNCTIONS_getProcessHostId(char *host_id);
+
 #endif
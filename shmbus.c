@@ -0,0 +1,366 @@
+/*********************************************************************
+* @Purpose: Module that publishes messages for all the IluvatarSons of
+*           the same machine at once, through a ring of messages in
+*           shared memory that every son maps. The writers take a lock
+*           and the readers check a sequence counter per message, so
+*           one copy of a message reaches all of them.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "shmbus.h"
+
+/*********************************************************************
+* @Purpose: Checks if a subscriber of the bus is alive.
+* @Params: in: pid = PID of the subscriber
+* @Return: Returns 1 if it is alive, otherwise 0.
+*********************************************************************/
+char isBusProcessAlive(int pid) {
+	return ((0 < pid) && ((0 == kill(pid, 0)) || (ESRCH != errno)));
+}
+
+/*********************************************************************
+* @Purpose: Takes the lock of the bus. If its owner died while writing
+*           a message, the message is left as overwritten.
+* @Params: in/out: header = mapped header of the bus
+* @Return: ----
+*********************************************************************/
+void lockBus(ShmBusHeader *header) {
+	ShmBusSlot *slot = NULL;
+
+	if (EOWNERDEAD == pthread_mutex_lock(&header->lock)) {
+	    slot = &header->slots[header->head % SHMBUS_SLOTS];
+
+		if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) & 1) {
+		    __atomic_add_fetch(&slot->seq, 1, __ATOMIC_SEQ_CST);
+		}
+
+		pthread_mutex_consistent(&header->lock);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Waits until the creator of the bus has given it its size
+*           (for SHMBUS_READY_TIME ms at most).
+* @Params: in: fd = file descriptor of the shared memory
+* @Return: Returns SHMBUS_OK if it has the size of the bus, otherwise
+*          SHMBUS_KO.
+*********************************************************************/
+char waitBusSize(int fd) {
+	struct stat st;
+	int i = 0;
+
+	for (i = 0; i < SHMBUS_READY_TIME; i++) {
+	    if (0 != fstat(fd, &st)) {
+		    return (SHMBUS_KO);
+		}
+
+		if ((long long) st.st_size == (long long) sizeof(ShmBusHeader)) {
+		    return (SHMBUS_OK);
+		}
+
+		usleep(1000);
+	}
+
+	return (SHMBUS_KO);
+}
+
+/*********************************************************************
+* @Purpose: Maps the bus, creating it if it does not exist.
+* @Params: in/out: bus = instance of ShmBus with its name
+* @Return: Returns SHMBUS_OK if no errors, otherwise SHMBUS_KO.
+*********************************************************************/
+char mapBus(ShmBus *bus) {
+	pthread_mutexattr_t attr;
+	void *map = MAP_FAILED;
+	int fd = shm_open(bus->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	char created = (fd >= 0);
+	int i = 0;
+
+	if (!created) {
+	    fd = shm_open(bus->name, O_RDWR, 0600);
+	}
+
+	if ((fd >= 0) && (created ? (0 == ftruncate(fd, sizeof(ShmBusHeader))) : (SHMBUS_OK == waitBusSize(fd)))) {
+	    map = mmap(NULL, sizeof(ShmBusHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	if (fd >= 0) {
+	    close(fd);
+	}
+
+	if (MAP_FAILED == map) {
+	    if (created) {
+		    shm_unlink(bus->name);
+		}
+
+		return (SHMBUS_KO);
+	}
+
+	bus->header = (ShmBusHeader *) map;
+
+	if (created) {
+	    // the lock is shared by the processes and released if its owner dies
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&bus->header->lock, &attr);
+		pthread_mutexattr_destroy(&attr);
+		// the rest of the memory is filled with zeros
+		__atomic_store_n(&bus->header->magic, SHMBUS_MAGIC, __ATOMIC_RELEASE);
+		return (SHMBUS_OK);
+	}
+
+	// the creator may not have initialized the lock yet
+	for (i = 0; (i < SHMBUS_READY_TIME) && (SHMBUS_MAGIC != __atomic_load_n(&bus->header->magic, __ATOMIC_ACQUIRE)); i++) {
+	    usleep(1000);
+	}
+
+	if (SHMBUS_MAGIC != __atomic_load_n(&bus->header->magic, __ATOMIC_ACQUIRE)) {
+	    munmap(bus->header, sizeof(ShmBusHeader));
+		bus->header = NULL;
+		return (SHMBUS_KO);
+	}
+
+	return (SHMBUS_OK);
+}
+
+/*********************************************************************
+* @Purpose: Opens the bus of the sons of the machine connected to an
+*           Arda (creating it if this is the first one) and subscribes
+*           this process to the messages published from now on.
+* @Params: out: bus = instance of ShmBus to initialize
+*          in: arda_ip = IP address of Arda
+*          in: arda_port = port of Arda
+* @Return: Returns SHMBUS_OK if no errors, otherwise SHMBUS_KO (e.g.
+*          there are too many subscribers).
+*********************************************************************/
+char SHMBUS_open(ShmBus *bus, char *arda_ip, int arda_port) {
+	int tries = 0;
+	int free_slot = -1;
+	int i = 0;
+
+	bus->header = NULL;
+	bus->next = 0;
+	asprintf(&bus->name, SHMBUS_NAME, arda_ip, arda_port);
+
+	for (tries = 0; tries < SHMBUS_OPEN_TRIES; tries++) {
+	    if (SHMBUS_KO == mapBus(bus)) {
+		    continue;
+		}
+
+		lockBus(bus->header);
+
+		// the last subscriber has deleted it while it was being opened
+		if (bus->header->closed) {
+		    pthread_mutex_unlock(&bus->header->lock);
+			munmap(bus->header, sizeof(ShmBusHeader));
+			bus->header = NULL;
+			continue;
+		}
+
+		// the places of the sons that died are taken again
+		for (i = 0, free_slot = -1; (i < SHMBUS_MAX_SUBSCRIBERS) && (free_slot < 0); i++) {
+		    if (!isBusProcessAlive(bus->header->subscribers[i])) {
+			    free_slot = i;
+			}
+		}
+
+		if (free_slot >= 0) {
+		    bus->header->subscribers[free_slot] = getpid();
+			bus->next = bus->header->head;
+		}
+
+		pthread_mutex_unlock(&bus->header->lock);
+
+		if (free_slot >= 0) {
+		    return (SHMBUS_OK);
+		}
+
+		break;
+	}
+
+	if (NULL != bus->header) {
+	    munmap(bus->header, sizeof(ShmBusHeader));
+		bus->header = NULL;
+	}
+
+	free(bus->name);
+	bus->name = NULL;
+
+	return (SHMBUS_KO);
+}
+
+/*********************************************************************
+* @Purpose: Checks if a process is subscribed to the bus.
+* @Params: in: bus = opened instance of ShmBus
+*          in: pid = PID of the process
+* @Return: Returns 1 if it is subscribed, otherwise 0.
+*********************************************************************/
+char SHMBUS_isSubscriber(ShmBus *bus, int pid) {
+	int i = 0;
+
+	for (i = 0; i < SHMBUS_MAX_SUBSCRIBERS; i++) {
+	    if (pid == __atomic_load_n(&bus->header->subscribers[i], __ATOMIC_SEQ_CST)) {
+		    return (1);
+		}
+	}
+
+	return (0);
+}
+
+/*********************************************************************
+* @Purpose: Publishes a message for all the subscribers of the bus and
+*           wakes them up.
+* @Params: in/out: bus = opened instance of ShmBus
+*          in: data = message to publish
+*          in: length = number of bytes of the message
+* @Return: Returns SHMBUS_OK if no errors, otherwise SHMBUS_KO (the
+*          message does not fit in a slot).
+*********************************************************************/
+char SHMBUS_publish(ShmBus *bus, char *data, int length) {
+	ShmBusHeader *header = bus->header;
+	ShmBusSlot *slot = NULL;
+	unsigned int head = 0, seq = 0;
+
+	if ((length <= 0) || (length > SHMBUS_SLOT_SIZE)) {
+	    return (SHMBUS_KO);
+	}
+
+	lockBus(header);
+	head = header->head;
+	slot = &header->slots[head % SHMBUS_SLOTS];
+	seq = slot->seq;
+
+	// the readers that see an odd counter (or a different one at the end) read it again
+	__atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(slot->data, data, length);
+	slot->length = length;
+	slot->sender_pid = getpid();
+	slot->index = head;
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->head, head + 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&header->lock);
+
+	// a single call wakes up every subscriber
+	syscall(SYS_futex, &header->head, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+	return (SHMBUS_OK);
+}
+
+/*********************************************************************
+* @Purpose: Reads the next message published by another process,
+*           without blocking.
+* @Params: in/out: bus = opened instance of ShmBus
+*          out: data = buffer of SHMBUS_SLOT_SIZE bytes for the message
+*          out: lost = number of messages overwritten before they were
+*               read
+* @Return: Returns the number of bytes of the message, or 0 if there are
+*          no new messages.
+*********************************************************************/
+int SHMBUS_read(ShmBus *bus, char *data, int *lost) {
+	ShmBusSlot *slot = NULL;
+	unsigned int head = 0, seq = 0, index = 0;
+	int length = 0, sender_pid = 0;
+
+	*lost = 0;
+
+	while (1) {
+	    head = __atomic_load_n(&bus->header->head, __ATOMIC_ACQUIRE);
+
+		if (head == bus->next) {
+		    return (0);
+		}
+
+		// the writers do not wait for the readers, so a slow one loses the oldest messages
+		if (head - bus->next > SHMBUS_SLOTS) {
+		    *lost += head - bus->next - SHMBUS_SLOTS;
+			bus->next = head - SHMBUS_SLOTS;
+		}
+
+		slot = &bus->header->slots[bus->next % SHMBUS_SLOTS];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		index = slot->index;
+		sender_pid = slot->sender_pid;
+		length = slot->length;
+		length = ((length < 0) || (length > SHMBUS_SLOT_SIZE)) ? 0 : length;
+		memcpy(data, slot->data, length);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		// a newer message is being written (or was written) in the slot
+		if ((seq & 1) || (seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED)) || (index != bus->next)) {
+		    (*lost)++;
+			bus->next++;
+			continue;
+		}
+
+		bus->next++;
+
+		if ((getpid() != sender_pid) && (length > 0)) {
+		    return (length);
+		}
+	}
+}
+
+/*********************************************************************
+* @Purpose: Gets the number of messages published in the bus.
+* @Params: in: bus = opened instance of ShmBus
+* @Return: Returns the head of the bus.
+*********************************************************************/
+unsigned int SHMBUS_head(ShmBus *bus) {
+	return (__atomic_load_n(&bus->header->head, __ATOMIC_SEQ_CST));
+}
+
+/*********************************************************************
+* @Purpose: Waits until a message is published (or for SHMBUS_WAIT_TIME
+*           seconds at most).
+* @Params: in: bus = opened instance of ShmBus
+*          in: head = head of the bus when it was checked
+* @Return: ----
+*********************************************************************/
+void SHMBUS_wait(ShmBus *bus, unsigned int head) {
+	struct timespec timeout;
+
+	timeout.tv_sec = SHMBUS_WAIT_TIME;
+	timeout.tv_nsec = 0;
+	syscall(SYS_futex, &bus->header->head, FUTEX_WAIT, head, &timeout, NULL, 0);
+}
+
+/*********************************************************************
+* @Purpose: Unsubscribes this process and unmaps the bus. The last
+*           subscriber deletes it.
+* @Params: in/out: bus = instance of ShmBus
+* @Return: ----
+*********************************************************************/
+void SHMBUS_close(ShmBus *bus) {
+	char last = 1;
+	int i = 0;
+
+	if (NULL == bus->header) {
+	    return;
+	}
+
+	lockBus(bus->header);
+
+	for (i = 0; i < SHMBUS_MAX_SUBSCRIBERS; i++) {
+	    if (getpid() == bus->header->subscribers[i]) {
+		    bus->header->subscribers[i] = 0;
+		} else if (isBusProcessAlive(bus->header->subscribers[i])) {
+		    last = 0;
+		}
+	}
+
+	// a son opening it now sees it closed and creates a new one
+	if (last) {
+	    bus->header->closed = 1;
+		shm_unlink(bus->name);
+	}
+
+	pthread_mutex_unlock(&bus->header->lock);
+	munmap(bus->header, sizeof(ShmBusHeader));
+	bus->header = NULL;
+	free(bus->name);
+	bus->name = NULL;
+}
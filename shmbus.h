@@ -0,0 +1,128 @@
+#ifndef _SHMBUS_H_
+#define _SHMBUS_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* Constants */
+#define SHMBUS_NAME					"/iluvatar_bus_%s_%d"
+#define SHMBUS_SLOTS				64
+#define SHMBUS_SLOT_SIZE			1024
+#define SHMBUS_MAX_SUBSCRIBERS		64
+#define SHMBUS_MAGIC				0x494c4255
+#define SHMBUS_OPEN_TRIES			3
+#define SHMBUS_READY_TIME			1000
+#define SHMBUS_WAIT_TIME			1
+#define SHMBUS_OK					0
+#define SHMBUS_KO					1
+
+// message of the bus, protected by a sequence lock: its counter is odd
+// while it is written, so the readers never take the bus lock
+typedef struct {
+	unsigned int seq;
+	unsigned int index;
+	int sender_pid;
+	int length;
+	char data[SHMBUS_SLOT_SIZE];
+} ShmBusSlot;
+
+// shared memory of the bus: the writers take the lock one at a time and
+// the readers sleep on the head until a new message is published
+typedef struct {
+	unsigned int magic;
+	pthread_mutex_t lock;
+	char closed;
+	int subscribers[SHMBUS_MAX_SUBSCRIBERS];
+	unsigned int head;
+	ShmBusSlot slots[SHMBUS_SLOTS];
+} ShmBusHeader;
+
+// bus shared by the sons of the machine connected to the same Arda, with
+// the position of this son in it
+typedef struct {
+	ShmBusHeader *header;
+	char *name;
+	unsigned int next;
+} ShmBus;
+
+/*********************************************************************
+* @Purpose: Opens the bus of the sons of the machine connected to an
+*           Arda (creating it if this is the first one) and subscribes
+*           this process to the messages published from now on.
+* @Params: out: bus = instance of ShmBus to initialize
+*          in: arda_ip = IP address of Arda
+*          in: arda_port = port of Arda
+* @Return: Returns SHMBUS_OK if no errors, otherwise SHMBUS_KO (e.g.
+*          there are too many subscribers).
+*********************************************************************/
+char SHMBUS_open(ShmBus *bus, char *arda_ip, int arda_port);
+
+/*********************************************************************
+* @Purpose: Checks if a process is subscribed to the bus.
+* @Params: in: bus = opened instance of ShmBus
+*          in: pid = PID of the process
+* @Return: Returns 1 if it is subscribed, otherwise 0.
+*********************************************************************/
+char SHMBUS_isSubscriber(ShmBus *bus, int pid);
+
+/*********************************************************************
+* @Purpose: Publishes a message for all the subscribers of the bus and
+*           wakes them up.
+* @Params: in/out: bus = opened instance of ShmBus
+*          in: data = message to publish
+*          in: length = number of bytes of the message
+* @Return: Returns SHMBUS_OK if no errors, otherwise SHMBUS_KO (the
+*          message does not fit in a slot).
+*********************************************************************/
+char SHMBUS_publish(ShmBus *bus, char *data, int length);
+
+/*********************************************************************
+* @Purpose: Reads the next message published by another process,
+*           without blocking.
+* @Params: in/out: bus = opened instance of ShmBus
+*          out: data = buffer of SHMBUS_SLOT_SIZE bytes for the message
+*          out: lost = number of messages overwritten before they were
+*               read
+* @Return: Returns the number of bytes of the message, or 0 if there are
+*          no new messages.
+*********************************************************************/
+int SHMBUS_read(ShmBus *bus, char *data, int *lost);
+
+/*********************************************************************
+* @Purpose: Gets the number of messages published in the bus.
+* @Params: in: bus = opened instance of ShmBus
+* @Return: Returns the head of the bus.
+*********************************************************************/
+unsigned int SHMBUS_head(ShmBus *bus);
+
+/*********************************************************************
+* @Purpose: Waits until a message is published (or for SHMBUS_WAIT_TIME
+*           seconds at most).
+* @Params: in: bus = opened instance of ShmBus
+*          in: head = head of the bus when it was checked
+* @Return: ----
+*********************************************************************/
+void SHMBUS_wait(ShmBus *bus, unsigned int head);
+
+/*********************************************************************
+* @Purpose: Unsubscribes this process and unmaps the bus. The last
+*           subscriber deletes it.
+* @Params: in/out: bus = instance of ShmBus
+* @Return: ----
+*********************************************************************/
+void SHMBUS_close(ShmBus *bus);
+
+#endif
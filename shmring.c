@@ -0,0 +1,327 @@
+/*********************************************************************
+* @Purpose: Module that moves the data of the files sent between
+*           IluvatarSons in the same machine through a ring buffer in
+*           shared memory. Each son has its own ring; the sides only
+*           sleep on a futex when the ring is full or empty.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "shmring.h"
+
+/*********************************************************************
+* @Purpose: Waits until a word of the ring changes its value (or for
+*           SHMRING_WAIT_TIME seconds at most).
+* @Params: in: address = word of the shared memory
+*          in: value = value of the word when it was checked
+* @Return: ----
+*********************************************************************/
+void waitRingFutex(unsigned int *address, unsigned int value) {
+	struct timespec timeout;
+
+	timeout.tv_sec = SHMRING_WAIT_TIME;
+	timeout.tv_nsec = 0;
+	syscall(SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+/*********************************************************************
+* @Purpose: Wakes up the process waiting on a word of the ring.
+* @Params: in: address = word of the shared memory
+* @Return: ----
+*********************************************************************/
+void wakeRingFutex(unsigned int *address) {
+	syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*********************************************************************
+* @Purpose: Checks if a process of the other side of the ring is alive.
+* @Params: in: pid = PID of the process
+* @Return: Returns 1 if it is alive, otherwise 0.
+*********************************************************************/
+char isRingProcessAlive(int pid) {
+	return ((0 < pid) && ((0 == kill(pid, 0)) || (ESRCH != errno)));
+}
+
+/*********************************************************************
+* @Purpose: Maps the shared memory of a ring.
+* @Params: out: ring = instance of ShmRing to initialize
+*          in: fd = file descriptor of the shared memory
+* @Return: Returns SHMRING_OK if no errors, otherwise SHMRING_KO.
+*********************************************************************/
+char mapRing(ShmRing *ring, int fd) {
+	void *map = mmap(NULL, sizeof(ShmRingHeader) + SHMRING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	close(fd);
+
+	if (MAP_FAILED == map) {
+	    ring->header = NULL;
+		ring->data = NULL;
+		return (SHMRING_KO);
+	}
+
+	ring->header = (ShmRingHeader *) map;
+	ring->data = (char *) map + sizeof(ShmRingHeader);
+
+	return (SHMRING_OK);
+}
+
+/*********************************************************************
+* @Purpose: Creates the ring buffer of this process in shared memory.
+* @Params: out: ring = instance of ShmRing to initialize
+* @Return: Returns SHMRING_OK if no errors, otherwise SHMRING_KO.
+*********************************************************************/
+char SHMRING_create(ShmRing *ring) {
+	pthread_mutexattr_t attr;
+	char *name = NULL;
+	int fd = -1;
+
+	ring->header = NULL;
+	ring->data = NULL;
+	asprintf(&name, SHMRING_NAME, getpid());
+	// a ring with our PID can only be left by a process that died
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if ((fd < 0) || (0 != ftruncate(fd, sizeof(ShmRingHeader) + SHMRING_SIZE)) || (SHMRING_KO == mapRing(ring, fd))) {
+	    if (fd >= 0) {
+		    close(fd);
+		}
+
+		shm_unlink(name);
+		free(name);
+		name = NULL;
+		return (SHMRING_KO);
+	}
+
+	free(name);
+	name = NULL;
+
+	// the lock is shared by the processes and released if its owner dies
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&ring->header->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	ring->header->owner_pid = getpid();
+	ring->header->sender_pid = 0;
+	ring->header->size = SHMRING_SIZE;
+	ring->header->head = 0;
+	ring->header->tail = 0;
+	ring->header->reader_waiting = 0;
+	ring->header->writer_waiting = 0;
+
+	return (SHMRING_OK);
+}
+
+/*********************************************************************
+* @Purpose: Opens the ring buffer of another process of the machine.
+* @Params: out: ring = instance of ShmRing to initialize
+*          in: pid = PID of the owner of the ring
+* @Return: Returns SHMRING_OK if no errors, otherwise SHMRING_KO (e.g.
+*          the owner has no ring).
+*********************************************************************/
+char SHMRING_open(ShmRing *ring, int pid) {
+	struct stat st;
+	char *name = NULL;
+	int fd = -1;
+
+	ring->header = NULL;
+	ring->data = NULL;
+	asprintf(&name, SHMRING_NAME, pid);
+	fd = shm_open(name, O_RDWR, 0600);
+	free(name);
+	name = NULL;
+
+	if (fd < 0) {
+	    return (SHMRING_KO);
+	}
+
+	// the owner may not have finished creating it
+	if ((0 != fstat(fd, &st)) || ((long long) st.st_size != (long long) (sizeof(ShmRingHeader) + SHMRING_SIZE))) {
+	    close(fd);
+		return (SHMRING_KO);
+	}
+
+	if ((SHMRING_KO == mapRing(ring, fd)) || (pid != ring->header->owner_pid)) {
+	    SHMRING_close(ring);
+		return (SHMRING_KO);
+	}
+
+	return (SHMRING_OK);
+}
+
+/*********************************************************************
+* @Purpose: Takes the ring to send a file if no other son has it. A
+*           sender that died holding it does not block the ring.
+* @Params: in/out: ring = opened instance of ShmRing
+* @Return: Returns SHMRING_OK if the ring was taken, otherwise
+*          SHMRING_KO.
+*********************************************************************/
+char SHMRING_trylock(ShmRing *ring) {
+	int error = pthread_mutex_trylock(&ring->header->lock);
+
+	if (EOWNERDEAD == error) {
+	    // the owner empties the ring before the next file
+		pthread_mutex_consistent(&ring->header->lock);
+	} else if (0 != error) {
+	    return (SHMRING_KO);
+	}
+
+	__atomic_store_n(&ring->header->sender_pid, getpid(), __ATOMIC_SEQ_CST);
+
+	return (SHMRING_OK);
+}
+
+/*********************************************************************
+* @Purpose: Releases the ring once the file has been sent.
+* @Params: in/out: ring = opened instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_unlock(ShmRing *ring) {
+	__atomic_store_n(&ring->header->sender_pid, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&ring->header->lock);
+}
+
+/*********************************************************************
+* @Purpose: Empties the ring before a new file is received. Only the
+*           owner calls it, while no sender is writing.
+* @Params: in/out: ring = created instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_reset(ShmRing *ring) {
+	__atomic_store_n(&ring->header->head, __atomic_load_n(&ring->header->tail, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+	__atomic_store_n(&ring->header->reader_waiting, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&ring->header->writer_waiting, 0, __ATOMIC_SEQ_CST);
+}
+
+/*********************************************************************
+* @Purpose: Copies data into the ring, waiting for free space when it
+*           is full. The reader is only woken up if it is waiting, so
+*           there are no system calls while both sides keep up.
+* @Params: in/out: ring = opened and locked instance of ShmRing
+*          in: data = data to copy
+*          in: length = number of bytes of the data
+* @Return: Returns SHMRING_OK if no errors, or SHMRING_KO if the owner
+*          of the ring has died.
+*********************************************************************/
+char SHMRING_write(ShmRing *ring, char *data, int length) {
+	ShmRingHeader *header = ring->header;
+	unsigned int head = 0, tail = 0, offset = 0, n = 0;
+
+	while (length > 0) {
+	    // only this side moves the tail
+		tail = header->tail;
+		head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+		n = header->size - (tail - head);
+
+		if (0 == n) {
+		    // announce the wait before checking the head again, so the wake up is not lost
+			__atomic_store_n(&header->writer_waiting, 1, __ATOMIC_SEQ_CST);
+
+			if (head == __atomic_load_n(&header->head, __ATOMIC_SEQ_CST)) {
+			    waitRingFutex(&header->head, head);
+
+				if (!isRingProcessAlive(header->owner_pid)) {
+				    return (SHMRING_KO);
+				}
+			}
+
+			continue;
+		}
+
+		offset = tail % header->size;
+		n = (n > header->size - offset) ? header->size - offset : n;
+		n = (n > (unsigned int) length) ? (unsigned int) length : n;
+		memcpy(ring->data + offset, data, n);
+		__atomic_store_n(&header->tail, tail + n, __ATOMIC_SEQ_CST);
+
+		if (__atomic_exchange_n(&header->reader_waiting, 0, __ATOMIC_SEQ_CST)) {
+		    wakeRingFutex(&header->tail);
+		}
+
+		data += n;
+		length -= n;
+	}
+
+	return (SHMRING_OK);
+}
+
+/*********************************************************************
+* @Purpose: Waits for data in the ring and gets the part of it that is
+*           contiguous in memory, to be read in place.
+* @Params: in/out: ring = created instance of ShmRing
+*          in: sender_pid = PID of the son sending the data
+*          out: data = pointer to the data inside the ring
+* @Return: Returns the number of bytes available, or -1 if the sender
+*          has died (or another son has taken the ring).
+*********************************************************************/
+int SHMRING_peek(ShmRing *ring, int sender_pid, char **data) {
+	ShmRingHeader *header = ring->header;
+	unsigned int head = 0, tail = 0, offset = 0, n = 0;
+
+	while (1) {
+	    // only this side moves the head
+		head = header->head;
+		tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+
+		if (tail != head) {
+		    offset = head % header->size;
+			n = tail - head;
+			n = (n > header->size - offset) ? header->size - offset : n;
+			*data = ring->data + offset;
+			return ((int) n);
+		}
+
+		if ((sender_pid != __atomic_load_n(&header->sender_pid, __ATOMIC_SEQ_CST)) || !isRingProcessAlive(sender_pid)) {
+		    return (-1);
+		}
+
+		// announce the wait before checking the tail again, so the wake up is not lost
+		__atomic_store_n(&header->reader_waiting, 1, __ATOMIC_SEQ_CST);
+
+		if (tail == __atomic_load_n(&header->tail, __ATOMIC_SEQ_CST)) {
+		    waitRingFutex(&header->tail, tail);
+		}
+	}
+}
+
+/*********************************************************************
+* @Purpose: Frees the space of the data already read, waking up the
+*           sender if it is waiting for it.
+* @Params: in/out: ring = created instance of ShmRing
+*          in: length = number of bytes read
+* @Return: ----
+*********************************************************************/
+void SHMRING_release(ShmRing *ring, int length) {
+	__atomic_store_n(&ring->header->head, ring->header->head + (unsigned int) length, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&ring->header->writer_waiting, 0, __ATOMIC_SEQ_CST)) {
+	    wakeRingFutex(&ring->header->head);
+	}
+}
+
+/*********************************************************************
+* @Purpose: Unmaps the ring. The owner also deletes it.
+* @Params: in/out: ring = instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_close(ShmRing *ring) {
+	char *name = NULL;
+
+	if (NULL == ring->header) {
+	    return;
+	}
+
+	if (getpid() == ring->header->owner_pid) {
+	    asprintf(&name, SHMRING_NAME, getpid());
+		shm_unlink(name);
+		free(name);
+		name = NULL;
+	}
+
+	munmap(ring->header, sizeof(ShmRingHeader) + SHMRING_SIZE);
+	ring->header = NULL;
+	ring->data = NULL;
+}
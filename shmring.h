@@ -0,0 +1,126 @@
+#ifndef _SHMRING_H_
+#define _SHMRING_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "sharedFunctions.h"
+
+/* Constants */
+#define SHMRING_NAME				"/iluvatar_ring_%d"
+#define SHMRING_SIZE				4194304
+#define SHMRING_WAIT_TIME			1
+#define SHMRING_OK					0
+#define SHMRING_KO					1
+
+// header of the shared memory, the data follows it
+typedef struct {
+	pthread_mutex_t lock;
+	int owner_pid;
+	int sender_pid;
+	unsigned int size;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int reader_waiting;
+	unsigned int writer_waiting;
+} ShmRingHeader;
+
+// ring buffer of a son in shared memory: many sons write to it (one
+// file at a time, holding the lock) and its owner reads it
+typedef struct {
+	ShmRingHeader *header;
+	char *data;
+} ShmRing;
+
+/*********************************************************************
+* @Purpose: Creates the ring buffer of this process in shared memory.
+* @Params: out: ring = instance of ShmRing to initialize
+* @Return: Returns SHMRING_OK if no errors, otherwise SHMRING_KO.
+*********************************************************************/
+char SHMRING_create(ShmRing *ring);
+
+/*********************************************************************
+* @Purpose: Opens the ring buffer of another process of the machine.
+* @Params: out: ring = instance of ShmRing to initialize
+*          in: pid = PID of the owner of the ring
+* @Return: Returns SHMRING_OK if no errors, otherwise SHMRING_KO (e.g.
+*          the owner has no ring).
+*********************************************************************/
+char SHMRING_open(ShmRing *ring, int pid);
+
+/*********************************************************************
+* @Purpose: Takes the ring to send a file if no other son has it. A
+*           sender that died holding it does not block the ring.
+* @Params: in/out: ring = opened instance of ShmRing
+* @Return: Returns SHMRING_OK if the ring was taken, otherwise
+*          SHMRING_KO.
+*********************************************************************/
+char SHMRING_trylock(ShmRing *ring);
+
+/*********************************************************************
+* @Purpose: Releases the ring once the file has been sent.
+* @Params: in/out: ring = opened instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_unlock(ShmRing *ring);
+
+/*********************************************************************
+* @Purpose: Empties the ring before a new file is received. Only the
+*           owner calls it, while no sender is writing.
+* @Params: in/out: ring = created instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_reset(ShmRing *ring);
+
+/*********************************************************************
+* @Purpose: Copies data into the ring, waiting for free space when it
+*           is full. The reader is only woken up if it is waiting, so
+*           there are no system calls while both sides keep up.
+* @Params: in/out: ring = opened and locked instance of ShmRing
+*          in: data = data to copy
+*          in: length = number of bytes of the data
+* @Return: Returns SHMRING_OK if no errors, or SHMRING_KO if the owner
+*          of the ring has died.
+*********************************************************************/
+char SHMRING_write(ShmRing *ring, char *data, int length);
+
+/*********************************************************************
+* @Purpose: Waits for data in the ring and gets the part of it that is
+*           contiguous in memory, to be read in place.
+* @Params: in/out: ring = created instance of ShmRing
+*          in: sender_pid = PID of the son sending the data
+*          out: data = pointer to the data inside the ring
+* @Return: Returns the number of bytes available, or -1 if the sender
+*          has died (or another son has taken the ring).
+*********************************************************************/
+int SHMRING_peek(ShmRing *ring, int sender_pid, char **data);
+
+/*********************************************************************
+* @Purpose: Frees the space of the data already read, waking up the
+*           sender if it is waiting for it.
+* @Params: in/out: ring = created instance of ShmRing
+*          in: length = number of bytes read
+* @Return: ----
+*********************************************************************/
+void SHMRING_release(ShmRing *ring, int length);
+
+/*********************************************************************
+* @Purpose: Unmaps the ring. The owner also deletes it.
+* @Params: in/out: ring = instance of ShmRing
+* @Return: ----
+*********************************************************************/
+void SHMRING_close(ShmRing *ring);
+
+#endif
@@ -0,0 +1,595 @@
+/*********************************************************************
+* @Purpose: Module to download a file from several IluvatarSons at the
+*           same time. The sons publish the content hashes of their
+*           directories to Arda, which tells who holds a content, and
+*           every one of them serves different pieces of the file.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "swarm.h"
+
+/*********************************************************************
+* @Purpose: Sends a frame of the inventory of a directory.
+* @Params: in: fd_arda = socket connected to Arda
+*          in: first = 1 if it is the first frame of the inventory
+*          in: data = data of the frame (username and entries)
+* @Return: Returns SWARM_OK if no errors, otherwise SWARM_KO.
+*********************************************************************/
+char sendInventoryFrame(int fd_arda, char first, char *data) {
+	char *header = first ? GCP_INVENTORY_HEADER : GCP_INVENTORY_ADD_HEADER;
+
+	if (GCP_WRITE_KO == GPC_writeFrame(fd_arda, GCP_SWARM_TYPE, header, data, strlen(data))) {
+	    return (SWARM_KO);
+	}
+
+	return (SWARM_OK);
+}
+
+/*********************************************************************
+* @Purpose: Publishes the content hashes of the directory to Arda (as
+*           many INVENTORY frames as needed, the first one replaces
+*           the previous inventory and the rest are INVENTORY_ADD).
+* @Params: in: fd_arda = socket connected to Arda
+*          in: username = name of the IluvatarSon
+*          in: directory = string with the directory of the IluvatarSon
+* @Return: Returns SWARM_OK if no errors, otherwise SWARM_KO.
+*********************************************************************/
+char SWARM_publishInventory(int fd_arda, char *username, char *directory) {
+	FileIndex index;
+	char *data = NULL;
+	char *entry = NULL;
+	char first = 1, error = SWARM_OK;
+	int i = 0, length = 0, n = 0;
+
+	index = FILEINDEX_open(directory, FILEINDEX_REFRESH);
+	length = asprintf(&data, "%s", username);
+
+	for (i = 0; (i < index.n_entries) && (SWARM_OK == error); i++) {
+	    // the separators of the frame cannot be part of a filename
+		if ((NULL != strchr(index.entries[i].filename, GPC_DATA_SEPARATOR)) || (NULL != strchr(index.entries[i].filename, GPC_USERS_SEPARATOR))) {
+		    continue;
+		}
+
+		n = asprintf(&entry, "%c%s%c%lld%c%s", GPC_USERS_SEPARATOR, index.entries[i].md5sum, GPC_DATA_SEPARATOR,
+		             index.entries[i].size, GPC_DATA_SEPARATOR, index.entries[i].filename);
+
+		// a full frame is sent and the next one starts again with the username
+		if (length + n > GPC_FILE_MAX_BYTES) {
+		    error = sendInventoryFrame(fd_arda, first, data);
+			first = 0;
+			free(data);
+			length = asprintf(&data, "%s", username);
+		}
+
+		data = (char *) realloc(data, sizeof(char) * (length + n + 1));
+		memcpy(data + length, entry, n + 1);
+		length += n;
+		free(entry);
+		entry = NULL;
+	}
+
+	FILEINDEX_close(directory, &index);
+
+	// an empty inventory is sent too, it replaces the previous one
+	if (SWARM_OK == error) {
+	    error = sendInventoryFrame(fd_arda, first, data);
+	}
+
+	free(data);
+	data = NULL;
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Gets the content and the users of a HAS_LIST frame, in the
+*           format hash&size&filename#user&ip&port#user&ip&port...
+* @Params: in: has_list = data of the HAS_LIST frame
+*          out: download = download to store the hash and the size
+*          out: filename = name of the file in the first user
+*          out: peers = array of the users that hold the content
+* @Return: Returns the number of users.
+*********************************************************************/
+int parseHasList(char *has_list, SwarmDownload *download, char **filename, SwarmPeer **peers) {
+	char *entry = NULL;
+	char *buffer = NULL;
+	char *slash = NULL;
+	int pos = 0, i = 0, n_peers = 0;
+
+	entry = SHAREDFUNCTIONS_splitString(has_list, GPC_USERS_SEPARATOR, &pos);
+	download->md5sum = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	buffer = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	download->size = atoll(buffer);
+	free(buffer);
+	buffer = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+	free(entry);
+	entry = NULL;
+
+	// the file is stored in the root of the directory
+	slash = strrchr(buffer, '/');
+	*filename = strdup((NULL == slash) ? buffer : slash + 1);
+	free(buffer);
+	buffer = NULL;
+	*peers = NULL;
+
+	while (pos < (int) strlen(has_list)) {
+	    entry = SHAREDFUNCTIONS_splitString(has_list, GPC_USERS_SEPARATOR, &pos);
+		*peers = (SwarmPeer *) realloc(*peers, sizeof(SwarmPeer) * (n_peers + 1));
+		i = 0;
+		(*peers)[n_peers].username = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+		(*peers)[n_peers].ip_address = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+		buffer = SHAREDFUNCTIONS_splitString(entry, GPC_DATA_SEPARATOR, &i);
+		(*peers)[n_peers].port = atoi(buffer);
+		free(buffer);
+		buffer = NULL;
+		free(entry);
+		entry = NULL;
+		n_peers++;
+	}
+
+	return (n_peers);
+}
+
+/*********************************************************************
+* @Purpose: Asks Arda for a range of a blob of its cache and writes it
+*           in the file being downloaded. After BLOB_OK the range comes
+*           raw through the socket (Arda sends it with sendfile).
+* @Params: in/out: download = download in progress
+*          in: peer = Arda (user with an empty name)
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+* @Return: Returns SWARM_OK if the range is in the file, otherwise
+*          SWARM_KO.
+*********************************************************************/
+char fetchBlobRange(SwarmDownload *download, SwarmPeer *peer, long long offset, long long length) {
+	Client c;
+	FileWriter writer;
+	char *header = NULL;
+	char *buffer = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	char error = SWARM_KO;
+	long long received = 0;
+	ssize_t n = 0;
+
+	c = CLIENT_init(peer->ip_address, peer->port);
+
+	if (FD_NOT_FOUND == c.server_fd) {
+	    return (SWARM_KO);
+	}
+
+	asprintf(&buffer, "%s%c%s%c%lld%c%lld", download->username, GPC_DATA_SEPARATOR, download->md5sum, GPC_DATA_SEPARATOR,
+	         offset, GPC_DATA_SEPARATOR, length);
+
+	if (GCP_WRITE_KO != GPC_writeFrame(c.server_fd, GCP_BLOB_TYPE, GCP_BLOB_GET_HEADER, buffer, strlen(buffer))) {
+	    free(buffer);
+		buffer = NULL;
+		GPC_readFrame(c.server_fd, &type, &header, &buffer);
+
+		// the blob may have been evicted (BLOB_KO)
+		if ((GCP_BLOB_TYPE == type) && (NULL != header) && (0 == strcmp(header, GCP_BLOB_OK_HEADER)) &&
+		    (FILEWRITER_OK == FILEWRITER_openRange(&writer, download->path, offset, length, &download->policy))) {
+			if (NULL != buffer) {
+			    free(buffer);
+			}
+
+			buffer = (char *) malloc(sizeof(char) * SWARM_READ_SIZE);
+
+			while ((received < length) && !download->control->cancel) {
+			    n = read(c.server_fd, buffer, (length - received > SWARM_READ_SIZE) ? SWARM_READ_SIZE : length - received);
+
+				if ((n <= 0) || (FILEWRITER_KO == FILEWRITER_write(&writer, buffer, (int) n))) {
+				    break;
+				}
+
+				received += n;
+			}
+
+			error = (received == length) ? SWARM_OK : SWARM_KO;
+
+			if (FILEWRITER_KO == FILEWRITER_close(&writer)) {
+			    error = SWARM_KO;
+			}
+		}
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	close(c.server_fd);
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Asks a user for a range of the file and writes it in the
+*           file being downloaded.
+* @Params: in/out: download = download in progress
+*          in: peer = user that serves the range
+*          in: offset = offset of the first byte of the range
+*          in: length = number of bytes of the range
+* @Return: Returns SWARM_OK if the range is in the file, otherwise
+*          SWARM_KO.
+*********************************************************************/
+char fetchRange(SwarmDownload *download, SwarmPeer *peer, long long offset, long long length) {
+	Client c;
+	DataPlane dp;
+	FileWriter writer;
+	char *header = NULL;
+	char *buffer = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	char error = SWARM_KO;
+
+	c = CLIENT_init(peer->ip_address, peer->port);
+
+	if (FD_NOT_FOUND == c.server_fd) {
+	    return (SWARM_KO);
+	}
+
+	asprintf(&buffer, "%s%c%s%c%lld%c%lld%c%s", download->username, GPC_DATA_SEPARATOR, download->md5sum, GPC_DATA_SEPARATOR,
+	         offset, GPC_DATA_SEPARATOR, length, GPC_DATA_SEPARATOR, GPC_getCodecName(download->codec));
+
+	if (GCP_WRITE_KO != GPC_writeFrame(c.server_fd, GCP_SEND_FILE_TYPE, GCP_GET_RANGE_HEADER, buffer, strlen(buffer))) {
+	    free(buffer);
+		buffer = NULL;
+		GPC_readFrame(c.server_fd, &type, &header, &buffer);
+
+		// the user may not have the content anymore (RANGE_KO)
+		if ((GCP_SEND_FILE_TYPE == type) && (NULL != header) && (0 == strcmp(header, GCP_RANGE_OK_HEADER)) &&
+		    (FILEWRITER_OK == FILEWRITER_openRange(&writer, download->path, offset, length, &download->policy))) {
+			DATAPLANE_init(&dp, c.server_fd, CODEC_NONE, NULL);
+			error = (DATAPLANE_OK == DATAPLANE_receiveFile(&dp, &writer, length)) ? SWARM_OK : SWARM_KO;
+
+			if (FILEWRITER_KO == FILEWRITER_close(&writer)) {
+			    error = SWARM_KO;
+			}
+		}
+	}
+
+	if (NULL != header) {
+	    free(header);
+		header = NULL;
+	}
+
+	if (NULL != buffer) {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	close(c.server_fd);
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Takes the next piece to download. If the only pieces left
+*           are being downloaded by other users, waits for them (a
+*           piece that fails is given back). The mutex of the download
+*           must be locked.
+* @Params: in/out: download = download in progress
+* @Return: Returns the index of the piece, or -1 if there are no more
+*          pieces to download or the download has been cancelled.
+*********************************************************************/
+int takePiece(SwarmDownload *download) {
+	char taken = 0;
+	int i = 0;
+
+	while (!download->control->cancel) {
+	    taken = 0;
+
+		for (i = 0; i < download->n_pieces; i++) {
+		    if (SWARM_PIECE_TODO == download->pieces[i]) {
+			    download->pieces[i] = SWARM_PIECE_TAKEN;
+				return (i);
+			}
+
+			taken = taken || (SWARM_PIECE_TAKEN == download->pieces[i]);
+		}
+
+		if (!taken) {
+		    return (-1);
+		}
+
+		pthread_cond_wait(&download->cond, &download->mutex);
+	}
+
+	return (-1);
+}
+
+/*********************************************************************
+* @Purpose: Downloads pieces of the file from a user until there are
+*           no more pieces or the user fails (its piece is given back
+*           for the other users).
+* @Params: in/out: args = instance of SwarmWorker
+* @Return: Returns NULL.
+*********************************************************************/
+void *fetchPieces(void *args) {
+	SwarmWorker *worker = (SwarmWorker *) args;
+	SwarmDownload *download = worker->download;
+	long long offset = 0, length = 0;
+	char error = SWARM_OK;
+	int piece = 0;
+
+	while (SWARM_OK == error) {
+	    pthread_mutex_lock(&download->mutex);
+		piece = takePiece(download);
+		pthread_mutex_unlock(&download->mutex);
+
+		if (-1 == piece) {
+		    break;
+		}
+
+		offset = piece * SWARM_PIECE_SIZE;
+		length = (download->size - offset > SWARM_PIECE_SIZE) ? SWARM_PIECE_SIZE : download->size - offset;
+
+		// Arda serves the blobs of its cache
+		if (0 == strcmp(worker->peer->username, GPC_BLOB_PEER_NAME)) {
+		    error = fetchBlobRange(download, worker->peer, offset, length);
+		} else {
+		    error = fetchRange(download, worker->peer, offset, length);
+		}
+
+		pthread_mutex_lock(&download->mutex);
+
+		if (SWARM_OK == error) {
+		    download->pieces[piece] = SWARM_PIECE_DONE;
+			download->control->bytes += length;
+			(worker->n_pieces)++;
+		} else {
+		    download->pieces[piece] = SWARM_PIECE_TODO;
+		}
+
+		pthread_cond_broadcast(&download->cond);
+		pthread_mutex_unlock(&download->mutex);
+	}
+
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Creates the file to download with its final size, after
+*           reserving its disk space.
+* @Params: in: path = path of the file
+*          in: size = size in bytes of the file
+* @Return: Returns SWARM_OK if no errors, otherwise SWARM_KO (errno is
+*          ENOSPC if there is not enough space).
+*********************************************************************/
+char createDownloadFile(char *path, long long size) {
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (FD_NOT_FOUND == fd) {
+	    return (SWARM_KO);
+	}
+
+	// the pieces are written in any order, so the file has its size from the start
+	if (((size > 0) && (0 != fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size)) && (ENOSPC == errno)) || (0 != ftruncate(fd, size))) {
+	    close(fd);
+		unlink(path);
+		return (SWARM_KO);
+	}
+
+	close(fd);
+
+	return (SWARM_OK);
+}
+
+/*********************************************************************
+* @Purpose: Shows an error of a download.
+* @Params: in: message = format of the message
+*          in: argument = string of the message
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: ----
+*********************************************************************/
+void printSwarmError(char *message, char *argument, pthread_mutex_t *mutex) {
+	char *buffer = NULL;
+
+	asprintf(&buffer, message, argument);
+	pthread_mutex_lock(mutex);
+	printMsg(COLOR_RED_TXT);
+	printMsg(buffer);
+	printMsg(COLOR_DEFAULT_TXT);
+	pthread_mutex_unlock(mutex);
+	free(buffer);
+	buffer = NULL;
+}
+
+/*********************************************************************
+* @Purpose: Downloads the pieces of a file with one thread per user.
+* @Params: in/out: download = download with the file already created
+*          in: peers = users that hold the content
+*          in: n_peers = number of users
+* @Return: Returns the number of users that served a piece, or -1 if
+*          some piece could not be downloaded.
+*********************************************************************/
+int runSwarm(SwarmDownload *download, SwarmPeer *peers, int n_peers) {
+	SwarmWorker *workers = NULL;
+	pthread_t *threads = NULL;
+	int i = 0, n_workers = 0, n_users = 0;
+
+	n_workers = (n_peers > SWARM_MAX_PEERS) ? SWARM_MAX_PEERS : n_peers;
+	workers = (SwarmWorker *) malloc(sizeof(SwarmWorker) * n_workers);
+	threads = (pthread_t *) malloc(sizeof(pthread_t) * n_workers);
+
+	for (i = 0; i < n_workers; i++) {
+	    workers[i].download = download;
+		workers[i].peer = &peers[i];
+		workers[i].n_pieces = 0;
+
+		if (0 != pthread_create(&threads[i], NULL, fetchPieces, &workers[i])) {
+		    break;
+		}
+	}
+
+	n_workers = i;
+
+	for (i = 0; i < n_workers; i++) {
+	    pthread_join(threads[i], NULL);
+
+		if (0 < workers[i].n_pieces) {
+		    n_users++;
+		}
+	}
+
+	free(workers);
+	workers = NULL;
+	free(threads);
+	threads = NULL;
+
+	for (i = 0; i < download->n_pieces; i++) {
+	    if (SWARM_PIECE_DONE != download->pieces[i]) {
+		    return (-1);
+		}
+	}
+
+	return (n_users);
+}
+
+/*********************************************************************
+* @Purpose: Frees the users of a HAS_LIST frame.
+* @Params: in/out: peers = array of users
+*          in: n_peers = number of users
+* @Return: ----
+*********************************************************************/
+void freeSwarmPeers(SwarmPeer **peers, int n_peers) {
+	int i = 0;
+
+	for (i = 0; i < n_peers; i++) {
+	    free((*peers)[i].username);
+		(*peers)[i].username = NULL;
+		free((*peers)[i].ip_address);
+		(*peers)[i].ip_address = NULL;
+	}
+
+	if (NULL != *peers) {
+	    free(*peers);
+		*peers = NULL;
+	}
+}
+
+/*********************************************************************
+* @Purpose: Downloads a file from all the users that hold it at the
+*           same time. The file is split in pieces of SWARM_PIECE_SIZE
+*           bytes that every user serves from its Iluvatar server
+*           (GET_RANGE), and a piece that fails is asked to another
+*           user. Arda is one more user when the content is in its blob
+*           cache. The file is checked with its content hash before it
+*           replaces the final one.
+* @Params: in: has_list = data of the HAS_LIST frame sent by Arda
+*          in: directory = string with the directory of the IluvatarSon
+*          in: username = name of the IluvatarSon
+*          in: codec = codec accepted to compress the data
+*          in: policy = durability policy of the received files
+*          in/out: control = progress and cancellation of the download
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns SWARM_OK if the file is in the directory, otherwise
+*          SWARM_KO.
+*********************************************************************/
+char SWARM_download(char *has_list, char *directory, char *username, char codec, WritePolicy *policy, TransferControl *control, pthread_mutex_t *mutex) {
+	SwarmDownload download;
+	SwarmPeer *peers = NULL;
+	char *filename = NULL;
+	char *path = NULL;
+	char *buffer = NULL;
+	char error = SWARM_KO;
+	int n_peers = 0, n_users = 0;
+
+	n_peers = parseHasList(has_list, &download, &filename, &peers);
+
+	if (0 == n_peers) {
+	    printSwarmError(SWARM_NO_PEERS_MSG, download.md5sum, mutex);
+		free(download.md5sum);
+		download.md5sum = NULL;
+		free(filename);
+		filename = NULL;
+		return (SWARM_KO);
+	}
+
+	// the content may already be in the directory with another name
+	if (FILEINDEX_FOUND == FILEINDEX_materialize(directory, download.md5sum, download.size, filename)) {
+	    asprintf(&buffer, SWARM_ALREADY_PRESENT_MSG, filename);
+		pthread_mutex_lock(mutex);
+		printMsg(buffer);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+		freeSwarmPeers(&peers, n_peers);
+		free(download.md5sum);
+		download.md5sum = NULL;
+		free(filename);
+		filename = NULL;
+		return (SWARM_OK);
+	}
+
+	download.path = FILEINDEX_getTmpPath(directory, filename);
+	download.username = username;
+	download.codec = codec;
+	download.policy = *policy;
+	download.control = control;
+	download.n_pieces = (int) ((download.size + SWARM_PIECE_SIZE - 1) / SWARM_PIECE_SIZE);
+	download.pieces = (char *) calloc(download.n_pieces + 1, sizeof(char));
+	pthread_mutex_init(&download.mutex, NULL);
+	pthread_cond_init(&download.cond, NULL);
+
+	if (SWARM_KO == createDownloadFile(download.path, download.size)) {
+	    printSwarmError((ENOSPC == errno) ? SWARM_NO_SPACE_MSG : SWARM_FAILED_MSG, filename, mutex);
+	} else if (-1 == (n_users = runSwarm(&download, peers, n_peers))) {
+	    if (!control->cancel) {
+		    printSwarmError(SWARM_FAILED_MSG, filename, mutex);
+		}
+	} else {
+	    // the pieces are checked all together with the content hash
+		buffer = TREEHASH_getFileHash(download.path, download.md5sum, mutex);
+		asprintf(&path, ".%s/%s", directory, filename);
+
+		if ((NULL == buffer) || (0 != strcmp(buffer, download.md5sum)) || (0 != rename(download.path, path))) {
+		    printSwarmError(SWARM_CHECK_FAILED_MSG, filename, mutex);
+		} else {
+		    FILEINDEX_add(directory, filename, download.md5sum);
+			error = SWARM_OK;
+		}
+
+		if (NULL != buffer) {
+		    free(buffer);
+			buffer = NULL;
+		}
+
+		free(path);
+		path = NULL;
+	}
+
+	if (SWARM_OK == error) {
+	    asprintf(&buffer, SWARM_DOWNLOADED_MSG, filename, download.size, n_users);
+		pthread_mutex_lock(mutex);
+		printMsg(buffer);
+		pthread_mutex_unlock(mutex);
+		free(buffer);
+		buffer = NULL;
+	} else {
+	    unlink(download.path);
+	}
+
+	// free memory
+	pthread_mutex_destroy(&download.mutex);
+	pthread_cond_destroy(&download.cond);
+	freeSwarmPeers(&peers, n_peers);
+	free(download.pieces);
+	download.pieces = NULL;
+	free(download.path);
+	download.path = NULL;
+	free(download.md5sum);
+	download.md5sum = NULL;
+	free(filename);
+	filename = NULL;
+
+	return (error);
+}
@@ -0,0 +1,99 @@
+#ifndef _SWARM_H_
+#define _SWARM_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "definitions.h"
+#include "sharedFunctions.h"
+#include "gpc.h"
+#include "client.h"
+#include "fileindex.h"
+#include "filewriter.h"
+#include "dataplane.h"
+#include "treehash.h"
+
+/* Messages */
+#define SWARM_NO_PEERS_MSG			"ERROR: Nobody has the content %s. Try again after the other users UPDATE USERS\n"
+#define SWARM_ALREADY_PRESENT_MSG	"%s is already in the directory, no data transferred\n"
+#define SWARM_NO_SPACE_MSG			"ERROR: There is not enough space to download %s\n"
+#define SWARM_FAILED_MSG			"ERROR: %s could not be downloaded from any user\n"
+#define SWARM_CHECK_FAILED_MSG		"ERROR: The downloaded content of %s is wrong\n"
+#define SWARM_DOWNLOADED_MSG		"\nNew file downloaded!\n%s (%lld bytes) from %d users\n"
+
+/* Constants */
+#define SWARM_PIECE_SIZE			(16LL * 1024 * 1024)
+#define SWARM_MAX_PEERS				8
+#define SWARM_READ_SIZE				(256 * 1024)
+#define SWARM_PIECE_TODO			0
+#define SWARM_PIECE_TAKEN			1
+#define SWARM_PIECE_DONE			2
+#define SWARM_OK					0
+#define SWARM_KO					1
+
+typedef struct {
+	char *username;
+	char *ip_address;
+	int port;
+} SwarmPeer;
+
+typedef struct {
+	char *md5sum;
+	long long size;
+	char *path;
+	char *username;
+	char codec;
+	WritePolicy policy;
+	char *pieces;
+	int n_pieces;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	TransferControl *control;
+} SwarmDownload;
+
+typedef struct {
+	SwarmDownload *download;
+	SwarmPeer *peer;
+	int n_pieces;
+} SwarmWorker;
+
+/*********************************************************************
+* @Purpose: Publishes the content hashes of the directory to Arda (as
+*           many INVENTORY frames as needed, the first one replaces
+*           the previous inventory and the rest are INVENTORY_ADD).
+* @Params: in: fd_arda = socket connected to Arda
+*          in: username = name of the IluvatarSon
+*          in: directory = string with the directory of the IluvatarSon
+* @Return: Returns SWARM_OK if no errors, otherwise SWARM_KO.
+*********************************************************************/
+char SWARM_publishInventory(int fd_arda, char *username, char *directory);
+
+/*********************************************************************
+* @Purpose: Downloads a file from all the users that hold it at the
+*           same time. The file is split in pieces of SWARM_PIECE_SIZE
+*           bytes that every user serves from its Iluvatar server
+*           (GET_RANGE), and a piece that fails is asked to another
+*           user. Arda is one more user when the content is in its blob
+*           cache. The file is checked with its content hash before it
+*           replaces the final one.
+* @Params: in: has_list = data of the HAS_LIST frame sent by Arda
+*          in: directory = string with the directory of the IluvatarSon
+*          in: username = name of the IluvatarSon
+*          in: codec = codec accepted to compress the data
+*          in: policy = durability policy of the received files
+*          in/out: control = progress and cancellation of the download
+*          in/out: mutex = screen mutex to prevent writing to screen
+*                  simultaneously
+* @Return: Returns SWARM_OK if the file is in the directory, otherwise
+*          SWARM_KO.
+*********************************************************************/
+char SWARM_download(char *has_list, char *directory, char *username, char codec, WritePolicy *policy, TransferControl *control, pthread_mutex_t *mutex);
+
+#endif
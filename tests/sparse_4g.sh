@@ -0,0 +1,118 @@
+#!/bin/bash
+# Sends a sparse file bigger than 4 GB, with data at both ends, from one
+# IluvatarSon to another over TCP and through the message queue, and
+# checks that every copy is identical to the original.
+#
+# Usage: tests/sparse_4g.sh (from any directory, after make)
+#
+# Arda and three IluvatarSons are started in a temporary directory: A
+# sends the file to B, configured with local_transport=tcp so it goes
+# over TCP, and to C, configured with local_transport=queue so it goes
+# through the queue of C.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d /tmp/iluvatar_sparse_XXXXXX)
+PORT=$((20000 + $$ % 20000))
+SIZE=$((4 * 1024 * 1024 * 1024 + 12345))
+TIMEOUT=600
+PIDS=""
+FAILED=0
+
+cleanup() {
+	for pid in $PIDS; do
+		kill -INT "$pid" 2>/dev/null
+	done
+
+	sleep 1
+	exec 2>/dev/null
+
+	for pid in $PIDS; do
+		kill -9 "$pid" 2>/dev/null
+	done
+
+	rm -rf "$WORK"
+}
+
+# waits until a log has the given number of lines matching a pattern
+waitFor() {
+	local waited=0
+
+	while [ "$(grep -a -c "$2" "$1")" -lt "$3" ]; do
+		if [ $waited -ge $TIMEOUT ] || grep -a -q "ERROR" "$1"; then
+			return 1
+		fi
+
+		sleep 1
+		waited=$((waited + 1))
+	done
+
+	return 0
+}
+
+check() {
+	if cmp -s "$WORK/dirA/big.img" "$2"; then
+		echo "OK   $1"
+	else
+		echo "FAIL $1"
+		FAILED=1
+	fi
+}
+
+trap cleanup EXIT
+
+if [ ! -x "$ROOT/Arda" ] || [ ! -x "$ROOT/IluvatarSon" ]; then
+	echo "Build the binaries first (make)"
+	exit 1
+fi
+
+cd "$WORK" || exit 1
+mkdir ardadir dirA dirB dirC
+
+# the sparse file: random data at the beginning and at the end, a hole in between
+truncate -s $SIZE dirA/big.img
+head -c 1048576 /dev/urandom | dd of=dirA/big.img conv=notrunc status=none
+head -c 1048576 /dev/urandom | dd of=dirA/big.img oflag=seek_bytes seek=$((SIZE - 1048576)) conv=notrunc status=none
+
+printf "127.0.0.1\n%d\n/ardadir\n" $PORT > arda.cfg
+printf "A\n/dirA\n127.0.0.1\n%d\n127.0.0.1\n%d\n" $PORT $((PORT + 1)) > A.cfg
+printf "B\n/dirB\n127.0.0.1\n%d\n127.0.0.1\n%d\nlocal_transport=tcp\n" $PORT $((PORT + 2)) > B.cfg
+printf "C\n/dirC\n127.0.0.1\n%d\n127.0.0.1\n%d\nlocal_transport=queue\n" $PORT $((PORT + 3)) > C.cfg
+mkfifo inA inB inC
+exec 3<>inA 4<>inB 5<>inC
+
+"$ROOT/Arda" arda.cfg > arda.log 2>&1 &
+PIDS="$PIDS $!"
+sleep 0.5
+
+for son in A B C; do
+	"$ROOT/IluvatarSon" $son.cfg < in$son > $son.log 2>&1 &
+	PIDS="$PIDS $!"
+done
+
+sleep 1
+
+for fd in 3 4 5; do
+	echo "UPDATE USERS" >&$fd
+done
+
+sleep 1
+
+echo "SEND FILE B big.img" >&3
+
+if waitFor A.log "File correctly sent" 1; then
+	check "TCP" dirB/big.img
+else
+	echo "FAIL TCP (not sent)"
+	FAILED=1
+fi
+
+echo "SEND FILE C big.img" >&3
+
+if waitFor A.log "File correctly sent" 2; then
+	check "message queue" dirC/big.img
+else
+	echo "FAIL message queue (not sent)"
+	FAILED=1
+fi
+
+exit $FAILED
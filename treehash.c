@@ -0,0 +1,377 @@
+/*********************************************************************
+* @Purpose: Module with the content hash of big files: the file is
+*           split in leaves of TREEHASH_LEAF_SIZE bytes that are hashed
+*           in parallel, and the digests are joined in a Merkle tree
+*           (every node is the MD5 of its two children). A wrong copy
+*           can then be traced to the leaves that are different.
+* @Authors: Claudia Lajara Silvosa
+*           Angel Garcia Gascon
+* @Date: 19/10/2026
+* @Last change: 19/10/2026
+*********************************************************************/
+#include "treehash.h"
+
+/*********************************************************************
+* @Purpose: Thread of the pool that hashes leaves until there are no
+*           more left (every thread takes the next one not taken).
+* @Params: in/out: arg = LeafJob shared by the threads
+* @Return: ----
+*********************************************************************/
+void * hashLeaves(void *arg) {
+	LeafJob *job = (LeafJob *) arg;
+	char *buffer = (char *) malloc(sizeof(char) * TREEHASH_LEAF_SIZE);
+	long long offset = 0;
+	int i = 0, length = 0, n = 0, r = 0;
+
+	while (NULL != buffer) {
+	    pthread_mutex_lock(&job->mutex);
+		i = (job->error) ? job->tree->n_leaves : (job->next)++;
+		pthread_mutex_unlock(&job->mutex);
+
+		if (i >= job->tree->n_leaves) {
+		    break;
+		}
+
+		offset = (long long) i * TREEHASH_LEAF_SIZE;
+		length = (job->file_size - offset < TREEHASH_LEAF_SIZE) ? (int) (job->file_size - offset) : TREEHASH_LEAF_SIZE;
+
+		for (n = 0; n < length; n += r) {
+		    r = pread(job->fd, buffer + n, length - n, offset + n);
+
+			if (r <= 0) {
+			    break;
+			}
+		}
+
+		if (n < length) {
+		    pthread_mutex_lock(&job->mutex);
+			job->error = 1;
+			pthread_mutex_unlock(&job->mutex);
+			break;
+		}
+
+		MD5_buffer(buffer, length, job->tree->leaves + (long long) i * MD5_DIGEST_BYTES);
+	}
+
+	if (NULL == buffer) {
+	    pthread_mutex_lock(&job->mutex);
+		job->error = 1;
+		pthread_mutex_unlock(&job->mutex);
+	} else {
+	    free(buffer);
+		buffer = NULL;
+	}
+
+	return (NULL);
+}
+
+/*********************************************************************
+* @Purpose: Computes the digests of the leaves of a file (blocks of
+*           TREEHASH_LEAF_SIZE bytes) with a pool of threads, one per
+*           core, that read and hash different leaves at the same time.
+* @Params: out: tree = instance of TreeHash to store the leaves
+*          in: fd_file = open file descriptor of the file
+*          in: file_size = size in bytes of the file
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_compute(TreeHash *tree, int fd_file, long long file_size) {
+	pthread_t threads[TREEHASH_MAX_THREADS];
+	LeafJob job;
+	long n_threads = 0;
+	int i = 0, n_started = 0;
+
+	tree->n_leaves = (int) ((file_size + TREEHASH_LEAF_SIZE - 1) / TREEHASH_LEAF_SIZE);
+	tree->leaves = (unsigned char *) malloc(sizeof(unsigned char) * MD5_DIGEST_BYTES * (tree->n_leaves + 1));
+
+	if (NULL == tree->leaves) {
+	    tree->n_leaves = 0;
+		return (TREEHASH_KO);
+	}
+
+	job.tree = tree;
+	job.fd = fd_file;
+	job.file_size = file_size;
+	job.next = 0;
+	job.error = 0;
+	pthread_mutex_init(&job.mutex, NULL);
+
+	// one thread per core, and never more threads than leaves
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	n_threads = (n_threads > TREEHASH_MAX_THREADS) ? TREEHASH_MAX_THREADS : n_threads;
+	n_threads = (n_threads > tree->n_leaves) ? tree->n_leaves : n_threads;
+
+	// the current thread is also one of the pool
+	for (i = 1; i < n_threads; i++) {
+	    if (0 == pthread_create(&threads[n_started], NULL, hashLeaves, &job)) {
+		    n_started++;
+		}
+	}
+
+	hashLeaves(&job);
+
+	for (i = 0; i < n_started; i++) {
+	    pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&job.mutex);
+
+	if (job.error) {
+	    TREEHASH_free(tree);
+		return (TREEHASH_KO);
+	}
+
+	return (TREEHASH_OK);
+}
+
+/*********************************************************************
+* @Purpose: Gets the root of the Merkle tree of the leaves, as the
+*           string that identifies the content ('T' and 32 hex digits).
+* @Params: in: tree = computed instance of TreeHash
+* @Return: Returns the string of the root.
+*********************************************************************/
+char * TREEHASH_getRoot(TreeHash *tree) {
+	unsigned char *level = NULL;
+	char *digest = NULL;
+	char *root = NULL;
+	int n = tree->n_leaves, i = 0;
+
+	level = (unsigned char *) malloc(sizeof(unsigned char) * MD5_DIGEST_BYTES * (n + 1));
+
+	if (0 == n) {
+	    MD5_buffer("", 0, level);
+		n = 1;
+	} else {
+	    memcpy(level, tree->leaves, (size_t) MD5_DIGEST_BYTES * n);
+	}
+
+	// every level has half the nodes of the previous one (a node without pair goes up as is)
+	while (n > 1) {
+	    for (i = 0; i < n; i += 2) {
+		    if (i + 1 < n) {
+			    MD5_buffer(level + i * MD5_DIGEST_BYTES, 2 * MD5_DIGEST_BYTES, level + (i / 2) * MD5_DIGEST_BYTES);
+			} else {
+			    memmove(level + (i / 2) * MD5_DIGEST_BYTES, level + i * MD5_DIGEST_BYTES, MD5_DIGEST_BYTES);
+			}
+		}
+
+		n = (n + 1) / 2;
+	}
+
+	digest = MD5_toString(level);
+	asprintf(&root, "%c%s", TREEHASH_PREFIX, digest);
+	free(digest);
+	digest = NULL;
+	free(level);
+	level = NULL;
+
+	return (root);
+}
+
+/*********************************************************************
+* @Purpose: Checks if a content hash is the root of a Merkle tree (the
+*           other ones are the MD5SUM of the whole file).
+* @Params: in: hash = content hash
+* @Return: Returns 1 if it is a tree hash, otherwise 0.
+*********************************************************************/
+char TREEHASH_isTree(char *hash) {
+	return ((NULL != hash) && (TREEHASH_PREFIX == hash[0]));
+}
+
+/*********************************************************************
+* @Purpose: Gets the content hash of a file. Files of at least
+*           TREEHASH_MIN_FILE_SIZE bytes are hashed as a Merkle tree in
+*           parallel, smaller ones with the MD5SUM of the whole file.
+*           The hash to check a received file must be of the same kind
+*           as the one announced by the sender.
+* @Params: in: path = path of the file
+*          in: model = hash whose kind is used (NULL to choose it from
+*              the size of the file)
+*          in/out: mutex = screen mutex to report an error (NULL to
+*                  not report it)
+* @Return: Returns the content hash, or NULL if it could not be computed.
+*********************************************************************/
+char * TREEHASH_getFileHash(char *path, char *model, pthread_mutex_t *mutex) {
+	TreeHash tree;
+	struct stat st;
+	char *hash = NULL;
+	int fd_file = 0;
+
+	fd_file = open(path, O_RDONLY);
+
+	if ((0 <= fd_file) && (0 == fstat(fd_file, &st))) {
+	    if ((NULL != model) ? !TREEHASH_isTree(model) : (st.st_size < TREEHASH_MIN_FILE_SIZE)) {
+		    hash = MD5_file(path);
+		} else if (TREEHASH_OK == TREEHASH_compute(&tree, fd_file, st.st_size)) {
+		    hash = TREEHASH_getRoot(&tree);
+			TREEHASH_free(&tree);
+		}
+	}
+
+	if (0 <= fd_file) {
+	    close(fd_file);
+	}
+
+	if ((NULL == hash) && (NULL != mutex)) {
+	    pthread_mutex_lock(mutex);
+		printMsg(COLOR_RED_TXT);
+		printMsg("ERROR: The MD5SUM of the file could not be computed\n");
+		printMsg(COLOR_DEFAULT_TXT);
+		pthread_mutex_unlock(mutex);
+	}
+
+	return (hash);
+}
+
+/*********************************************************************
+* @Purpose: Sends the digests of the leaves (as many FILE_TREE frames
+*           as needed).
+* @Params: in: fd_socket = socket connected to the receiver
+*          in: tree = computed instance of TreeHash
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_sendLeaves(int fd_socket, TreeHash *tree) {
+	int i = 0, n = 0;
+
+	for (i = 0; i < tree->n_leaves; i += n) {
+	    n = (tree->n_leaves - i < TREEHASH_LEAVES_PER_FRAME) ? tree->n_leaves - i : TREEHASH_LEAVES_PER_FRAME;
+
+		if (GCP_WRITE_KO == GPC_writeFrame(fd_socket, GCP_SEND_FILE_TYPE, GCP_SEND_FILE_TREE_HEADER,
+		                                   (char *) tree->leaves + (long long) i * MD5_DIGEST_BYTES, n * MD5_DIGEST_BYTES)) {
+		    return (TREEHASH_KO);
+		}
+	}
+
+	return (TREEHASH_OK);
+}
+
+/*********************************************************************
+* @Purpose: Reads the digests of the leaves sent with
+*           TREEHASH_sendLeaves. Files of more than TREEHASH_MAX_LEAVES
+*           leaves are refused.
+* @Params: in: fd_socket = socket connected to the sender
+*          out: tree = instance of TreeHash to store the leaves
+*          in: file_size = size in bytes of the file
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_readLeaves(int fd_socket, TreeHash *tree, long long file_size) {
+	char *header = NULL;
+	char *data = NULL;
+	char type = GCP_UNKNOWN_TYPE;
+	unsigned short length = 0;
+	char error = TREEHASH_OK;
+	int i = 0;
+
+	tree->leaves = NULL;
+	tree->n_leaves = 0;
+
+	// the size comes from the sender, it must not decide how much memory is allocated
+	if ((0 > file_size) || (TREEHASH_MAX_LEAVES < (file_size + TREEHASH_LEAF_SIZE - 1) / TREEHASH_LEAF_SIZE)) {
+	    return (TREEHASH_KO);
+	}
+
+	tree->n_leaves = (int) ((file_size + TREEHASH_LEAF_SIZE - 1) / TREEHASH_LEAF_SIZE);
+	tree->leaves = (unsigned char *) malloc(sizeof(unsigned char) * MD5_DIGEST_BYTES * (tree->n_leaves + 1));
+
+	if (NULL == tree->leaves) {
+	    tree->n_leaves = 0;
+		return (TREEHASH_KO);
+	}
+
+	while ((TREEHASH_OK == error) && (i < tree->n_leaves)) {
+	    if ((GCP_READ_OK != GPC_readFrameWithLength(fd_socket, &type, &header, &data, &length)) || (NULL == header) ||
+		    (0 != strcmp(header, GCP_SEND_FILE_TREE_HEADER)) || (NULL == data) || (0 == length) || (0 != length % MD5_DIGEST_BYTES) ||
+			(i + length / MD5_DIGEST_BYTES > tree->n_leaves)) {
+		    error = TREEHASH_KO;
+		} else {
+		    memcpy(tree->leaves + (long long) i * MD5_DIGEST_BYTES, data, length);
+			i += length / MD5_DIGEST_BYTES;
+		}
+
+		if (NULL != header) {
+		    free(header);
+			header = NULL;
+		}
+
+		if (NULL != data) {
+		    free(data);
+			data = NULL;
+		}
+	}
+
+	if (TREEHASH_KO == error) {
+	    TREEHASH_free(tree);
+	}
+
+	return (error);
+}
+
+/*********************************************************************
+* @Purpose: Gets the byte ranges whose leaves are different in two
+*           trees of the same file (consecutive leaves are joined).
+* @Params: in: expected = leaves of the original file
+*          in: actual = leaves of the copy
+*          in: file_size = size in bytes of the file
+* @Return: Returns the ranges as "start-end,start-end" (cut to
+*          TREEHASH_MAX_RANGES_BYTES), or NULL if all the leaves match.
+*********************************************************************/
+char * TREEHASH_getBadRanges(TreeHash *expected, TreeHash *actual, long long file_size) {
+	char *ranges = NULL;
+	char *buffer = NULL;
+	long long end = 0;
+	int i = 0, j = 0;
+
+	if (expected->n_leaves != actual->n_leaves) {
+	    asprintf(&ranges, "0-%lld", file_size - 1);
+		return (ranges);
+	}
+
+	while (i < expected->n_leaves) {
+	    if (0 == memcmp(expected->leaves + (long long) i * MD5_DIGEST_BYTES, actual->leaves + (long long) i * MD5_DIGEST_BYTES, MD5_DIGEST_BYTES)) {
+		    i++;
+			continue;
+		}
+
+		// join the following wrong leaves
+		for (j = i + 1; (j < expected->n_leaves) &&
+		     (0 != memcmp(expected->leaves + (long long) j * MD5_DIGEST_BYTES, actual->leaves + (long long) j * MD5_DIGEST_BYTES, MD5_DIGEST_BYTES)); j++);
+
+		end = (long long) j * TREEHASH_LEAF_SIZE;
+		end = (end > file_size) ? file_size : end;
+
+		asprintf(&buffer, "%s%s%lld-%lld", (NULL == ranges) ? "" : ranges, (NULL == ranges) ? "" : ",", (long long) i * TREEHASH_LEAF_SIZE, end - 1);
+
+		if (NULL != ranges) {
+		    free(ranges);
+		}
+
+		ranges = buffer;
+		buffer = NULL;
+
+		// the list is cut so it fits in a frame
+		if ((j < expected->n_leaves) && (strlen(ranges) > TREEHASH_MAX_RANGES_BYTES)) {
+		    asprintf(&buffer, "%s,...", ranges);
+			free(ranges);
+			ranges = buffer;
+			buffer = NULL;
+			break;
+		}
+
+		i = j;
+	}
+
+	return (ranges);
+}
+
+/*********************************************************************
+* @Purpose: Frees the memory of a TreeHash.
+* @Params: in/out: tree = instance of TreeHash
+* @Return: ----
+*********************************************************************/
+void TREEHASH_free(TreeHash *tree) {
+	if (NULL != tree->leaves) {
+	    free(tree->leaves);
+		tree->leaves = NULL;
+	}
+
+	tree->n_leaves = 0;
+}
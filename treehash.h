@@ -0,0 +1,122 @@
+#ifndef _TREEHASH_H_
+#define _TREEHASH_H_
+
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "sharedFunctions.h"
+#include "gpc.h"
+#include "md5.h"
+
+/* Constants */
+#define TREEHASH_LEAF_SIZE			(4 * 1024 * 1024)
+#define TREEHASH_MIN_FILE_SIZE		(64LL * 1024 * 1024)
+#define TREEHASH_MAX_THREADS		16
+#define TREEHASH_PREFIX				'T'
+#define TREEHASH_LEAVES_PER_FRAME	(GPC_FILE_MAX_BYTES / MD5_DIGEST_BYTES)
+#define TREEHASH_MAX_LEAVES			(4 * 1024 * 1024)
+#define TREEHASH_MAX_RANGES_BYTES	1024
+#define TREEHASH_OK					0
+#define TREEHASH_KO					1
+
+typedef struct {
+	unsigned char *leaves;
+	int n_leaves;
+} TreeHash;
+
+typedef struct {
+	TreeHash *tree;
+	int fd;
+	long long file_size;
+	int next;
+	char error;
+	pthread_mutex_t mutex;
+} LeafJob;
+
+/*********************************************************************
+* @Purpose: Computes the digests of the leaves of a file (blocks of
+*           TREEHASH_LEAF_SIZE bytes) with a pool of threads, one per
+*           core, that read and hash different leaves at the same time.
+* @Params: out: tree = instance of TreeHash to store the leaves
+*          in: fd_file = open file descriptor of the file
+*          in: file_size = size in bytes of the file
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_compute(TreeHash *tree, int fd_file, long long file_size);
+
+/*********************************************************************
+* @Purpose: Gets the root of the Merkle tree of the leaves, as the
+*           string that identifies the content ('T' and 32 hex digits).
+* @Params: in: tree = computed instance of TreeHash
+* @Return: Returns the string of the root.
+*********************************************************************/
+char * TREEHASH_getRoot(TreeHash *tree);
+
+/*********************************************************************
+* @Purpose: Checks if a content hash is the root of a Merkle tree (the
+*           other ones are the MD5SUM of the whole file).
+* @Params: in: hash = content hash
+* @Return: Returns 1 if it is a tree hash, otherwise 0.
+*********************************************************************/
+char TREEHASH_isTree(char *hash);
+
+/*********************************************************************
+* @Purpose: Gets the content hash of a file. Files of at least
+*           TREEHASH_MIN_FILE_SIZE bytes are hashed as a Merkle tree in
+*           parallel, smaller ones with the MD5SUM of the whole file.
+*           The hash to check a received file must be of the same kind
+*           as the one announced by the sender.
+* @Params: in: path = path of the file
+*          in: model = hash whose kind is used (NULL to choose it from
+*              the size of the file)
+*          in/out: mutex = screen mutex to report an error (NULL to
+*                  not report it)
+* @Return: Returns the content hash, or NULL if it could not be computed.
+*********************************************************************/
+char * TREEHASH_getFileHash(char *path, char *model, pthread_mutex_t *mutex);
+
+/*********************************************************************
+* @Purpose: Sends the digests of the leaves (as many FILE_TREE frames
+*           as needed).
+* @Params: in: fd_socket = socket connected to the receiver
+*          in: tree = computed instance of TreeHash
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_sendLeaves(int fd_socket, TreeHash *tree);
+
+/*********************************************************************
+* @Purpose: Reads the digests of the leaves sent with
+*           TREEHASH_sendLeaves. Files of more than TREEHASH_MAX_LEAVES
+*           leaves are refused.
+* @Params: in: fd_socket = socket connected to the sender
+*          out: tree = instance of TreeHash to store the leaves
+*          in: file_size = size in bytes of the file
+* @Return: Returns TREEHASH_OK if no errors, otherwise TREEHASH_KO.
+*********************************************************************/
+char TREEHASH_readLeaves(int fd_socket, TreeHash *tree, long long file_size);
+
+/*********************************************************************
+* @Purpose: Gets the byte ranges whose leaves are different in two
+*           trees of the same file (consecutive leaves are joined).
+* @Params: in: expected = leaves of the original file
+*          in: actual = leaves of the copy
+*          in: file_size = size in bytes of the file
+* @Return: Returns the ranges as "start-end,start-end" (cut to
+*          TREEHASH_MAX_RANGES_BYTES), or NULL if all the leaves match.
+*********************************************************************/
+char * TREEHASH_getBadRanges(TreeHash *expected, TreeHash *actual, long long file_size);
+
+/*********************************************************************
+* @Purpose: Frees the memory of a TreeHash.
+* @Params: in/out: tree = instance of TreeHash
+* @Return: ----
+*********************************************************************/
+void TREEHASH_free(TreeHash *tree);
+
+#endif